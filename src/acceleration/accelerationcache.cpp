@@ -0,0 +1,191 @@
+#include "acceleration/accelerationcache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "acceleration/bruteforce.h"
+#include "acceleration/bvh.h"
+#include "acceleration/grid.h"
+#include "acceleration/lazyprimitive.h"
+#include "core/mappedfile.h"
+
+using namespace tracer;
+
+namespace
+{
+
+const char MAGIC[8] = { 'T', 'R', 'A', 'C', 'C', 'E', 'L', '\0' };
+const uint32_t VERSION = 1;
+
+/*!
+ * Hlavička souboru, data struktury začínají hned za ní.
+ */
+struct Header
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t padding;
+    uint64_t key;
+    uint64_t nPrimitives;
+    uint64_t dataSize;
+    char type[16];
+    uint64_t reserved;
+};
+
+/*!
+ * Přidá 32bitové slovo do haše (FNV-1a po slovech se závěrečným
+ * promícháním v AccelerationCache::key()).
+ */
+inline uint64_t hashWord(uint64_t h, uint32_t word)
+{
+    return (h ^ word) * 0x100000001B3ull;
+}
+
+inline uint64_t hashReal(uint64_t h, Real r)
+{
+    uint32_t word;
+    memcpy(&word, &r, sizeof(word));
+    return hashWord(h, word);
+}
+
+}
+
+AccelerationCache::AccelerationCache(const std::string& directory)
+    : directory(directory)
+{ }
+
+uint64_t AccelerationCache::key(const std::string& type, const std::vector<Reference<Primitive>>& prims)
+{
+    uint64_t h = 0xCBF29CE484222325ull;
+    for (size_t i = 0; i < type.size(); ++i)
+        h = hashWord(h, static_cast<unsigned char>(type[i]));
+    h = hashWord(h, VERSION);
+    h = hashWord(h, static_cast<uint32_t>(prims.size()));
+    h = hashWord(h, static_cast<uint32_t>(static_cast<uint64_t>(prims.size()) >> 32));
+
+    for (size_t i = 0; i < prims.size(); ++i)
+    {
+        Reference<Primitive> p(prims[i]);
+        BBox b = p->bounds();
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            h = hashReal(h, b.pMin[axis]);
+            h = hashReal(h, b.pMax[axis]);
+        }
+    }
+
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDull;
+    h ^= h >> 33;
+    return h;
+}
+
+AccelerationStructure* AccelerationCache::create(const std::string& type, std::vector<Reference<Primitive>>& p,
+                                                 bool* loaded) const
+{
+    if (loaded)
+        *loaded = false;
+
+    if (type != "bvh" && type != "grid")
+    {
+        if (type == "bruteforce")
+            return new BruteForce(p);
+        throw std::runtime_error("Unknown acceleration structure " + type);
+    }
+
+    std::vector<Reference<Primitive>> prims;
+    for (size_t i = 0; i < p.size(); ++i)
+        LazyPrimitive::expand(p[i], prims);
+
+    const uint64_t k = key(type, prims);
+    char name[32];
+    snprintf(name, sizeof(name), "-%016llx.accel", static_cast<unsigned long long>(k));
+    const std::string path = directory + type + name;
+
+    AccelerationStructure* a = load(path, type, k, prims);
+    if (a)
+    {
+        if (loaded)
+            *loaded = true;
+        return a;
+    }
+
+    if (type == "bvh")
+        a = new BVH(prims);
+    else
+        a = new Grid(prims);
+
+    try
+    {
+        save(path, type, k, prims, *a);
+    }
+    catch (const std::runtime_error&)
+    {
+        // Uložení jen zrychluje další stavbu, struktura už je postavená.
+    }
+    return a;
+}
+
+AccelerationStructure* AccelerationCache::load(const std::string& path, const std::string& type, uint64_t key,
+                                               const std::vector<Reference<Primitive>>& prims) const
+{
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(Header))
+        return nullptr;
+
+    Reference<MappedFile> file(new MappedFile(path.c_str()));
+    Header h;
+    memcpy(&h, file->data(), sizeof(h));
+    if (memcmp(h.magic, MAGIC, sizeof(MAGIC)) != 0 || h.version != VERSION || h.key != key ||
+        h.nPrimitives != prims.size() || strncmp(h.type, type.c_str(), sizeof(h.type)) != 0 ||
+        h.dataSize != file->size() - sizeof(Header))
+        return nullptr;
+
+    const char* data = file->data() + sizeof(Header);
+    if (type == "bvh")
+        return BVH::deserialize(data, h.dataSize, prims);
+    return Grid::deserialize(data, h.dataSize, prims);
+}
+
+void AccelerationCache::save(const std::string& path, const std::string& type, uint64_t key,
+                             const std::vector<Reference<Primitive>>& prims, const AccelerationStructure& a) const
+{
+    std::unordered_map<const Primitive*, uint32_t> indices;
+    indices.reserve(prims.size());
+    for (size_t i = 0; i < prims.size(); ++i)
+    {
+        Reference<Primitive> p(prims[i]);
+        indices[&*p] = static_cast<uint32_t>(i);
+    }
+
+    std::vector<char> data;
+    if (!a.serialize(indices, data))
+        throw std::runtime_error("Acceleration structure cannot be serialized");
+
+    Header h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, MAGIC, sizeof(MAGIC));
+    h.version = VERSION;
+    h.key = key;
+    h.nPrimitives = prims.size();
+    h.dataSize = data.size();
+    strncpy(h.type, type.c_str(), sizeof(h.type) - 1);
+
+    const std::string tmp = path + ".tmp" + std::to_string(getpid());
+    FILE* f = fopen(tmp.c_str(), "wb");
+    if (!f)
+        throw std::runtime_error("Cannot create " + tmp);
+
+    bool ok = fwrite(&h, sizeof(h), 1, f) == 1 &&
+              (data.empty() || fwrite(data.data(), data.size(), 1, f) == 1);
+    ok = (fclose(f) == 0) && ok;
+    if (!ok || rename(tmp.c_str(), path.c_str()) != 0)
+    {
+        remove(tmp.c_str());
+        throw std::runtime_error("Cannot write " + path);
+    }
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "core/primitive.h"
+
+namespace tracer
+{
+
+/*!
+ * Vytváří akcelerační struktury a ukládá je do souborů, aby se nad stejnými
+ * tělesy nemusely stavět znovu. Soubor je pojmenován podle typu struktury
+ * a klíče, což je haš obalových kvádrů rozložených těles v pořadí, v jakém
+ * je struktura dostala. Stavba BVH i mřížky závisí jen na nich, uložená
+ * struktura tedy odpovídá nové stavbě. Pokud se tělesa změní, změní se
+ * i klíč a struktura se postaví znovu (starý soubor zůstane).
+ *
+ * Soubor má hlavičku s verzí, klíčem a počtem těles, za ní následují data
+ * z AccelerationStructure::serialize(). Načítá se namapováním do paměti,
+ * uzly se z něj zkopírují jedním blokem.
+ */
+class AccelerationCache
+{
+public:
+    /*!
+     * Konstruktor.
+     * \param directory adresář pro soubory struktur (prázdný pro aktuální
+     *                  adresář, jinak zakončený lomítkem)
+     */
+    AccelerationCache(const std::string& directory);
+
+    /*!
+     * Vytvoří akcelerační strukturu. Pokud existuje uložená struktura se
+     * stejným klíčem, načte ji, jinak ji postaví a uloží. Chyba při ukládání
+     * se ignoruje. Pro neznámý typ vyhodí výjimku std::runtime_error.
+     * \param type typ struktury (bvh, grid, bruteforce)
+     * \param p tělesa, nad nerozloženými se provede Primitive::refine()
+     * \param loaded pokud není nullptr, vrátí se přes něj, jestli se struktura načetla
+     * \return nová struktura
+     */
+    AccelerationStructure* create(const std::string& type, std::vector<Reference<Primitive>>& p,
+                                  bool* loaded = nullptr) const;
+
+    /*!
+     * Spočítá klíč struktury.
+     * \param type typ struktury
+     * \param prims rozložená tělesa
+     */
+    static uint64_t key(const std::string& type, const std::vector<Reference<Primitive>>& prims);
+
+private:
+    /*!
+     * Načte strukturu ze souboru.
+     * \return struktura nebo nullptr, pokud soubor neexistuje nebo neodpovídá
+     */
+    AccelerationStructure* load(const std::string& path, const std::string& type, uint64_t key,
+                                const std::vector<Reference<Primitive>>& prims) const;
+
+    /*!
+     * Uloží strukturu do souboru. Při chybě vyhodí výjimku std::runtime_error.
+     */
+    void save(const std::string& path, const std::string& type, uint64_t key,
+              const std::vector<Reference<Primitive>>& prims, const AccelerationStructure& a) const;
+
+    std::string directory; ///< Adresář souborů.
+};
+
+}
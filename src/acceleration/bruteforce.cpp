@@ -1,24 +1,60 @@
 #include "bruteforce.h"
 
+#include <unordered_set>
+
+#include "acceleration/lazyprimitive.h"
+
 using namespace tracer;
 
+BruteForce::BruteForce(std::vector<Reference<Primitive>>& p)
+{
+    rebuild(p);
+}
+
+BruteForce::~BruteForce()
+{ }
+
 /*!
  * Nad každým tělesem zkusí provést Primitive::Refine() tak,
  * aby bylo možné s každým tělesem provést výpočet průsečíku.
+ * Tělesa s odloženým rozložením se jen obalí (LazyPrimitive).
  */
-BruteForce::BruteForce(std::vector<Reference<Primitive>>& p)
+void BruteForce::rebuild(std::vector<Reference<Primitive>>& p)
 {
+    primitives.clear();
     for (size_t i = 0; i < p.size(); ++i)
-    {
-        if (!p[i]->canIntersect())
-            p[i]->refine(primitives);
-        else
-            primitives.push_back(p[i]);
-    }
+        LazyPrimitive::expand(p[i], primitives);
 }
 
-BruteForce::~BruteForce()
-{ }
+bool BruteForce::insert(std::vector<Reference<Primitive>>& prims, UpdateReport& report)
+{
+    primitives.insert(primitives.end(), prims.begin(), prims.end());
+    report.inserted += prims.size();
+    return true;
+}
+
+bool BruteForce::remove(std::vector<Reference<Primitive>>& prims, UpdateReport& report)
+{
+    std::unordered_set<const Primitive*> removed;
+    for (size_t i = 0; i < prims.size(); ++i)
+        removed.insert(&*prims[i]);
+
+    size_t kept = 0;
+    for (size_t i = 0; i < primitives.size(); ++i)
+        if (!removed.count(&*primitives[i]))
+            primitives[kept++] = primitives[i];
+    report.removed += primitives.size() - kept;
+    primitives.resize(kept);
+
+    return true;
+}
+
+bool BruteForce::refit(std::vector<Reference<Primitive>>& prims,
+                       const std::vector<BBox>& oldBounds, UpdateReport& report)
+{
+    report.refitted += prims.size();
+    return true;
+}
 
 bool BruteForce::intersectP(const Ray& ray)
 {
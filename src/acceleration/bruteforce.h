@@ -30,6 +30,19 @@ public:
     /*! Vypočítá obalovou krychli kolem všech svých těles. */
     virtual BBox bounds() const override;
 
+    /*! \copydoc AccelerationStructure::insert() */
+    virtual bool insert(std::vector<Reference<Primitive>>& prims, UpdateReport& report) override;
+
+    /*! \copydoc AccelerationStructure::remove() */
+    virtual bool remove(std::vector<Reference<Primitive>>& prims, UpdateReport& report) override;
+
+    /*! Struktura nemá žádné buňky, změna polohy těles se neprojeví. */
+    virtual bool refit(std::vector<Reference<Primitive>>& prims,
+                       const std::vector<BBox>& oldBounds, UpdateReport& report) override;
+
+    /*! \copydoc AccelerationStructure::rebuild() */
+    virtual void rebuild(std::vector<Reference<Primitive>>& p) override;
+
 private:
     /*!
 	 * std::vector obsahující tělesa.
@@ -0,0 +1,513 @@
+#include "acceleration/bvh.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "acceleration/lazyprimitive.h"
+#include "core/parallel.h"
+
+using namespace tracer;
+
+namespace
+{
+
+/// Počet přihrádek pro vyhodnocení SAH.
+const int SAH_BUCKETS = 12;
+
+/// Cena průchodu vnitřním uzlem vzhledem k ceně průsečíku s tělesem.
+const Real TRAVERSAL_COST = 0.125f;
+
+/// Maximální hloubka zásobníku při průchodu stromem.
+const int MAX_TODO = 64;
+
+Real surfaceArea(const BBox& b)
+{
+    Vector d = b.diagonal();
+    if (d.x < 0.f || d.y < 0.f || d.z < 0.f)
+        return 0.f;
+    return 2.f * (d.x * d.y + d.x * d.z + d.y * d.z);
+}
+
+/*!
+ * Test paprsku s obalovým kvádrem uzlu s předpočítanými převrácenými
+ * hodnotami směru. Průsečík dál než ray.maxt (už nalezený bližší průsečík)
+ * se nepočítá.
+ */
+inline bool hitBox(const BBox& b, const Ray& ray, const Vector& invDir, const int dirIsNeg[3])
+{
+    Real tMin = ((dirIsNeg[0] ? b.pMax : b.pMin).x - ray.o.x) * invDir.x;
+    Real tMax = ((dirIsNeg[0] ? b.pMin : b.pMax).x - ray.o.x) * invDir.x;
+    Real tyMin = ((dirIsNeg[1] ? b.pMax : b.pMin).y - ray.o.y) * invDir.y;
+    Real tyMax = ((dirIsNeg[1] ? b.pMin : b.pMax).y - ray.o.y) * invDir.y;
+    if (tMin > tyMax || tyMin > tMax)
+        return false;
+    if (tyMin > tMin) tMin = tyMin;
+    if (tyMax < tMax) tMax = tyMax;
+
+    Real tzMin = ((dirIsNeg[2] ? b.pMax : b.pMin).z - ray.o.z) * invDir.z;
+    Real tzMax = ((dirIsNeg[2] ? b.pMin : b.pMax).z - ray.o.z) * invDir.z;
+    if (tMin > tzMax || tzMin > tMax)
+        return false;
+    if (tzMin > tMin) tMin = tzMin;
+    if (tzMax < tMax) tMax = tzMax;
+
+    return tMin < ray.maxt && tMax > ray.mint;
+}
+
+/*!
+ * Hlavička dat z BVH::serialize(), za ní následují uzly a indexy těles.
+ */
+struct SerializedBVH
+{
+    uint64_t nNodes;
+    uint64_t nPrimitives;
+};
+
+}
+
+BVH::BVH(std::vector<Reference<Primitive>>& p, int maxPrimsInNode, Real rebuildThreshold)
+    : maxPrimsInNode(clamp(maxPrimsInNode, 1, 255)),
+      rebuildThreshold(rebuildThreshold),
+      builtCost(0.f),
+      currentCost(0.f)
+{
+    int tasks = 4 * numSystemCores();
+    subtreeDepth = 0;
+    while ((1 << subtreeDepth) < tasks)
+        ++subtreeDepth;
+
+    rebuild(p);
+}
+
+BVH::BVH(const BVHNode* n, size_t nNodes, std::vector<Reference<Primitive>>& ordered,
+         int maxPrimsInNode, Real rebuildThreshold)
+    : nodes(n, n + nNodes),
+      maxPrimsInNode(clamp(maxPrimsInNode, 1, 255)),
+      rebuildThreshold(rebuildThreshold),
+      builtCost(0.f),
+      currentCost(0.f)
+{
+    int tasks = 4 * numSystemCores();
+    subtreeDepth = 0;
+    while ((1 << subtreeDepth) < tasks)
+        ++subtreeDepth;
+
+    primitives.swap(ordered);
+    if (nodes.empty())
+        return;
+
+    findSubtrees(0, 0);
+    builtCost = currentCost = treeCost();
+}
+
+BVH::~BVH()
+{ }
+
+void BVH::rebuild(std::vector<Reference<Primitive>>& p)
+{
+    primitives.clear();
+    for (size_t i = 0; i < p.size(); ++i)
+        LazyPrimitive::expand(p[i], primitives);
+
+    build();
+}
+
+void BVH::build()
+{
+    nodes.clear();
+    subtrees.clear();
+    topNodes.clear();
+    builtCost = currentCost = 0.f;
+    if (primitives.empty())
+        return;
+
+    std::vector<BuildPrimitive> build(primitives.size());
+    for (size_t i = 0; i < primitives.size(); ++i)
+    {
+        build[i].bounds = primitives[i]->bounds();
+        build[i].centroid = build[i].bounds.centroid();
+        build[i].index = static_cast<uint32_t>(i);
+    }
+
+    std::vector<Reference<Primitive>> ordered;
+    ordered.reserve(primitives.size());
+    nodes.reserve(2 * primitives.size());
+    buildRecursive(build, 0, static_cast<uint32_t>(build.size()), ordered);
+    primitives.swap(ordered);
+
+    findSubtrees(0, 0);
+    builtCost = currentCost = treeCost();
+}
+
+Real BVH::treeCost() const
+{
+    Real sum = 0.f;
+    for (size_t i = 0; i < nodes.size(); ++i)
+        sum += nodeCost(nodes[i]);
+    Real rootArea = surfaceArea(nodes[0].bounds);
+    return (rootArea > 0.f) ? sum / rootArea : 0.f;
+}
+
+/*!
+ * Konec podstromu leží za jeho nejpravějším listem, ke kterému se dojde
+ * po druhých potomcích.
+ */
+uint32_t BVH::findSubtrees(uint32_t nodeIndex, int depth)
+{
+    if (nodes[nodeIndex].nPrimitives || depth == subtreeDepth)
+    {
+        uint32_t last = nodeIndex;
+        while (!nodes[last].nPrimitives)
+            last = nodes[last].offset;
+
+        subtrees.push_back(nodeIndex);
+        subtrees.push_back(last + 1);
+        return last + 1;
+    }
+
+    topNodes.push_back(nodeIndex);
+    findSubtrees(nodeIndex + 1, depth + 1);
+    return findSubtrees(nodes[nodeIndex].offset, depth + 1);
+}
+
+/*!
+ * Osa dělení je osa s největším rozsahem těžišť. Pro každou z SAH_BUCKETS - 1
+ * hranic mezi přihrádkami se spočítá cena rozdělení a vybere se nejlevnější.
+ * List vznikne, pokud je dostatečně malý a levnější než nejlepší rozdělení.
+ */
+uint32_t BVH::buildRecursive(std::vector<BuildPrimitive>& build, uint32_t start, uint32_t end,
+                             std::vector<Reference<Primitive>>& ordered)
+{
+    const uint32_t nodeIndex = static_cast<uint32_t>(nodes.size());
+    nodes.push_back(BVHNode());
+
+    BBox bounds, centroidBounds;
+    for (uint32_t i = start; i < end; ++i)
+    {
+        bounds = unite(bounds, build[i].bounds);
+        centroidBounds = unite(centroidBounds, build[i].centroid);
+    }
+    nodes[nodeIndex].bounds = bounds;
+
+    const uint32_t n = end - start;
+    const int axis = centroidBounds.maxDimensionIndex();
+    const Real cMin = centroidBounds.pMin[axis];
+    const Real cMax = centroidBounds.pMax[axis];
+
+    uint32_t mid = start;
+    bool leaf = (n == 1 || cMax == cMin);
+    if (leaf && n > 0xFFFF)
+    {
+        // Těžiště splývají, ale těles je moc na jeden list.
+        leaf = false;
+        mid = start + n / 2;
+    }
+    else if (!leaf)
+    {
+        struct Bucket
+        {
+            uint32_t count = 0;
+            BBox bounds;
+        } buckets[SAH_BUCKETS];
+
+        const Real scale = SAH_BUCKETS / (cMax - cMin);
+        for (uint32_t i = start; i < end; ++i)
+        {
+            int b = min(static_cast<int>((build[i].centroid[axis] - cMin) * scale), SAH_BUCKETS - 1);
+            ++buckets[b].count;
+            buckets[b].bounds = unite(buckets[b].bounds, build[i].bounds);
+        }
+
+        Real splitCost[SAH_BUCKETS - 1];
+        BBox below;
+        uint32_t countBelow = 0;
+        for (int b = 0; b < SAH_BUCKETS - 1; ++b)
+        {
+            below = unite(below, buckets[b].bounds);
+            countBelow += buckets[b].count;
+            splitCost[b] = countBelow * surfaceArea(below);
+        }
+
+        BBox above;
+        uint32_t countAbove = 0;
+        for (int b = SAH_BUCKETS - 1; b > 0; --b)
+        {
+            above = unite(above, buckets[b].bounds);
+            countAbove += buckets[b].count;
+            splitCost[b - 1] += countAbove * surfaceArea(above);
+        }
+
+        int bestBucket = 0;
+        for (int b = 1; b < SAH_BUCKETS - 1; ++b)
+            if (splitCost[b] < splitCost[bestBucket])
+                bestBucket = b;
+
+        const Real area = surfaceArea(bounds);
+        const Real bestCost = TRAVERSAL_COST + (area > 0.f ? splitCost[bestBucket] / area : 0.f);
+        if (n > static_cast<uint32_t>(maxPrimsInNode) || bestCost < static_cast<Real>(n))
+        {
+            BuildPrimitive* pmid = std::partition(&build[start], &build[end - 1] + 1,
+                [=](const BuildPrimitive& bp)
+                {
+                    int b = min(static_cast<int>((bp.centroid[axis] - cMin) * scale), SAH_BUCKETS - 1);
+                    return b <= bestBucket;
+                });
+            mid = static_cast<uint32_t>(pmid - &build[0]);
+            if (mid == start || mid == end)
+            {
+                mid = start + n / 2;
+                std::nth_element(&build[start], &build[mid], &build[end - 1] + 1,
+                    [=](const BuildPrimitive& a, const BuildPrimitive& b)
+                    { return a.centroid[axis] < b.centroid[axis]; });
+            }
+        }
+        else
+        {
+            leaf = true;
+        }
+    }
+
+    if (leaf)
+    {
+        nodes[nodeIndex].offset = static_cast<uint32_t>(ordered.size());
+        nodes[nodeIndex].nPrimitives = static_cast<uint16_t>(n);
+        nodes[nodeIndex].axis = 0;
+        for (uint32_t i = start; i < end; ++i)
+            ordered.push_back(primitives[build[i].index]);
+        return nodeIndex;
+    }
+
+    nodes[nodeIndex].nPrimitives = 0;
+    nodes[nodeIndex].axis = static_cast<uint8_t>(axis);
+    buildRecursive(build, start, mid, ordered);
+    nodes[nodeIndex].offset = buildRecursive(build, mid, end, ordered);
+    return nodeIndex;
+}
+
+Real BVH::nodeCost(const BVHNode& node)
+{
+    Real area = surfaceArea(node.bounds);
+    return node.nPrimitives ? area * node.nPrimitives : area * TRAVERSAL_COST;
+}
+
+Real BVH::refitRange(uint32_t start, uint32_t end)
+{
+    Real sum = 0.f;
+    for (uint32_t i = end; i-- > start;)
+    {
+        BVHNode& node = nodes[i];
+        if (node.nPrimitives)
+        {
+            BBox b;
+            for (uint32_t j = 0; j < node.nPrimitives; ++j)
+                b = unite(b, primitives[node.offset + j]->bounds());
+            node.bounds = b;
+        }
+        else
+        {
+            node.bounds = unite(nodes[i + 1].bounds, nodes[node.offset].bounds);
+        }
+        sum += nodeCost(node);
+    }
+    return sum;
+}
+
+bool BVH::refit(std::vector<Reference<Primitive>>& prims,
+                const std::vector<BBox>& oldBounds, UpdateReport& report)
+{
+    return refitAll(report);
+}
+
+/*!
+ * Podstromy tvoří souvislé úseky pole uzlů, takže je lze přepočítat
+ * nezávisle na sobě. Uzly nad nimi se pak přepočítají sekvenčně.
+ */
+bool BVH::refitAll(UpdateReport& report)
+{
+    if (nodes.empty())
+        return true;
+
+    const size_t count = subtrees.size() / 2;
+    std::vector<Real> partial(count);
+    parallelFor(count, [&](size_t i)
+    {
+        partial[i] = refitRange(subtrees[2 * i], subtrees[2 * i + 1]);
+    });
+
+    Real sum = 0.f;
+    for (size_t i = 0; i < count; ++i)
+        sum += partial[i];
+
+    for (size_t i = topNodes.size(); i-- > 0;)
+    {
+        BVHNode& node = nodes[topNodes[i]];
+        node.bounds = unite(nodes[topNodes[i] + 1].bounds, nodes[node.offset].bounds);
+        sum += nodeCost(node);
+    }
+
+    Real rootArea = surfaceArea(nodes[0].bounds);
+    currentCost = (rootArea > 0.f) ? sum / rootArea : 0.f;
+    report.refitted += primitives.size();
+    report.cells += nodes.size();
+
+    if (currentCost > builtCost * rebuildThreshold)
+    {
+        build();
+        report.rebuilt = true;
+    }
+
+    return true;
+}
+
+bool BVH::intersect(const Ray& ray, Intersection& sr)
+{
+    if (nodes.empty())
+        return false;
+
+    Vector invDir(1.f / ray.d.x, 1.f / ray.d.y, 1.f / ray.d.z);
+    int dirIsNeg[3] = { invDir.x < 0.f, invDir.y < 0.f, invDir.z < 0.f };
+
+    uint32_t todo[MAX_TODO];
+    int todoOffset = 0;
+    uint32_t current = 0;
+    bool hit = false;
+    while (true)
+    {
+        const BVHNode& node = nodes[current];
+        if (hitBox(node.bounds, ray, invDir, dirIsNeg))
+        {
+            if (node.nPrimitives)
+            {
+                for (uint32_t i = 0; i < node.nPrimitives; ++i)
+                    hit |= primitives[node.offset + i]->intersect(ray, sr);
+            }
+            else if (dirIsNeg[node.axis])
+            {
+                todo[todoOffset++] = current + 1;
+                current = node.offset;
+                continue;
+            }
+            else
+            {
+                todo[todoOffset++] = node.offset;
+                current = current + 1;
+                continue;
+            }
+        }
+
+        if (todoOffset == 0)
+            break;
+        current = todo[--todoOffset];
+    }
+
+    return hit;
+}
+
+bool BVH::intersectP(const Ray& ray)
+{
+    if (nodes.empty())
+        return false;
+
+    Vector invDir(1.f / ray.d.x, 1.f / ray.d.y, 1.f / ray.d.z);
+    int dirIsNeg[3] = { invDir.x < 0.f, invDir.y < 0.f, invDir.z < 0.f };
+
+    uint32_t todo[MAX_TODO];
+    int todoOffset = 0;
+    uint32_t current = 0;
+    while (true)
+    {
+        const BVHNode& node = nodes[current];
+        if (hitBox(node.bounds, ray, invDir, dirIsNeg))
+        {
+            if (node.nPrimitives)
+            {
+                for (uint32_t i = 0; i < node.nPrimitives; ++i)
+                    if (primitives[node.offset + i]->intersectP(ray))
+                        return true;
+            }
+            else
+            {
+                todo[todoOffset++] = node.offset;
+                current = current + 1;
+                continue;
+            }
+        }
+
+        if (todoOffset == 0)
+            break;
+        current = todo[--todoOffset];
+    }
+
+    return false;
+}
+
+bool BVH::serialize(const std::unordered_map<const Primitive*, uint32_t>& indices,
+                    std::vector<char>& data) const
+{
+    if (nodes.empty())
+        return false;
+
+    SerializedBVH header;
+    header.nNodes = nodes.size();
+    header.nPrimitives = primitives.size();
+
+    std::vector<uint32_t> order(primitives.size());
+    for (size_t i = 0; i < primitives.size(); ++i)
+    {
+        Reference<Primitive> p(primitives[i]);
+        std::unordered_map<const Primitive*, uint32_t>::const_iterator it = indices.find(&*p);
+        if (it == indices.end())
+            return false;
+        order[i] = it->second;
+    }
+
+    const size_t nodeBytes = nodes.size() * sizeof(BVHNode);
+    data.resize(sizeof(header) + nodeBytes + order.size() * sizeof(uint32_t));
+    memcpy(&data[0], &header, sizeof(header));
+    memcpy(&data[sizeof(header)], nodes.data(), nodeBytes);
+    memcpy(&data[sizeof(header) + nodeBytes], order.data(), order.size() * sizeof(uint32_t));
+    return true;
+}
+
+BVH* BVH::deserialize(const char* data, size_t size, const std::vector<Reference<Primitive>>& prims)
+{
+    SerializedBVH header;
+    if (size < sizeof(header))
+        return nullptr;
+    memcpy(&header, data, sizeof(header));
+    if (header.nNodes == 0 || header.nNodes > 0xFFFFFFFFu || header.nPrimitives > prims.size() ||
+        size != sizeof(header) + header.nNodes * sizeof(BVHNode) + header.nPrimitives * sizeof(uint32_t))
+        return nullptr;
+
+    const BVHNode* n = reinterpret_cast<const BVHNode*>(data + sizeof(header));
+    if (!validNodes(n, header.nNodes, header.nPrimitives))
+        return nullptr;
+
+    const uint32_t* order = reinterpret_cast<const uint32_t*>(n + header.nNodes);
+    std::vector<Reference<Primitive>> ordered(header.nPrimitives);
+    for (size_t i = 0; i < ordered.size(); ++i)
+    {
+        if (order[i] >= prims.size())
+            return nullptr;
+        ordered[i] = prims[order[i]];
+    }
+
+    return new BVH(n, header.nNodes, ordered);
+}
+
+bool BVH::validNodes(const BVHNode* nodes, size_t nNodes, size_t nPrimitives)
+{
+    for (size_t i = 0; i < nNodes; ++i)
+    {
+        const BVHNode& node = nodes[i];
+        if (node.nPrimitives ? (node.offset > nPrimitives || node.nPrimitives > nPrimitives - node.offset)
+                             : (node.offset <= i + 1 || node.offset >= nNodes || node.axis > 2))
+            return false;
+    }
+    return true;
+}
+
+BBox BVH::bounds() const
+{
+    return nodes.empty() ? BBox() : nodes[0].bounds;
+}
@@ -0,0 +1,216 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "core/primitive.h"
+
+namespace tracer
+{
+
+/*!
+ * Uzel hierarchie obalových kvádrů. Uzly jsou uloženy v poli v pořadí
+ * průchodu do hloubky, první potomek vnitřního uzlu tedy leží hned za ním
+ * a celý podstrom zabírá souvislý úsek pole.
+ */
+struct BVHNode
+{
+    BBox bounds; ///< Obalový kvádr uzlu.
+    uint32_t offset; ///< U listu index prvního tělesa, u vnitřního uzlu index druhého potomka.
+    uint16_t nPrimitives; ///< Počet těles listu, 0 u vnitřního uzlu.
+    uint8_t axis; ///< Osa, podle které byl uzel rozdělen.
+};
+
+/*!
+ * Hierarchie obalových kvádrů (BVH) stavěná podle heuristiky povrchu (SAH)
+ * s rozdělením těžišť do přihrádek.
+ *
+ * Pro deformovanou geometrii (stejná topologie, jiné polohy vrcholů) umí
+ * strukturu přepočítat bez přestavby (refitAll()): zachová stromovou
+ * strukturu a obalové kvádry uzlů přepočítá zdola nahoru. Podstromy se
+ * zpracují paralelně. Strom se tím ale zhoršuje, proto se po každém
+ * přepočtu spočítá jeho cena podle SAH a pokud vzroste nad zadaný násobek
+ * ceny po poslední stavbě, strom se postaví znovu.
+ */
+class BVH : public AccelerationStructure
+{
+public:
+    /*!
+     * Vytvoří hierarchii ze zadaných těles.
+     * Nad každým tělesem se zkusí provést Primitive::Refine().
+     * \param p tělesa
+     * \param maxPrimsInNode maximální počet těles v listu
+     * \param rebuildThreshold násobek ceny SAH po stavbě, při jehož překročení
+     *                         se strom při přepočtu postaví znovu
+     */
+    BVH(std::vector<Reference<Primitive>>& p, int maxPrimsInNode = 4, Real rebuildThreshold = 1.5f);
+
+    /*!
+     * Vytvoří hierarchii z dříve postaveného stromu (např. z binárního
+     * souboru scény) bez nové stavby. Uzly se zkopírují, musí odpovídat
+     * tělesům a tvořit platný strom.
+     * \param nodes uzly stromu v pořadí průchodu do hloubky
+     * \param nNodes počet uzlů
+     * \param ordered tělesa v pořadí listů, jejich pole se vyprázdní
+     * \param maxPrimsInNode maximální počet těles v listu při případné přestavbě
+     * \param rebuildThreshold viz BVH::BVH()
+     */
+    BVH(const BVHNode* nodes, size_t nNodes, std::vector<Reference<Primitive>>& ordered,
+        int maxPrimsInNode = 4, Real rebuildThreshold = 1.5f);
+
+    virtual ~BVH();
+
+    /*! \copydoc Primitive::intersect() */
+    virtual bool intersect(const Ray& ray, Intersection& sr) override;
+
+    /*! \copydoc Primitive::intersectP() */
+    virtual bool intersectP(const Ray& ray) override;
+
+    virtual BBox bounds() const override;
+
+    /*!
+     * \copydoc AccelerationStructure::refit()
+     * Přepočítá obalové kvádry celého stromu, viz refitAll().
+     */
+    virtual bool refit(std::vector<Reference<Primitive>>& prims,
+                       const std::vector<BBox>& oldBounds, UpdateReport& report) override;
+
+    /*! \copydoc AccelerationStructure::refitAll() */
+    virtual bool refitAll(UpdateReport& report) override;
+
+    /*! \copydoc AccelerationStructure::rebuild() */
+    virtual void rebuild(std::vector<Reference<Primitive>>& p) override;
+
+    /*!
+     * \copydoc AccelerationStructure::serialize()
+     * Ukládá pole uzlů a indexy těles v pořadí listů.
+     */
+    virtual bool serialize(const std::unordered_map<const Primitive*, uint32_t>& indices,
+                           std::vector<char>& data) const override;
+
+    /*!
+     * Vytvoří hierarchii z dat uložených metodou serialize().
+     * \param data uložená data
+     * \param size velikost dat v bajtech
+     * \param prims tělesa, nad kterými byla hierarchie postavena
+     * \return nová hierarchie nebo nullptr, pokud data nejsou platná
+     */
+    static BVH* deserialize(const char* data, size_t size, const std::vector<Reference<Primitive>>& prims);
+
+    /*!
+     * Ověří, že uzly tvoří platný strom: potomci leží vždy za rodičem
+     * a listy se odkazují do pole těles.
+     * \param nodes uzly v pořadí průchodu do hloubky
+     * \param nNodes počet uzlů (nenulový)
+     * \param nPrimitives počet těles
+     */
+    static bool validNodes(const BVHNode* nodes, size_t nNodes, size_t nPrimitives);
+
+    /*!
+     * Cena stromu podle SAH vztažená k povrchu kořene.
+     * \return aktuální cena
+     */
+    Real cost() const
+    { return currentCost; }
+
+    /*!
+     * \return cena stromu po poslední stavbě
+     */
+    Real buildCost() const
+    { return builtCost; }
+
+    /*!
+     * \return počet uzlů stromu
+     */
+    size_t numNodes() const
+    { return nodes.size(); }
+
+    /*!
+     * \return uzly stromu v pořadí průchodu do hloubky
+     */
+    const std::vector<BVHNode>& nodeArray() const
+    { return nodes; }
+
+    /*!
+     * \return tělesa v pořadí listů, listy se do tohoto pole odkazují
+     */
+    const std::vector<Reference<Primitive>>& orderedPrimitives() const
+    { return primitives; }
+
+private:
+    /*!
+     * Pomocné informace o tělese během stavby.
+     */
+    struct BuildPrimitive
+    {
+        BBox bounds; ///< Obalový kvádr tělesa.
+        Vector centroid; ///< Těžiště obalového kvádru.
+        uint32_t index; ///< Index tělesa v původním poli.
+
+        /*!
+         * Záměna pro algoritmy knihovny STL, jinak by volání swap() bylo
+         * nejednoznačné se šablonou tracer::swap().
+         */
+        friend void swap(BuildPrimitive& a, BuildPrimitive& b)
+        {
+            BuildPrimitive t = a;
+            a = b;
+            b = t;
+        }
+    };
+
+    /*!
+     * Postaví strom z těles v poli primitives.
+     */
+    void build();
+
+    /*!
+     * Rekurzivně postaví podstrom z těles build[start; end) a uloží ho do pole nodes.
+     * \param build pomocné informace o tělesech, jejich pořadí se mění
+     * \param start první těleso podstromu
+     * \param end konec úseku těles podstromu
+     * \param ordered slouží k návratu těles v pořadí listů
+     * \return index kořene podstromu
+     */
+    uint32_t buildRecursive(std::vector<BuildPrimitive>& build, uint32_t start, uint32_t end,
+                            std::vector<Reference<Primitive>>& ordered);
+
+    /*!
+     * Rozdělí strom na podstromy přepočítávané paralelně (pole subtrees)
+     * a uzly nad nimi (pole topNodes).
+     * \param nodeIndex kořen podstromu
+     * \param depth hloubka uzlu
+     * \return index uzlu za koncem podstromu
+     */
+    uint32_t findSubtrees(uint32_t nodeIndex, int depth);
+
+    /*!
+     * \return cena neprázdného stromu podle SAH vztažená k povrchu kořene
+     */
+    Real treeCost() const;
+
+    /*!
+     * Přepočítá obalové kvádry uzlů z úseku pole [start; end) odzadu,
+     * tedy potomky dříve než rodiče.
+     * \return součet příspěvků uzlů k ceně SAH (bez normalizace povrchem kořene)
+     */
+    Real refitRange(uint32_t start, uint32_t end);
+
+    /*!
+     * Příspěvek uzlu k ceně SAH bez normalizace povrchem kořene.
+     * \param node uzel
+     */
+    static Real nodeCost(const BVHNode& node);
+
+    std::vector<BVHNode> nodes; ///< Uzly stromu v pořadí průchodu do hloubky.
+    std::vector<Reference<Primitive>> primitives; ///< Tělesa v pořadí listů.
+    std::vector<uint32_t> subtrees; ///< Kořeny podstromů, které se přepočítávají paralelně (dvojice začátek, konec).
+    std::vector<uint32_t> topNodes; ///< Vnitřní uzly nad podstromy, vzestupně.
+    int maxPrimsInNode; ///< Maximální počet těles v listu.
+    int subtreeDepth; ///< Hloubka, ve které strom dělí na paralelně přepočítávané podstromy.
+    Real rebuildThreshold; ///< Povolený nárůst ceny SAH před přestavbou.
+    Real builtCost; ///< Cena SAH po poslední stavbě.
+    Real currentCost; ///< Aktuální cena SAH.
+};
+
+}
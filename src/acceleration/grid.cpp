@@ -1,10 +1,29 @@
 #include "acceleration/grid.h"
 
 #include <string.h>
+#include <unordered_set>
 
+#include "acceleration/lazyprimitive.h"
 
 using namespace tracer;
 
+namespace
+{
+
+/*!
+ * Hlavička dat z Grid::serialize(). Za ní následuje pole nv + 1 začátků
+ * voxelů v poli indexů a samotné pole indexů těles.
+ */
+struct SerializedGrid
+{
+    BBox bounds;
+    uint32_t nVoxels[3];
+    uint32_t padding;
+    uint64_t nIndices;
+};
+
+}
+
 /************************************************************************/
 /* Voxel methods                                                        */
 /************************************************************************/
@@ -23,6 +42,21 @@ void Voxel::addPrimitive(Reference<Primitive>& p)
     primitives.push_back(p);
 }
 
+bool Voxel::removePrimitive(const Primitive* p)
+{
+    for (size_t i = 0; i < primitives.size(); ++i)
+    {
+        if (&*primitives[i] == p)
+        {
+            primitives[i] = primitives.back();
+            primitives.pop_back();
+            return true;
+        }
+    }
+
+    return false;
+}
+
 bool Voxel::intersect(const Ray& ray, Intersection& inter) const
 {
     for (size_t i = 0; i < primitives.size(); ++i)
@@ -45,12 +79,25 @@ bool Voxel::intersectP(const Ray& ray) const
 /************************************************************************/
 
 Grid::Grid(std::vector<Reference<Primitive> >& p)
+    : voxels(nullptr)
+{
+    build(p);
+}
+
+Grid::Grid()
+    : nv(0),
+      voxels(nullptr)
+{ }
+
+Grid::~Grid()
+{
+    clear();
+}
+
+void Grid::build(std::vector<Reference<Primitive>>& p)
 {
     for (size_t i = 0; i < p.size(); ++i)
-        if (p[i]->canIntersect())
-            primitives.push_back(p[i]);
-        else
-            p[i]->refine(primitives);
+        LazyPrimitive::expand(p[i], primitives);
 
     for (size_t i = 0; i < primitives.size(); ++i)
         m_bounds = unite(m_bounds, primitives[i]->bounds());
@@ -67,8 +114,17 @@ Grid::Grid(std::vector<Reference<Primitive> >& p)
         nVoxels[axis] = clamp(nVoxels[axis], 1, MAX_VOXELS);
     }
 
+    allocateVoxels();
+
+    for (size_t i = 0; i < primitives.size(); ++i)
+        addToVoxels(primitives[i], primitives[i]->bounds());
+}
+
+void Grid::allocateVoxels()
+{
     nv = nVoxels[0] * nVoxels[1] * nVoxels[2];
 
+    Vector delta = m_bounds.diagonal();
     for (int axis = 0; axis < 3; ++axis)
     {
         width[axis] = delta[axis] / nVoxels[axis];
@@ -77,37 +133,250 @@ Grid::Grid(std::vector<Reference<Primitive> >& p)
 
     voxels = new Voxel* [nv];
     memset(voxels, 0, nv * sizeof(Voxel*));
+}
 
-    for (size_t i = 0; i < primitives.size(); ++i)
+void Grid::clear()
+{
+    if (!voxels)
+        return;
+
+    for (size_t i = 0; i < nv; ++i)
+        if (voxels[i]) delete voxels[i];
+    delete[] voxels;
+    voxels = nullptr;
+}
+
+size_t Grid::addToVoxels(Reference<Primitive>& p, const BBox& b)
+{
+    size_t vmin[3], vmax[3];
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        vmin[axis] = posToVoxel(b.pMin, axis);
+        vmax[axis] = posToVoxel(b.pMax, axis);
+    }
+
+    for (size_t x = vmin[0]; x <= vmax[0]; ++x)
     {
-        BBox pb = primitives[i]->bounds();
-        size_t vmin[3], vmax[3];
-        for (int axis = 0; axis < 3; ++axis)
+        for (size_t y = vmin[1]; y <= vmax[1]; ++y)
         {
-            vmin[axis] = posToVoxel(pb.pMin, axis);
-            vmax[axis] = posToVoxel(pb.pMax, axis);
+            for (size_t z = vmin[2]; z <= vmax[2]; ++z)
+            {
+                size_t o = offset(x, y, z);
+                if (!voxels[o])
+                    voxels[o] = new Voxel(p);
+                else
+                    voxels[o]->addPrimitive(p);
+            }
         }
+    }
+
+    return (vmax[0] - vmin[0] + 1) * (vmax[1] - vmin[1] + 1) * (vmax[2] - vmin[2] + 1);
+}
+
+size_t Grid::removeFromVoxels(const Primitive* p, const BBox& b)
+{
+    size_t vmin[3], vmax[3];
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        vmin[axis] = posToVoxel(b.pMin, axis);
+        vmax[axis] = posToVoxel(b.pMax, axis);
+    }
 
-        for (size_t x = vmin[0]; x <= vmax[0]; ++x)
+    size_t count = 0;
+    for (size_t x = vmin[0]; x <= vmax[0]; ++x)
+    {
+        for (size_t y = vmin[1]; y <= vmax[1]; ++y)
         {
-            for (size_t y = vmin[1]; y <= vmax[1]; ++y)
+            for (size_t z = vmin[2]; z <= vmax[2]; ++z)
             {
-                for (size_t z = vmin[2]; z <= vmax[2]; ++z)
+                size_t o = offset(x, y, z);
+                if (!voxels[o] || !voxels[o]->removePrimitive(p))
+                    continue;
+
+                ++count;
+                if (voxels[o]->empty())
                 {
-                    size_t o = offset(x, y, z);
-                    if (!voxels[o])
-                        voxels[o] = new Voxel(primitives[i]);
-                    else
-                        voxels[o]->addPrimitive(primitives[i]);
+                    delete voxels[o];
+                    voxels[o] = nullptr;
                 }
             }
         }
     }
+
+    return count;
 }
 
-Grid::~Grid()
+bool Grid::insert(std::vector<Reference<Primitive>>& prims, UpdateReport& report)
+{
+    for (size_t i = 0; i < prims.size(); ++i)
+        if (!contains(prims[i]->bounds()))
+            return false;
+
+    for (size_t i = 0; i < prims.size(); ++i)
+    {
+        primitives.push_back(prims[i]);
+        report.cells += addToVoxels(primitives.back(), primitives.back()->bounds());
+    }
+    report.inserted += prims.size();
+
+    return true;
+}
+
+/*!
+ * Seznam všech těles se prochází jen jednou, odebíraná tělesa se hledají
+ * v hašovací tabulce.
+ */
+bool Grid::remove(std::vector<Reference<Primitive>>& prims, UpdateReport& report)
+{
+    std::unordered_set<const Primitive*> removed;
+    for (size_t i = 0; i < prims.size(); ++i)
+    {
+        removed.insert(&*prims[i]);
+        report.cells += removeFromVoxels(&*prims[i], prims[i]->bounds());
+    }
+
+    size_t kept = 0;
+    for (size_t i = 0; i < primitives.size(); ++i)
+        if (!removed.count(&*primitives[i]))
+            primitives[kept++] = primitives[i];
+    report.removed += primitives.size() - kept;
+    primitives.resize(kept);
+
+    return true;
+}
+
+bool Grid::refit(std::vector<Reference<Primitive>>& prims,
+                 const std::vector<BBox>& oldBounds, UpdateReport& report)
+{
+    for (size_t i = 0; i < prims.size(); ++i)
+        if (!contains(prims[i]->bounds()))
+            return false;
+
+    for (size_t i = 0; i < prims.size(); ++i)
+    {
+        Reference<Primitive> p(prims[i]);
+        report.cells += removeFromVoxels(&*p, oldBounds[i]);
+        report.cells += addToVoxels(p, p->bounds());
+    }
+    report.refitted += prims.size();
+
+    return true;
+}
+
+bool Grid::refitAll(UpdateReport& report)
+{
+    for (size_t i = 0; i < primitives.size(); ++i)
+        if (!contains(primitives[i]->bounds()))
+            return false;
+
+    for (size_t i = 0; i < nv; ++i)
+    {
+        if (voxels[i]) delete voxels[i];
+        voxels[i] = nullptr;
+    }
+
+    for (size_t i = 0; i < primitives.size(); ++i)
+        report.cells += addToVoxels(primitives[i], primitives[i]->bounds());
+    report.refitted += primitives.size();
+
+    return true;
+}
+
+void Grid::rebuild(std::vector<Reference<Primitive>>& p)
+{
+    clear();
+    primitives.clear();
+    m_bounds = BBox();
+    build(p);
+}
+
+bool Grid::serialize(const std::unordered_map<const Primitive*, uint32_t>& indices,
+                     std::vector<char>& data) const
+{
+    SerializedGrid header = SerializedGrid();
+    header.bounds = m_bounds;
+    for (int axis = 0; axis < 3; ++axis)
+        header.nVoxels[axis] = static_cast<uint32_t>(nVoxels[axis]);
+
+    std::vector<uint32_t> starts(nv + 1);
+    std::vector<uint32_t> contents;
+    for (size_t i = 0; i < nv; ++i)
+    {
+        starts[i] = static_cast<uint32_t>(contents.size());
+        if (!voxels[i])
+            continue;
+
+        const std::vector<Reference<Primitive>>& prims = voxels[i]->contents();
+        for (size_t j = 0; j < prims.size(); ++j)
+        {
+            Reference<Primitive> p(prims[j]);
+            std::unordered_map<const Primitive*, uint32_t>::const_iterator it = indices.find(&*p);
+            if (it == indices.end() || contents.size() == 0xFFFFFFFFu)
+                return false;
+            contents.push_back(it->second);
+        }
+    }
+    starts[nv] = static_cast<uint32_t>(contents.size());
+    header.nIndices = contents.size();
+
+    const size_t startBytes = starts.size() * sizeof(uint32_t);
+    data.resize(sizeof(header) + startBytes + contents.size() * sizeof(uint32_t));
+    memcpy(&data[0], &header, sizeof(header));
+    memcpy(&data[sizeof(header)], starts.data(), startBytes);
+    if (!contents.empty())
+        memcpy(&data[sizeof(header) + startBytes], contents.data(), contents.size() * sizeof(uint32_t));
+    return true;
+}
+
+Grid* Grid::deserialize(const char* data, size_t size, const std::vector<Reference<Primitive>>& prims)
 {
+    SerializedGrid header;
+    if (size < sizeof(header))
+        return nullptr;
+    memcpy(reinterpret_cast<unsigned char*>(&header), data, sizeof(header));
+
+    uint64_t cells = 1;
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        if (header.nVoxels[axis] < 1 || header.nVoxels[axis] > MAX_VOXELS)
+            return nullptr;
+        cells *= header.nVoxels[axis];
+    }
+    if (header.nIndices > 0xFFFFFFFFu ||
+        size != sizeof(header) + (cells + 1 + header.nIndices) * sizeof(uint32_t))
+        return nullptr;
+
+    const uint32_t* starts = reinterpret_cast<const uint32_t*>(data + sizeof(header));
+    const uint32_t* contents = starts + cells + 1;
+    if (starts[0] != 0 || starts[cells] != header.nIndices)
+        return nullptr;
+    for (uint64_t i = 0; i < cells; ++i)
+        if (starts[i] > starts[i + 1])
+            return nullptr;
+    for (uint64_t i = 0; i < header.nIndices; ++i)
+        if (contents[i] >= prims.size())
+            return nullptr;
+
+    Grid* grid = new Grid();
+    grid->primitives = prims;
+    grid->m_bounds = header.bounds;
+    for (int axis = 0; axis < 3; ++axis)
+        grid->nVoxels[axis] = header.nVoxels[axis];
+    grid->allocateVoxels();
+
+    for (size_t i = 0; i < grid->nv; ++i)
+    {
+        for (uint32_t j = starts[i]; j < starts[i + 1]; ++j)
+        {
+            Reference<Primitive> p(prims[contents[j]]);
+            if (!grid->voxels[i])
+                grid->voxels[i] = new Voxel(p);
+            else
+                grid->voxels[i]->addPrimitive(p);
+        }
+    }
 
+    return grid;
 }
 
 bool Grid::intersect(const Ray& ray, Intersection& sr)
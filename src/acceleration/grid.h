@@ -32,6 +32,25 @@ struct Voxel
 	 */
     void addPrimitive(Reference<Primitive>& p);
 
+    /*!
+     * Odebere těleso z voxelu.
+     * \param p odebírané těleso
+     * \return jestli voxel těleso obsahoval
+     */
+    bool removePrimitive(const Primitive* p);
+
+    /*!
+     * \return jestli je voxel prázdný
+     */
+    bool empty() const
+    { return primitives.empty(); }
+
+    /*!
+     * \return tělesa voxelu
+     */
+    const std::vector<Reference<Primitive>>& contents() const
+    { return primitives; }
+
     /*! \copydoc Primitive::intersect() */
     bool intersect(const Ray& ray, Intersection& inter) const;
 
@@ -61,7 +80,90 @@ public:
 
     virtual BBox bounds() const;
 
+    /*!
+     * \copydoc AccelerationStructure::insert()
+     * Tělesa se vloží do voxelů, které překrývají. Přestavba je nutná,
+     * pokud některé těleso přesahuje obalový kvádr mřížky.
+     */
+    virtual bool insert(std::vector<Reference<Primitive>>& prims, UpdateReport& report) override;
+
+    /*! \copydoc AccelerationStructure::remove() */
+    virtual bool remove(std::vector<Reference<Primitive>>& prims, UpdateReport& report) override;
+
+    /*!
+     * \copydoc AccelerationStructure::refit()
+     * Těleso se odebere z voxelů původního obalového kvádru a vloží do voxelů
+     * nového. Přestavba je nutná, pokud těleso opustí obalový kvádr mřížky.
+     */
+    virtual bool refit(std::vector<Reference<Primitive>>& prims,
+                       const std::vector<BBox>& oldBounds, UpdateReport& report) override;
+
+    /*!
+     * \copydoc AccelerationStructure::refitAll()
+     * Rozměry a rozlišení mřížky zůstávají, tělesa se znovu rozmístí do voxelů.
+     * Přestavba je nutná, pokud některé těleso opustí obalový kvádr mřížky.
+     */
+    virtual bool refitAll(UpdateReport& report) override;
+
+    /*! \copydoc AccelerationStructure::rebuild() */
+    virtual void rebuild(std::vector<Reference<Primitive>>& p) override;
+
+    /*!
+     * \copydoc AccelerationStructure::serialize()
+     * Ukládá rozměry mřížky a obsah voxelů jako souvislé pole indexů těles.
+     */
+    virtual bool serialize(const std::unordered_map<const Primitive*, uint32_t>& indices,
+                           std::vector<char>& data) const override;
+
+    /*!
+     * Vytvoří mřížku z dat uložených metodou serialize().
+     * \param data uložená data
+     * \param size velikost dat v bajtech
+     * \param prims tělesa, nad kterými byla mřížka postavena
+     * \return nová mřížka nebo nullptr, pokud data nejsou platná
+     */
+    static Grid* deserialize(const char* data, size_t size, const std::vector<Reference<Primitive>>& prims);
+
 private:
+    /*! Prázdná mřížka pro deserialize(). */
+    Grid();
+
+    /*!
+     * Podle obalového kvádru a počtu voxelů v osách spočítá rozměry
+     * voxelů a alokuje prázdné pole voxelů.
+     */
+    void allocateVoxels();
+    /*!
+     * Rozloží tělesa, určí rozměry mřížky a rozmístí tělesa do voxelů.
+     * \param p tělesa
+     */
+    void build(std::vector<Reference<Primitive>>& p);
+
+    /*! Uvolní všechny voxely. */
+    void clear();
+
+    /*!
+     * Vloží těleso do všech voxelů, které překrývá jeho obalový kvádr.
+     * \param p těleso
+     * \param b obalový kvádr tělesa
+     * \return počet voxelů
+     */
+    size_t addToVoxels(Reference<Primitive>& p, const BBox& b);
+
+    /*!
+     * Odebere těleso ze všech voxelů, které překrývá zadaný obalový kvádr.
+     * Voxely, které zůstanou prázdné, se uvolní.
+     * \param p těleso
+     * \param b obalový kvádr tělesa
+     * \return počet voxelů, ze kterých bylo těleso odebráno
+     */
+    size_t removeFromVoxels(const Primitive* p, const BBox& b);
+
+    /*!
+     * \return jestli obalový kvádr leží celý uvnitř mřížky
+     */
+    bool contains(const BBox& b) const
+    { return m_bounds.isInside(b.pMin) && m_bounds.isInside(b.pMax); }
     /*!
 	 * Dokáže určit ve kterém voxelu zadané osy se bod nachází.
 	 * \param p bod pro který je hledá voxel.
@@ -0,0 +1,50 @@
+#include "acceleration/instance.h"
+
+#include <stdexcept>
+
+using namespace tracer;
+
+Instance::Instance(const Reference<Primitive>& prim, const Transform& objectToWorld)
+    : prim(prim)
+{
+    if (!this->prim->canIntersect())
+        throw std::runtime_error("Instanced primitive must be intersectable");
+
+    setTransform(objectToWorld);
+}
+
+Instance::~Instance()
+{ }
+
+bool Instance::intersect(const Ray& ray, Intersection& sr)
+{
+    Ray r = worldToObject.ray(ray);
+    prim->intersect(r, sr);
+    if (!(r.maxt < ray.maxt))
+        return false;
+
+    ray.maxt = r.maxt;
+    sr.hitPoint = ray(sr.t);
+    sr.normal = objectToWorld.normal(sr.normal).normalize();
+    sr.ray = ray;
+
+    return true;
+}
+
+bool Instance::intersectP(const Ray& ray)
+{
+    return prim->intersectP(worldToObject.ray(ray));
+}
+
+BBox Instance::bounds() const
+{
+    return worldBounds;
+}
+
+bool Instance::setTransform(const Transform& t)
+{
+    objectToWorld = t;
+    worldToObject = t.inverse();
+    worldBounds = t.bounds(prim->bounds());
+    return true;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "core/primitive.h"
+#include "core/transform.h"
+
+namespace tracer
+{
+
+/*!
+ * Instance sdíleného tělesa umístěná do scény transformací. Těleso je
+ * obvykle akcelerační struktura (spodní úroveň) postavená nad jednou sítí
+ * v jejích lokálních souřadnicích, libovolné množství instancí pak sdílí
+ * jednu její kopii. Nad instancemi se staví horní akcelerační struktura
+ * jako nad běžnými tělesy.
+ *
+ * Při výpočtu průsečíku se paprsek převede do souřadnic tělesa.
+ * Transformovaný směr se nenormalizuje, parametr t je tedy v obou
+ * soustavách stejný a nalezený průsečík zkracuje paprsek ve scéně. Zda
+ * těleso našlo bližší průsečík, se pozná podle zkrácení paprsku (ray.maxt),
+ * protože některé struktury vrací true i pro dříve nalezený průsečík.
+ */
+class Instance : public Primitive
+{
+public:
+    /*!
+     * Konstruktor.
+     * \param prim sdílené těleso, musí umět počítat průsečík (Primitive::canIntersect())
+     * \param objectToWorld transformace ze souřadnic tělesa do scény
+     */
+    Instance(const Reference<Primitive>& prim, const Transform& objectToWorld);
+
+    virtual ~Instance();
+
+    /*! \copydoc Primitive::intersect() */
+    virtual bool intersect(const Ray& ray, Intersection& sr) override;
+
+    /*! \copydoc Primitive::intersectP() */
+    virtual bool intersectP(const Ray& ray) override;
+
+    /*!
+     * Instance průsečík počítat umí.
+     * \return true
+     */
+    virtual bool canIntersect() const override
+    { return true; }
+
+    /*! Instance se nedělí, sdílené těleso zůstává celé. */
+    virtual void refine(std::vector<Reference<Primitive>>& refined) override
+    { return; }
+
+    /*! Obalový kvádr transformovaného obalového kvádru tělesa. */
+    virtual BBox bounds() const override;
+
+    /*!
+     * \copydoc Primitive::setTransform()
+     * Mění se pouze transformace instance, sdílené těleso zůstává beze změny.
+     */
+    virtual bool setTransform(const Transform& t) override;
+
+    /*!
+     * \return sdílené těleso
+     */
+    Reference<Primitive> primitive() const
+    { return prim; }
+
+    /*!
+     * \return transformace ze souřadnic tělesa do scény
+     */
+    const Transform& transform() const
+    { return objectToWorld; }
+
+private:
+    mutable Reference<Primitive> prim; ///< Sdílené těleso.
+    Transform objectToWorld; ///< Transformace ze souřadnic tělesa do scény.
+    Transform worldToObject; ///< Inverzní transformace.
+    BBox worldBounds; ///< Obalový kvádr ve scéně.
+};
+
+}
@@ -0,0 +1,108 @@
+#include "acceleration/lazyprimitive.h"
+
+#include "acceleration/bvh.h"
+
+using namespace tracer;
+
+LazyPrimitive::LazyPrimitive(const Reference<Primitive>& prim)
+    : prim(prim),
+      accelerator(nullptr)
+{ }
+
+LazyPrimitive::~LazyPrimitive()
+{
+    delete accelerator.load();
+}
+
+void LazyPrimitive::expand(const Reference<Primitive>& p, std::vector<Reference<Primitive>>& out)
+{
+    Reference<Primitive> object(p);
+    if (object->canIntersect())
+        out.push_back(object);
+    else if (object->refineOnDemand())
+        out.push_back(new LazyPrimitive(object));
+    else
+        object->refine(out);
+}
+
+bool LazyPrimitive::intersect(const Ray& ray, Intersection& sr)
+{
+    const Real maxt = ray.maxt;
+    structure()->intersect(ray, sr);
+    return ray.maxt < maxt;
+}
+
+bool LazyPrimitive::intersectP(const Ray& ray)
+{
+    return structure()->intersectP(ray);
+}
+
+BBox LazyPrimitive::bounds() const
+{
+    return prim->bounds();
+}
+
+bool LazyPrimitive::setTransform(const Transform& t)
+{
+    if (!prim->setTransform(t))
+        return false;
+    invalidate();
+    return true;
+}
+
+size_t LazyPrimitive::setMaterial(const Reference<Material>& material)
+{
+    size_t changed = 0;
+    if (GeometricPrimitive* geometric = dynamic_cast<GeometricPrimitive*>(&*prim))
+    {
+        geometric->setMaterial(material);
+        ++changed;
+    }
+
+    BVH* bvh = accelerator.load(std::memory_order_acquire);
+    if (!bvh)
+        return changed;
+
+    const std::vector<Reference<Primitive>>& parts = bvh->orderedPrimitives();
+    for (size_t i = 0; i < parts.size(); ++i)
+    {
+        Reference<Primitive> part(parts[i]);
+        if (GeometricPrimitive* geometric = dynamic_cast<GeometricPrimitive*>(&*part))
+        {
+            geometric->setMaterial(material);
+            ++changed;
+        }
+    }
+    return changed;
+}
+
+void LazyPrimitive::invalidate()
+{
+    delete accelerator.exchange(nullptr);
+}
+
+/*!
+ * Dvojitá kontrola: postavená BVH se vrátí bez zámku, jinak se stavba
+ * provede pod zámkem, pokud ji mezitím neprovedlo jiné vlákno.
+ */
+BVH* LazyPrimitive::structure()
+{
+    BVH* bvh = accelerator.load(std::memory_order_acquire);
+    if (bvh)
+        return bvh;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    bvh = accelerator.load(std::memory_order_relaxed);
+    if (!bvh)
+    {
+        // Části, které samy žádají odložené rozložení, obalí BVH dalším zástupcem.
+        std::vector<Reference<Primitive>> parts;
+        if (prim->canIntersect())
+            parts.push_back(prim);
+        else
+            prim->refine(parts);
+        bvh = new BVH(parts);
+        accelerator.store(bvh, std::memory_order_release);
+    }
+    return bvh;
+}
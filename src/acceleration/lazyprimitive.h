@@ -0,0 +1,112 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+
+#include "core/primitive.h"
+
+namespace tracer
+{
+
+class BVH;
+
+/*!
+ * Zástupce nerozloženého tělesa v akcelerační struktuře. Navenek má jen
+ * obalový kvádr tělesa, těleso se rozloží (Primitive::refine()) a nad
+ * jeho částmi se postaví vlastní BVH až ve chvíli, kdy do kvádru poprvé
+ * dopadne paprsek. Tělesa, na která žádný paprsek nedopadne (např. velká
+ * procedurální geometrie mimo záběr), tak nestojí čas ani paměť.
+ *
+ * Stavbu provede první vlákno, které ji potřebuje, ostatní na ni počkají.
+ * Po stavbě se BVH čte bez zámku. Zda těleso našlo bližší průsečík, se
+ * pozná podle zkrácení paprsku (ray.maxt), stejně jako u Instance.
+ *
+ * Akcelerační struktury a Scene::addObject() obalí zástupcem tělesa,
+ * která o to požádají (Primitive::refineOnDemand()), viz expand().
+ */
+class LazyPrimitive : public Primitive
+{
+public:
+    /*!
+     * Konstruktor.
+     * \param prim těleso, které se rozloží až při prvním průsečíku
+     */
+    LazyPrimitive(const Reference<Primitive>& prim);
+
+    virtual ~LazyPrimitive();
+
+    LazyPrimitive(const LazyPrimitive&) = delete;
+    LazyPrimitive& operator=(const LazyPrimitive&) = delete;
+
+    /*!
+     * Připraví těleso pro vložení do akcelerační struktury: tělesa, která
+     * průsečík počítat umí, vloží beze změny, tělesa s Primitive::refineOnDemand()
+     * obalí zástupcem a ostatní hned rozloží.
+     * \param p těleso
+     * \param out std::vector, do kterého se tělesa vloží
+     */
+    static void expand(const Reference<Primitive>& p, std::vector<Reference<Primitive>>& out);
+
+    /*! \copydoc Primitive::intersect() */
+    virtual bool intersect(const Ray& ray, Intersection& sr) override;
+
+    /*! \copydoc Primitive::intersectP() */
+    virtual bool intersectP(const Ray& ray) override;
+
+    /*!
+     * Zástupce průsečík počítá sám.
+     * \return true
+     */
+    virtual bool canIntersect() const override
+    { return true; }
+
+    /*! Zástupce se nerozkládá, jinak by se těleso rozložilo hned. */
+    virtual void refine(std::vector<Reference<Primitive>>& refined) override
+    { return; }
+
+    /*! Obalový kvádr tělesa. */
+    virtual BBox bounds() const override;
+
+    /*!
+     * \copydoc Primitive::setTransform()
+     * Transformace se předá tělesu a případně postavená BVH se zahodí.
+     */
+    virtual bool setTransform(const Transform& t) override;
+
+    /*!
+     * Nastaví materiál tělesu i jeho už rozloženým částem.
+     * \param material nový materiál
+     * \return počet těles, kterým se materiál vyměnil
+     */
+    size_t setMaterial(const Reference<Material>& material);
+
+    /*!
+     * Zahodí postavenou BVH, těleso se při příštím průsečíku rozloží znovu
+     * (např. po změně jeho tvaru). Nesmí běžet současně s výpočtem průsečíků.
+     */
+    void invalidate();
+
+    /*!
+     * \return jestli už bylo těleso rozloženo
+     */
+    bool isRefined() const
+    { return accelerator.load(std::memory_order_acquire) != nullptr; }
+
+    /*!
+     * \return obalené těleso
+     */
+    Reference<Primitive> primitive() const
+    { return prim; }
+
+private:
+    /*!
+     * Vrátí BVH nad částmi tělesa, při prvním volání ji postaví.
+     */
+    BVH* structure();
+
+    mutable Reference<Primitive> prim; ///< Obalené těleso.
+    std::atomic<BVH*> accelerator; ///< BVH nad částmi tělesa, nullptr dokud se nepostaví.
+    std::mutex mutex; ///< Zámek stavby.
+};
+
+}
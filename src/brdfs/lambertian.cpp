@@ -0,0 +1,27 @@
+#include "brdfs/lambertian.h"
+
+using namespace tracer;
+
+Lambertian::Lambertian(const RGBColor& r)
+    : BxDF(BxDFType(BSDF_REFLECTION | BSDF_DIFFUSE)),
+      r(r)
+{ }
+
+Lambertian::~Lambertian()
+{ }
+
+RGBColor Lambertian::f(const Vector& wi, const Vector& wo, const Vector& n) const
+{
+    return r * static_cast<Real>(M_1_PI);
+}
+
+RGBColor Lambertian::sampleF(const Vector& wi, Vector& wo, const Vector& n) const
+{
+    wo = n;
+    return BLACK;
+}
+
+RGBColor Lambertian::rho(const Vector& wi, const Vector& wo, const Vector& n) const
+{
+    return r;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "core/brdf.h"
+
+namespace tracer
+{
+
+/*!
+ * Ideálně difúzní (Lambertovský) odraz. Světlo se odráží do všech směrů
+ * polokoule stejně.
+ */
+class Lambertian : public BxDF
+{
+public:
+    /*!
+     * Konstruktor.
+     * \param r odrazivost povrchu
+     */
+    Lambertian(const RGBColor& r);
+
+    virtual ~Lambertian();
+
+    /*! \copydoc BxDF::f() Hodnota je konstantní R / pi. */
+    virtual RGBColor f(const Vector& wi, const Vector& wo, const Vector& n) const override;
+
+    /*!
+     * Difúzní odraz nemá žádný význačný směr, vrací se černá barva
+     * a jako směr normála.
+     */
+    virtual RGBColor sampleF(const Vector& wi, Vector& wo, const Vector& n) const override;
+
+    /*! \copydoc BxDF::rho() */
+    virtual RGBColor rho(const Vector& wi, const Vector& wo, const Vector& n) const override;
+
+private:
+    RGBColor r; ///< Odrazivost povrchu.
+};
+
+}
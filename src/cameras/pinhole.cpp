@@ -0,0 +1,34 @@
+#include "cameras/pinhole.h"
+
+#include <cmath>
+
+using namespace tracer;
+
+/*!
+ * Pixely jsou čtvercové, vodorovný zorný úhel se dopočítá z poměru stran.
+ */
+PinholeCamera::PinholeCamera(const Vector& eye, const Vector& target, const Vector& up,
+                             Real fov, int width, int height)
+    : Camera(eye, target, up),
+      halfWidth(0.5f * width),
+      halfHeight(0.5f * height)
+{
+    Real tanHalf = std::tan(0.5f * fov * static_cast<Real>(M_PI) / 180.f);
+    scale = tanHalf / halfHeight;
+}
+
+PinholeCamera::~PinholeCamera()
+{ }
+
+/*!
+ * Báze (u, v, w) má vektor v orientovaný dolů, takže souřadnice y
+ * vzorku rostoucí od horního okraje filmu se použije přímo. Stopa paprsku
+ * odpovídá velikosti pixelu ve vzdálenosti 1 od kamery.
+ */
+void PinholeCamera::generateRay(const Pixel& sample, Ray* ray) const
+{
+    Vector d = u * ((sample.x - halfWidth) * scale) + v * ((sample.y - halfHeight) * scale) - w;
+    d.normalize();
+    *ray = Ray(eye, d);
+    ray->spread = scale;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "core/camera.h"
+
+namespace tracer
+{
+
+/*!
+ * Dírková kamera s perspektivní projekcí. Všechny paprsky vychází z bodu
+ * pozorovatele a procházejí průmětnou ve vzdálenosti 1 od něj.
+ */
+class PinholeCamera : public Camera
+{
+public:
+    /*!
+     * Konstruktor.
+     * \param eye bod pozorovatele
+     * \param target cíl pozorování
+     * \param up vektor natočení
+     * \param fov svislý zorný úhel ve stupních
+     * \param width šířka filmu v pixelech
+     * \param height výška filmu v pixelech
+     */
+    PinholeCamera(const Vector& eye, const Vector& target, const Vector& up,
+                  Real fov, int width, int height);
+
+    virtual ~PinholeCamera();
+
+    /*! \copydoc Camera::generateRay() */
+    virtual void generateRay(const Pixel& sample, Ray* ray) const override;
+
+    /*!
+     * \return šířka pixelu ve vzdálenosti 1 od kamery (Ray::spread)
+     */
+    Real pixelSpread() const
+    { return scale; }
+
+private:
+    Real scale; ///< Převod vzdálenosti na filmu v pixelech na vzdálenost na průmětně.
+    Real halfWidth; ///< Polovina šířky filmu v pixelech.
+    Real halfHeight; ///< Polovina výšky filmu v pixelech.
+};
+
+}
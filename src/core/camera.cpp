@@ -3,7 +3,8 @@
 using namespace tracer;
 
 Camera::Camera(const Vector& eye, const Vector& target, const Vector& up, Real exposure)
-    : eye(eye),
+    : film(nullptr),
+      eye(eye),
       target(target),
       up(up),
       exposure(exposure)
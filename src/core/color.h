@@ -163,6 +163,15 @@ public:
         return out;
     }
 
+    /*!
+     * Vypočítá jas barvy (váhy podle Rec. 709).
+     * \return jas barvy
+     */
+    Real luminance() const
+    {
+        return 0.2126f * r + 0.7152f * g + 0.0722f * b;
+    }
+
     Real r, g, b; ///< jednotlivé barevné složky
 };
 
@@ -26,6 +26,12 @@ class Material;
  */
 typedef float Real;
 
+/*!
+ * Největší hodnota typu Real menší než 1. Slouží k ořezání náhodných čísel
+ * do intervalu <0; 1).
+ */
+const Real ONE_MINUS_EPSILON = 0.99999994f;
+
 /*!
  * Ořezání hodnoty pomocí intervalu <from; to> pro hodnoty zadaného typu pomocí šablony.
  * \tparam T Musí mít přetíženy operátory menší a větší (<, >)
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+
+namespace tracer
+{
+
+/*!
+ * Přehled sítí, které import scény nahradil instancemi sdílených sítí.
+ * Vyplňuje ho MeshDeduplicator, scéna ho drží v Scene::deduplication.
+ */
+struct DeduplicationReport
+{
+    DeduplicationReport()
+        : meshes(0),
+          duplicates(0),
+          shared(0),
+          bytesSaved(0)
+    { }
+
+    size_t meshes; ///< Počet posouzených sítí.
+    size_t duplicates; ///< Počet sítí nahrazených instancí jiné sítě.
+    size_t shared; ///< Počet sítí sdílených alespoň dvěma instancemi.
+    size_t bytesSaved; ///< Odhad ušetřené paměti v bajtech.
+};
+
+}
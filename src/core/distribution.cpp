@@ -0,0 +1,202 @@
+#include <assert.h>
+#include <algorithm>
+
+#include "core/distribution.h"
+#include "core/parallel.h"
+
+using namespace tracer;
+
+AliasTable::AliasTable()
+    : total(0.f)
+{ }
+
+AliasTable::AliasTable(const std::vector<Real>& weights)
+    : total(0.f)
+{
+    build(weights);
+}
+
+/*!
+ * Vose: váhy se přeškálují tak, aby jejich průměr byl 1. Prvky s menší
+ * hodnotou se postupně doplňují z prvků s větší hodnotou, každý sloupec
+ * tak obsahuje nejvýše dva prvky. Počítá se v double kvůli přesnosti
+ * u velkého počtu prvků.
+ */
+void AliasTable::build(const std::vector<Real>& weights)
+{
+    const size_t n = weights.size();
+    bins.assign(n, Bin());
+    total = 0.f;
+    if (n == 0)
+        return;
+
+    double sum = 0.0;
+    for (size_t i = 0; i < n; ++i)
+        sum += weights[i];
+
+    total = static_cast<Real>(sum);
+    const bool uniform = !(sum > 0.0);
+
+    std::vector<double> scaled(n);
+    std::vector<size_t> small, large;
+    small.reserve(n);
+    large.reserve(n);
+
+    for (size_t i = 0; i < n; ++i)
+    {
+        const double p = uniform ? 1.0 / n : weights[i] / sum;
+        bins[i].pdf = static_cast<Real>(p);
+        scaled[i] = p * n;
+        if (scaled[i] < 1.0)
+            small.push_back(i);
+        else
+            large.push_back(i);
+    }
+
+    while (!small.empty() && !large.empty())
+    {
+        size_t s = small.back();
+        small.pop_back();
+        size_t l = large.back();
+
+        bins[s].prob = static_cast<Real>(scaled[s]);
+        bins[s].alias = l;
+
+        scaled[l] = (scaled[l] + scaled[s]) - 1.0;
+        if (scaled[l] < 1.0)
+        {
+            large.pop_back();
+            small.push_back(l);
+        }
+    }
+
+    // Zbylé sloupce jsou plné, případné odchylky jsou jen zaokrouhlovací chyby.
+    for (size_t i = 0; i < large.size(); ++i)
+    {
+        bins[large[i]].prob = 1.f;
+        bins[large[i]].alias = large[i];
+    }
+    for (size_t i = 0; i < small.size(); ++i)
+    {
+        bins[small[i]].prob = 1.f;
+        bins[small[i]].alias = small[i];
+    }
+}
+
+size_t AliasTable::sample(Real u, Real* pdf, Real* uRemapped) const
+{
+    assert(!bins.empty());
+
+    const size_t n = bins.size();
+    const Real scaled = u * n;
+    size_t offset = min(static_cast<size_t>(scaled), n - 1);
+    const Real up = min(scaled - offset, ONE_MINUS_EPSILON);
+
+    const Bin& bin = bins[offset];
+    size_t index;
+    if (up < bin.prob)
+    {
+        index = offset;
+        if (uRemapped) *uRemapped = min(up / bin.prob, ONE_MINUS_EPSILON);
+    }
+    else
+    {
+        index = bin.alias;
+        if (uRemapped) *uRemapped = min((up - bin.prob) / (1.f - bin.prob), ONE_MINUS_EPSILON);
+    }
+
+    if (pdf) *pdf = bins[index].pdf;
+    return index;
+}
+
+/************************************************************************/
+/* Distribution1D methods                                               */
+/************************************************************************/
+
+Distribution1D::Distribution1D()
+    : funcInt(0.f)
+{ }
+
+Distribution1D::Distribution1D(const Real* f, size_t n)
+    : funcInt(0.f)
+{
+    build(f, n);
+}
+
+void Distribution1D::build(const Real* f, size_t n)
+{
+    func.assign(f, f + n);
+    cdf.assign(n + 1, 0.f);
+
+    for (size_t i = 1; i <= n; ++i)
+        cdf[i] = cdf[i - 1] + func[i - 1] / n;
+
+    funcInt = cdf[n];
+    if (funcInt == 0.f)
+    {
+        for (size_t i = 1; i <= n; ++i)
+            cdf[i] = static_cast<Real>(i) / n;
+    }
+    else
+    {
+        for (size_t i = 1; i <= n; ++i)
+            cdf[i] /= funcInt;
+    }
+}
+
+Real Distribution1D::sampleContinuous(Real u, Real* pdf, size_t* offset) const
+{
+    assert(!func.empty());
+
+    // Poslední prvek CDF, který je menší nebo roven u.
+    size_t o = std::upper_bound(cdf.begin(), cdf.end(), u) - cdf.begin();
+    o = clamp(o, static_cast<size_t>(1), cdf.size() - 1) - 1;
+    if (offset) *offset = o;
+
+    Real du = u - cdf[o];
+    if (cdf[o + 1] - cdf[o] > 0.f)
+        du /= cdf[o + 1] - cdf[o];
+
+    if (pdf) *pdf = funcInt > 0.f ? func[o] / funcInt : 1.f;
+
+    return (o + du) / count();
+}
+
+/************************************************************************/
+/* Distribution2D methods                                               */
+/************************************************************************/
+
+Distribution2D::Distribution2D(const Real* f, size_t nu, size_t nv)
+    : conditional(nv)
+{
+    parallelFor(nv, [&](size_t v)
+    {
+        conditional[v].build(&f[v * nu], nu);
+    }, 16);
+
+    std::vector<Real> marginalFunc(nv);
+    for (size_t v = 0; v < nv; ++v)
+        marginalFunc[v] = conditional[v].integral();
+    marginal.build(&marginalFunc[0], nv);
+}
+
+void Distribution2D::sampleContinuous(Real u0, Real u1, Real uv[2], Real* pdf) const
+{
+    Real pdfs[2];
+    size_t v;
+    uv[1] = marginal.sampleContinuous(u1, &pdfs[1], &v);
+    uv[0] = conditional[v].sampleContinuous(u0, &pdfs[0]);
+    *pdf = pdfs[0] * pdfs[1];
+}
+
+Real Distribution2D::pdf(Real u, Real v) const
+{
+    size_t nu = conditional[0].count();
+    size_t nv = marginal.count();
+    size_t iu = clamp(static_cast<size_t>(u * nu), static_cast<size_t>(0), nu - 1);
+    size_t iv = clamp(static_cast<size_t>(v * nv), static_cast<size_t>(0), nv - 1);
+
+    if (marginal.integral() == 0.f)
+        return 1.f;
+    return conditional[iv].value(iu) / marginal.integral();
+}
@@ -0,0 +1,192 @@
+#pragma once
+
+/*!
+ * \file
+ * V souboru jsou definovány pomocné struktury pro vzorkování
+ * diskrétních rozdělení pravděpodobnosti.
+ */
+
+#include <vector>
+
+#include "core/core.h"
+
+namespace tracer
+{
+
+/*!
+ * Tabulka aliasů (Walker, Vose) pro vzorkování diskrétního rozdělení
+ * v konstantním čase. Tabulka se sestaví jednou (typicky při načítání scény)
+ * a každý další vzorek pak stojí jedno porovnání bez ohledu na počet prvků.
+ */
+class AliasTable
+{
+public:
+    /*!
+     * Vytvoří prázdnou tabulku.
+     */
+    AliasTable();
+
+    /*!
+     * Vytvoří tabulku podle zadaných vah.
+     * \param weights nezáporné váhy jednotlivých prvků
+     */
+    AliasTable(const std::vector<Real>& weights);
+
+    /*!
+     * Sestaví tabulku podle zadaných vah. Pokud je součet vah nulový,
+     * použije se rovnoměrné rozdělení.
+     * \param weights nezáporné váhy jednotlivých prvků
+     */
+    void build(const std::vector<Real>& weights);
+
+    /*!
+     * Vybere prvek úměrně jeho váze.
+     * \param u náhodná hodnota z intervalu <0; 1)
+     * \param pdf pokud není nullptr, uloží se sem pravděpodobnost vybraného prvku
+     * \param uRemapped pokud není nullptr, uloží se sem hodnota u přemapovaná
+     *        zpět na interval <0; 1), lze ji tak znovu použít jako náhodné číslo
+     * \return index vybraného prvku
+     */
+    size_t sample(Real u, Real* pdf = nullptr, Real* uRemapped = nullptr) const;
+
+    /*!
+     * Pravděpodobnost výběru zadaného prvku.
+     * \param i index prvku
+     * \return pravděpodobnost výběru
+     */
+    Real pdf(size_t i) const
+    {
+        return bins[i].pdf;
+    }
+
+    /*!
+     * \return počet prvků v tabulce
+     */
+    size_t size() const
+    {
+        return bins.size();
+    }
+
+    /*!
+     * \return součet vah, ze kterých byla tabulka sestavena
+     */
+    Real sum() const
+    {
+        return total;
+    }
+
+private:
+    /*!
+     * Jeden sloupec tabulky. Vše potřebné pro vzorek je pohromadě,
+     * takže výběr sáhne pouze do jednoho místa v paměti.
+     */
+    struct Bin
+    {
+        Real prob; ///< pravděpodobnost, že zůstane vybrán tento sloupec
+        Real pdf; ///< pravděpodobnost prvku v původním rozdělení
+        size_t alias; ///< index prvku, na který se přejde v opačném případě
+    };
+
+    std::vector<Bin> bins; ///< sloupce tabulky
+    Real total; ///< součet vah
+};
+
+/*!
+ * Po částech konstantní rozdělení pravděpodobnosti na intervalu <0; 1).
+ * Spojitý vzorek se získá inverzí distribuční funkce (CDF).
+ */
+class Distribution1D
+{
+public:
+    /*!
+     * Vytvoří prázdné rozdělení.
+     */
+    Distribution1D();
+
+    /*!
+     * Sestaví rozdělení ze zadaných hodnot funkce.
+     * \param f hodnoty funkce na jednotlivých úsecích
+     * \param n počet úseků
+     */
+    Distribution1D(const Real* f, size_t n);
+
+    /*!
+     * Sestaví rozdělení ze zadaných hodnot funkce. Pokud je integrál
+     * funkce nulový, použije se rovnoměrné rozdělení.
+     * \param f hodnoty funkce na jednotlivých úsecích
+     * \param n počet úseků
+     */
+    void build(const Real* f, size_t n);
+
+    /*!
+     * Vybere spojitý vzorek z intervalu <0; 1) úměrně funkci.
+     * \param u náhodná hodnota z intervalu <0; 1)
+     * \param pdf pokud není nullptr, uloží se sem hustota pravděpodobnosti vzorku
+     * \param offset pokud není nullptr, uloží se sem index úseku
+     * \return vzorek
+     */
+    Real sampleContinuous(Real u, Real* pdf, size_t* offset = nullptr) const;
+
+    /*!
+     * \return počet úseků
+     */
+    size_t count() const
+    { return func.size(); }
+
+    /*!
+     * \return integrál funkce přes interval <0; 1)
+     */
+    Real integral() const
+    { return funcInt; }
+
+    /*!
+     * \param i index úseku
+     * \return hodnota funkce na úseku
+     */
+    Real value(size_t i) const
+    { return func[i]; }
+
+private:
+    std::vector<Real> func; ///< hodnoty funkce
+    std::vector<Real> cdf; ///< distribuční funkce, má o jeden prvek více než func
+    Real funcInt; ///< integrál funkce
+};
+
+/*!
+ * Po částech konstantní dvourozměrné rozdělení na <0; 1)^2. Skládá se
+ * z podmíněných rozdělení pro každý řádek a marginálního rozdělení řádků.
+ */
+class Distribution2D
+{
+public:
+    /*!
+     * Sestaví rozdělení. Podmíněná rozdělení řádků se sestavují paralelně.
+     * \param f hodnoty funkce uložené po řádcích
+     * \param nu počet sloupců
+     * \param nv počet řádků
+     */
+    Distribution2D(const Real* f, size_t nu, size_t nv);
+
+    /*!
+     * Vybere spojitý vzorek úměrně funkci.
+     * \param u0 náhodná hodnota pro výběr sloupce
+     * \param u1 náhodná hodnota pro výběr řádku
+     * \param uv slouží k návratu souřadnic vzorku
+     * \param pdf slouží k návratu hustoty pravděpodobnosti vzorku
+     */
+    void sampleContinuous(Real u0, Real u1, Real uv[2], Real* pdf) const;
+
+    /*!
+     * Hustota pravděpodobnosti v zadaném bodě.
+     * \param u souřadnice ve směru sloupců
+     * \param v souřadnice ve směru řádků
+     * \return hustota pravděpodobnosti
+     */
+    Real pdf(Real u, Real v) const;
+
+private:
+    std::vector<Distribution1D> conditional; ///< rozdělení uvnitř jednotlivých řádků
+    Distribution1D marginal; ///< rozdělení řádků
+};
+
+}
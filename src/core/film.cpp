@@ -1,5 +1,10 @@
 #include "film.h"
 
+#include <cstring>
+#include <stdexcept>
+
+#include "filters/box.h"
+
 using namespace tracer;
 
 Film::Film(const Film& film)
@@ -7,21 +12,273 @@ Film::Film(const Film& film)
       height(film.height),
       size(film.size),
       gamma(film.gamma),
-      invGamma(film.invGamma)
+      invGamma(film.invGamma),
+      pixels(film.pixels),
+      splats(new SplatPixel[film.pixels.size()]),
+      splatScale(film.splatScale),
+      filterTable(film.filterTable)
+{
+    for (size_t i = 0; i < pixels.size(); ++i)
+        for (int c = 0; c < 3; ++c)
+            splats[i].rgb[c] = static_cast<Real>(film.splats[i].rgb[c]);
+}
+
+Film::Film(int width, int height, Real size, Real gamma /* = 1.f */, Real invGamma /* = 1.f */,
+           Filter* filter /* = nullptr */)
+    : Film(width, height, size, gamma, filter, true)
 {
 
 }
 
-Film::Film(int width, int height, Real size, Real gamma /* = 1.f */, Real invGamma /* = 1.f */)
+/*!
+ * Tabulka filtru se spočítá jednou pro hodnoty ve středech buněk mřížky,
+ * která pokrývá kladný kvadrant dosahu filtru.
+ */
+Film::Film(int width, int height, Real size, Real gamma, Filter* filter, bool allocate)
     : width(width),
       height(height),
       size(size),
       gamma(gamma),
-      invGamma(1.f / gamma)
+      invGamma(1.f / gamma),
+      pixels(allocate ? static_cast<size_t>(width) * height : 0),
+      splats(allocate ? new SplatPixel[pixels.size()] : nullptr),
+      splatScale(1.f)
 {
+    if (!filter)
+        filter = new BoxFilter();
 
+    filterTable.filter = filter;
+
+    Real* value = filterTable.values;
+    for (int y = 0; y < FILTER_TABLE_SIZE; ++y)
+    {
+        Real fy = (y + 0.5f) * filter->yWidth / FILTER_TABLE_SIZE;
+        for (int x = 0; x < FILTER_TABLE_SIZE; ++x)
+        {
+            Real fx = (x + 0.5f) * filter->xWidth / FILTER_TABLE_SIZE;
+            *value++ = filter->evaluate(fx, fy);
+        }
+    }
 }
 
 Film::~Film()
 {
+    delete[] splats;
+}
+
+FilmTile* Film::getFilmTile(int x0, int y0, int x1, int y1) const
+{
+    return new FilmTile(*this, x0, y0, x1, y1);
+}
+
+void Film::mergeFilmTile(const FilmTile& tile)
+{
+    std::lock_guard<std::mutex> lock(mergeMutex);
+
+    int tileWidth = tile.px1 - tile.px0;
+    for (int y = tile.py0; y < tile.py1; ++y)
+    {
+        for (int x = tile.px0; x < tile.px1; ++x)
+        {
+            const FilmTile::TilePixel& src = tile.pixels[(y - tile.py0) * tileWidth + (x - tile.px0)];
+            FilmPixel& dst = pixels[y * width + x];
+            dst.sum += src.sum;
+            dst.weightSum += src.weightSum;
+        }
+    }
+
+    int sampleWidth = tile.x1 - tile.x0;
+    for (int y = tile.y0; y < tile.y1; ++y)
+        for (int x = tile.x0; x < tile.x1; ++x)
+            pixels[y * width + x].stats.merge(tile.stats[(y - tile.y0) * sampleWidth + (x - tile.x0)]);
+}
+
+void Film::addSplat(Real px, Real py, const RGBColor& l)
+{
+    int x = static_cast<int>(std::floor(px));
+    int y = static_cast<int>(std::floor(py));
+    if (x < 0 || y < 0 || x >= width || y >= height)
+        return;
+
+    SplatPixel& p = splats[y * width + x];
+    p.rgb[0].add(l.r);
+    p.rgb[1].add(l.g);
+    p.rgb[2].add(l.b);
+}
+
+/*!
+ * Filtry se zápornými laloky mohou dát záporný součet vah, takový
+ * pixel se považuje za černý.
+ */
+RGBColor Film::pixel(int x, int y) const
+{
+    const FilmPixel& p = pixels[y * width + x];
+    const SplatPixel& s = splats[y * width + x];
+    RGBColor splat(s.rgb[0], s.rgb[1], s.rgb[2]);
+    return (p.weightSum > 0.f ? p.sum / p.weightSum : BLACK) + splat * splatScale;
+}
+
+void Film::getRow(int y, Real* rgb) const
+{
+    const FilmPixel* p = &pixels[static_cast<size_t>(y) * width];
+    const SplatPixel* s = &splats[static_cast<size_t>(y) * width];
+    for (int x = 0; x < width; ++x, rgb += 3)
+    {
+        Real invWeight = p[x].weightSum > 0.f ? 1.f / p[x].weightSum : 0.f;
+        rgb[0] = p[x].sum.r * invWeight + s[x].rgb[0] * splatScale;
+        rgb[1] = p[x].sum.g * invWeight + s[x].rgb[1] * splatScale;
+        rgb[2] = p[x].sum.b * invWeight + s[x].rgb[2] * splatScale;
+    }
+}
+
+Real Film::variance(int x, int y) const
+{
+    const PixelStats& s = pixels[y * width + x].stats;
+    return s.count > 1 ? s.m2 / (s.count - 1) : 0.f;
+}
+
+/*!
+ * K průměru se přičítá malá konstanta, aby téměř černé pixely
+ * s nepatrným šumem nebyly považovány za nekonvergované.
+ */
+Real Film::relativeError(int x, int y) const
+{
+    const PixelStats& s = pixels[y * width + x].stats;
+    if (s.count < 2)
+        return INFINITY;
+
+    Real stdError = std::sqrt(variance(x, y) / s.count);
+    return stdError / (s.mean + 1e-3f);
+}
+
+void Film::clear()
+{
+    pixels.assign(pixels.size(), FilmPixel());
+    for (size_t i = 0; i < pixels.size(); ++i)
+        for (int c = 0; c < 3; ++c)
+            splats[i].rgb[c] = 0.f;
+}
+
+Film* Film::clone() const
+{
+    return new Film(*this);
+}
+
+void Film::write(FILE* f) const
+{
+    std::vector<Real> splatValues(pixels.size() * 3);
+    for (size_t i = 0; i < pixels.size(); ++i)
+        for (int c = 0; c < 3; ++c)
+            splatValues[i * 3 + c] = splats[i].rgb[c];
+
+    const int size[2] = { width, height };
+    if (fwrite(size, sizeof(int), 2, f) != 2 ||
+        fwrite(&splatScale, sizeof(Real), 1, f) != 1 ||
+        fwrite(&pixels[0], sizeof(FilmPixel), pixels.size(), f) != pixels.size() ||
+        fwrite(&splatValues[0], sizeof(Real), splatValues.size(), f) != splatValues.size())
+        throw std::runtime_error("Cannot write film");
+}
+
+void Film::read(FILE* f)
+{
+    int size[2];
+    if (fread(size, sizeof(int), 2, f) != 2)
+        throw std::runtime_error("Cannot read film");
+    if (size[0] != width || size[1] != height)
+        throw std::runtime_error("Film size does not match");
+
+    std::vector<Real> splatValues(pixels.size() * 3);
+    if (fread(&splatScale, sizeof(Real), 1, f) != 1 ||
+        fread(&pixels[0], sizeof(FilmPixel), pixels.size(), f) != pixels.size() ||
+        fread(&splatValues[0], sizeof(Real), splatValues.size(), f) != splatValues.size())
+        throw std::runtime_error("Cannot read film");
+
+    for (size_t i = 0; i < pixels.size(); ++i)
+        for (int c = 0; c < 3; ++c)
+            splats[i].rgb[c] = splatValues[i * 3 + c];
+}
+
+/*!
+ * Střed pixelu (x, y) leží na souřadnicích (x + 0.5, y + 0.5), vzorek
+ * tedy ovlivní pixely, jejichž střed je od něj vzdálen nejvýše o poloměr filtru.
+ */
+FilmTile::FilmTile(const Film& film, int x0, int y0, int x1, int y1)
+    : x0(x0),
+      y0(y0),
+      x1(x1),
+      y1(y1),
+      film(film)
+{
+    const Filter& filter = film.filter();
+    px0 = max(0, static_cast<int>(std::ceil(x0 - 0.5f - filter.xWidth)));
+    py0 = max(0, static_cast<int>(std::ceil(y0 - 0.5f - filter.yWidth)));
+    px1 = min(film.width, static_cast<int>(std::floor(x1 - 0.5f + filter.xWidth)) + 1);
+    py1 = min(film.height, static_cast<int>(std::floor(y1 - 0.5f + filter.yWidth)) + 1);
+
+    pixels.resize(static_cast<size_t>(px1 - px0) * (py1 - py0));
+    stats.resize(static_cast<size_t>(x1 - x0) * (y1 - y0));
+    ifx.resize(static_cast<size_t>(std::ceil(2.f * filter.xWidth)) + 1);
+    ify.resize(static_cast<size_t>(std::ceil(2.f * filter.yWidth)) + 1);
+}
+
+void FilmTile::addSample(Real px, Real py, const RGBColor& l)
+{
+    const Filter& filter = film.filter();
+
+    Real dx = px - 0.5f;
+    Real dy = py - 0.5f;
+    int fx0 = max(px0, static_cast<int>(std::ceil(dx - filter.xWidth)));
+    int fy0 = max(py0, static_cast<int>(std::ceil(dy - filter.yWidth)));
+    int fx1 = min(px1 - 1, static_cast<int>(std::floor(dx + filter.xWidth)));
+    int fy1 = min(py1 - 1, static_cast<int>(std::floor(dy + filter.yWidth)));
+
+    for (int x = fx0; x <= fx1; ++x)
+    {
+        Real fx = std::fabs((x - dx) * filter.invXWidth * FILTER_TABLE_SIZE);
+        ifx[x - fx0] = min(static_cast<int>(fx), FILTER_TABLE_SIZE - 1);
+    }
+    for (int y = fy0; y <= fy1; ++y)
+    {
+        Real fy = std::fabs((y - dy) * filter.invYWidth * FILTER_TABLE_SIZE);
+        ify[y - fy0] = min(static_cast<int>(fy), FILTER_TABLE_SIZE - 1);
+    }
+
+    int tileWidth = px1 - px0;
+    for (int y = fy0; y <= fy1; ++y)
+    {
+        const Real* row = film.filterTable.values + ify[y - fy0] * FILTER_TABLE_SIZE;
+        TilePixel* p = &pixels[(y - py0) * tileWidth + (fx0 - px0)];
+        for (int x = fx0; x <= fx1; ++x, ++p)
+        {
+            Real weight = row[ifx[x - fx0]];
+            p->sum += l * weight;
+            p->weightSum += weight;
+        }
+    }
+
+    int sx = min(max(static_cast<int>(px), x0), x1 - 1);
+    int sy = min(max(static_cast<int>(py), y0), y1 - 1);
+    stats[(sy - y0) * (x1 - x0) + (sx - x0)].add(l.luminance());
+}
+
+void FilmTile::serialize(std::vector<unsigned char>& data) const
+{
+    const size_t pixelBytes = pixels.size() * sizeof(TilePixel);
+    const size_t statsBytes = stats.size() * sizeof(PixelStats);
+    const size_t offset = data.size();
+
+    data.resize(offset + pixelBytes + statsBytes);
+    memcpy(&data[offset], pixels.data(), pixelBytes);
+    memcpy(&data[offset + pixelBytes], stats.data(), statsBytes);
+}
+
+void FilmTile::deserialize(const unsigned char* data, size_t size)
+{
+    const size_t pixelBytes = pixels.size() * sizeof(TilePixel);
+    const size_t statsBytes = stats.size() * sizeof(PixelStats);
+    if (size != pixelBytes + statsBytes)
+        throw std::runtime_error("Film tile data size does not match");
+
+    memcpy(reinterpret_cast<unsigned char*>(pixels.data()), data, pixelBytes);
+    memcpy(stats.data(), data + pixelBytes, statsBytes);
 }
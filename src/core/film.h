@@ -1,13 +1,91 @@
 #pragma once
 
+#include <cstdio>
+#include <mutex>
+#include <vector>
+
 #include "core.h"
+#include "core/color.h"
+#include "core/filter.h"
+#include "core/parallel.h"
+#include "core/reference.h"
+
+#define FILTER_TABLE_SIZE 16
 
 namespace tracer
 {
 
+/*!
+ * Průběžný průměr a rozptyl jasu vzorků pixelu (Welfordův algoritmus),
+ * podle kterých se řídí adaptivní vzorkování.
+ */
+struct PixelStats
+{
+    PixelStats()
+        : mean(0.f), m2(0.f), count(0)
+    { }
+
+    /*!
+     * Přidá hodnotu vzorku.
+     * \param v jas vzorku
+     */
+    void add(Real v)
+    {
+        count++;
+        Real delta = v - mean;
+        mean += delta / count;
+        m2 += delta * (v - mean);
+    }
+
+    /*!
+     * Sloučí statistiky dvou disjunktních množin vzorků (Chanův vzorec).
+     * \param s přičítané statistiky
+     */
+    void merge(const PixelStats& s)
+    {
+        if (s.count == 0)
+            return;
+
+        unsigned int n = count + s.count;
+        Real delta = s.mean - mean;
+        mean += delta * s.count / n;
+        m2 += s.m2 + delta * delta * (static_cast<Real>(count) * s.count / n);
+        count = n;
+    }
+
+    Real mean; ///< průběžný průměr jasu vzorků
+    Real m2; ///< součet čtverců odchylek jasu od průměru
+    unsigned int count; ///< počet vzorků
+};
+
+/*!
+ * Údaje uchovávané pro jeden pixel filmu: váhovaný součet vzorků,
+ * součet vah rekonstrukčního filtru a statistiky vzorků.
+ */
+struct FilmPixel
+{
+    FilmPixel()
+        : weightSum(0.f)
+    { }
+
+    RGBColor sum; ///< součet vzorků vynásobených vahou filtru
+    Real weightSum; ///< součet vah filtru
+    PixelStats stats; ///< statistiky vzorků, které padly do pixelu
+};
+
+class FilmTile;
+
 /*!
  * Třída Film reprezentuje film v kameře. Narozdíl od klasického filmu v reálném světě,
  * tento uchovává takové atributy, které jsou potom využitelné pro práci s počítačovou grafikou.
+ *
+ * Vzorky se do filmu nepřidávají přímo, ale přes dlaždice (FilmTile), které
+ * si každé vlákno vytvoří pomocí getFilmTile() a po dokončení je sloučí
+ * metodou mergeFilmTile(). Vlákna tak při vzorkování nesdílí žádnou paměť.
+ *
+ * Příspěvky, které nepatří pixelu právě sledovaného paprsku (např. při
+ * sledování cest ze světla), se přidávají metodou addSplat() do zvláštního
+ * bufferu bez zámku. Ten se k výsledku přičte až v metodě pixel().
  */
 class Film
 {
@@ -27,13 +105,141 @@ public:
      * \param size velikost pixelu ve scéně
      * \param gamma gamma obrázku
      * \param invGamma inverzní gamma pro zjednodušení operace dělení
+     * \param filter rekonstrukční filtr, pokud je nullptr, použije se krabicový filtr o poloměru 0.5
      */
-    Film(int width, int height, Real size, Real gamma = 1.f, Real invGamma = 1.f);
+    Film(int width, int height, Real size, Real gamma = 1.f, Real invGamma = 1.f,
+         Filter* filter = nullptr);
 
     /*!
      * Destruktor
      */
-    ~Film();
+    virtual ~Film();
+
+    Film& operator=(const Film&) = delete;
+
+    /*!
+     * Vytvoří dlaždici pro vzorky, jejichž poloha leží v zadaném obdélníku
+     * pixelů. Dlaždice pokrývá i okolní pixely, do kterých zasahuje filtr.
+     * \param x0 levý okraj (včetně)
+     * \param y0 horní okraj (včetně)
+     * \param x1 pravý okraj (bez)
+     * \param y1 dolní okraj (bez)
+     * \return nová dlaždice na haldě, po sloučení ji maže volající
+     */
+    FilmTile* getFilmTile(int x0, int y0, int x1, int y1) const;
+
+    /*!
+     * Přičte obsah dlaždice do filmu. Lze volat z více vláken současně.
+     * \param tile dlaždice vytvořená metodou getFilmTile()
+     */
+    virtual void mergeFilmTile(const FilmTile& tile);
+
+    /*!
+     * Přičte příspěvek do pixelu, do kterého padne zadaná poloha. Lze volat
+     * z libovolného počtu vláken současně, nic se nezamyká. Příspěvky mimo
+     * film se zahodí.
+     * \param px poloha na filmu v pixelech
+     * \param py poloha na filmu v pixelech
+     * \param l přičítaná radiance
+     */
+    virtual void addSplat(Real px, Real py, const RGBColor& l);
+
+    /*!
+     * \return true, pokud film podporuje addSplat()
+     */
+    virtual bool supportsSplats() const
+    { return true; }
+
+    /*!
+     * \return true, pokud lze do stejných pixelů slučovat dlaždice opakovaně
+     * (více průchodů) a film vede statistiky vzorků pro sampleCount(),
+     * variance() a relativeError()
+     */
+    virtual bool supportsPasses() const
+    { return true; }
+
+    /*!
+     * Nastaví měřítko, kterým se násobí splat buffer při výpočtu pixelu.
+     * Typicky převrácená hodnota počtu vzorků na pixel, kterými se splaty tvořily.
+     * \param scale měřítko
+     */
+    void setSplatScale(Real scale)
+    { splatScale = scale; }
+
+    /*!
+     * Aktuální odhad hodnoty pixelu (váhovaný průměr vzorků) včetně
+     * přeškálovaného obsahu splat bufferu.
+     * \param x souřadnice pixelu
+     * \param y souřadnice pixelu
+     * \return hodnota pixelu
+     */
+    virtual RGBColor pixel(int x, int y) const;
+
+    /*!
+     * Zapíše hodnoty celého řádku pixelů (stejně jako pixel()) do pole
+     * složek RGB. Slouží k výstupu obrázku po řádcích bez kopie celého snímku.
+     * \param y index řádku
+     * \param rgb výstupní pole o velikosti 3 * width
+     */
+    virtual void getRow(int y, Real* rgb) const;
+
+    /*!
+     * \param x souřadnice pixelu
+     * \param y souřadnice pixelu
+     * \return počet vzorků pixelu
+     */
+    virtual unsigned int sampleCount(int x, int y) const
+    { return pixels[y * width + x].stats.count; }
+
+    /*!
+     * Výběrový rozptyl jasu vzorků pixelu.
+     * \param x souřadnice pixelu
+     * \param y souřadnice pixelu
+     * \return rozptyl, nebo 0 pokud má pixel méně než dva vzorky
+     */
+    virtual Real variance(int x, int y) const;
+
+    /*!
+     * Relativní chyba odhadu pixelu, tedy směrodatná chyba průměru
+     * vydělená průměrem. Slouží jako kritérium konvergence.
+     * \param x souřadnice pixelu
+     * \param y souřadnice pixelu
+     * \return relativní chyba, nebo INFINITY pokud má pixel méně než dva vzorky
+     */
+    virtual Real relativeError(int x, int y) const;
+
+    /*!
+     * Vymaže všechny vzorky.
+     */
+    virtual void clear();
+
+    /*!
+     * Vytvoří kopii filmu na haldě, například pro uložení stavu
+     * v jiném vlákně, zatímco se do filmu dál vykresluje.
+     * \return nová kopie, maže ji volající
+     */
+    virtual Film* clone() const;
+
+    /*!
+     * Zapíše nasčítané hodnoty všech pixelů (včetně statistik a splat
+     * bufferu) do souboru v binární podobě. Při chybě vyhodí výjimku
+     * std::runtime_error.
+     * \param f otevřený soubor
+     */
+    virtual void write(FILE* f) const;
+
+    /*!
+     * Načte hodnoty zapsané metodou write(). Film musí mít stejné rozměry.
+     * Při chybě vyhodí výjimku std::runtime_error.
+     * \param f otevřený soubor
+     */
+    virtual void read(FILE* f);
+
+    /*!
+     * \return rekonstrukční filtr filmu
+     */
+    const Filter& filter() const
+    { return *filterTable.filter; }
 
 public:
     int width; ///< výška v pixelech
@@ -41,6 +247,121 @@ public:
     float size; ///< velikost pixelu ve scéně
     float gamma; ///< gamma obrázku
     float invGamma; ///< inverzní gamma pro zjednodušení operace dělení
+
+protected:
+    /*!
+     * Konstruktor pro potomky, kteří si pixely ukládají sami.
+     * \param width výška v pixelech
+     * \param height šířka v pixelech
+     * \param size velikost pixelu ve scéně
+     * \param gamma gamma obrázku
+     * \param filter rekonstrukční filtr, pokud je nullptr, použije se krabicový filtr o poloměru 0.5
+     * \param allocate pokud je false, nealokují se pixely ani splat buffer
+     */
+    Film(int width, int height, Real size, Real gamma, Filter* filter, bool allocate);
+
+private:
+    friend class FilmTile;
+
+    /*!
+     * Předpočítané hodnoty filtru na mřížce FILTER_TABLE_SIZE^2 pokrývající
+     * jeden kvadrant (filtry jsou symetrické). Při přidávání vzorků se filtr
+     * nevyhodnocuje, pouze se vyhledá nejbližší hodnota v tabulce.
+     */
+    struct FilterTable
+    {
+        mutable Reference<Filter> filter; ///< filtr, ze kterého je tabulka spočítaná
+        Real values[FILTER_TABLE_SIZE * FILTER_TABLE_SIZE]; ///< hodnoty filtru po řádcích
+    };
+
+    /*!
+     * Pixel splat bufferu.
+     */
+    struct SplatPixel
+    {
+        AtomicFloat rgb[3]; ///< složky přičtené radiance
+    };
+
+    std::vector<FilmPixel> pixels; ///< pixely uložené po řádcích
+    SplatPixel* splats; ///< splat buffer uložený po řádcích
+    Real splatScale; ///< měřítko splat bufferu
+    FilterTable filterTable; ///< tabulka rekonstrukčního filtru
+    std::mutex mergeMutex; ///< zámek pro slučování dlaždic
+};
+
+/*!
+ * Část filmu, do které přidává vzorky jedno vlákno. Obsahuje vlastní
+ * kopii pixelů včetně okraje, do kterého zasahuje filtr, takže se při
+ * přidávání vzorků nic nezamyká. Do filmu se přičte metodou Film::mergeFilmTile().
+ */
+class FilmTile
+{
+public:
+    /*!
+     * Konstruktor. Používá se přes Film::getFilmTile().
+     * \param film film, ke kterému dlaždice patří
+     * \param x0 levý okraj oblasti vzorků (včetně)
+     * \param y0 horní okraj oblasti vzorků (včetně)
+     * \param x1 pravý okraj oblasti vzorků (bez)
+     * \param y1 dolní okraj oblasti vzorků (bez)
+     */
+    FilmTile(const Film& film, int x0, int y0, int x1, int y1);
+
+    /*!
+     * Přidá vzorek. Jeho poloha musí ležet v oblasti vzorků dlaždice.
+     * \param px poloha vzorku na filmu v pixelech
+     * \param py poloha vzorku na filmu v pixelech
+     * \param l radiance vzorku
+     */
+    void addSample(Real px, Real py, const RGBColor& l);
+
+    /*!
+     * Zapíše obsah dlaždice (pixely včetně okraje a statistiky) na konec
+     * bufferu, např. pro odeslání po síti.
+     * \param data buffer, do kterého se přidávají bajty
+     */
+    void serialize(std::vector<unsigned char>& data) const;
+
+    /*!
+     * Nahradí obsah dlaždice daty zapsanými metodou serialize() u dlaždice
+     * se stejnými rozměry a filtrem. Při nesouhlasné velikosti dat vyhodí
+     * výjimku std::runtime_error.
+     * \param data začátek dat
+     * \param size velikost dat v bajtech
+     */
+    void deserialize(const unsigned char* data, size_t size);
+
+    const int x0; ///< levý okraj oblasti vzorků
+    const int y0; ///< horní okraj oblasti vzorků
+    const int x1; ///< pravý okraj oblasti vzorků
+    const int y1; ///< dolní okraj oblasti vzorků
+
+private:
+    friend class Film;
+    friend class TiledFilm;
+
+    /*!
+     * Pixel dlaždice.
+     */
+    struct TilePixel
+    {
+        TilePixel()
+            : weightSum(0.f)
+        { }
+
+        RGBColor sum; ///< součet vzorků vynásobených vahou filtru
+        Real weightSum; ///< součet vah filtru
+    };
+
+    const Film& film; ///< Film, ke kterému dlaždice patří.
+    int px0; ///< Levý okraj pixelů dlaždice (včetně).
+    int py0; ///< Horní okraj pixelů dlaždice (včetně).
+    int px1; ///< Pravý okraj pixelů dlaždice (bez).
+    int py1; ///< Dolní okraj pixelů dlaždice (bez).
+    std::vector<TilePixel> pixels; ///< Pixely dlaždice včetně okraje.
+    std::vector<PixelStats> stats; ///< Statistiky pixelů oblasti vzorků.
+    std::vector<int> ifx; ///< Pomocné pole indexů do tabulky filtru ve směru x.
+    std::vector<int> ify; ///< Pomocné pole indexů do tabulky filtru ve směru y.
 };
 
 }
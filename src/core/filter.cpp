@@ -0,0 +1,13 @@
+#include "core/filter.h"
+
+using namespace tracer;
+
+Filter::Filter(Real xWidth, Real yWidth)
+    : xWidth(xWidth),
+      yWidth(yWidth),
+      invXWidth(1.f / xWidth),
+      invYWidth(1.f / yWidth)
+{ }
+
+Filter::~Filter()
+{ }
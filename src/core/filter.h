@@ -0,0 +1,50 @@
+#pragma once
+
+#include "core/core.h"
+#include "core/reference.h"
+
+namespace tracer
+{
+
+/*!
+ * Rozhraní rekonstrukčních filtrů. Filtr určuje, jakou vahou přispěje vzorek
+ * do okolních pixelů podle jeho vzdálenosti od jejich středů. Třída Filter
+ * dědí z třídy ReferenceCounted, takže může být předávána pomocí
+ * instance třídy Reference<Filter>.
+ */
+class Filter : public ReferenceCounted
+{
+public:
+    /*!
+     * Konstruktor.
+     * \param xWidth poloměr filtru ve směru x (v pixelech)
+     * \param yWidth poloměr filtru ve směru y (v pixelech)
+     */
+    Filter(Real xWidth, Real yWidth);
+
+    /*!
+     * Virtuální destruktor.
+     */
+    virtual ~Filter();
+
+    /*!
+     * Hodnota filtru v zadané vzdálenosti od středu. Volá se pouze
+     * při sestavování tabulky filtru ve třídě Film, ne pro každý vzorek.
+     * \param x vzdálenost ve směru x
+     * \param y vzdálenost ve směru y
+     * \return váha vzorku
+     */
+    virtual Real evaluate(Real x, Real y) const = 0;
+
+    /*!
+     * \return jméno typu filtru, stejné jako v atributu filter souboru scény
+     */
+    virtual const char* name() const = 0;
+
+    const Real xWidth; ///< poloměr ve směru x
+    const Real yWidth; ///< poloměr ve směru y
+    const Real invXWidth; ///< převrácená hodnota xWidth
+    const Real invYWidth; ///< převrácená hodnota yWidth
+};
+
+}
@@ -292,7 +292,7 @@ public:
      * Bezparametrický konstruktor.
      */
     Ray()
-            : mint(0.f), maxt(INFINITY), rayEpsilon(EPSILON), depth(0)
+            : mint(0.f), maxt(INFINITY), rayEpsilon(EPSILON), depth(0), spread(0.f)
     { }
 
     /*!
@@ -306,7 +306,7 @@ public:
      */
     Ray(const Vector& _o, const Vector& _d, float start = 0.f, float end =
     INFINITY, float eps = EPSILON, int _depth = 0)
-            : o(_o), d(_d), mint(start), maxt(end), rayEpsilon(eps), depth(_depth)
+            : o(_o), d(_d), mint(start), maxt(end), rayEpsilon(eps), depth(_depth), spread(0.f)
     { }
 
     /*!
@@ -325,6 +325,7 @@ public:
     mutable Real maxt; ///< maximalni hodnota parametru t
     mutable Real rayEpsilon; ///< vypocitane epsilon (zamezuje vzniku artefaktu)
     mutable int depth; ///< hloubka rekurze
+    Real spread; ///< šířka stopy paprsku na jednotku délky d (0 = bod), pro volbu úrovně MIP textur
 };
 
 /*!
@@ -0,0 +1,92 @@
+#include "core/imageio.h"
+
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+
+using namespace tracer;
+
+namespace
+{
+
+/*!
+ * Přečte z hlavičky jedno slovo oddělené bílými znaky.
+ */
+std::string readToken(FILE* f)
+{
+    std::string token;
+    int c;
+    while ((c = fgetc(f)) != EOF && isspace(c));
+    while (c != EOF && !isspace(c))
+    {
+        token += static_cast<char>(c);
+        c = fgetc(f);
+    }
+    return token;
+}
+
+bool isLittleEndianHost()
+{
+    const unsigned int one = 1;
+    return *reinterpret_cast<const unsigned char*>(&one) == 1;
+}
+
+}
+
+std::vector<RGBColor> tracer::readPFM(const char* file, int& width, int& height)
+{
+    FILE* f = fopen(file, "rb");
+    if (!f)
+        throw std::runtime_error(std::string("Cannot open file ") + file);
+
+    std::string magic = readToken(f);
+    int channels = magic == "PF" ? 3 : (magic == "Pf" ? 1 : 0);
+    width = atoi(readToken(f).c_str());
+    height = atoi(readToken(f).c_str());
+    double scale = atof(readToken(f).c_str());
+
+    if (channels == 0 || width <= 0 || height <= 0 || scale == 0.0)
+    {
+        fclose(f);
+        throw std::runtime_error(std::string("Invalid PFM header in ") + file);
+    }
+
+    // Záporné měřítko značí little-endian data.
+    const bool swapBytes = (scale < 0.0) != isLittleEndianHost();
+    const size_t rowSize = static_cast<size_t>(width) * channels;
+
+    std::vector<float> row(rowSize);
+    std::vector<RGBColor> pixels(static_cast<size_t>(width) * height);
+
+    // Řádky jsou v souboru uloženy odspodu nahoru.
+    for (int y = height - 1; y >= 0; --y)
+    {
+        if (fread(&row[0], sizeof(float), rowSize, f) != rowSize)
+        {
+            fclose(f);
+            throw std::runtime_error(std::string("Unexpected end of file ") + file);
+        }
+
+        if (swapBytes)
+        {
+            for (size_t i = 0; i < rowSize; ++i)
+            {
+                unsigned char* b = reinterpret_cast<unsigned char*>(&row[i]);
+                std::swap(b[0], b[3]);
+                std::swap(b[1], b[2]);
+            }
+        }
+
+        RGBColor* out = &pixels[static_cast<size_t>(y) * width];
+        for (int x = 0; x < width; ++x)
+        {
+            const float* in = &row[static_cast<size_t>(x) * channels];
+            out[x] = channels == 3 ? RGBColor(in[0], in[1], in[2]) : RGBColor(in[0], in[0], in[0]);
+        }
+    }
+
+    fclose(f);
+    return pixels;
+}
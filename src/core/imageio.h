@@ -0,0 +1,27 @@
+#pragma once
+
+/*!
+ * \file
+ * V souboru jsou definovány funkce pro čtení obrázků z disku.
+ */
+
+#include <vector>
+
+#include "core/core.h"
+#include "core/color.h"
+
+namespace tracer
+{
+
+/*!
+ * Načte obrázek ve formátu PFM (Portable Float Map). Podporuje barevnou (PF)
+ * i šedotónovou (Pf) variantu v obou pořadích bajtů. Při chybě vyhodí
+ * výjimku std::runtime_error.
+ * \param file cesta k souboru
+ * \param width slouží k návratu šířky obrázku
+ * \param height slouží k návratu výšky obrázku
+ * \return pixely uložené po řádcích od levého horního rohu
+ */
+std::vector<RGBColor> readPFM(const char* file, int& width, int& height);
+
+}
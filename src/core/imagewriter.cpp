@@ -0,0 +1,106 @@
+#include "core/imagewriter.h"
+
+#include <cmath>
+#include <stdexcept>
+
+using namespace tracer;
+
+ImageWriter::ImageWriter(const Film& film)
+    : film(film),
+      f(nullptr),
+      headerSize(0),
+      rowRadius(static_cast<int>(std::ceil(film.filter().yWidth))),
+      covered(film.height, 0),
+      written(film.height, false)
+{ }
+
+ImageWriter::~ImageWriter()
+{
+    if (f)
+        fclose(f);
+}
+
+void ImageWriter::open(const char* file)
+{
+    f = fopen(file, "wb");
+    if (!f)
+        throw std::runtime_error(std::string("Cannot open file ") + file);
+
+    std::string h = header();
+    if (fwrite(h.data(), 1, h.size(), f) != h.size())
+        throw std::runtime_error(std::string("Cannot write file ") + file);
+
+    headerSize = static_cast<long>(h.size());
+    rgbRow.resize(static_cast<size_t>(film.width) * 3);
+    outRow.resize(static_cast<size_t>(film.width) * bytesPerPixel());
+}
+
+void ImageWriter::tileDone(int x0, int y0, int x1, int y1)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    for (int y = y0; y < y1; ++y)
+        covered[y] += x1 - x0;
+
+    int from = max(0, y0 - rowRadius);
+    int to = min(film.height, y1 + rowRadius);
+    for (int y = from; y < to; ++y)
+        if (!written[y] && rowReady(y))
+            writeRow(y);
+}
+
+void ImageWriter::writeRows(int y0, int y1)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    for (int y = y0; y < y1; ++y)
+        writeRow(y);
+}
+
+void ImageWriter::close()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (!f)
+        return;
+
+    for (int y = 0; y < film.height; ++y)
+        if (!written[y])
+            writeRow(y);
+
+    if (fclose(f) != 0 && error.empty())
+        error = "Cannot write image file";
+    f = nullptr;
+
+    if (!error.empty())
+        throw std::runtime_error(error);
+}
+
+void ImageWriter::writeRow(int y)
+{
+    if (!error.empty())
+        return;
+
+    film.getRow(y, &rgbRow[0]);
+    convertRow(&rgbRow[0], &outRow[0]);
+
+    int fileRow = bottomUp() ? film.height - 1 - y : y;
+    long offset = headerSize + static_cast<long>(fileRow) * static_cast<long>(outRow.size());
+    if (fseek(f, offset, SEEK_SET) != 0 || fwrite(&outRow[0], 1, outRow.size(), f) != outRow.size())
+    {
+        error = "Cannot write image row " + std::to_string(y);
+        return;
+    }
+
+    written[y] = true;
+}
+
+bool ImageWriter::rowReady(int y) const
+{
+    int from = max(0, y - rowRadius);
+    int to = min(film.height - 1, y + rowRadius);
+    for (int i = from; i <= to; ++i)
+        if (covered[i] < film.width)
+            return false;
+    return true;
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "core/core.h"
+#include "core/film.h"
+
+namespace tracer
+{
+
+/*!
+ * Rozhraní pro zápis obrázku z filmu na disk po řádcích. Všechny řádky
+ * mají v souboru pevnou velikost, každý řádek se proto zapíše na své místo
+ * hned, jak je hotový, v libovolném pořadí. V paměti se drží pouze jeden
+ * převedený řádek, celý snímek se nikdy nekopíruje.
+ *
+ * Renderer oznamuje hotové dlaždice metodou tileDone(). Řádek se zapíše,
+ * jakmile jsou hotové všechny dlaždice, jejichž vzorky do něj mohou
+ * zasáhnout přes rekonstrukční filtr.
+ *
+ * Chyba zápisu řádku se jen zaznamená (tileDone() a writeRows() se volají
+ * z vykreslovacích vláken, kde by výjimka ukončila proces), další řádky se
+ * už nezapisují a výjimku vyhodí až close().
+ */
+class ImageWriter
+{
+public:
+    /*!
+     * Konstruktor.
+     * \param film film, ze kterého se obrázek zapisuje
+     */
+    ImageWriter(const Film& film);
+
+    /*!
+     * Destruktor. Zavře soubor, pokud je otevřený.
+     */
+    virtual ~ImageWriter();
+
+    ImageWriter(const ImageWriter&) = delete;
+    ImageWriter& operator=(const ImageWriter&) = delete;
+
+    /*!
+     * Oznámí dokončení dlaždice. Lze volat z více vláken současně.
+     * Zapíše všechny řádky, které tím byly dokončeny. Nevyhazuje výjimky,
+     * chybu zápisu ohlásí až close().
+     * \param x0 levý okraj dlaždice (včetně)
+     * \param y0 horní okraj dlaždice (včetně)
+     * \param x1 pravý okraj dlaždice (bez)
+     * \param y1 dolní okraj dlaždice (bez)
+     */
+    void tileDone(int x0, int y0, int x1, int y1);
+
+    /*!
+     * Zapíše zadané řádky bez ohledu na to, zda jsou hotové.
+     * Lze volat z více vláken současně. Chybu zápisu ohlásí až close().
+     * \param y0 první řádek (včetně)
+     * \param y1 poslední řádek (bez)
+     */
+    void writeRows(int y0, int y1);
+
+    /*!
+     * Zapíše řádky, které ještě zapsány nebyly, a zavře soubor. Pokud
+     * některý zápis selhal, vyhodí výjimku std::runtime_error.
+     */
+    void close();
+
+protected:
+    /*!
+     * Otevře soubor a zapíše hlavičku. Volají konstruktory potomků.
+     * Při chybě vyhodí výjimku std::runtime_error.
+     * \param file cesta k souboru
+     */
+    void open(const char* file);
+
+    /*!
+     * \return hlavička souboru
+     */
+    virtual std::string header() const = 0;
+
+    /*!
+     * \return počet bajtů jednoho pixelu v souboru
+     */
+    virtual size_t bytesPerPixel() const = 0;
+
+    /*!
+     * \return true, pokud jsou řádky v souboru uloženy odspodu nahoru
+     */
+    virtual bool bottomUp() const = 0;
+
+    /*!
+     * Převede řádek pixelů do formátu souboru.
+     * \param rgb složky RGB řádku, 3 * width hodnot
+     * \param out výstup o velikosti width * bytesPerPixel()
+     */
+    virtual void convertRow(const Real* rgb, unsigned char* out) const = 0;
+
+    const Film& film; ///< Zapisovaný film.
+
+private:
+    /*!
+     * Převede a zapíše jeden řádek, při chybě ji zaznamená. Po první
+     * chybě už nic nezapisuje. Volající drží zámek.
+     * \param y index řádku
+     */
+    void writeRow(int y);
+
+    /*!
+     * \param y index řádku
+     * \return true, pokud jsou hotové všechny řádky v dosahu filtru
+     */
+    bool rowReady(int y) const;
+
+    FILE* f; ///< Otevřený soubor.
+    long headerSize; ///< Velikost hlavičky v bajtech.
+    int rowRadius; ///< Počet sousedních řádků, které zasahují přes filtr.
+    std::vector<int> covered; ///< Počet hotových sloupců v každém řádku.
+    std::vector<bool> written; ///< Příznaky zapsaných řádků.
+    std::vector<Real> rgbRow; ///< Pomocný řádek složek RGB.
+    std::vector<unsigned char> outRow; ///< Pomocný převedený řádek.
+    std::string error; ///< První chyba zápisu, prázdný řetězec pokud žádná nenastala.
+    std::mutex mutex; ///< Zámek pro zápis.
+};
+
+}
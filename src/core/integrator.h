@@ -28,6 +28,12 @@ public:
      * \return světelný příspěvek v bodě
      */
     virtual RGBColor l(const Ray& ray, const Scene& scene, Intersection& inter) const = 0;
+
+    /*!
+     * \return true, pokud integrátor přidává příspěvky do filmu metodou Film::addSplat()
+     */
+    virtual bool usesSplats() const
+    { return false; }
 };
 
 }
\ No newline at end of file
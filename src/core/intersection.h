@@ -18,7 +18,10 @@ struct Intersection
         : hitObject(false),
           material(nullptr),
           depth(0),
-          t(INFINITY)
+          t(INFINITY),
+          u(0.f),
+          v(0.f),
+          footprint(0.f)
     { }
 
     Intersection(const Intersection& i)
@@ -28,7 +31,10 @@ struct Intersection
           ray(i.ray),
           material(i.material),
           depth(i.depth),
-          t(i.t)
+          t(i.t),
+          u(i.u),
+          v(i.v),
+          footprint(i.footprint)
     { }
 
     bool hitObject; ///< protnul paprsek objekt?
@@ -38,6 +44,8 @@ struct Intersection
     Reference<Material> material; ///< Reference na materiál objektu
     int depth; ///< Hloubka rekurze
     float t; ///< hodnota parametru t v místě dopadu
+    Real u, v; ///< Texturové souřadnice v místě dopadu
+    Real footprint; ///< Šířka stopy paprsku v texturových souřadnicích (0 = bod)
 };
 
 }
\ No newline at end of file
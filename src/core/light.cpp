@@ -9,4 +9,27 @@ Light::Light(const Light& light)
 { }
 
 Light::~Light()
-{ }
\ No newline at end of file
+{ }
+
+RGBColor Light::sampleL(const Intersection& inter, const LightSample& sample,
+                        Vector& wi, Real& pdf, Ray& shadowRay) const
+{
+    wi = direction(inter);
+    wi.normalize();
+    pdf = 1.f;
+    shadowRay = Ray(inter.hitPoint, wi, EPSILON);
+    return l(inter);
+}
+
+Real Light::power() const
+{
+    return 1.f;
+}
+
+RGBColor Light::le(const Ray& ray) const
+{
+    return BLACK;
+}
+
+void Light::preprocess(const Scene& scene)
+{ }
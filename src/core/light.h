@@ -8,6 +8,31 @@
 namespace tracer
 {
 
+class Scene;
+
+/*!
+ * Struktura uchovává náhodné hodnoty, které jsou potřeba pro vzorkování světla.
+ */
+struct LightSample
+{
+    LightSample()
+        : uComponent(0.5f)
+    { uPos[0] = uPos[1] = 0.5f; }
+
+    /*!
+     * Konstruktor.
+     * \param uc hodnota pro výběr části světla
+     * \param u1 první hodnota pro výběr bodu na světle
+     * \param u2 druhá hodnota pro výběr bodu na světle
+     */
+    LightSample(Real uc, Real u1, Real u2)
+        : uComponent(uc)
+    { uPos[0] = u1; uPos[1] = u2; }
+
+    Real uComponent; ///< výběr části světla (např. trojúhelníku sítě)
+    Real uPos[2]; ///< výběr bodu na zvolené části
+};
+
 /*!
  * Rozhraní pro objekty světel. Je možné z nich získat intezitu osvětlení daného bodu
  * a směr k danému bodu.
@@ -44,6 +69,42 @@ public:
 	 * \return hodnota světelného příspěvku
 	 */
     virtual RGBColor l(const Intersection& inter) const = 0;
+
+    /*!
+     * Vybere na světle bod, ze kterého přichází světlo do místa průsečíku.
+     * Výchozí implementace odpovídá bodovým světlům a využívá metody
+     * direction() a l().
+     * \param inter informace o průsečíku
+     * \param sample náhodné hodnoty pro výběr bodu
+     * \param wi slouží k návratu normalizovaného směru ke světlu
+     * \param pdf slouží k návratu hustoty pravděpodobnosti vzorku (vzhledem k prostorovému úhlu)
+     * \param shadowRay slouží k návratu stínového paprsku mezi průsečíkem a světlem
+     * \return světelný příspěvek vzorku
+     */
+    virtual RGBColor sampleL(const Intersection& inter, const LightSample& sample,
+                             Vector& wi, Real& pdf, Ray& shadowRay) const;
+
+    /*!
+     * Odhad celkového vyzářeného výkonu. Podle něj se mezi světly vybírá
+     * při vzorkování scény.
+     * \return výkon světla
+     */
+    virtual Real power() const;
+
+    /*!
+     * Radiance, kterou světlo přispívá paprsku, jenž neprotnul žádné těleso.
+     * Nenulovou hodnotu vrací pouze světla v nekonečnu.
+     * \param ray paprsek, který opustil scénu
+     * \return radiance ve směru paprsku
+     */
+    virtual RGBColor le(const Ray& ray) const;
+
+    /*!
+     * Volá se po sestavení scény, světlo si může připravit údaje,
+     * které závisí na scéně (např. její rozměry).
+     * \param scene sestavená scéna
+     */
+    virtual void preprocess(const Scene& scene);
 };
 
 }
\ No newline at end of file
@@ -0,0 +1,225 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
+#include "core/reference.h"
+
+namespace tracer
+{
+
+/*!
+ * Vláknově bezpečná cache s pevným rozpočtem paměti, která při jeho
+ * překročení vyřazuje nejdéle nepoužité položky (LRU). Hodnoty se předávají
+ * přes Reference, vyřazená položka tak zůstane platná, dokud ji používá
+ * některé vlákno, a rozpočet může být přechodně překročen o právě používané
+ * položky.
+ *
+ * Chybějící hodnota se načte zadanou funkcí mimo zámek, ostatní vlákna
+ * mezitím mohou cache používat. Pokud stejnou hodnotu načtou dvě vlákna
+ * současně, uloží se první a druhá kopie se zahodí.
+ *
+ * \tparam Key klíč položky
+ * \tparam Value hodnota, musí dědit od ReferenceCounted
+ * \tparam Hash hašovací funkce klíče
+ */
+template<class Key, class Value, class Hash = std::hash<Key>>
+class LRUCache : public ReferenceCounted
+{
+public:
+    /*!
+     * Funkce, která načte chybějící hodnotu a vrátí přes parametr její
+     * velikost v bajtech.
+     */
+    typedef std::function<Value*(size_t& size)> Loader;
+
+    /*!
+     * Konstruktor.
+     * \param budget rozpočet paměti v bajtech
+     */
+    explicit LRUCache(size_t budget)
+        : budget(budget),
+          used(0),
+          hitCount(0),
+          missCount(0),
+          evictionCount(0)
+    { }
+
+    LRUCache(const LRUCache&) = delete;
+    LRUCache& operator=(const LRUCache&) = delete;
+
+    /*!
+     * Vrátí hodnotu z cache, chybějící načte a vloží. Načítací funkce může
+     * vyhodit výjimku, cache pak zůstane beze změny.
+     * \param key klíč
+     * \param load funkce, která hodnotu načte
+     * \return hodnota
+     */
+    Reference<Value> get(const Key& key, const Loader& load)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            typename Map::iterator it = map.find(key);
+            if (it != map.end())
+            {
+                entries.splice(entries.begin(), entries, it->second);
+                hitCount.fetch_add(1, std::memory_order_relaxed);
+                return it->second->value;
+            }
+        }
+
+        size_t size = 0;
+        Reference<Value> value(load(size));
+        missCount.fetch_add(1, std::memory_order_relaxed);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        typename Map::iterator it = map.find(key);
+        if (it != map.end())
+        {
+            entries.splice(entries.begin(), entries, it->second);
+            return it->second->value;
+        }
+
+        entries.push_front(Entry(key, value, size));
+        map[key] = entries.begin();
+        used += size;
+        evict();
+        return value;
+    }
+
+    /*!
+     * Vrátí hodnotu, pokud je v cache, a označí ji jako použitou.
+     * \param key klíč
+     * \return hodnota nebo prázdná reference
+     */
+    Reference<Value> find(const Key& key)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        typename Map::iterator it = map.find(key);
+        if (it == map.end())
+            return Reference<Value>();
+        entries.splice(entries.begin(), entries, it->second);
+        return it->second->value;
+    }
+
+    /*!
+     * Odebere hodnotu z cache.
+     * \param key klíč
+     */
+    void erase(const Key& key)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        typename Map::iterator it = map.find(key);
+        if (it == map.end())
+            return;
+        used -= it->second->size;
+        entries.erase(it->second);
+        map.erase(it);
+    }
+
+    /*!
+     * Odebere všechny hodnoty.
+     */
+    void clear()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        entries.clear();
+        map.clear();
+        used = 0;
+    }
+
+    /*!
+     * Změní rozpočet, případně hned vyřadí přebývající položky.
+     * \param bytes nový rozpočet v bajtech
+     */
+    void setBudget(size_t bytes)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        budget = bytes;
+        evict();
+    }
+
+    /*! \return rozpočet v bajtech */
+    size_t capacity() const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return budget;
+    }
+
+    /*! \return součet velikostí položek v cache */
+    size_t size() const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return used;
+    }
+
+    /*! \return počet položek v cache */
+    size_t numEntries() const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return map.size();
+    }
+
+    /*! \return počet dotazů, které hodnotu našly v cache */
+    size_t hits() const
+    { return hitCount.load(std::memory_order_relaxed); }
+
+    /*! \return počet dotazů, které hodnotu musely načíst */
+    size_t misses() const
+    { return missCount.load(std::memory_order_relaxed); }
+
+    /*! \return počet vyřazených položek */
+    size_t evictions() const
+    { return evictionCount.load(std::memory_order_relaxed); }
+
+private:
+    /*!
+     * Položka cache.
+     */
+    struct Entry
+    {
+        Entry(const Key& key, const Reference<Value>& value, size_t size)
+            : key(key), value(value), size(size)
+        { }
+
+        Key key; ///< Klíč.
+        Reference<Value> value; ///< Hodnota.
+        size_t size; ///< Velikost v bajtech.
+    };
+
+    typedef std::list<Entry> List;
+    typedef std::unordered_map<Key, typename List::iterator, Hash> Map;
+
+    /*!
+     * Vyřadí nejdéle nepoužité položky, dokud se nevejdou do rozpočtu.
+     * Poslední vložená položka zůstane vždy, i když je větší než rozpočet.
+     * Volá se pod zámkem.
+     */
+    void evict()
+    {
+        while (used > budget && entries.size() > 1)
+        {
+            const Entry& last = entries.back();
+            used -= last.size;
+            map.erase(last.key);
+            entries.pop_back();
+            evictionCount.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    mutable std::mutex mutex; ///< Zámek seznamu a mapy.
+    List entries; ///< Položky od naposledy použité.
+    Map map; ///< Položky podle klíče.
+    size_t budget; ///< Rozpočet v bajtech.
+    size_t used; ///< Součet velikostí položek.
+    std::atomic<size_t> hitCount; ///< Počet nalezených hodnot.
+    std::atomic<size_t> missCount; ///< Počet načtených hodnot.
+    std::atomic<size_t> evictionCount; ///< Počet vyřazených položek.
+};
+
+}
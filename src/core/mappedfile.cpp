@@ -0,0 +1,43 @@
+#include "core/mappedfile.h"
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace tracer;
+
+MappedFile::MappedFile(const char* path)
+    : address(nullptr),
+      length(0)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        throw std::runtime_error(std::string("Cannot open ") + path + ": " + strerror(errno));
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0)
+    {
+        close(fd);
+        throw std::runtime_error(std::string("Cannot map empty file ") + path);
+    }
+
+    length = static_cast<size_t>(st.st_size);
+    void* p = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED)
+        throw std::runtime_error(std::string("Cannot map ") + path + ": " + strerror(errno));
+
+    address = static_cast<char*>(p);
+}
+
+MappedFile::~MappedFile()
+{
+    if (address)
+        munmap(address, length);
+}
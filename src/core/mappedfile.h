@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+
+#include "core/reference.h"
+
+namespace tracer
+{
+
+/*!
+ * Soubor namapovaný do paměti. Mapování je soukromé (copy-on-write), data
+ * lze tedy používat přímo na místě i měnit, aniž by se změny zapsaly do
+ * souboru. Dokud se stránka nezmění, sdílí ji všechny procesy, které
+ * mají soubor namapovaný, a načítá se až při prvním přístupu.
+ *
+ * Objekty, které ukazují do namapovaných dat, drží na soubor referenci,
+ * mapování tak zanikne až s posledním z nich.
+ */
+class MappedFile : public ReferenceCounted
+{
+public:
+    /*!
+     * Namapuje celý soubor. Při chybě vyhodí výjimku std::runtime_error.
+     * \param path cesta k souboru
+     */
+    MappedFile(const char* path);
+
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /*!
+     * \return začátek namapovaných dat
+     */
+    char* data() const
+    { return address; }
+
+    /*!
+     * \return velikost souboru v bajtech
+     */
+    size_t size() const
+    { return length; }
+
+private:
+    char* address; ///< Začátek mapování.
+    size_t length; ///< Velikost mapování.
+};
+
+}
@@ -49,6 +49,11 @@ Material::Material(const Material& material)
 Material::~Material()
 { }
 
+BSDF* Material::getBSDF(const Intersection& in) const
+{
+    return getBSDF(in.normal, in.ray.d);
+}
+
 /************************************************************************/
 /* Helper functions                                                     */
 /************************************************************************/
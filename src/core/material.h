@@ -90,6 +90,15 @@ public:
      * \return objekt BSDF reprezentující povrch pomocí BRDF funkcí
      */
     virtual BSDF* getBSDF(const Vector& normal, const Vector& incident) const = 0;
+
+    /*!
+     * Vytvoří BSDF v místě průsečíku. Na rozdíl od předchozí varianty má
+     * materiál k dispozici texturové souřadnice a šířku stopy paprsku, takže
+     * může vyhodnotit textury. Výchozí implementace textury nepoužívá.
+     * \param in průsečík
+     * \return objekt BSDF reprezentující povrch pomocí BRDF funkcí
+     */
+    virtual BSDF* getBSDF(const Intersection& in) const;
 };
 
 /*!
@@ -0,0 +1,49 @@
+#include "core/parallel.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using namespace tracer;
+
+int tracer::numSystemCores()
+{
+    unsigned n = std::thread::hardware_concurrency();
+    return n > 0 ? static_cast<int>(n) : 1;
+}
+
+void tracer::parallelFor(size_t count, const std::function<void(size_t)>& func, size_t chunkSize)
+{
+    if (count == 0)
+        return;
+    if (chunkSize == 0)
+        chunkSize = 1;
+
+    const size_t nChunks = (count + chunkSize - 1) / chunkSize;
+    size_t nThreads = static_cast<size_t>(numSystemCores());
+    if (nThreads > nChunks)
+        nThreads = nChunks;
+
+    std::atomic<size_t> next(0);
+    auto worker = [&]()
+    {
+        while (true)
+        {
+            size_t begin = next.fetch_add(chunkSize);
+            if (begin >= count)
+                break;
+            size_t end = begin + chunkSize < count ? begin + chunkSize : count;
+            for (size_t i = begin; i < end; ++i)
+                func(i);
+        }
+    };
+
+    // Volající vlákno pracuje také, proto se spouští o jedno vlákno méně.
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < nThreads; ++i)
+        threads.push_back(std::thread(worker));
+    worker();
+
+    for (size_t i = 0; i < threads.size(); ++i)
+        threads[i].join();
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+/*!
+ * \file
+ * V souboru jsou definovány pomocné funkce pro paralelní zpracování.
+ */
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+
+#include "core/core.h"
+
+namespace tracer
+{
+
+/*!
+ * Zjistí počet dostupných jader procesoru.
+ * \return počet jader (alespoň 1)
+ */
+int numSystemCores();
+
+/*!
+ * Zavolá zadanou funkci pro každý index z intervalu <0; count) paralelně
+ * na všech jádrech procesoru. Indexy se mezi vlákna rozdělují dynamicky
+ * po blocích velikosti chunkSize. Funkce se vrátí až po zpracování všech indexů.
+ * \param count počet indexů
+ * \param func funkce volaná pro každý index
+ * \param chunkSize počet indexů, které si vlákno najednou vezme
+ */
+void parallelFor(size_t count, const std::function<void(size_t)>& func, size_t chunkSize = 1);
+
+/*!
+ * Reálné číslo, ke kterému lze přičítat z více vláken bez zámku.
+ * Hodnota je uložena jako bity v std::atomic<uint32_t> a přičítá se
+ * ve smyčce compare-and-swap, protože std::atomic<float> v C++11
+ * nemá operaci fetch_add.
+ */
+class AtomicFloat
+{
+public:
+    /*!
+     * Konstruktor.
+     * \param v počáteční hodnota
+     */
+    explicit AtomicFloat(Real v = 0.f)
+    { bits.store(toBits(v), std::memory_order_relaxed); }
+
+    AtomicFloat(const AtomicFloat&) = delete;
+    AtomicFloat& operator=(const AtomicFloat&) = delete;
+
+    /*!
+     * \return aktuální hodnota
+     */
+    operator Real() const
+    { return fromBits(bits.load(std::memory_order_relaxed)); }
+
+    /*!
+     * Nastaví hodnotu.
+     * \param v nová hodnota
+     * \return nová hodnota
+     */
+    Real operator=(Real v)
+    {
+        bits.store(toBits(v), std::memory_order_relaxed);
+        return v;
+    }
+
+    /*!
+     * Atomicky přičte hodnotu.
+     * \param v přičítaná hodnota
+     */
+    void add(Real v)
+    {
+        uint32_t oldBits = bits.load(std::memory_order_relaxed);
+        uint32_t newBits;
+        do
+        {
+            newBits = toBits(fromBits(oldBits) + v);
+        }
+        while (!bits.compare_exchange_weak(oldBits, newBits, std::memory_order_relaxed));
+    }
+
+private:
+    static uint32_t toBits(Real v)
+    {
+        uint32_t b;
+        std::memcpy(&b, &v, sizeof(b));
+        return b;
+    }
+
+    static Real fromBits(uint32_t b)
+    {
+        Real v;
+        std::memcpy(&v, &b, sizeof(v));
+        return v;
+    }
+
+    std::atomic<uint32_t> bits; ///< bity hodnoty typu Real
+};
+
+}
@@ -1,11 +1,14 @@
 #pragma once
 
+#include <cstdint>
+#include <unordered_map>
 #include <vector>
 
 #include "core/geometry.h"
 #include "core/material.h"
 #include "core/intersection.h"
 #include "core/reference.h"
+#include "core/transform.h"
 
 namespace tracer
 {
@@ -56,11 +59,32 @@ public:
      */
     virtual void refine(std::vector<Reference<Primitive>>& refined) = 0;
 
+    /*!
+     * Zjistí, jestli se má těleso rozložit až ve chvíli, kdy do jeho
+     * obalového kvádru poprvé dopadne paprsek (LazyPrimitive). Hodí se pro
+     * tělesa, jejichž rozložení je drahé a nemusí být vůbec potřeba.
+     * Výchozí implementace vrací false, těleso se rozloží hned.
+     * \return jestli se má rozložení odložit
+     */
+    virtual bool refineOnDemand() const
+    { return false; }
+
     /*!
      * Vrátí vypočítanou obalovou krychli tělesa.
      * \return instanci BBox představující obalovou krychli
      */
     virtual BBox bounds() const = 0;
+
+    /*!
+     * Umístí těleso do scény zadanou transformací. Transformace se vždy
+     * aplikuje na původní (netransformovaný) tvar tělesa, opakovaná volání se
+     * tedy neskládají. Tělesa vzniklá metodou refine() se změnou musí řídit.
+     * Výchozí implementace přesun nepodporuje.
+     * \param t nová transformace tělesa
+     * \return jestli těleso transformaci podporuje
+     */
+    virtual bool setTransform(const Transform& t)
+    { return false; }
 };
 
 /**
@@ -103,13 +127,101 @@ protected:
     mutable Reference<Material> _material; ///< Materiál tělesa.
 };
 
+/*!
+ * Přehled toho, co se při změně scény muselo přepočítat.
+ * \see Scene::setMaterial(), Scene::setTransform(), Scene::addObject(), Scene::removeObject()
+ */
+struct UpdateReport
+{
+    UpdateReport()
+        : materials(0),
+          refitted(0),
+          inserted(0),
+          removed(0),
+          cells(0),
+          rebuilt(false)
+    { }
+
+    size_t materials; ///< Počet těles, kterým se vyměnil materiál.
+    size_t refitted; ///< Počet těles, jejichž umístění ve struktuře se přepočítalo.
+    size_t inserted; ///< Počet těles vložených do struktury.
+    size_t removed; ///< Počet těles odebraných ze struktury.
+    size_t cells; ///< Počet změněných buněk struktury (voxelů, uzlů).
+    bool rebuilt; ///< Jestli se musela znovu postavit celá struktura.
+};
+
 /*!
  * Třída vznikla ze sémantických důvodů jako předek tříd pro implementaci
  * akceleračních struktur.
+ *
+ * Struktury umí změnu těles zpracovat lokálně metodami insert(), remove()
+ * a refit(). Tělesa předávaná těmto metodám už musí být rozložená
+ * (Primitive::canIntersect()). Pokud struktura změnu lokálně zpracovat
+ * nedokáže, vrátí false a nic nezmění, volající pak použije rebuild().
+ * Žádná z těchto metod nesmí běžet současně s výpočtem průsečíků.
  */
 class AccelerationStructure : public Primitive
 {
 public:
+    /*!
+     * Vloží tělesa do struktury.
+     * \param prims vkládaná tělesa
+     * \param report slouží k návratu přehledu změn
+     * \return jestli se vložení podařilo bez přestavby
+     */
+    virtual bool insert(std::vector<Reference<Primitive>>& prims, UpdateReport& report)
+    { return false; }
+
+    /*!
+     * Odebere tělesa ze struktury.
+     * \param prims odebíraná tělesa, jejich obalové kvádry musí odpovídat
+     *              stavu při vložení, resp. poslednímu volání refit()
+     * \param report slouží k návratu přehledu změn
+     * \return jestli se odebrání podařilo bez přestavby
+     */
+    virtual bool remove(std::vector<Reference<Primitive>>& prims, UpdateReport& report)
+    { return false; }
+
+    /*!
+     * Přepočítá umístění těles, která změnila tvar nebo polohu.
+     * \param prims změněná tělesa
+     * \param oldBounds obalové kvádry těles před změnou
+     * \param report slouží k návratu přehledu změn
+     * \return jestli se změna podařila zpracovat bez přestavby
+     */
+    virtual bool refit(std::vector<Reference<Primitive>>& prims,
+                       const std::vector<BBox>& oldBounds, UpdateReport& report)
+    { return false; }
+
+    /*!
+     * Přepočítá strukturu poté, co se mohla změnit poloha libovolných jejích
+     * těles, ale ne jejich počet (např. deformace sítě). Pokud je to možné,
+     * zachová rozdělení prostoru a přepočítá jen obalové kvádry.
+     * \param report slouží k návratu přehledu změn
+     * \return jestli se změna podařila zpracovat bez přestavby z původních těles
+     */
+    virtual bool refitAll(UpdateReport& report)
+    { return false; }
+
+    /*!
+     * Postaví strukturu znovu ze zadaných těles.
+     * \param p tělesa, nad nerozloženými se provede Primitive::refine(),
+     *          resp. se obalí LazyPrimitive (viz LazyPrimitive::expand())
+     */
+    virtual void rebuild(std::vector<Reference<Primitive>>& p) = 0;
+
+    /*!
+     * Uloží postavenou strukturu do pole bajtů, ze kterého ji lze znovu
+     * vytvořit bez stavby (viz AccelerationCache). Tělesa se ukládají jako
+     * indexy do pole, nad kterým byla struktura postavena.
+     * \param indices indexy těles
+     * \param data slouží k návratu uložených dat
+     * \return false, pokud struktura ukládání nepodporuje
+     */
+    virtual bool serialize(const std::unordered_map<const Primitive*, uint32_t>& indices,
+                           std::vector<char>& data) const
+    { return false; }
+
     /*!
      * Všechny akcelerační struktury dokáží vypočítat průsečík s tělesem.
      * \return true
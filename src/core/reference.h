@@ -1,5 +1,6 @@
 #pragma once
 
+#include <atomic>
 #include <cstdlib>
 
 namespace tracer
@@ -19,11 +20,19 @@ public:
     ReferenceCounted()
     { count = 0; }
 
+    /*!
+     * Kopírovací konstruktor. Kopie začíná s vynulovaným čítačem,
+     * protože na ni zatím žádná reference neukazuje.
+     */
+    ReferenceCounted(const ReferenceCounted&)
+    { count = 0; }
+
     /*!
      * Proměnná čítače referencí. Musí být nastavena jako @a mutable aby bylo možné
-     * předávat reference jako const Reference<T>.
+     * předávat reference jako const Reference<T>. Je atomická, protože reference
+     * (např. na materiál v průsečíku) se kopírují z více vykreslovacích vláken.
      */
-    mutable unsigned int count;
+    mutable std::atomic<unsigned int> count;
 };
 
 /*!
@@ -50,7 +59,7 @@ public:
             : ptr(_ptr)
     {
         if (ptr)
-            ptr->count = ptr->count + 1;
+            ++ptr->count;
     }
 
     /*!
@@ -63,7 +72,7 @@ public:
         ptr = orig.ptr;
 
         if (ptr)
-            ptr->count = ptr->count + 1;
+            ++ptr->count;
     }
 
     /*!
@@ -137,7 +146,7 @@ public:
      */
     Reference<T>& operator=(T* right)
     {
-        if (right) right->count = right->count + 1;
+        if (right) ++right->count;
 
         decrementCount();
 
@@ -159,7 +168,7 @@ public:
 
         decrementCount();
 
-        right.ptr->count = right.ptr->count + 1;
+        if (right.ptr) ++right.ptr->count;
         ptr = right.ptr;
 
         return *this;
@@ -1,5 +1,11 @@
 #include "renderer.h"
 
+#include <stdexcept>
+#include <string>
+
+#include "shapes/pagedmesh.h"
+#include "textures/image.h"
+
 using namespace tracer;
 
 Renderer::Renderer(Scene* sc)
@@ -17,3 +23,36 @@ Renderer::~Renderer()
         scene = nullptr;
     }
 }
+
+RGBColor Renderer::radiance(const Integrator& integrator, const Ray& ray) const
+{
+    Intersection inter;
+    if (scene->intersect(ray, inter))
+        return integrator.l(ray, *scene, inter);
+
+    RGBColor l = scene->background;
+    for (size_t i = 0; i < scene->lights.size(); ++i)
+        l += scene->lights[i]->le(ray);
+    return l;
+}
+
+void Renderer::checkFilm(const Integrator& integrator, bool passes, const char* name) const
+{
+    if (integrator.usesSplats() && !film->supportsSplats())
+        throw std::runtime_error(std::string(name) + ": the film does not support splatting integrators");
+    if (passes && !film->supportsPasses())
+        throw std::runtime_error(std::string(name) + ": the film does not support multiple passes or sample statistics");
+}
+
+size_t Renderer::failedLoads() const
+{
+    return PagedMesh::totalFailedLoads() + ImageTexture::totalFailedReads();
+}
+
+void Renderer::reportFailedLoads(size_t before) const
+{
+    const size_t failed = failedLoads() - before;
+    if (failed)
+        throw std::runtime_error(std::to_string(failed) +
+                                 " geometry chunk or texture tile reads failed, the frame is incomplete");
+}
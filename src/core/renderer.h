@@ -30,10 +30,51 @@ public:
     virtual ~Renderer();
 
     /*!
-     * Slouží ke spuštění renderingu.
+     * Slouží ke spuštění renderingu. Pokud se během snímku nepodařilo načíst
+     * část geometrie nebo textur, vyhodí po jeho dokončení výjimku
+     * std::runtime_error (viz reportFailedLoads()).
      */
     virtual void render() const = 0;
 
+protected:
+    /*!
+     * Vypočítá radianci přicházející po paprsku. Pokud paprsek protne těleso,
+     * použije se integrátor, jinak se vrátí barva pozadí spolu s radiancí
+     * světel v nekonečnu.
+     * \param integrator integrátor pro výpočet světelného příspěvku
+     * \param ray paprsek vygenerovaný kamerou
+     * \return radiance přicházející po paprsku
+     */
+    RGBColor radiance(const Integrator& integrator, const Ray& ray) const;
+
+    /*!
+     * Ověří, že film scény zvládne zadaný integrátor a renderovací smyčku.
+     * Volá se na začátku render() ve volajícím vlákně, aby se nepodporovaná
+     * kombinace odmítla dřív, než na ni narazí renderovací vlákna.
+     * Při nepodporované kombinaci vyhodí výjimku std::runtime_error.
+     * \param integrator integrátor rendereru
+     * \param passes true, pokud renderer slučuje do pixelů více průchodů
+     *               nebo čte statistiky vzorků
+     * \param name jméno rendereru do chybové hlášky
+     */
+    void checkFilm(const Integrator& integrator, bool passes, const char* name) const;
+
+    /*!
+     * \return počet bloků stránkovaných sítí a dlaždic textur, které se od
+     * spuštění procesu nepodařilo načíst (PagedMesh::totalFailedLoads(),
+     * ImageTexture::totalFailedReads())
+     */
+    size_t failedLoads() const;
+
+    /*!
+     * Ohlásí bloky a dlaždice, které se během snímku nepodařilo načíst
+     * a vykreslily se jako prázdné, resp. černé. Volá se na konci render()
+     * ve volajícím vlákně, až je snímek zapsaný. Pokud nějaké přibyly,
+     * vyhodí výjimku std::runtime_error.
+     * \param before hodnota failedLoads() na začátku snímku
+     */
+    void reportFailedLoads(size_t before) const;
+
 protected:
     Scene* scene; ///< Vykreslovaná scéna.
     Film* film; ///< Film kamery vytáhnutý ze scene, kvůli přehlednému přístupu.
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstdint>
+
+#include "core/core.h"
+
+namespace tracer
+{
+
+/*!
+ * Generátor pseudonáhodných čísel PCG32. Je malý, rychlý a jeho stav lze
+ * odvodit z libovolného čísla (např. z polohy pixelu), takže každé vlákno
+ * může mít vlastní deterministickou posloupnost.
+ */
+class RNG
+{
+public:
+    /*!
+     * Konstruktor.
+     * \param seed počáteční hodnota
+     * \param stream číslo posloupnosti, různé posloupnosti jsou nezávislé
+     */
+    RNG(uint64_t seed = 0x853c49e6748fea9bULL, uint64_t stream = 0xda3e39cb94b95bdbULL)
+    {
+        setSeed(seed, stream);
+    }
+
+    /*!
+     * Nastaví stav generátoru.
+     * \param seed počáteční hodnota
+     * \param stream číslo posloupnosti
+     */
+    void setSeed(uint64_t seed, uint64_t stream = 0xda3e39cb94b95bdbULL)
+    {
+        state = 0u;
+        inc = (stream << 1u) | 1u;
+        uniformUInt32();
+        state += seed;
+        uniformUInt32();
+    }
+
+    /*!
+     * \return náhodné celé číslo
+     */
+    uint32_t uniformUInt32()
+    {
+        uint64_t old = state;
+        state = old * 0x5851f42d4c957f2dULL + inc;
+        uint32_t xorShifted = static_cast<uint32_t>(((old >> 18u) ^ old) >> 27u);
+        uint32_t rot = static_cast<uint32_t>(old >> 59u);
+        return (xorShifted >> rot) | (xorShifted << ((~rot + 1u) & 31));
+    }
+
+    /*!
+     * \return náhodné číslo z intervalu <0; 1)
+     */
+    Real uniformFloat()
+    {
+        return min(uniformUInt32() * 2.3283064365386963e-10f, ONE_MINUS_EPSILON);
+    }
+
+private:
+    uint64_t state; ///< stav generátoru
+    uint64_t inc; ///< přírůstek určující posloupnost
+};
+
+/*!
+ * Promíchá bity čísla (finalizér MurmurHash3). Slouží k odvození
+ * nekorelovaných semínek např. z polohy pixelu a čísla dimenze.
+ * \param v vstupní hodnota
+ * \return promíchaná hodnota
+ */
+inline uint64_t mixBits(uint64_t v)
+{
+    v ^= v >> 33;
+    v *= 0xff51afd7ed558ccdULL;
+    v ^= v >> 33;
+    v *= 0xc4ceb9fe1a85ec53ULL;
+    v ^= v >> 33;
+    return v;
+}
+
+/*!
+ * Spojí několik hodnot do jednoho hashe.
+ * \param a první hodnota
+ * \param b druhá hodnota
+ * \return hash
+ */
+inline uint64_t hashValues(uint64_t a, uint64_t b)
+{
+    return mixBits(a ^ (mixBits(b) + 0x9e3779b97f4a7c15ULL + (a << 6) + (a >> 2)));
+}
+
+/*!
+ * Spojí několik hodnot do jednoho hashe.
+ * \param a první hodnota
+ * \param b druhá hodnota
+ * \param c třetí hodnota
+ * \return hash
+ */
+inline uint64_t hashValues(uint64_t a, uint64_t b, uint64_t c)
+{
+    return hashValues(hashValues(a, b), c);
+}
+
+}
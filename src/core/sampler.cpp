@@ -0,0 +1,52 @@
+#include "core/sampler.h"
+
+#include "core/rng.h"
+
+using namespace tracer;
+
+Sampler::Sampler(int samplesPerPixel, uint64_t seed)
+    : spp(max(samplesPerPixel, 1)),
+      seed(seed),
+      px(0),
+      py(0),
+      sampleIndex(0),
+      dimension(0)
+{ }
+
+Sampler::~Sampler()
+{ }
+
+void Sampler::startPixelSample(int x, int y, uint64_t index)
+{
+    px = x;
+    py = y;
+    sampleIndex = index;
+    dimension = 0;
+}
+
+Real Sampler::get1D()
+{
+    return sample(dimension++);
+}
+
+void Sampler::get2D(Real& u0, Real& u1)
+{
+    u0 = sample(dimension++);
+    u1 = sample(dimension++);
+}
+
+CameraSample Sampler::getCameraSample(int x, int y)
+{
+    CameraSample cs;
+    Real u0, u1;
+    get2D(u0, u1);
+    cs.x = x + u0;
+    cs.y = y + u1;
+    return cs;
+}
+
+uint64_t Sampler::pixelSeed(int dim) const
+{
+    uint64_t pixel = (static_cast<uint64_t>(static_cast<uint32_t>(px)) << 32) | static_cast<uint32_t>(py);
+    return hashValues(pixel, static_cast<uint64_t>(dim), seed);
+}
@@ -0,0 +1,177 @@
+#pragma once
+
+#include <cstdint>
+
+#include "core/core.h"
+#include "core/camera.h"
+
+namespace tracer
+{
+
+/*!
+ * Rozhraní generátorů vzorků. Hodnota každého vzorku je jednoznačně určena
+ * pixelem, indexem vzorku v pixelu, číslem dimenze a semínkem. Sampler
+ * tedy nemá žádný skrytý stav, dlaždice zpracované různými vlákny jsou
+ * na sobě nezávislé a výsledek je reprodukovatelný.
+ *
+ * Použití:
+ * \code
+ * sampler->startPixelSample(x, y, i);
+ * CameraSample cs = sampler->getCameraSample(x, y);
+ * Real u = sampler->get1D();
+ * \endcode
+ */
+class Sampler
+{
+public:
+    /*!
+     * Konstruktor.
+     * \param samplesPerPixel předpokládaný počet vzorků na pixel
+     * \param seed semínko, různá semínka dávají různé (ale stejně kvalitní) vzorky
+     */
+    Sampler(int samplesPerPixel, uint64_t seed = 0);
+
+    virtual ~Sampler();
+
+    /*!
+     * Začne nový vzorek v pixelu. Nastaví dimenzi na 0.
+     * \param x souřadnice pixelu
+     * \param y souřadnice pixelu
+     * \param index index vzorku v pixelu
+     */
+    virtual void startPixelSample(int x, int y, uint64_t index);
+
+    /*!
+     * Vrátí hodnotu další dimenze aktuálního vzorku.
+     * \return hodnota z intervalu <0; 1)
+     */
+    Real get1D();
+
+    /*!
+     * Vrátí hodnoty dvou dalších dimenzí aktuálního vzorku.
+     * \param u0 slouží k návratu první hodnoty
+     * \param u1 slouží k návratu druhé hodnoty
+     */
+    void get2D(Real& u0, Real& u1);
+
+    /*!
+     * Vrátí polohu vzorku na filmu. Využívá první dvě dimenze vzorku.
+     * \param x souřadnice pixelu
+     * \param y souřadnice pixelu
+     * \return poloha vzorku v pixelech
+     */
+    CameraSample getCameraSample(int x, int y);
+
+    /*!
+     * Vytvoří kopii sampleru pro jiné vlákno. Případné předpočítané
+     * tabulky jsou sdílené.
+     * \return nová instance na haldě
+     */
+    virtual Sampler* clone() const = 0;
+
+    /*!
+     * \return jméno typu sampleru, např. pro kontrolu uloženého stavu
+     */
+    virtual const char* name() const = 0;
+
+    /*!
+     * \return předpokládaný počet vzorků na pixel
+     */
+    int samplesPerPixel() const
+    { return spp; }
+
+    /*!
+     * \return semínko sampleru
+     */
+    uint64_t getSeed() const
+    { return seed; }
+
+protected:
+    /*!
+     * Hodnota vzorku v zadané dimenzi.
+     * \param dim číslo dimenze
+     * \return hodnota z intervalu <0; 1)
+     */
+    virtual Real sample(int dim) const = 0;
+
+    /*!
+     * Semínko odvozené od aktuálního pixelu a zadané dimenze.
+     * \param dim číslo dimenze
+     */
+    uint64_t pixelSeed(int dim) const;
+
+protected:
+    int spp; ///< Předpokládaný počet vzorků na pixel.
+    uint64_t seed; ///< Semínko.
+    int px; ///< Souřadnice aktuálního pixelu.
+    int py; ///< Souřadnice aktuálního pixelu.
+    uint64_t sampleIndex; ///< Index aktuálního vzorku v pixelu.
+    int dimension; ///< Následující dimenze aktuálního vzorku.
+};
+
+/*!
+ * Převede hash na číslo z intervalu <0; 1).
+ * \param h hash
+ * \return hodnota z intervalu <0; 1)
+ */
+inline Real hashToFloat(uint64_t h)
+{
+    return static_cast<Real>(h >> 40) * 5.9604645e-8f;
+}
+
+/*!
+ * Obrátí pořadí bitů 32bitového čísla.
+ * \param v vstupní hodnota
+ * \return hodnota s obráceným pořadím bitů
+ */
+inline uint32_t reverseBits32(uint32_t v)
+{
+    v = (v << 16) | (v >> 16);
+    v = ((v & 0x00ff00ff) << 8) | ((v & 0xff00ff00) >> 8);
+    v = ((v & 0x0f0f0f0f) << 4) | ((v & 0xf0f0f0f0) >> 4);
+    v = ((v & 0x33333333) << 2) | ((v & 0xcccccccc) >> 2);
+    v = ((v & 0x55555555) << 1) | ((v & 0xaaaaaaaa) >> 1);
+    return v;
+}
+
+/*!
+ * Prvek náhodné permutace čísel <0; n) bez nutnosti permutaci ukládat
+ * (Kensler, Correlated Multi-Jittered Sampling).
+ * \param i index prvku
+ * \param n délka permutace
+ * \param p semínko permutace
+ * \return i-tý prvek permutace
+ */
+inline uint32_t permutationElement(uint32_t i, uint32_t n, uint32_t p)
+{
+    uint32_t w = n - 1;
+    w |= w >> 1;
+    w |= w >> 2;
+    w |= w >> 4;
+    w |= w >> 8;
+    w |= w >> 16;
+    do
+    {
+        i ^= p;
+        i *= 0xe170893d;
+        i ^= p >> 16;
+        i ^= (i & w) >> 4;
+        i ^= p >> 8;
+        i *= 0x0929eb3f;
+        i ^= p >> 23;
+        i ^= (i & w) >> 1;
+        i *= 1 | p >> 27;
+        i *= 0x6935fa69;
+        i ^= (i & w) >> 11;
+        i *= 0x74dcb303;
+        i ^= (i & w) >> 2;
+        i *= 0x9e501cc3;
+        i ^= (i & w) >> 2;
+        i *= 0xc860a3df;
+        i &= w;
+        i ^= i >> 5;
+    } while (i >= n);
+    return (i + p) % n;
+}
+
+}
@@ -1,5 +1,9 @@
+#include <map>
 #include <stdexcept>
 #include "scene.h"
+#include "acceleration/lazyprimitive.h"
+#include "importers/binaryscene.h"
+#include "importers/xmlsceneimporter.h"
 
 using namespace tracer;
 
@@ -8,7 +12,8 @@ Scene::Scene()
       ambient(nullptr),
       film(nullptr),
       camera(nullptr),
-      aggregator(nullptr)
+      aggregator(nullptr),
+      nextSequence(0)
 { }
 
 Scene::~Scene()
@@ -40,5 +45,180 @@ bool Scene::intersectP(const Ray& ray) const
 
 void Scene::build(const char* file)
 {
-    throw std::runtime_error("Not implemented yet.");
+    const std::string cache = std::string(file) + ".bin";
+    BinarySceneLoader loader(*this);
+    if (loader.load(cache.c_str(), file))
+    {
+        preprocess();
+        return;
+    }
+
+    BinarySceneWriter writer;
+    XMLSceneImporter importer(*this, &writer);
+    importer.import(file);
+    deduplication = importer.deduplicationReport();
+
+    try
+    {
+        writer.write(cache.c_str(), file, *this);
+    }
+    catch (const std::runtime_error&)
+    {
+        // Binární soubor jen zrychluje další načtení, scéna už je sestavená.
+    }
+    preprocess();
+}
+
+void Scene::preprocess()
+{
+    std::vector<Real> power(lights.size());
+    for (size_t i = 0; i < lights.size(); ++i)
+    {
+        lights[i]->preprocess(*this);
+        power[i] = lights[i]->power();
+    }
+
+    lightDistribution.build(power);
+}
+
+const Light* Scene::sampleLight(Real u, Real* pdf, Real* uRemapped) const
+{
+    if (lightDistribution.size() == 0)
+    {
+        *pdf = 0.f;
+        return nullptr;
+    }
+
+    return lights[lightDistribution.sample(u, pdf, uRemapped)];
+}
+
+Scene::SceneObject& Scene::findObject(const Reference<Primitive>& object)
+{
+    Reference<Primitive> o(object);
+    std::unordered_map<const Primitive*, SceneObject>::iterator it = objects.find(&*o);
+    if (it == objects.end())
+        throw std::runtime_error("Object is not part of the scene");
+    return it->second;
+}
+
+void Scene::rebuildAggregator(UpdateReport& report)
+{
+    if (objects.empty())
+        throw std::runtime_error("Scene objects were not added by addObject()");
+
+    std::vector<Reference<Primitive>> prims;
+    primitives(prims);
+    aggregator->rebuild(prims);
+    report.rebuilt = true;
+}
+
+void Scene::primitives(std::vector<Reference<Primitive>>& prims) const
+{
+    std::map<uint64_t, const SceneObject*> ordered;
+    for (std::unordered_map<const Primitive*, SceneObject>::const_iterator it = objects.begin();
+         it != objects.end(); ++it)
+        ordered[it->second.sequence] = &it->second;
+
+    for (std::map<uint64_t, const SceneObject*>::const_iterator it = ordered.begin(); it != ordered.end(); ++it)
+        prims.insert(prims.end(), it->second->refined.begin(), it->second->refined.end());
+}
+
+const std::vector<Reference<Primitive>>& Scene::refined(const Reference<Primitive>& object)
+{
+    return findObject(object).refined;
+}
+
+UpdateReport Scene::addObject(const Reference<Primitive>& object)
+{
+    Reference<Primitive> p(object);
+    if (objects.count(&*p))
+        throw std::runtime_error("Object is already part of the scene");
+
+    SceneObject& o = objects[&*p];
+    o.object = p;
+    o.sequence = nextSequence++;
+    LazyPrimitive::expand(p, o.refined);
+
+    UpdateReport report;
+    if (aggregator && !aggregator->insert(o.refined, report))
+        rebuildAggregator(report);
+    if (aggregator)
+        preprocess();
+    return report;
+}
+
+UpdateReport Scene::removeObject(const Reference<Primitive>& object)
+{
+    SceneObject& o = findObject(object);
+    std::vector<Reference<Primitive>> refined;
+    refined.swap(o.refined);
+    objects.erase(&*o.object);
+
+    UpdateReport report;
+    if (aggregator && !aggregator->remove(refined, report))
+        rebuildAggregator(report);
+    if (aggregator)
+        preprocess();
+    return report;
+}
+
+UpdateReport Scene::setMaterial(const Reference<Primitive>& object, const Reference<Material>& material)
+{
+    SceneObject& o = findObject(object);
+    GeometricPrimitive* geometric = dynamic_cast<GeometricPrimitive*>(&*o.object);
+    if (!geometric)
+        throw std::runtime_error("Object has no material");
+    geometric->setMaterial(material);
+
+    UpdateReport report;
+    for (size_t i = 0; i < o.refined.size(); ++i)
+    {
+        GeometricPrimitive* part = dynamic_cast<GeometricPrimitive*>(&*o.refined[i]);
+        if (part)
+        {
+            part->setMaterial(material);
+            ++report.materials;
+        }
+        else if (LazyPrimitive* lazy = dynamic_cast<LazyPrimitive*>(&*o.refined[i]))
+            report.materials += lazy->setMaterial(material);
+    }
+    return report;
+}
+
+UpdateReport Scene::setTransform(const Reference<Primitive>& object, const Transform& t)
+{
+    SceneObject& o = findObject(object);
+
+    std::vector<BBox> oldBounds(o.refined.size());
+    for (size_t i = 0; i < o.refined.size(); ++i)
+        oldBounds[i] = o.refined[i]->bounds();
+
+    if (!o.object->setTransform(t))
+        throw std::runtime_error("Object cannot be transformed");
+    for (size_t i = 0; i < o.refined.size(); ++i)
+        if (LazyPrimitive* lazy = dynamic_cast<LazyPrimitive*>(&*o.refined[i]))
+            lazy->invalidate();
+
+    UpdateReport report;
+    if (aggregator && !aggregator->refit(o.refined, oldBounds, report))
+        rebuildAggregator(report);
+    if (aggregator)
+        preprocess();
+    return report;
+}
+
+UpdateReport Scene::refit()
+{
+    // Odložená tělesa se po změně tvaru rozloží znovu při příštím průsečíku.
+    for (std::unordered_map<const Primitive*, SceneObject>::iterator it = objects.begin(); it != objects.end(); ++it)
+        for (size_t i = 0; i < it->second.refined.size(); ++i)
+            if (LazyPrimitive* lazy = dynamic_cast<LazyPrimitive*>(&*it->second.refined[i]))
+                lazy->invalidate();
+
+    UpdateReport report;
+    if (aggregator && !aggregator->refitAll(report))
+        rebuildAggregator(report);
+    if (aggregator)
+        preprocess();
+    return report;
 }
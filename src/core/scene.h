@@ -7,8 +7,14 @@
 #include "core/film.h"
 #include "core/camera.h"
 #include "core/light.h"
+#include "core/distribution.h"
+#include "core/transform.h"
+#include "core/deduplicationreport.h"
 #include "primitive.h"
 
+#include <unordered_map>
+#include <vector>
+
 namespace tracer
 {
 
@@ -26,10 +32,34 @@ public:
     /*!
 	 * Vybuduje scénu podle souboru XML, který definuje scénu.
 	 * Používá k tomu třídu XMLSceneImporter.
+	 * Vedle souboru udržuje binární kopii scény (soubor s příponou .bin),
+	 * kterou při dalším sestavení jen namapuje (BinarySceneLoader).
+	 * Kopie se zapíše při prvním načtení a po každé změně souboru XML.
+	 * Přehled sloučených sítí uloží do deduplication.
+	 * Na konci scénu připraví metodou preprocess().
 	 * \param file cesta k souboru
 	 */
     void build(const char* file);
 
+    /*!
+     * Připraví pomocné struktury scény po jejím sestavení. Nechá světla
+     * připravit se na scénu a sestaví tabulku aliasů pro výběr světel
+     * úměrně jejich výkonu. Volá ji build() a po sestavení akcelerační
+     * struktury i každá změna těles (addObject(), removeObject(),
+     * setTransform(), refit()), protože mění rozměry scény a polohu
+     * plošných světel. Po ruční změně pole lights je potřeba ji zavolat znovu.
+     */
+    void preprocess();
+
+    /*!
+     * Vybere světlo úměrně jeho výkonu v konstantním čase.
+     * \param u náhodná hodnota z intervalu <0; 1)
+     * \param pdf slouží k návratu pravděpodobnosti výběru světla
+     * \param uRemapped pokud není nullptr, uloží se sem znovu použitelná náhodná hodnota
+     * \return vybrané světlo nebo nullptr, pokud scéna žádná světla nemá
+     */
+    const Light* sampleLight(Real u, Real* pdf, Real* uRemapped = nullptr) const;
+
     /*!
 	 * Vypočítá průsečík paprsku se scénou. Deleguje tento problém na tělesa ve scéně,
 	 * nebo akcelerační struktury.
@@ -53,6 +83,67 @@ public:
 	 */
     BBox bounds() const;
 
+    /*!
+     * Přidá těleso do scény. Těleso se rozloží (Primitive::refine()), resp.
+     * s Primitive::refineOnDemand() se jen obalí LazyPrimitive, a pokud
+     * už existuje akcelerační struktura, vloží se do ní lokálně, případně se
+     * struktura postaví znovu. Bez akcelerační struktury se těleso jen
+     * zaregistruje a strukturu lze postavit z primitives().
+     * \param object přidávané těleso
+     * \return přehled přepočítaných částí
+     */
+    UpdateReport addObject(const Reference<Primitive>& object);
+
+    /*!
+     * Odebere těleso přidané metodou addObject() ze scény i z akcelerační struktury.
+     * \param object odebírané těleso
+     * \return přehled přepočítaných částí
+     */
+    UpdateReport removeObject(const Reference<Primitive>& object);
+
+    /*!
+     * Vymění materiál tělesa a všech jeho rozložených částí. Akcelerační
+     * struktura se nemění. Těleso musí být potomkem GeometricPrimitive.
+     * \param object těleso přidané metodou addObject()
+     * \param material nový materiál
+     * \return přehled přepočítaných částí
+     */
+    UpdateReport setMaterial(const Reference<Primitive>& object, const Reference<Material>& material);
+
+    /*!
+     * Přesune těleso (Primitive::setTransform()) a přepočítá jeho umístění
+     * v akcelerační struktuře a znovu připraví světla (preprocess()).
+     * \param object těleso přidané metodou addObject()
+     * \param t nová transformace tělesa
+     * \return přehled přepočítaných částí
+     */
+    UpdateReport setTransform(const Reference<Primitive>& object, const Transform& t);
+
+    /*!
+     * Přepočítá akcelerační strukturu po změně poloh vrcholů těles, jejichž
+     * topologie zůstala stejná (deformace). Struktura se postaví znovu jen
+     * pokud přepočet nepodporuje nebo pokud se tím příliš zhorší její kvalita.
+     * \return přehled přepočítaných částí
+     */
+    UpdateReport refit();
+
+    /*!
+     * Vrátí rozložená tělesa všech objektů přidaných metodou addObject(),
+     * např. pro stavbu akcelerační struktury. Objekty jsou v pořadí
+     * přidání, takže stejně sestavená scéna vrátí tělesa vždy ve stejném
+     * pořadí (viz AccelerationCache).
+     * \param prims std::vector, do kterého se tělesa vloží
+     */
+    void primitives(std::vector<Reference<Primitive>>& prims) const;
+
+    /*!
+     * Rozložená tělesa jednoho objektu přidaného metodou addObject().
+     * Pole je platné, dokud se objekt ze scény neodebere.
+     * \param object objekt scény
+     * \return tělesa v pořadí, v jakém je vrátil Primitive::refine()
+     */
+    const std::vector<Reference<Primitive>>& refined(const Reference<Primitive>& object);
+
 public:
     RGBColor background; ///< Barva pozadí.
     Light* ambient;
@@ -60,6 +151,36 @@ public:
     Film* film;
     Camera* camera;
     AccelerationStructure* aggregator;
+    AliasTable lightDistribution; ///< Rozdělení pravděpodobnosti výběru světel.
+    DeduplicationReport deduplication; ///< Sítě nahrazené instancemi při importu (atribut deduplicate).
+
+private:
+    /*!
+     * Těleso scény spolu se svými rozloženými částmi, které jsou vložené
+     * v akcelerační struktuře.
+     */
+    struct SceneObject
+    {
+        Reference<Primitive> object; ///< Těleso.
+        std::vector<Reference<Primitive>> refined; ///< Rozložené části tělesa.
+        uint64_t sequence; ///< Pořadí přidání do scény.
+    };
+
+    /*!
+     * Najde zaregistrované těleso, pokud neexistuje, vyhodí výjimku std::runtime_error.
+     * \param object hledané těleso
+     */
+    SceneObject& findObject(const Reference<Primitive>& object);
+
+    /*!
+     * Postaví akcelerační strukturu znovu ze všech těles scény. Pokud scéna
+     * nemá žádná tělesa přidaná metodou addObject(), vyhodí výjimku std::runtime_error.
+     * \param report přehled změn, nastaví se v něm příznak přestavby
+     */
+    void rebuildAggregator(UpdateReport& report);
+
+    std::unordered_map<const Primitive*, SceneObject> objects; ///< Tělesa přidaná metodou addObject().
+    uint64_t nextSequence; ///< Pořadí příštího přidaného tělesa.
 };
 
 }
\ No newline at end of file
@@ -0,0 +1,9 @@
+#include "core/texture.h"
+
+using namespace tracer;
+
+Texture::Texture()
+{ }
+
+Texture::~Texture()
+{ }
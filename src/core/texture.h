@@ -0,0 +1,39 @@
+#pragma once
+
+#include "core/color.h"
+#include "core/intersection.h"
+#include "core/reference.h"
+
+namespace tracer
+{
+
+/*!
+ * Rozhraní textury, tedy barvy proměnné po povrchu tělesa. Textura se
+ * vyhodnocuje v místě průsečíku podle jeho texturových souřadnic a šířky
+ * stopy paprsku (Intersection::footprint), podle které si může zvolit
+ * úroveň detailu. Třída dědí z ReferenceCounted, jednu texturu tak může
+ * sdílet více materiálů.
+ */
+class Texture : public ReferenceCounted
+{
+public:
+    /*!
+     * Bezparametrický konstruktor.
+     */
+    Texture();
+
+    /*!
+     * Virtuální destruktor.
+     */
+    virtual ~Texture();
+
+    /*!
+     * Vyhodnotí texturu v místě průsečíku. Volá se souběžně z vykreslovacích
+     * vláken.
+     * \param in průsečík
+     * \return barva textury
+     */
+    virtual RGBColor evaluate(const Intersection& in) const = 0;
+};
+
+}
@@ -0,0 +1,71 @@
+#include "core/texturecache.h"
+
+using namespace tracer;
+
+namespace
+{
+
+/// Přidělování identifikátorů textur.
+std::atomic<uint32_t> nextTextureId(0);
+
+/*!
+ * Položka cache vlákna. Cache se rozlišuje podle adresy, vlákno může
+ * používat víc cache zároveň.
+ */
+struct MicroEntry
+{
+    MicroEntry()
+        : cache(nullptr), key(0)
+    { }
+
+    const TextureCache* cache; ///< Cache, ze které dlaždice pochází.
+    uint64_t key; ///< Klíč dlaždice.
+    Reference<TextureTile> tile; ///< Dlaždice.
+};
+
+/// Cache posledních dlaždic vlákna.
+thread_local MicroEntry microCache[TextureCache::MICRO_ENTRIES];
+
+}
+
+/************************************************************************/
+/* TextureTile methods                                                  */
+/************************************************************************/
+
+TextureTile::TextureTile(int size)
+    : texels(static_cast<size_t>(size) * size)
+{ }
+
+/************************************************************************/
+/* TextureCache methods                                                 */
+/************************************************************************/
+
+TextureCache::TextureCache(size_t budget)
+    : tiles(budget)
+{ }
+
+Reference<TextureCache> TextureCache::shared()
+{
+    static Reference<TextureCache> cache(new TextureCache(static_cast<size_t>(512) << 20));
+    return cache;
+}
+
+uint32_t TextureCache::newTextureId()
+{
+    return nextTextureId.fetch_add(1);
+}
+
+Reference<TextureTile> TextureCache::tile(uint64_t key, const TileCache::Loader& load)
+{
+    // Sousední dlaždice se liší v dolních bitech klíče, rozptýlí se násobením.
+    static_assert(TextureCache::MICRO_ENTRIES == 16, "Slot index uses the top 4 bits of the hash");
+    MicroEntry& entry = microCache[(key * 0x9E3779B97F4A7C15ull) >> 60];
+    if (entry.cache == this && entry.key == key)
+        return entry.tile;
+
+    Reference<TextureTile> tile = tiles.get(key, load);
+    entry.cache = this;
+    entry.key = key;
+    entry.tile = tile;
+    return tile;
+}
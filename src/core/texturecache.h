@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "core/color.h"
+#include "core/lrucache.h"
+
+namespace tracer
+{
+
+/*!
+ * Dlaždice textury načtená do paměti, čtvercový blok texelů uložený po
+ * řádcích.
+ */
+class TextureTile : public ReferenceCounted
+{
+public:
+    /*!
+     * Konstruktor.
+     * \param size délka strany dlaždice v texelech
+     */
+    TextureTile(int size);
+
+    TextureTile(const TextureTile&) = delete;
+    TextureTile& operator=(const TextureTile&) = delete;
+
+    std::vector<RGBColor> texels; ///< Texely dlaždice po řádcích.
+};
+
+/*!
+ * Cache dlaždic textur s pevným rozpočtem paměti, sdílená všemi texturami.
+ * Paměť textur tak neroste s jejich celkovou velikostí, ale s rozpočtem,
+ * a načítá se jen to, na co paprsky skutečně dopadnou.
+ *
+ * Dlaždice drží LRUCache pod zámkem. Aby vlákna o zámek nesoupeřila při
+ * každém texelu, má každé vlákno ještě malou přímo mapovanou cache
+ * posledních dlaždic, do které se sdílená cache dívá až při jejím minutí.
+ * Dlaždice v cache vláken se tím do rozpočtu počítají jen do vyřazení ze
+ * sdílené cache, rozpočet tak může být překročen nejvýše o MICRO_ENTRIES
+ * dlaždic na vlákno.
+ *
+ * Klíč dlaždice skládá textura ze svého identifikátoru (newTextureId())
+ * a polohy dlaždice. Identifikátory se nepoužijí znovu, položky zaniklých
+ * textur proto nemohou zaměnit dlaždice jiné textury a jen vypadnou z cache.
+ */
+class TextureCache : public ReferenceCounted
+{
+public:
+    typedef LRUCache<uint64_t, TextureTile> TileCache;
+
+    /// Počet položek cache jednoho vlákna.
+    static const size_t MICRO_ENTRIES = 16;
+
+    /*!
+     * Konstruktor.
+     * \param budget rozpočet paměti v bajtech
+     */
+    explicit TextureCache(size_t budget);
+
+    TextureCache(const TextureCache&) = delete;
+    TextureCache& operator=(const TextureCache&) = delete;
+
+    /*!
+     * \return cache sdílená celým procesem, výchozí rozpočet je 512 MB
+     */
+    static Reference<TextureCache> shared();
+
+    /*!
+     * \return nový identifikátor textury pro klíče dlaždic
+     */
+    static uint32_t newTextureId();
+
+    /*!
+     * Vrátí dlaždici, chybějící načte a vloží. Nejprve se hledá v cache
+     * vlákna, potom ve sdílené cache.
+     * \param key klíč dlaždice
+     * \param load funkce, která dlaždici načte
+     * \return dlaždice
+     */
+    Reference<TextureTile> tile(uint64_t key, const TileCache::Loader& load);
+
+    /*!
+     * Změní rozpočet, případně hned vyřadí přebývající dlaždice.
+     * \param bytes nový rozpočet v bajtech
+     */
+    void setBudget(size_t bytes)
+    { tiles.setBudget(bytes); }
+
+    /*! \return rozpočet v bajtech */
+    size_t capacity() const
+    { return tiles.capacity(); }
+
+    /*! \return součet velikostí dlaždic ve sdílené cache */
+    size_t size() const
+    { return tiles.size(); }
+
+    /*! \return počet dotazů, které dlaždici našly ve sdílené cache */
+    size_t hits() const
+    { return tiles.hits(); }
+
+    /*! \return počet načtených dlaždic */
+    size_t misses() const
+    { return tiles.misses(); }
+
+    /*! \return počet vyřazených dlaždic */
+    size_t evictions() const
+    { return tiles.evictions(); }
+
+private:
+    TileCache tiles; ///< Sdílená cache dlaždic.
+};
+
+}
@@ -0,0 +1,218 @@
+#include "core/transform.h"
+
+#include <cstring>
+#include <stdexcept>
+
+using namespace tracer;
+
+namespace
+{
+
+const Real IDENTITY[4][4] = {
+    { 1.f, 0.f, 0.f, 0.f },
+    { 0.f, 1.f, 0.f, 0.f },
+    { 0.f, 0.f, 1.f, 0.f },
+    { 0.f, 0.f, 0.f, 1.f }
+};
+
+void multiply(const Real a[4][4], const Real b[4][4], Real r[4][4])
+{
+    for (int i = 0; i < 4; ++i)
+        for (int j = 0; j < 4; ++j)
+            r[i][j] = a[i][0] * b[0][j] + a[i][1] * b[1][j] +
+                      a[i][2] * b[2][j] + a[i][3] * b[3][j];
+}
+
+/*!
+ * Inverze Gauss-Jordanovou eliminací s výběrem hlavního prvku.
+ * Počítá se v dvojnásobné přesnosti.
+ */
+void invert(const Real mat[4][4], Real inv[4][4])
+{
+    double a[4][8];
+    for (int i = 0; i < 4; ++i)
+        for (int j = 0; j < 4; ++j)
+        {
+            a[i][j] = mat[i][j];
+            a[i][j + 4] = (i == j) ? 1.0 : 0.0;
+        }
+
+    for (int col = 0; col < 4; ++col)
+    {
+        int pivot = col;
+        for (int row = col + 1; row < 4; ++row)
+            if (std::fabs(a[row][col]) > std::fabs(a[pivot][col]))
+                pivot = row;
+        if (a[pivot][col] == 0.0)
+            throw std::runtime_error("Singular transformation matrix");
+
+        if (pivot != col)
+            for (int j = 0; j < 8; ++j)
+                std::swap(a[col][j], a[pivot][j]);
+
+        const double invPivot = 1.0 / a[col][col];
+        for (int j = 0; j < 8; ++j)
+            a[col][j] *= invPivot;
+
+        for (int row = 0; row < 4; ++row)
+        {
+            if (row == col || a[row][col] == 0.0)
+                continue;
+            const double f = a[row][col];
+            for (int j = 0; j < 8; ++j)
+                a[row][j] -= f * a[col][j];
+        }
+    }
+
+    for (int i = 0; i < 4; ++i)
+        for (int j = 0; j < 4; ++j)
+            inv[i][j] = static_cast<Real>(a[i][j + 4]);
+}
+
+}
+
+Transform::Transform()
+{
+    memcpy(m, IDENTITY, sizeof(m));
+    memcpy(mInv, IDENTITY, sizeof(mInv));
+}
+
+Transform::Transform(const Real mat[4][4])
+{
+    memcpy(m, mat, sizeof(m));
+    invert(m, mInv);
+}
+
+Transform::Transform(const Real mat[4][4], const Real inv[4][4])
+{
+    memcpy(m, mat, sizeof(m));
+    memcpy(mInv, inv, sizeof(mInv));
+}
+
+Transform Transform::translate(const Vector& delta)
+{
+    const Real mat[4][4] = {
+        { 1.f, 0.f, 0.f, delta.x },
+        { 0.f, 1.f, 0.f, delta.y },
+        { 0.f, 0.f, 1.f, delta.z },
+        { 0.f, 0.f, 0.f, 1.f }
+    };
+    const Real inv[4][4] = {
+        { 1.f, 0.f, 0.f, -delta.x },
+        { 0.f, 1.f, 0.f, -delta.y },
+        { 0.f, 0.f, 1.f, -delta.z },
+        { 0.f, 0.f, 0.f, 1.f }
+    };
+    return Transform(mat, inv);
+}
+
+Transform Transform::scale(Real x, Real y, Real z)
+{
+    const Real mat[4][4] = {
+        { x, 0.f, 0.f, 0.f },
+        { 0.f, y, 0.f, 0.f },
+        { 0.f, 0.f, z, 0.f },
+        { 0.f, 0.f, 0.f, 1.f }
+    };
+    return Transform(mat);
+}
+
+/*!
+ * Rodriguesův vzorec. Matice otočení je ortogonální, inverze je tedy
+ * transpozice.
+ */
+Transform Transform::rotate(Real angle, const Vector& axis)
+{
+    Vector a(axis);
+    a.normalize();
+    const Real theta = angle * static_cast<Real>(M_PI) / 180.f;
+    const Real s = std::sin(theta);
+    const Real c = std::cos(theta);
+
+    Real mat[4][4];
+    mat[0][0] = a.x * a.x + (1.f - a.x * a.x) * c;
+    mat[0][1] = a.x * a.y * (1.f - c) - a.z * s;
+    mat[0][2] = a.x * a.z * (1.f - c) + a.y * s;
+    mat[0][3] = 0.f;
+
+    mat[1][0] = a.x * a.y * (1.f - c) + a.z * s;
+    mat[1][1] = a.y * a.y + (1.f - a.y * a.y) * c;
+    mat[1][2] = a.y * a.z * (1.f - c) - a.x * s;
+    mat[1][3] = 0.f;
+
+    mat[2][0] = a.x * a.z * (1.f - c) - a.y * s;
+    mat[2][1] = a.y * a.z * (1.f - c) + a.x * s;
+    mat[2][2] = a.z * a.z + (1.f - a.z * a.z) * c;
+    mat[2][3] = 0.f;
+
+    mat[3][0] = mat[3][1] = mat[3][2] = 0.f;
+    mat[3][3] = 1.f;
+
+    Real inv[4][4];
+    for (int i = 0; i < 4; ++i)
+        for (int j = 0; j < 4; ++j)
+            inv[i][j] = mat[j][i];
+
+    return Transform(mat, inv);
+}
+
+Transform Transform::inverse() const
+{
+    return Transform(mInv, m);
+}
+
+Transform Transform::operator*(const Transform& t) const
+{
+    Real mat[4][4], inv[4][4];
+    multiply(m, t.m, mat);
+    multiply(t.mInv, mInv, inv);
+    return Transform(mat, inv);
+}
+
+bool Transform::isIdentity() const
+{
+    return memcmp(m, IDENTITY, sizeof(m)) == 0;
+}
+
+Vector Transform::point(const Vector& p) const
+{
+    Real x = m[0][0] * p.x + m[0][1] * p.y + m[0][2] * p.z + m[0][3];
+    Real y = m[1][0] * p.x + m[1][1] * p.y + m[1][2] * p.z + m[1][3];
+    Real z = m[2][0] * p.x + m[2][1] * p.y + m[2][2] * p.z + m[2][3];
+    Real w = m[3][0] * p.x + m[3][1] * p.y + m[3][2] * p.z + m[3][3];
+    if (w == 1.f)
+        return Vector(x, y, z);
+    return Vector(x / w, y / w, z / w);
+}
+
+Vector Transform::vector(const Vector& v) const
+{
+    return Vector(m[0][0] * v.x + m[0][1] * v.y + m[0][2] * v.z,
+                  m[1][0] * v.x + m[1][1] * v.y + m[1][2] * v.z,
+                  m[2][0] * v.x + m[2][1] * v.y + m[2][2] * v.z);
+}
+
+Vector Transform::normal(const Vector& n) const
+{
+    return Vector(mInv[0][0] * n.x + mInv[1][0] * n.y + mInv[2][0] * n.z,
+                  mInv[0][1] * n.x + mInv[1][1] * n.y + mInv[2][1] * n.z,
+                  mInv[0][2] * n.x + mInv[1][2] * n.y + mInv[2][2] * n.z);
+}
+
+Ray Transform::ray(const Ray& r) const
+{
+    Ray result(point(r.o), vector(r.d), r.mint, r.maxt, r.rayEpsilon, r.depth);
+    result.spread = r.spread;
+    return result;
+}
+
+BBox Transform::bounds(const BBox& b) const
+{
+    BBox result;
+    for (int i = 0; i < 8; ++i)
+    {
+        Vector corner(b[i & 1].x, b[(i >> 1) & 1].y, b[(i >> 2) & 1].z);
+        result = unite(result, point(corner));
+    }
+    return result;
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include "core/geometry.h"
+
+namespace tracer
+{
+
+/*!
+ * Afinní transformace prostoru zadaná maticí 4x4. Spolu s maticí se
+ * uchovává i její inverze, takže získání inverzní transformace je levné.
+ */
+class Transform
+{
+public:
+    /*!
+     * Bezparametrický konstruktor. Vytvoří identitu.
+     */
+    Transform();
+
+    /*!
+     * Konstruktor z matice. Inverze se dopočítá, pokud matice není
+     * regulární, vyhodí výjimku std::runtime_error.
+     * \param mat matice transformace uložená po řádcích
+     */
+    Transform(const Real mat[4][4]);
+
+    /*!
+     * Konstruktor z matice a její inverze.
+     * \param mat matice transformace
+     * \param inv inverzní matice
+     */
+    Transform(const Real mat[4][4], const Real inv[4][4]);
+
+    /*!
+     * Posunutí.
+     * \param delta vektor posunutí
+     */
+    static Transform translate(const Vector& delta);
+
+    /*!
+     * Změna měřítka podél os.
+     * \param x měřítko v ose X
+     * \param y měřítko v ose Y
+     * \param z měřítko v ose Z
+     */
+    static Transform scale(Real x, Real y, Real z);
+
+    /*!
+     * Otočení kolem osy procházející počátkem.
+     * \param angle úhel ve stupních
+     * \param axis osa otáčení
+     */
+    static Transform rotate(Real angle, const Vector& axis);
+
+    /*!
+     * \return inverzní transformace
+     */
+    Transform inverse() const;
+
+    /*!
+     * Složení transformací. Výsledek nejprve aplikuje \a t a poté tuto transformaci.
+     * \param t vnitřní transformace
+     */
+    Transform operator*(const Transform& t) const;
+
+    /*!
+     * \return jestli jde o identitu
+     */
+    bool isIdentity() const;
+
+    /*!
+     * Transformuje bod.
+     * \param p bod
+     */
+    Vector point(const Vector& p) const;
+
+    /*!
+     * Transformuje směrový vektor (bez posunutí).
+     * \param v vektor
+     */
+    Vector vector(const Vector& v) const;
+
+    /*!
+     * Transformuje normálu pomocí transponované inverzní matice.
+     * Výsledek není normalizovaný.
+     * \param n normála
+     */
+    Vector normal(const Vector& n) const;
+
+    /*!
+     * Transformuje paprsek. Směr se nenormalizuje, parametr t tedy odpovídá
+     * stejným bodům jako u původního paprsku a meze mint, maxt se přebírají.
+     * \param r paprsek
+     */
+    Ray ray(const Ray& r) const;
+
+    /*!
+     * Obalový kvádr transformovaného kvádru (transformuje všech osm rohů).
+     * \param b obalový kvádr
+     */
+    BBox bounds(const BBox& b) const;
+
+private:
+    Real m[4][4]; ///< Matice transformace.
+    Real mInv[4][4]; ///< Inverzní matice.
+};
+
+}
@@ -0,0 +1,370 @@
+#include "core/xmlparser.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+using namespace tracer;
+
+namespace
+{
+
+inline bool isSpace(int c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+inline bool isNameChar(int c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ||
+           c == '_' || c == '-' || c == '.' || c == ':' || c >= 0x80;
+}
+
+/*!
+ * Zakóduje znak Unicode do UTF-8.
+ */
+void appendUTF8(std::string& out, unsigned long cp)
+{
+    if (cp < 0x80)
+    {
+        out += static_cast<char>(cp);
+    }
+    else if (cp < 0x800)
+    {
+        out += static_cast<char>(0xC0 | (cp >> 6));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+    else if (cp < 0x10000)
+    {
+        out += static_cast<char>(0xE0 | (cp >> 12));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+    else
+    {
+        out += static_cast<char>(0xF0 | (cp >> 18));
+        out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+}
+
+}
+
+/************************************************************************/
+/* XMLAttributes methods                                                */
+/************************************************************************/
+
+const std::string* XMLAttributes::find(const char* name) const
+{
+    for (size_t i = 0; i < attributes.size(); ++i)
+        if (attributes[i].first == name)
+            return &attributes[i].second;
+    return nullptr;
+}
+
+/************************************************************************/
+/* XMLHandler methods                                                   */
+/************************************************************************/
+
+XMLHandler::~XMLHandler()
+{ }
+
+/************************************************************************/
+/* XMLParser methods                                                    */
+/************************************************************************/
+
+XMLParser::XMLParser(XMLHandler& handler, size_t bufferSize)
+    : handler(handler),
+      buffer(std::max(bufferSize, static_cast<size_t>(16))),
+      pos(0),
+      end(0),
+      file(nullptr),
+      line(1)
+{ }
+
+XMLParser::~XMLParser()
+{
+    if (file)
+        fclose(file);
+}
+
+void XMLParser::parse(const char* path)
+{
+    file = fopen(path, "rb");
+    if (!file)
+        throw std::runtime_error(std::string("Cannot open XML file ") + path);
+
+    pos = end = 0;
+    line = 1;
+    elements.clear();
+
+    bool root = false;
+    while (peek() != EOF)
+    {
+        if (peek() == '<')
+        {
+            get();
+            size_t depth = elements.size();
+            readMarkup();
+            if (depth == 0 && !elements.empty())
+            {
+                if (root)
+                    error("Multiple root elements");
+                root = true;
+            }
+        }
+        else
+        {
+            readText();
+        }
+    }
+
+    if (!elements.empty())
+        error("Unexpected end of file inside element " + elements.back());
+    if (!root)
+        error("No root element");
+
+    fclose(file);
+    file = nullptr;
+}
+
+bool XMLParser::fill()
+{
+    if (!file)
+        return false;
+    pos = 0;
+    end = fread(&buffer[0], 1, buffer.size(), file);
+    return end > 0;
+}
+
+void XMLParser::error(const std::string& message) const
+{
+    throw std::runtime_error("XML error on line " + std::to_string(line) + ": " + message);
+}
+
+void XMLParser::expect(char expected)
+{
+    int c = get();
+    if (c != static_cast<unsigned char>(expected))
+        error(std::string("Expected '") + expected + "'");
+}
+
+void XMLParser::skipSpace()
+{
+    while (isSpace(peek()))
+        get();
+}
+
+/*!
+ * V okně se drží přečtené znaky, které tvoří předponu ukončovacího řetězce.
+ * Znaky, které předponu tvořit přestanou, se z okna vyřadí.
+ */
+void XMLParser::skipUntil(const char* terminator, bool text)
+{
+    const size_t length = strlen(terminator);
+    std::string window;
+    while (window.size() < length)
+    {
+        int c = get();
+        if (c == EOF)
+            error(std::string("Missing '") + terminator + "'");
+        window += static_cast<char>(c);
+
+        while (!window.empty() && window.compare(0, window.size(), terminator, window.size()) != 0)
+        {
+            if (text)
+                handler.characters(window.data(), 1);
+            window.erase(0, 1);
+        }
+    }
+}
+
+void XMLParser::readName(std::string& name)
+{
+    name.clear();
+    while (isNameChar(peek()))
+        name += static_cast<char>(get());
+    if (name.empty())
+        error("Expected a name");
+}
+
+void XMLParser::readEntity(std::string& out)
+{
+    std::string entity;
+    int c;
+    while ((c = get()) != ';')
+    {
+        if (c == EOF || entity.size() > 10)
+            error("Unterminated entity");
+        entity += static_cast<char>(c);
+    }
+
+    if (entity == "lt")
+        out += '<';
+    else if (entity == "gt")
+        out += '>';
+    else if (entity == "amp")
+        out += '&';
+    else if (entity == "quot")
+        out += '"';
+    else if (entity == "apos")
+        out += '\'';
+    else if (entity.size() > 1 && entity[0] == '#')
+    {
+        char* endPtr;
+        unsigned long cp = (entity[1] == 'x')
+            ? strtoul(entity.c_str() + 2, &endPtr, 16)
+            : strtoul(entity.c_str() + 1, &endPtr, 10);
+        if (*endPtr || cp > 0x10FFFF)
+            error("Invalid character reference &" + entity + ";");
+        appendUTF8(out, cp);
+    }
+    else
+        error("Unknown entity &" + entity + ";");
+}
+
+/*!
+ * Souvislé úseky textu se předávají přímo z bufferu, zvlášť se zpracují
+ * pouze entity.
+ */
+void XMLParser::readText()
+{
+    while (peek() != EOF)
+    {
+        const char* begin = &buffer[pos];
+        const char* stop = begin;
+        const char* last = &buffer[0] + end;
+        while (stop != last && *stop != '<' && *stop != '&')
+            ++stop;
+
+        const size_t length = static_cast<size_t>(stop - begin);
+        if (length)
+        {
+            line += std::count(begin, stop, '\n');
+            pos += length;
+            if (!elements.empty())
+                handler.characters(begin, length);
+            else if (std::find_if(begin, stop, [](char c) { return !isSpace(c); }) != stop)
+                error("Text outside of the root element");
+        }
+
+        if (stop == last)
+            continue;
+        if (*stop == '<')
+            return;
+
+        get();
+        text.clear();
+        readEntity(text);
+        if (elements.empty())
+            error("Text outside of the root element");
+        handler.characters(text.data(), text.size());
+    }
+}
+
+void XMLParser::readMarkup()
+{
+    int c = peek();
+    if (c == '?')
+    {
+        skipUntil("?>");
+        return;
+    }
+
+    if (c == '!')
+    {
+        get();
+        if (peek() == '-')
+        {
+            expect('-');
+            expect('-');
+            skipUntil("-->");
+        }
+        else if (peek() == '[')
+        {
+            const char* cdata = "[CDATA[";
+            for (const char* p = cdata; *p; ++p)
+                expect(*p);
+            if (elements.empty())
+                error("CDATA outside of the root element");
+            skipUntil("]]>", true);
+        }
+        else
+        {
+            // DOCTYPE, případná vnitřní podmnožina v hranatých závorkách se přeskočí.
+            int nesting = 0;
+            while ((c = get()) != '>' || nesting > 0)
+            {
+                if (c == EOF)
+                    error("Unterminated declaration");
+                if (c == '[')
+                    ++nesting;
+                else if (c == ']')
+                    --nesting;
+            }
+        }
+        return;
+    }
+
+    if (c == '/')
+    {
+        get();
+        readName(name);
+        skipSpace();
+        expect('>');
+        if (elements.empty() || elements.back() != name)
+            error("Unexpected closing tag " + name);
+        elements.pop_back();
+        handler.endElement(name);
+        return;
+    }
+
+    readName(name);
+    attributes.attributes.clear();
+    bool empty = false;
+    while (true)
+    {
+        skipSpace();
+        c = peek();
+        if (c == '>')
+        {
+            get();
+            break;
+        }
+        if (c == '/')
+        {
+            get();
+            expect('>');
+            empty = true;
+            break;
+        }
+
+        attributes.attributes.push_back(std::make_pair(std::string(), std::string()));
+        std::pair<std::string, std::string>& attribute = attributes.attributes.back();
+        readName(attribute.first);
+        skipSpace();
+        expect('=');
+        skipSpace();
+        int quote = get();
+        if (quote != '"' && quote != '\'')
+            error("Expected quoted value of attribute " + attribute.first);
+        while ((c = get()) != quote)
+        {
+            if (c == EOF || c == '<')
+                error("Unterminated value of attribute " + attribute.first);
+            if (c == '&')
+                readEntity(attribute.second);
+            else
+                attribute.second += static_cast<char>(c);
+        }
+    }
+
+    elements.push_back(name);
+    handler.startElement(name, attributes);
+    if (empty)
+    {
+        elements.pop_back();
+        handler.endElement(name);
+    }
+}
@@ -0,0 +1,188 @@
+#pragma once
+
+#include <cstdio>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace tracer
+{
+
+/*!
+ * Atributy jednoho elementu XML v pořadí, v jakém jsou uvedeny.
+ */
+class XMLAttributes
+{
+public:
+    /*!
+     * Najde hodnotu atributu.
+     * \param name název atributu
+     * \return hodnota atributu nebo nullptr, pokud atribut chybí
+     */
+    const std::string* find(const char* name) const;
+
+    /*!
+     * \return počet atributů
+     */
+    size_t size() const
+    { return attributes.size(); }
+
+    /*!
+     * Přístup k atributu podle pořadí.
+     * \param i pořadí atributu
+     * \return dvojice název, hodnota
+     */
+    const std::pair<std::string, std::string>& operator[](size_t i) const
+    { return attributes[i]; }
+
+private:
+    friend class XMLParser;
+
+    std::vector<std::pair<std::string, std::string>> attributes; ///< Dvojice název, hodnota.
+};
+
+/*!
+ * Rozhraní pro příjem událostí z XMLParser.
+ */
+class XMLHandler
+{
+public:
+    virtual ~XMLHandler();
+
+    /*!
+     * Začátek elementu.
+     * \param name název elementu
+     * \param attributes atributy elementu
+     */
+    virtual void startElement(const std::string& name, const XMLAttributes& attributes) = 0;
+
+    /*!
+     * Konec elementu. Volá se i pro prázdné elementy (<a/>).
+     * \param name název elementu
+     */
+    virtual void endElement(const std::string& name) = 0;
+
+    /*!
+     * Textový obsah elementu. Text jednoho elementu může přijít
+     * rozdělený do libovolného počtu volání, hranice může ležet i uprostřed
+     * slova. Entity jsou už nahrazené.
+     * \param data znaky textu (bez ukončovací nuly)
+     * \param length počet znaků
+     */
+    virtual void characters(const char* data, size_t length) = 0;
+};
+
+/*!
+ * Proudový (SAX) parser XML. Soubor čte po blocích pevné velikosti
+ * a události předává objektu XMLHandler, v paměti tedy nikdy není celý
+ * dokument. Textový obsah se předává přímo z bufferu bez kopírování.
+ *
+ * Podporuje elementy, atributy, znakové a předdefinované entity, komentáře,
+ * sekce CDATA a přeskakuje instrukce pro zpracování a deklaraci DOCTYPE.
+ * Jmenné prostory ani validace podporovány nejsou. Při chybě vyhodí
+ * výjimku std::runtime_error s číslem řádku.
+ */
+class XMLParser
+{
+public:
+    /*!
+     * Konstruktor.
+     * \param handler příjemce událostí
+     * \param bufferSize velikost bloku čteného ze souboru
+     */
+    XMLParser(XMLHandler& handler, size_t bufferSize = 1 << 20);
+
+    ~XMLParser();
+
+    XMLParser(const XMLParser&) = delete;
+    XMLParser& operator=(const XMLParser&) = delete;
+
+    /*!
+     * Zpracuje soubor.
+     * \param file cesta k souboru
+     */
+    void parse(const char* file);
+
+private:
+    /*!
+     * Načte další blok souboru.
+     * \return jestli byla načtena nějaká data
+     */
+    bool fill();
+
+    /*!
+     * \return další znak nebo EOF
+     */
+    int get()
+    {
+        if (pos == end && !fill())
+            return EOF;
+        char c = buffer[pos++];
+        if (c == '\n')
+            ++line;
+        return static_cast<unsigned char>(c);
+    }
+
+    /*!
+     * \return další znak bez jeho přečtení nebo EOF
+     */
+    int peek()
+    {
+        if (pos == end && !fill())
+            return EOF;
+        return static_cast<unsigned char>(buffer[pos]);
+    }
+
+    /*!
+     * Přečte znak a ověří, že odpovídá očekávanému.
+     * \param expected očekávaný znak
+     */
+    void expect(char expected);
+
+    /*! Přeskočí bílé znaky. */
+    void skipSpace();
+
+    /*!
+     * Přeskočí vstup až za zadaný řetězec.
+     * \param terminator ukončovací řetězec
+     * \param text jestli se přeskočený obsah předá jako text elementu (sekce CDATA)
+     */
+    void skipUntil(const char* terminator, bool text = false);
+
+    /*!
+     * Přečte název elementu nebo atributu.
+     * \param name slouží k návratu názvu
+     */
+    void readName(std::string& name);
+
+    /*!
+     * Přečte entitu (za znakem &) a připojí její hodnotu k řetězci.
+     * \param out řetězec, ke kterému se hodnota připojí
+     */
+    void readEntity(std::string& out);
+
+    /*! Zpracuje text až k dalšímu znaku < nebo konci souboru. */
+    void readText();
+
+    /*! Zpracuje značku (za znakem <). */
+    void readMarkup();
+
+    /*!
+     * Vyhodí výjimku s popisem chyby a číslem řádku.
+     * \param message popis chyby
+     */
+    [[noreturn]] void error(const std::string& message) const;
+
+    XMLHandler& handler; ///< Příjemce událostí.
+    std::vector<char> buffer; ///< Aktuální blok souboru.
+    size_t pos; ///< Pozice v bufferu.
+    size_t end; ///< Konec platných dat v bufferu.
+    FILE* file; ///< Zpracovávaný soubor.
+    size_t line; ///< Aktuální řádek pro hlášení chyb.
+    std::vector<std::string> elements; ///< Otevřené elementy.
+    XMLAttributes attributes; ///< Atributy právě čteného elementu.
+    std::string name; ///< Název právě čteného elementu.
+    std::string text; ///< Pomocný řetězec pro entity v textu.
+};
+
+}
@@ -0,0 +1,216 @@
+#include "films/tiledfilm.h"
+
+#include <cmath>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+using namespace tracer;
+
+namespace
+{
+
+/*!
+ * Obdélník [x0; x1) x [y0; y1) v pixelech.
+ */
+struct Rect
+{
+    int x0, y0, x1, y1;
+
+    size_t area() const
+    { return x1 > x0 && y1 > y0 ? static_cast<size_t>(x1 - x0) * (y1 - y0) : 0; }
+
+    Rect intersect(const Rect& r) const
+    { return Rect{ max(x0, r.x0), max(y0, r.y0), min(x1, r.x1), min(y1, r.y1) }; }
+};
+
+}
+
+TiledFilm::TiledFilm(const char* file, int width, int height, Real size, Real gamma /* = 1.f */,
+                     Filter* filter /* = nullptr */, int blockSize /* = 64 */)
+    : Film(width, height, size, gamma, filter, false),
+      file(file),
+      fd(-1),
+      data(nullptr),
+      blockSize(max(blockSize, 1))
+{
+    blocksX = (width + this->blockSize - 1) / this->blockSize;
+    blocksY = (height + this->blockSize - 1) / this->blockSize;
+    borderX = static_cast<int>(std::ceil(this->filter().xWidth));
+    borderY = static_cast<int>(std::ceil(this->filter().yWidth));
+
+    // Bloky jsou zarovnané na stránky, aby je šlo uvolňovat jednotlivě.
+    const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    blockStride = static_cast<size_t>(this->blockSize) * this->blockSize * sizeof(TiledPixel);
+    blockStride = (blockStride + pageSize - 1) / pageSize * pageSize;
+    fileSize = blockStride * blocksX * blocksY;
+
+    fd = ::open(file, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        throw std::runtime_error(std::string("Cannot open file ") + file);
+
+    if (ftruncate(fd, static_cast<off_t>(fileSize)) != 0)
+    {
+        ::close(fd);
+        unlink(file);
+        throw std::runtime_error(std::string("Cannot resize file ") + file);
+    }
+
+    void* mapped = mmap(nullptr, fileSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mapped == MAP_FAILED)
+    {
+        ::close(fd);
+        unlink(file);
+        throw std::runtime_error(std::string("Cannot map file ") + file);
+    }
+    data = static_cast<unsigned char*>(mapped);
+
+    covered.assign(static_cast<size_t>(blocksX) * blocksY, 0);
+    released.assign(covered.size(), false);
+}
+
+TiledFilm::~TiledFilm()
+{
+    munmap(data, fileSize);
+    ::close(fd);
+    unlink(file.c_str());
+}
+
+void TiledFilm::mergeFilmTile(const FilmTile& tile)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    int tileWidth = tile.px1 - tile.px0;
+    for (int y = tile.py0; y < tile.py1; ++y)
+    {
+        for (int x = tile.px0; x < tile.px1; ++x)
+        {
+            const FilmTile::TilePixel& src = tile.pixels[(y - tile.py0) * tileWidth + (x - tile.px0)];
+            TiledPixel* dst = at(x, y);
+            dst->sum[0] += src.sum.r;
+            dst->sum[1] += src.sum.g;
+            dst->sum[2] += src.sum.b;
+            dst->weightSum += src.weightSum;
+        }
+    }
+
+    updateBlocks(tile);
+}
+
+void TiledFilm::addSplat(Real px, Real py, const RGBColor& l)
+{
+    throw std::runtime_error("TiledFilm does not support splatting");
+}
+
+RGBColor TiledFilm::pixel(int x, int y) const
+{
+    const TiledPixel* p = at(x, y);
+    return p->weightSum > 0.f ? RGBColor(p->sum[0], p->sum[1], p->sum[2]) / p->weightSum : BLACK;
+}
+
+void TiledFilm::getRow(int y, Real* rgb) const
+{
+    for (int bx = 0; bx < blocksX; ++bx)
+    {
+        int x0 = bx * blockSize;
+        int x1 = min(x0 + blockSize, width);
+        const TiledPixel* p = at(x0, y);
+        for (int x = x0; x < x1; ++x, ++p, rgb += 3)
+        {
+            Real invWeight = p->weightSum > 0.f ? 1.f / p->weightSum : 0.f;
+            rgb[0] = p->sum[0] * invWeight;
+            rgb[1] = p->sum[1] * invWeight;
+            rgb[2] = p->sum[2] * invWeight;
+        }
+    }
+}
+
+/*!
+ * Zkrácením souboru na nulu se zahodí všechny stránky, po opětovném
+ * zvětšení se soubor chová jako vynulovaný a nezabírá místo na disku.
+ */
+void TiledFilm::clear()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (ftruncate(fd, 0) != 0 || ftruncate(fd, static_cast<off_t>(fileSize)) != 0)
+        throw std::runtime_error("Cannot clear file " + file);
+
+    covered.assign(covered.size(), 0);
+    released.assign(released.size(), false);
+}
+
+Film* TiledFilm::clone() const
+{
+    throw std::runtime_error("TiledFilm cannot be copied");
+}
+
+void TiledFilm::write(FILE* f) const
+{
+    throw std::runtime_error("TiledFilm does not support checkpoints");
+}
+
+void TiledFilm::read(FILE* f)
+{
+    throw std::runtime_error("TiledFilm does not support checkpoints");
+}
+
+size_t TiledFilm::residentBlocks() const
+{
+    size_t count = 0;
+    for (size_t i = 0; i < released.size(); ++i)
+        if (!released[i])
+            ++count;
+    return count;
+}
+
+TiledFilm::TiledPixel* TiledFilm::at(int x, int y) const
+{
+    int bx = x / blockSize;
+    int by = y / blockSize;
+    size_t block = static_cast<size_t>(by) * blocksX + bx;
+    size_t local = static_cast<size_t>(y - by * blockSize) * blockSize + (x - bx * blockSize);
+    return reinterpret_cast<TiledPixel*>(data + block * blockStride) + local;
+}
+
+/*!
+ * Do bloku mohou přispět vzorky z pixelů, které leží nejvýše borderX
+ * (borderY) pixelů od jeho okraje. Blok je hotový, když byly sloučeny
+ * vzorky ze všech takových pixelů. Předpokládá se, že každý pixel vzorků
+ * se sloučí jednou; pokud ne, blok se jen uvolní dříve a při dalším
+ * přístupu se znovu načte ze souboru.
+ */
+void TiledFilm::updateBlocks(const FilmTile& tile)
+{
+    const Rect image = { 0, 0, width, height };
+    const Rect samples = { tile.x0, tile.y0, tile.x1, tile.y1 };
+
+    int bx0 = max(0, (tile.x0 - borderX) / blockSize);
+    int by0 = max(0, (tile.y0 - borderY) / blockSize);
+    int bx1 = min(blocksX - 1, (tile.x1 - 1 + borderX) / blockSize);
+    int by1 = min(blocksY - 1, (tile.y1 - 1 + borderY) / blockSize);
+
+    for (int by = by0; by <= by1; ++by)
+    {
+        for (int bx = bx0; bx <= bx1; ++bx)
+        {
+            size_t block = static_cast<size_t>(by) * blocksX + bx;
+            if (released[block])
+                continue;
+
+            const Rect reach = Rect{ bx * blockSize - borderX, by * blockSize - borderY,
+                                     (bx + 1) * blockSize + borderX, (by + 1) * blockSize + borderY }.intersect(image);
+            covered[block] += reach.intersect(samples).area();
+
+            if (covered[block] >= reach.area())
+            {
+                unsigned char* start = data + block * blockStride;
+                msync(start, blockStride, MS_ASYNC);
+                madvise(start, blockStride, MADV_DONTNEED);
+                released[block] = true;
+            }
+        }
+    }
+}
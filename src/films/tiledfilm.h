@@ -0,0 +1,172 @@
+#pragma once
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "core/film.h"
+
+namespace tracer
+{
+
+/*!
+ * Film pro obrázky, které se nevejdou do paměti. Pixely jsou uloženy
+ * v souboru na disku namapovaném do paměti (mmap), rozděleném na bloky
+ * blockSize x blockSize pixelů. Každý blok leží v souboru souvisle, takže
+ * dlaždice rendereru se dotkne jen několika málo stránek.
+ *
+ * Dlaždice se slučují stejně jako do obyčejného filmu, příspěvky přes
+ * okraj filtru se zapíšou do sousedních bloků. Jakmile jsou sloučeny
+ * všechny vzorky, které mohou do bloku zasáhnout přes filtr, blok se
+ * zapíše na disk a jeho stránky se uvolní. V paměti tak zůstávají pouze
+ * bloky pod rozpracovanými dlaždicemi.
+ *
+ * Film neukládá statistiky vzorků ani splat buffer, je určený pro
+ * renderery s pevným počtem vzorků (TileRenderer). Uvolňování bloků
+ * předpokládá, že se každá dlaždice sloučí právě jednou. ProgressiveRenderer
+ * a AdaptiveRenderer, které slučují více průchodů a čtou statistiky vzorků,
+ * proto takový film odmítnou na začátku render(), stejně jako TileRenderer
+ * odmítne integrátor používající splaty (viz Renderer::checkFilm()).
+ * Výstup se čte po řádcích metodou getRow(), např. třídou ImageWriter.
+ */
+class TiledFilm : public Film
+{
+public:
+    /*!
+     * Konstruktor. Vytvoří pracovní soubor, který se smaže v destruktoru.
+     * Při chybě vyhodí výjimku std::runtime_error.
+     * \param file cesta k pracovnímu souboru
+     * \param width výška v pixelech
+     * \param height šířka v pixelech
+     * \param size velikost pixelu ve scéně
+     * \param gamma gamma obrázku
+     * \param filter rekonstrukční filtr, pokud je nullptr, použije se krabicový filtr o poloměru 0.5
+     * \param blockSize velikost strany bloku v pixelech
+     */
+    TiledFilm(const char* file, int width, int height, Real size, Real gamma = 1.f,
+              Filter* filter = nullptr, int blockSize = 64);
+
+    /*!
+     * Destruktor. Odmapuje a smaže pracovní soubor.
+     */
+    virtual ~TiledFilm();
+
+    TiledFilm(const TiledFilm&) = delete;
+    TiledFilm& operator=(const TiledFilm&) = delete;
+
+    /*! \copydoc Film::mergeFilmTile() */
+    virtual void mergeFilmTile(const FilmTile& tile) override;
+
+    /*!
+     * Splat buffer není podporován, vyhodí výjimku std::runtime_error.
+     * Renderery kombinaci se splatujícím integrátorem odmítnou předem,
+     * sem se tedy nemá dojít z renderovacích vláken.
+     */
+    virtual void addSplat(Real px, Real py, const RGBColor& l) override;
+
+    /*!
+     * \return vždy false
+     */
+    virtual bool supportsSplats() const override
+    { return false; }
+
+    /*!
+     * Bloky se po prvním sloučení zapíšou a uvolní a statistiky vzorků
+     * se neukládají.
+     * \return vždy false
+     */
+    virtual bool supportsPasses() const override
+    { return false; }
+
+    /*! \copydoc Film::pixel() */
+    virtual RGBColor pixel(int x, int y) const override;
+
+    /*! \copydoc Film::getRow() */
+    virtual void getRow(int y, Real* rgb) const override;
+
+    /*!
+     * Statistiky vzorků se neukládají.
+     * \return vždy 0
+     */
+    virtual unsigned int sampleCount(int x, int y) const override
+    { return 0; }
+
+    /*!
+     * Statistiky vzorků se neukládají.
+     * \return vždy 0
+     */
+    virtual Real variance(int x, int y) const override
+    { return 0.f; }
+
+    /*!
+     * Statistiky vzorků se neukládají.
+     * \return vždy INFINITY
+     */
+    virtual Real relativeError(int x, int y) const override
+    { return INFINITY; }
+
+    /*!
+     * Vynuluje soubor a všechny bloky označí jako nehotové.
+     */
+    virtual void clear() override;
+
+    /*!
+     * Kopie filmu není podporována, vyhodí výjimku std::runtime_error.
+     */
+    virtual Film* clone() const override;
+
+    /*!
+     * Uložení stavu není podporováno, stav je v pracovním souboru.
+     * Vyhodí výjimku std::runtime_error.
+     */
+    virtual void write(FILE* f) const override;
+
+    /*!
+     * Načtení stavu není podporováno, vyhodí výjimku std::runtime_error.
+     */
+    virtual void read(FILE* f) override;
+
+    /*!
+     * \return počet bloků, které ještě nebyly zapsány a uvolněny
+     */
+    size_t residentBlocks() const;
+
+private:
+    /*!
+     * Pixel uložený v souboru.
+     */
+    struct TiledPixel
+    {
+        float sum[3]; ///< součet vzorků vynásobených vahou filtru
+        float weightSum; ///< součet vah filtru
+    };
+
+    /*!
+     * \param x souřadnice pixelu
+     * \param y souřadnice pixelu
+     * \return ukazatel na pixel v namapovaném souboru
+     */
+    TiledPixel* at(int x, int y) const;
+
+    /*!
+     * Započte sloučené vzorky do pokrytí bloků a hotové bloky zapíše
+     * a uvolní. Volající drží zámek.
+     */
+    void updateBlocks(const FilmTile& tile);
+
+    std::string file; ///< Cesta k pracovnímu souboru.
+    int fd; ///< Deskriptor pracovního souboru.
+    unsigned char* data; ///< Namapovaný soubor.
+    size_t fileSize; ///< Velikost souboru v bajtech.
+    size_t blockStride; ///< Velikost bloku v souboru zarovnaná na stránky.
+    int blockSize; ///< Velikost strany bloku v pixelech.
+    int blocksX; ///< Počet bloků ve směru x.
+    int blocksY; ///< Počet bloků ve směru y.
+    int borderX; ///< Dosah filtru ve směru x v celých pixelech.
+    int borderY; ///< Dosah filtru ve směru y v celých pixelech.
+    std::vector<size_t> covered; ///< Počet sloučených pixelů vzorků v dosahu každého bloku.
+    std::vector<bool> released; ///< Příznaky uvolněných bloků.
+    std::mutex mutex; ///< Zámek pro slučování dlaždic.
+};
+
+}
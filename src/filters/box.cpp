@@ -0,0 +1,15 @@
+#include "filters/box.h"
+
+using namespace tracer;
+
+BoxFilter::BoxFilter(Real xWidth, Real yWidth)
+    : Filter(xWidth, yWidth)
+{ }
+
+BoxFilter::~BoxFilter()
+{ }
+
+Real BoxFilter::evaluate(Real x, Real y) const
+{
+    return 1.f;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "core/filter.h"
+
+namespace tracer
+{
+
+/*!
+ * Krabicový filtr. Všechny vzorky v jeho dosahu mají stejnou váhu.
+ * S poloměrem 0.5 odpovídá prostému průměrování vzorků v pixelu.
+ */
+class BoxFilter : public Filter
+{
+public:
+    /*!
+     * Konstruktor.
+     * \param xWidth poloměr ve směru x
+     * \param yWidth poloměr ve směru y
+     */
+    BoxFilter(Real xWidth = 0.5f, Real yWidth = 0.5f);
+
+    virtual ~BoxFilter();
+
+    /*! \copydoc Filter::evaluate() */
+    virtual Real evaluate(Real x, Real y) const override;
+
+    /*! \copydoc Filter::name() */
+    virtual const char* name() const override
+    { return "box"; }
+};
+
+}
@@ -0,0 +1,23 @@
+#include "filters/gaussian.h"
+
+using namespace tracer;
+
+GaussianFilter::GaussianFilter(Real xWidth, Real yWidth, Real alpha)
+    : Filter(xWidth, yWidth),
+      alpha(alpha),
+      expX(std::exp(-alpha * xWidth * xWidth)),
+      expY(std::exp(-alpha * yWidth * yWidth))
+{ }
+
+GaussianFilter::~GaussianFilter()
+{ }
+
+Real GaussianFilter::evaluate(Real x, Real y) const
+{
+    return gaussian(x, expX) * gaussian(y, expY);
+}
+
+Real GaussianFilter::gaussian(Real d, Real expv) const
+{
+    return max(0.f, std::exp(-alpha * d * d) - expv);
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "core/filter.h"
+
+namespace tracer
+{
+
+/*!
+ * Gaussův filtr posunutý tak, aby na okraji svého dosahu nabýval nuly.
+ */
+class GaussianFilter : public Filter
+{
+public:
+    /*!
+     * Konstruktor.
+     * \param xWidth poloměr ve směru x
+     * \param yWidth poloměr ve směru y
+     * \param alpha strmost poklesu, větší hodnota dává ostřejší obraz
+     */
+    GaussianFilter(Real xWidth = 2.f, Real yWidth = 2.f, Real alpha = 2.f);
+
+    virtual ~GaussianFilter();
+
+    /*! \copydoc Filter::evaluate() */
+    virtual Real evaluate(Real x, Real y) const override;
+
+    /*! \copydoc Filter::name() */
+    virtual const char* name() const override
+    { return "gaussian"; }
+
+private:
+    /*!
+     * Jednorozměrný posunutý Gaussián.
+     * \param d vzdálenost od středu
+     * \param expv hodnota Gaussiánu na okraji
+     */
+    Real gaussian(Real d, Real expv) const;
+
+    Real alpha; ///< Strmost poklesu.
+    Real expX; ///< Hodnota Gaussiánu na okraji ve směru x.
+    Real expY; ///< Hodnota Gaussiánu na okraji ve směru y.
+};
+
+}
@@ -0,0 +1,29 @@
+#include "filters/mitchell.h"
+
+using namespace tracer;
+
+MitchellFilter::MitchellFilter(Real xWidth, Real yWidth, Real b, Real c)
+    : Filter(xWidth, yWidth),
+      b(b),
+      c(c)
+{ }
+
+MitchellFilter::~MitchellFilter()
+{ }
+
+Real MitchellFilter::evaluate(Real x, Real y) const
+{
+    return mitchell1D(x * invXWidth) * mitchell1D(y * invYWidth);
+}
+
+Real MitchellFilter::mitchell1D(Real x) const
+{
+    x = std::fabs(2.f * x);
+    if (x > 1.f)
+        return ((-b - 6.f * c) * x * x * x + (6.f * b + 30.f * c) * x * x +
+                (-12.f * b - 48.f * c) * x + (8.f * b + 24.f * c)) * (1.f / 6.f);
+    else
+        return ((12.f - 9.f * b - 6.f * c) * x * x * x +
+                (-18.f + 12.f * b + 6.f * c) * x * x +
+                (6.f - 2.f * b)) * (1.f / 6.f);
+}
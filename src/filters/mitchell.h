@@ -0,0 +1,44 @@
+#pragma once
+
+#include "core/filter.h"
+
+namespace tracer
+{
+
+/*!
+ * Mitchellův-Netravaliho filtr. Kubický filtr se zápornými laloky,
+ * parametry B a C určují poměr mezi rozmazáním a zvoněním.
+ */
+class MitchellFilter : public Filter
+{
+public:
+    /*!
+     * Konstruktor.
+     * \param xWidth poloměr ve směru x
+     * \param yWidth poloměr ve směru y
+     * \param b parametr B
+     * \param c parametr C
+     */
+    MitchellFilter(Real xWidth = 2.f, Real yWidth = 2.f, Real b = 1.f / 3.f, Real c = 1.f / 3.f);
+
+    virtual ~MitchellFilter();
+
+    /*! \copydoc Filter::evaluate() */
+    virtual Real evaluate(Real x, Real y) const override;
+
+    /*! \copydoc Filter::name() */
+    virtual const char* name() const override
+    { return "mitchell"; }
+
+private:
+    /*!
+     * Jednorozměrný Mitchellův filtr.
+     * \param x vzdálenost od středu přeškálovaná na interval <-1; 1>
+     */
+    Real mitchell1D(Real x) const;
+
+    Real b; ///< Parametr B.
+    Real c; ///< Parametr C.
+};
+
+}
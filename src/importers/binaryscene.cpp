@@ -0,0 +1,987 @@
+#include "importers/binaryscene.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "acceleration/accelerationcache.h"
+#include "acceleration/bvh.h"
+#include "acceleration/instance.h"
+#include "cameras/pinhole.h"
+#include "core/texturecache.h"
+#include "filters/box.h"
+#include "filters/gaussian.h"
+#include "filters/mitchell.h"
+#include "lights/arealight.h"
+#include "lights/environmentlight.h"
+#include "lights/pointlight.h"
+#include "materials/matte.h"
+#include "textures/image.h"
+
+using namespace tracer;
+
+namespace
+{
+
+const char MAGIC[8] = { 'T', 'R', 'S', 'C', 'E', 'N', 'E', '\0' };
+const uint32_t VERSION = 6;
+
+/// Zarovnání začátků sekcí v souboru.
+const uint64_t SECTION_ALIGNMENT = 16;
+
+/// Hodnota PrimRef::mesh u odkazu na instanci.
+const uint32_t INSTANCE_REF = 0xFFFFFFFF;
+
+/// Hodnota MaterialRecord::texture u materiálu bez textury.
+const uint32_t NO_TEXTURE = 0xFFFFFFFF;
+
+enum AcceleratorType
+{
+    ACCELERATOR_BVH,
+    ACCELERATOR_GRID,
+    ACCELERATOR_BRUTEFORCE,
+    ACCELERATOR_COUNT
+};
+
+enum FilterType
+{
+    FILTER_BOX,
+    FILTER_GAUSSIAN,
+    FILTER_MITCHELL,
+    FILTER_COUNT
+};
+
+enum LightType
+{
+    LIGHT_POINT,
+    LIGHT_ENVIRONMENT
+};
+
+enum MeshFlags
+{
+    MESH_EMISSIVE = 1, ///< síť je plošným světlem
+    MESH_SHARED = 2 ///< síť patří sdílenému objektu
+};
+
+enum SectionType
+{
+    SECTION_MATERIALS,
+    SECTION_MESHES,
+    SECTION_VERTICES,
+    SECTION_INDICES,
+    SECTION_NORMALS,
+    SECTION_UVS,
+    SECTION_LIGHTS,
+    SECTION_STRINGS,
+    SECTION_OBJECTS,
+    SECTION_INSTANCES,
+    SECTION_NODES,
+    SECTION_REFS,
+    SECTION_DEPENDENCIES,
+    SECTION_COUNT
+};
+
+/*!
+ * Umístění sekce v souboru.
+ */
+struct Section
+{
+    uint64_t offset; ///< pozice v bajtech od začátku souboru
+    uint64_t count; ///< počet prvků
+};
+
+/*!
+ * Uložené BVH, úseky sekcí uzlů a odkazů.
+ */
+struct TreeRecord
+{
+    uint64_t firstNode;
+    uint64_t nNodes;
+    uint64_t firstRef;
+    uint64_t nRefs;
+};
+
+struct MaterialRecord
+{
+    Real color[3];
+    uint32_t texture; ///< pozice cesty k textuře v sekci řetězců nebo NO_TEXTURE
+};
+
+struct MeshRecord
+{
+    uint32_t material;
+    uint32_t flags; ///< kombinace MeshFlags
+    Real emission[3];
+    uint32_t padding;
+    uint64_t firstVertex;
+    uint64_t nVertices;
+    uint64_t firstIndex;
+    uint64_t nIndices;
+    uint64_t firstNormal;
+    uint64_t nNormals; ///< 0 nebo nVertices
+    uint64_t firstUV;
+    uint64_t nUVs; ///< 0 nebo 2 * nVertices
+};
+
+struct LightRecord
+{
+    uint32_t type; ///< LightType
+    uint32_t file; ///< pozice cesty k mapě okolí v sekci řetězců
+    Real position[3];
+    Real color[3];
+};
+
+struct InstanceRecord
+{
+    uint32_t object;
+    uint32_t padding;
+    unsigned char transform[sizeof(Transform)]; ///< Transform včetně inverze
+};
+
+/*!
+ * Soubor, ze kterého scéna vznikla.
+ */
+struct DependencyRecord
+{
+    uint32_t file; ///< pozice cesty v sekci řetězců
+    uint32_t padding;
+    uint64_t size; ///< velikost souboru
+    int64_t time; ///< čas změny souboru v ns
+};
+
+/*!
+ * Odkaz listu BVH na těleso: trojúhelník sítě nebo instance.
+ */
+struct PrimRef
+{
+    uint32_t mesh; ///< index sítě nebo INSTANCE_REF
+    uint32_t triangle; ///< index trojúhelníku v síti nebo index instance
+};
+
+struct Header
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t vectorSize; ///< velikosti typů používaných přímo ze souboru
+    uint32_t nodeSize;
+    uint32_t transformSize;
+    uint64_t sourceSize; ///< velikost zdrojového souboru
+    int64_t sourceTime; ///< čas změny zdrojového souboru v ns
+    uint64_t textureCache; ///< rozpočet TextureCache v bajtech, 0 pokud ho scéna nezadává
+    uint64_t deduplication[4]; ///< DeduplicationReport: sítě, kopie, sdílené sítě, ušetřené bajty
+    Real background[3];
+    uint32_t accelerator; ///< AcceleratorType
+    int32_t filmWidth; ///< 0, pokud scéna nemá film
+    int32_t filmHeight;
+    Real gamma;
+    uint32_t filter; ///< FilterType
+    uint32_t hasCamera;
+    Real eye[3];
+    Real target[3];
+    Real up[3];
+    Real fov;
+    TreeRecord tree; ///< BVH celé scény, prázdné u jiných struktur
+    Section sections[SECTION_COUNT];
+};
+
+const size_t SECTION_SIZES[SECTION_COUNT] = {
+    sizeof(MaterialRecord),
+    sizeof(MeshRecord),
+    sizeof(Vector),
+    sizeof(int),
+    sizeof(Vector),
+    sizeof(Real),
+    sizeof(LightRecord),
+    sizeof(char),
+    sizeof(TreeRecord),
+    sizeof(InstanceRecord),
+    sizeof(BVHNode),
+    sizeof(PrimRef),
+    sizeof(DependencyRecord)
+};
+
+/*!
+ * Zjistí velikost a čas poslední změny souboru.
+ * \return jestli soubor existuje
+ */
+bool fileStamp(const char* path, uint64_t& size, int64_t& time)
+{
+    struct stat st;
+    if (stat(path, &st) != 0)
+        return false;
+    size = static_cast<uint64_t>(st.st_size);
+    time = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+    return true;
+}
+
+void toArray(const Vector& v, Real a[3])
+{
+    a[0] = v.x;
+    a[1] = v.y;
+    a[2] = v.z;
+}
+
+void toArray(const RGBColor& c, Real a[3])
+{
+    a[0] = c.r;
+    a[1] = c.g;
+    a[2] = c.b;
+}
+
+Vector toVector(const Real a[3])
+{
+    return Vector(a[0], a[1], a[2]);
+}
+
+RGBColor toColor(const Real a[3])
+{
+    return RGBColor(a[0], a[1], a[2]);
+}
+
+/*!
+ * Zápis do souboru s kontrolou chyb a dorovnáním na pozice sekcí.
+ */
+class Output
+{
+public:
+    Output(const std::string& path)
+        : file(fopen(path.c_str(), "wb")),
+          pos(0)
+    {
+        if (!file)
+            throw std::runtime_error("Cannot create " + path);
+    }
+
+    ~Output()
+    {
+        if (file)
+            fclose(file);
+    }
+
+    void write(const void* data, size_t size)
+    {
+        if (size && fwrite(data, 1, size, file) != size)
+            throw std::runtime_error("Cannot write binary scene");
+        pos += size;
+    }
+
+    void seek(uint64_t offset)
+    {
+        static const char zeros[SECTION_ALIGNMENT] = { 0 };
+        while (pos < offset)
+            write(zeros, static_cast<size_t>(std::min<uint64_t>(offset - pos, SECTION_ALIGNMENT)));
+    }
+
+    void close()
+    {
+        int result = fclose(file);
+        file = nullptr;
+        if (result != 0)
+            throw std::runtime_error("Cannot write binary scene");
+    }
+
+private:
+    FILE* file;
+    uint64_t pos;
+};
+
+/*!
+ * Ověří, že úsek [first; first + count) leží v poli o velikosti size.
+ */
+bool inRange(uint64_t first, uint64_t count, uint64_t size)
+{
+    return first <= size && count <= size - first;
+}
+
+/*!
+ * Ověří uložené BVH: rozsahy úseků, uzly a odkazy listů.
+ * \param shared jestli jde o strom sdíleného objektu (odkazuje jen na jeho sítě)
+ */
+bool validTree(const TreeRecord& tree, const Header& h, const BVHNode* nodes, const PrimRef* refs,
+               const MeshRecord* meshes, bool shared)
+{
+    if (!inRange(tree.firstNode, tree.nNodes, h.sections[SECTION_NODES].count) ||
+        !inRange(tree.firstRef, tree.nRefs, h.sections[SECTION_REFS].count) ||
+        tree.nNodes == 0 || tree.nNodes > 0xFFFFFFFFu)
+        return false;
+
+    if (!BVH::validNodes(nodes + tree.firstNode, tree.nNodes, tree.nRefs))
+        return false;
+
+    for (uint64_t i = 0; i < tree.nRefs; ++i)
+    {
+        const PrimRef& ref = refs[tree.firstRef + i];
+        if (ref.mesh == INSTANCE_REF)
+        {
+            if (shared || ref.triangle >= h.sections[SECTION_INSTANCES].count)
+                return false;
+            continue;
+        }
+        if (ref.mesh >= h.sections[SECTION_MESHES].count)
+            return false;
+        const MeshRecord& mesh = meshes[ref.mesh];
+        if (ref.triangle >= mesh.nIndices / 3 || ((mesh.flags & MESH_SHARED) != 0) != shared)
+            return false;
+    }
+
+    return true;
+}
+
+}
+
+/************************************************************************/
+/* BinarySceneWriter methods                                            */
+/************************************************************************/
+
+BinarySceneWriter::BinarySceneWriter()
+    : background(BLACK),
+      accelerator(ACCELERATOR_BVH),
+      textureCache(0),
+      filmWidth(0),
+      filmHeight(0),
+      gamma(1.f),
+      filter(FILTER_BOX),
+      hasCamera(false),
+      fov(45.f)
+{ }
+
+void BinarySceneWriter::setBackground(const RGBColor& color)
+{
+    background = color;
+}
+
+void BinarySceneWriter::setAccelerator(const std::string& type)
+{
+    accelerator = (type == "grid") ? ACCELERATOR_GRID
+                : (type == "bruteforce") ? ACCELERATOR_BRUTEFORCE
+                : ACCELERATOR_BVH;
+}
+
+void BinarySceneWriter::setTextureCache(size_t bytes)
+{
+    textureCache = bytes;
+}
+
+void BinarySceneWriter::setFilm(int width, int height, Real gamma, const std::string& filter)
+{
+    filmWidth = width;
+    filmHeight = height;
+    this->gamma = gamma;
+    this->filter = (filter == "gaussian") ? FILTER_GAUSSIAN
+                 : (filter == "mitchell") ? FILTER_MITCHELL
+                 : FILTER_BOX;
+}
+
+void BinarySceneWriter::setCamera(const Vector& eye, const Vector& target, const Vector& up, Real fov)
+{
+    hasCamera = true;
+    this->eye = eye;
+    this->target = target;
+    this->up = up;
+    this->fov = fov;
+}
+
+void BinarySceneWriter::addMaterial(const Reference<Material>& material, const RGBColor& color,
+                                    const std::string& texture)
+{
+    Reference<Material> m(material);
+    materialIndices[&*m] = static_cast<uint32_t>(materials.size());
+    MaterialEntry entry;
+    entry.color = color;
+    entry.texture = texture;
+    materials.push_back(entry);
+    if (!texture.empty())
+        addDependency(texture);
+}
+
+void BinarySceneWriter::addPointLight(const Vector& position, const RGBColor& intensity)
+{
+    LightEntry light;
+    light.type = LIGHT_POINT;
+    light.position = position;
+    light.color = intensity;
+    lights.push_back(light);
+}
+
+void BinarySceneWriter::addEnvironmentLight(const std::string& file, const RGBColor& scale)
+{
+    LightEntry light;
+    light.type = LIGHT_ENVIRONMENT;
+    light.color = scale;
+    light.file = file;
+    lights.push_back(light);
+    addDependency(file);
+}
+
+void BinarySceneWriter::addDependency(const std::string& file)
+{
+    for (size_t i = 0; i < dependencies.size(); ++i)
+        if (dependencies[i].file == file)
+            return;
+
+    // Razítko se bere hned, soubor se právě načetl. Změna až před zápisem
+    // by jinak zůstala nepoznaná.
+    DependencyEntry entry;
+    entry.file = file;
+    if (!fileStamp(file.c_str(), entry.size, entry.time))
+    {
+        setUnsupported("Cannot stat " + file);
+        return;
+    }
+    dependencies.push_back(entry);
+}
+
+void BinarySceneWriter::addMesh(const Reference<TriangleMesh>& mesh, bool emissive,
+                                const RGBColor& emission, bool shared)
+{
+    MeshEntry entry;
+    entry.mesh = mesh;
+    entry.emissive = emissive;
+    entry.emission = emission;
+    entry.shared = shared;
+    meshIndices[&*entry.mesh] = static_cast<uint32_t>(meshes.size());
+    meshes.push_back(entry);
+}
+
+void BinarySceneWriter::addObject(const Reference<Primitive>& object)
+{
+    Reference<Primitive> o(object);
+    objectIndices[&*o] = static_cast<uint32_t>(objects.size());
+    objects.push_back(o);
+}
+
+void BinarySceneWriter::addInstance(const Reference<Primitive>& instance, const Reference<Primitive>& object,
+                                    const Transform& transform)
+{
+    Reference<Primitive> o(object);
+    std::unordered_map<const Primitive*, uint32_t>::const_iterator it = objectIndices.find(&*o);
+    if (it == objectIndices.end())
+        throw std::runtime_error("Instanced object was not added to the binary scene");
+
+    InstanceEntry entry;
+    entry.instance = instance;
+    entry.object = it->second;
+    entry.transform = transform;
+    instanceIndices[&*entry.instance] = static_cast<uint32_t>(instances.size());
+    instances.push_back(entry);
+}
+
+void BinarySceneWriter::setDeduplicationReport(const DeduplicationReport& report)
+{
+    deduplication = report;
+}
+
+void BinarySceneWriter::setUnsupported(const std::string& reason)
+{
+    unsupported = reason;
+}
+
+/*!
+ * Nejprve se spočítají velikosti a pozice všech sekcí, potom se sekce
+ * zapíší postupně. Vrcholy a indexy se zapisují přímo z polí sítí.
+ */
+void BinarySceneWriter::write(const char* path, const char* source, const Scene& scene) const
+{
+    if (!unsupported.empty())
+        throw std::runtime_error(unsupported);
+
+    Header h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, MAGIC, sizeof(MAGIC));
+    h.version = VERSION;
+    h.vectorSize = sizeof(Vector);
+    h.nodeSize = sizeof(BVHNode);
+    h.transformSize = sizeof(Transform);
+    if (!fileStamp(source, h.sourceSize, h.sourceTime))
+        throw std::runtime_error(std::string("Cannot stat ") + source);
+    toArray(background, h.background);
+    h.accelerator = accelerator;
+    h.textureCache = textureCache;
+    h.deduplication[0] = deduplication.meshes;
+    h.deduplication[1] = deduplication.duplicates;
+    h.deduplication[2] = deduplication.shared;
+    h.deduplication[3] = deduplication.bytesSaved;
+    h.filmWidth = filmWidth;
+    h.filmHeight = filmHeight;
+    h.gamma = gamma;
+    h.filter = filter;
+    h.hasCamera = hasCamera;
+    toArray(eye, h.eye);
+    toArray(target, h.target);
+    toArray(up, h.up);
+    h.fov = fov;
+
+    std::string strings;
+    std::vector<MaterialRecord> materialRecords(materials.size());
+    for (size_t i = 0; i < materials.size(); ++i)
+    {
+        MaterialRecord& r = materialRecords[i];
+        memset(&r, 0, sizeof(r));
+        toArray(materials[i].color, r.color);
+        r.texture = NO_TEXTURE;
+        if (!materials[i].texture.empty())
+        {
+            r.texture = static_cast<uint32_t>(strings.size());
+            strings.append(materials[i].texture.c_str(), materials[i].texture.size() + 1);
+        }
+    }
+
+    std::vector<MeshRecord> meshRecords(meshes.size());
+    uint64_t nVertices = 0, nIndices = 0, nNormals = 0, nUVs = 0;
+    for (size_t i = 0; i < meshes.size(); ++i)
+    {
+        const MeshEntry& entry = meshes[i];
+        Reference<TriangleMesh> mesh(entry.mesh);
+        MeshRecord& r = meshRecords[i];
+        memset(&r, 0, sizeof(r));
+        Reference<Material> material(mesh->material());
+        std::unordered_map<const Material*, uint32_t>::const_iterator it = materialIndices.find(&*material);
+        if (it == materialIndices.end())
+            throw std::runtime_error("Mesh material was not added to the binary scene");
+
+        r.material = it->second;
+        r.flags = (entry.emissive ? MESH_EMISSIVE : 0) | (entry.shared ? MESH_SHARED : 0);
+        toArray(entry.emission, r.emission);
+        r.firstVertex = nVertices;
+        r.nVertices = mesh->numVertices();
+        r.firstIndex = nIndices;
+        r.nIndices = 3 * mesh->numTriangles();
+        r.firstNormal = nNormals;
+        r.nNormals = mesh->vertexNormals() ? r.nVertices : 0;
+        r.firstUV = nUVs;
+        r.nUVs = mesh->vertexUVs() ? 2 * r.nVertices : 0;
+        nVertices += r.nVertices;
+        nIndices += r.nIndices;
+        nNormals += r.nNormals;
+        nUVs += r.nUVs;
+    }
+
+    std::vector<LightRecord> lightRecords(lights.size());
+    for (size_t i = 0; i < lights.size(); ++i)
+    {
+        LightRecord& r = lightRecords[i];
+        memset(&r, 0, sizeof(r));
+        r.type = lights[i].type;
+        toArray(lights[i].position, r.position);
+        toArray(lights[i].color, r.color);
+        if (r.type == LIGHT_ENVIRONMENT)
+        {
+            r.file = static_cast<uint32_t>(strings.size());
+            strings.append(lights[i].file.c_str(), lights[i].file.size() + 1);
+        }
+    }
+
+    std::vector<DependencyRecord> dependencyRecords(dependencies.size());
+    for (size_t i = 0; i < dependencies.size(); ++i)
+    {
+        DependencyRecord& r = dependencyRecords[i];
+        memset(&r, 0, sizeof(r));
+        r.file = static_cast<uint32_t>(strings.size());
+        strings.append(dependencies[i].file.c_str(), dependencies[i].file.size() + 1);
+        r.size = dependencies[i].size;
+        r.time = dependencies[i].time;
+    }
+
+    std::vector<InstanceRecord> instanceRecords(instances.size());
+    for (size_t i = 0; i < instances.size(); ++i)
+    {
+        memset(&instanceRecords[i], 0, sizeof(InstanceRecord));
+        instanceRecords[i].object = instances[i].object;
+        memcpy(instanceRecords[i].transform, &instances[i].transform, sizeof(Transform));
+    }
+
+    // Stromy sdílených objektů a nakonec strom celé scény.
+    std::vector<const BVH*> trees;
+    for (size_t i = 0; i < objects.size(); ++i)
+    {
+        Reference<Primitive> o(objects[i]);
+        const BVH* bvh = dynamic_cast<const BVH*>(&*o);
+        if (!bvh)
+            throw std::runtime_error("Shared objects must be BVH");
+        trees.push_back(bvh);
+    }
+    if (accelerator == ACCELERATOR_BVH)
+    {
+        const BVH* bvh = dynamic_cast<const BVH*>(scene.aggregator);
+        if (!bvh)
+            throw std::runtime_error("Scene accelerator is not BVH");
+        trees.push_back(bvh);
+    }
+
+    std::vector<TreeRecord> treeRecords(trees.size());
+    std::vector<PrimRef> refs;
+    uint64_t nNodes = 0;
+    for (size_t i = 0; i < trees.size(); ++i)
+    {
+        const std::vector<Reference<Primitive>>& ordered = trees[i]->orderedPrimitives();
+        treeRecords[i].firstNode = nNodes;
+        treeRecords[i].nNodes = trees[i]->numNodes();
+        treeRecords[i].firstRef = refs.size();
+        treeRecords[i].nRefs = ordered.size();
+        nNodes += trees[i]->numNodes();
+
+        for (size_t j = 0; j < ordered.size(); ++j)
+        {
+            Reference<Primitive> p(ordered[j]);
+            PrimRef ref;
+            if (const Triangle* tri = dynamic_cast<const Triangle*>(&*p))
+            {
+                std::unordered_map<const TriangleMesh*, uint32_t>::const_iterator it =
+                    meshIndices.find(tri->triangleMesh());
+                if (it == meshIndices.end())
+                    throw std::runtime_error("Triangle mesh was not added to the binary scene");
+                ref.mesh = it->second;
+                ref.triangle = static_cast<uint32_t>(tri->index());
+            }
+            else
+            {
+                std::unordered_map<const Primitive*, uint32_t>::const_iterator it = instanceIndices.find(&*p);
+                if (it == instanceIndices.end())
+                    throw std::runtime_error("Primitive cannot be stored in the binary scene");
+                ref.mesh = INSTANCE_REF;
+                ref.triangle = it->second;
+            }
+            refs.push_back(ref);
+        }
+    }
+    if (accelerator == ACCELERATOR_BVH)
+    {
+        h.tree = treeRecords.back();
+        treeRecords.pop_back();
+    }
+
+    const uint64_t counts[SECTION_COUNT] = {
+        materialRecords.size(), meshRecords.size(), nVertices, nIndices, nNormals, nUVs, lightRecords.size(),
+        strings.size(), treeRecords.size(), instanceRecords.size(), nNodes, refs.size(),
+        dependencyRecords.size()
+    };
+    uint64_t offset = sizeof(Header);
+    for (int i = 0; i < SECTION_COUNT; ++i)
+    {
+        offset = (offset + SECTION_ALIGNMENT - 1) / SECTION_ALIGNMENT * SECTION_ALIGNMENT;
+        h.sections[i].offset = offset;
+        h.sections[i].count = counts[i];
+        offset += counts[i] * SECTION_SIZES[i];
+    }
+
+    const std::string tmp = std::string(path) + ".tmp" + std::to_string(getpid());
+    try
+    {
+        Output out(tmp);
+        out.write(&h, sizeof(h));
+
+        out.seek(h.sections[SECTION_MATERIALS].offset);
+        out.write(materialRecords.data(), materialRecords.size() * sizeof(MaterialRecord));
+        out.seek(h.sections[SECTION_MESHES].offset);
+        out.write(meshRecords.data(), meshRecords.size() * sizeof(MeshRecord));
+        out.seek(h.sections[SECTION_VERTICES].offset);
+        for (size_t i = 0; i < meshes.size(); ++i)
+        {
+            Reference<TriangleMesh> mesh(meshes[i].mesh);
+            out.write(mesh->vertices(), mesh->numVertices() * sizeof(Vector));
+        }
+        out.seek(h.sections[SECTION_INDICES].offset);
+        for (size_t i = 0; i < meshes.size(); ++i)
+        {
+            Reference<TriangleMesh> mesh(meshes[i].mesh);
+            out.write(mesh->vertexIndices(), 3 * mesh->numTriangles() * sizeof(int));
+        }
+        out.seek(h.sections[SECTION_NORMALS].offset);
+        for (size_t i = 0; i < meshes.size(); ++i)
+        {
+            Reference<TriangleMesh> mesh(meshes[i].mesh);
+            if (mesh->vertexNormals())
+                out.write(mesh->vertexNormals(), mesh->numVertices() * sizeof(Vector));
+        }
+        out.seek(h.sections[SECTION_UVS].offset);
+        for (size_t i = 0; i < meshes.size(); ++i)
+        {
+            Reference<TriangleMesh> mesh(meshes[i].mesh);
+            if (mesh->vertexUVs())
+                out.write(mesh->vertexUVs(), 2 * mesh->numVertices() * sizeof(Real));
+        }
+        out.seek(h.sections[SECTION_LIGHTS].offset);
+        out.write(lightRecords.data(), lightRecords.size() * sizeof(LightRecord));
+        out.seek(h.sections[SECTION_STRINGS].offset);
+        out.write(strings.data(), strings.size());
+        out.seek(h.sections[SECTION_OBJECTS].offset);
+        out.write(treeRecords.data(), treeRecords.size() * sizeof(TreeRecord));
+        out.seek(h.sections[SECTION_INSTANCES].offset);
+        out.write(instanceRecords.data(), instanceRecords.size() * sizeof(InstanceRecord));
+        out.seek(h.sections[SECTION_NODES].offset);
+        for (size_t i = 0; i < trees.size(); ++i)
+            out.write(trees[i]->nodeArray().data(), trees[i]->numNodes() * sizeof(BVHNode));
+        out.seek(h.sections[SECTION_REFS].offset);
+        out.write(refs.data(), refs.size() * sizeof(PrimRef));
+        out.seek(h.sections[SECTION_DEPENDENCIES].offset);
+        out.write(dependencyRecords.data(), dependencyRecords.size() * sizeof(DependencyRecord));
+        out.close();
+
+        if (rename(tmp.c_str(), path) != 0)
+            throw std::runtime_error(std::string("Cannot rename binary scene to ") + path);
+    }
+    catch (...)
+    {
+        remove(tmp.c_str());
+        throw;
+    }
+}
+
+/************************************************************************/
+/* BinarySceneLoader methods                                            */
+/************************************************************************/
+
+BinarySceneLoader::BinarySceneLoader(Scene& scene)
+    : scene(scene)
+{ }
+
+/*!
+ * Celý soubor se nejprve ověří, teprve potom se mění scéna. Z pole vrcholů
+ * se přitom nečte, jeho stránky se načtou až při vykreslování. Indexy se
+ * projdou všechny, index mimo vrcholy své sítě by jinak při vykreslování
+ * četl mimo namapovaný soubor.
+ */
+bool BinarySceneLoader::load(const char* path, const char* source)
+{
+    uint64_t sourceSize, size;
+    int64_t sourceTime, time;
+    if (!fileStamp(source, sourceSize, sourceTime) || !fileStamp(path, size, time) ||
+        size < sizeof(Header))
+        return false;
+
+    // Nečitelný binární soubor jen znamená načtení ze souboru XML.
+    Reference<MappedFile> file;
+    try
+    {
+        file = new MappedFile(path);
+    }
+    catch (const std::runtime_error&)
+    {
+        return false;
+    }
+    char* data = file->data();
+    Header h;
+    memcpy(&h, data, sizeof(h));
+    if (memcmp(h.magic, MAGIC, sizeof(MAGIC)) != 0 || h.version != VERSION ||
+        h.vectorSize != sizeof(Vector) || h.nodeSize != sizeof(BVHNode) ||
+        h.transformSize != sizeof(Transform) ||
+        h.sourceSize != sourceSize || h.sourceTime != sourceTime)
+        return false;
+
+    for (int i = 0; i < SECTION_COUNT; ++i)
+        if (h.sections[i].offset % SECTION_ALIGNMENT != 0 || h.sections[i].count > file->size() ||
+            !inRange(h.sections[i].offset, h.sections[i].count * SECTION_SIZES[i], file->size()))
+            return false;
+
+    const MaterialRecord* materialRecords = reinterpret_cast<const MaterialRecord*>(data + h.sections[SECTION_MATERIALS].offset);
+    const MeshRecord* meshRecords = reinterpret_cast<const MeshRecord*>(data + h.sections[SECTION_MESHES].offset);
+    Vector* vertices = reinterpret_cast<Vector*>(data + h.sections[SECTION_VERTICES].offset);
+    int* indices = reinterpret_cast<int*>(data + h.sections[SECTION_INDICES].offset);
+    Vector* normals = reinterpret_cast<Vector*>(data + h.sections[SECTION_NORMALS].offset);
+    Real* uvs = reinterpret_cast<Real*>(data + h.sections[SECTION_UVS].offset);
+    const LightRecord* lightRecords = reinterpret_cast<const LightRecord*>(data + h.sections[SECTION_LIGHTS].offset);
+    const char* strings = data + h.sections[SECTION_STRINGS].offset;
+    const TreeRecord* objectRecords = reinterpret_cast<const TreeRecord*>(data + h.sections[SECTION_OBJECTS].offset);
+    const InstanceRecord* instanceRecords = reinterpret_cast<const InstanceRecord*>(data + h.sections[SECTION_INSTANCES].offset);
+    const BVHNode* nodes = reinterpret_cast<const BVHNode*>(data + h.sections[SECTION_NODES].offset);
+    const PrimRef* refs = reinterpret_cast<const PrimRef*>(data + h.sections[SECTION_REFS].offset);
+    const DependencyRecord* dependencyRecords = reinterpret_cast<const DependencyRecord*>(data + h.sections[SECTION_DEPENDENCIES].offset);
+
+    const uint64_t nMaterials = h.sections[SECTION_MATERIALS].count;
+    const uint64_t nMeshes = h.sections[SECTION_MESHES].count;
+    const uint64_t nLights = h.sections[SECTION_LIGHTS].count;
+    const uint64_t nStrings = h.sections[SECTION_STRINGS].count;
+    const uint64_t nObjects = h.sections[SECTION_OBJECTS].count;
+    const uint64_t nInstances = h.sections[SECTION_INSTANCES].count;
+    const uint64_t nDependencies = h.sections[SECTION_DEPENDENCIES].count;
+
+    if (h.accelerator >= ACCELERATOR_COUNT)
+        return false;
+    if (h.filmWidth != 0 && (h.filmWidth < 0 || h.filmHeight <= 0 || !(h.gamma > 0.f) || h.filter >= FILTER_COUNT))
+        return false;
+    if (h.hasCamera && h.filmWidth == 0)
+        return false;
+
+    for (uint64_t i = 0; i < nMeshes; ++i)
+    {
+        const MeshRecord& r = meshRecords[i];
+        if (r.material >= nMaterials || r.nIndices == 0 || r.nIndices % 3 != 0 ||
+            !inRange(r.firstVertex, r.nVertices, h.sections[SECTION_VERTICES].count) ||
+            !inRange(r.firstIndex, r.nIndices, h.sections[SECTION_INDICES].count) ||
+            (r.nNormals != 0 && r.nNormals != r.nVertices) ||
+            !inRange(r.firstNormal, r.nNormals, h.sections[SECTION_NORMALS].count) ||
+            (r.nUVs != 0 && r.nUVs != 2 * r.nVertices) ||
+            !inRange(r.firstUV, r.nUVs, h.sections[SECTION_UVS].count))
+            return false;
+        const int* meshIndices = indices + r.firstIndex;
+        for (uint64_t k = 0; k < r.nIndices; ++k)
+            if (meshIndices[k] < 0 || static_cast<uint64_t>(meshIndices[k]) >= r.nVertices)
+                return false;
+    }
+    for (uint64_t i = 0; i < nMaterials; ++i)
+    {
+        const uint32_t texture = materialRecords[i].texture;
+        if (texture != NO_TEXTURE && (texture >= nStrings || !memchr(strings + texture, '\0', nStrings - texture)))
+            return false;
+    }
+    for (uint64_t i = 0; i < nLights; ++i)
+    {
+        const LightRecord& r = lightRecords[i];
+        if (r.type == LIGHT_ENVIRONMENT)
+        {
+            if (r.file >= nStrings || !memchr(strings + r.file, '\0', nStrings - r.file))
+                return false;
+        }
+        else if (r.type != LIGHT_POINT)
+            return false;
+    }
+    // Změněný soubor sítě, textury nebo mapy okolí znamená nový import.
+    for (uint64_t i = 0; i < nDependencies; ++i)
+    {
+        const DependencyRecord& r = dependencyRecords[i];
+        if (r.file >= nStrings || !memchr(strings + r.file, '\0', nStrings - r.file) ||
+            !fileStamp(strings + r.file, size, time) || size != r.size || time != r.time)
+            return false;
+    }
+    for (uint64_t i = 0; i < nObjects; ++i)
+        if (!validTree(objectRecords[i], h, nodes, refs, meshRecords, true))
+            return false;
+    for (uint64_t i = 0; i < nInstances; ++i)
+        if (instanceRecords[i].object >= nObjects)
+            return false;
+    if ((h.accelerator == ACCELERATOR_BVH) != (h.tree.nNodes != 0) ||
+        (h.tree.nNodes && !validTree(h.tree, h, nodes, refs, meshRecords, false)))
+        return false;
+
+    // Materiály se vytvoří ještě před změnou scény, otevření textury
+    // (případně nové sestavení souboru dlaždic) může vyhodit výjimku.
+    std::vector<Reference<Material>> materials(nMaterials);
+    std::unordered_map<std::string, Reference<Texture>> textures;
+    for (uint64_t i = 0; i < nMaterials; ++i)
+    {
+        const MaterialRecord& r = materialRecords[i];
+        if (r.texture == NO_TEXTURE)
+        {
+            materials[i] = new MatteMaterial(toColor(r.color));
+            continue;
+        }
+        const std::string path(strings + r.texture);
+        std::unordered_map<std::string, Reference<Texture>>::iterator it = textures.find(path);
+        if (it == textures.end())
+            it = textures.insert(std::make_pair(path, Reference<Texture>(new ImageTexture(path)))).first;
+        materials[i] = new MatteMaterial(toColor(r.color), it->second);
+    }
+
+    // Soubor je v pořádku, sestaví se scéna. Dlaždice textur se čtou až
+    // při vykreslování, rozpočet cache tak stačí nastavit teď.
+    if (h.textureCache)
+        TextureCache::shared()->setBudget(static_cast<size_t>(h.textureCache));
+    scene.deduplication.meshes = static_cast<size_t>(h.deduplication[0]);
+    scene.deduplication.duplicates = static_cast<size_t>(h.deduplication[1]);
+    scene.deduplication.shared = static_cast<size_t>(h.deduplication[2]);
+    scene.deduplication.bytesSaved = static_cast<size_t>(h.deduplication[3]);
+    if (scene.aggregator)
+        delete scene.aggregator;
+    scene.aggregator = nullptr;
+    scene.background = toColor(h.background);
+
+    if (h.filmWidth)
+    {
+        Filter* filter = (h.filter == FILTER_GAUSSIAN) ? static_cast<Filter*>(new GaussianFilter())
+                       : (h.filter == FILTER_MITCHELL) ? static_cast<Filter*>(new MitchellFilter())
+                       : static_cast<Filter*>(new BoxFilter());
+        if (scene.film)
+            delete scene.film;
+        scene.film = new Film(h.filmWidth, h.filmHeight, 1.f, h.gamma, 1.f / h.gamma, filter);
+    }
+    if (h.hasCamera)
+    {
+        if (scene.camera)
+            delete scene.camera;
+        scene.camera = new PinholeCamera(toVector(h.eye), toVector(h.target), toVector(h.up), h.fov,
+                                         scene.film->width, scene.film->height);
+    }
+
+    for (uint64_t i = 0; i < nLights; ++i)
+    {
+        const LightRecord& r = lightRecords[i];
+        if (r.type == LIGHT_POINT)
+            scene.lights.push_back(new PointLight(toVector(r.position), toColor(r.color)));
+        else
+            scene.lights.push_back(new EnvironmentLight(strings + r.file, toColor(r.color)));
+    }
+
+    std::vector<Reference<TriangleMesh>> meshes(nMeshes);
+    std::vector<const std::vector<Reference<Primitive>>*> refined(nMeshes);
+    for (uint64_t i = 0; i < nMeshes; ++i)
+    {
+        const MeshRecord& r = meshRecords[i];
+        meshes[i] = new TriangleMesh(materials[r.material], vertices + r.firstVertex, r.nVertices,
+                                     indices + r.firstIndex, r.nIndices,
+                                     r.nNormals ? normals + r.firstNormal : nullptr,
+                                     r.nUVs ? uvs + r.firstUV : nullptr, file);
+        if (r.flags & MESH_SHARED)
+            continue;
+
+        if (r.flags & MESH_EMISSIVE)
+            scene.lights.push_back(new AreaLight(meshes[i], toColor(r.emission)));
+        Reference<Primitive> object(&*meshes[i]);
+        scene.addObject(object);
+        refined[i] = &scene.refined(object);
+    }
+
+    std::vector<Reference<Primitive>> objects(nObjects);
+    for (uint64_t i = 0; i < nObjects; ++i)
+    {
+        const TreeRecord& tree = objectRecords[i];
+        std::vector<Reference<Primitive>> ordered;
+        ordered.reserve(tree.nRefs);
+        for (uint64_t j = 0; j < tree.nRefs; ++j)
+        {
+            const PrimRef& ref = refs[tree.firstRef + j];
+            ordered.push_back(new Triangle(meshes[ref.mesh]->material(), meshes[ref.mesh], ref.triangle));
+        }
+        objects[i] = new BVH(nodes + tree.firstNode, tree.nNodes, ordered);
+    }
+
+    std::vector<Reference<Primitive>> instances(nInstances);
+    for (uint64_t i = 0; i < nInstances; ++i)
+    {
+        Transform t;
+        memcpy(&t, instanceRecords[i].transform, sizeof(Transform));
+        instances[i] = new Instance(objects[instanceRecords[i].object], t);
+        scene.addObject(instances[i]);
+    }
+
+    if (h.accelerator == ACCELERATOR_BVH)
+    {
+        // Trojúhelníky sítí už vytvořila scéna v addObject().
+        std::vector<Reference<Primitive>> ordered;
+        ordered.reserve(h.tree.nRefs);
+        for (uint64_t j = 0; j < h.tree.nRefs; ++j)
+        {
+            const PrimRef& ref = refs[h.tree.firstRef + j];
+            if (ref.mesh == INSTANCE_REF)
+                ordered.push_back(instances[ref.triangle]);
+            else
+                ordered.push_back((*refined[ref.mesh])[ref.triangle]);
+        }
+        scene.aggregator = new BVH(nodes + h.tree.firstNode, h.tree.nNodes, ordered);
+    }
+    else
+    {
+        const std::string file(source);
+        const size_t slash = file.find_last_of('/');
+        AccelerationCache cache(slash == std::string::npos ? std::string() : file.substr(0, slash + 1));
+
+        std::vector<Reference<Primitive>> prims;
+        scene.primitives(prims);
+        scene.aggregator = cache.create(h.accelerator == ACCELERATOR_GRID ? "grid" : "bruteforce", prims);
+    }
+
+    return true;
+}
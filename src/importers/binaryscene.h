@@ -0,0 +1,238 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "core/deduplicationreport.h"
+#include "core/scene.h"
+#include "core/transform.h"
+#include "shapes/trianglemesh.h"
+
+namespace tracer
+{
+
+/*!
+ * Zapisuje scénu do binárního souboru, ze kterého ji BinarySceneLoader
+ * načte bez parsování. Scénu popisuje importér při jejím sestavování
+ * (viz XMLSceneImporter), zápis proběhne až nad hotovou scénou.
+ *
+ * Soubor obsahuje hlavičku a za ní souvislá pole (sekce) materiálů, sítí,
+ * vrcholů, indexů, normál, světel, sdílených objektů, instancí, uzlů BVH
+ * a odkazů listů BVH na trojúhelníky. Vrcholy a indexy všech sítí tvoří jedno pole
+ * ve tvaru, se kterým pracuje TriangleMesh, takže se po namapování
+ * používají přímo. Data jsou v pořadí bajtů hostitele a soubor je vázán
+ * na velikost a čas změny zdrojového souboru scény i všech načtených
+ * souborů (sítí, textur a map okolí).
+ */
+class BinarySceneWriter
+{
+public:
+    BinarySceneWriter();
+
+    /*! \param color barva pozadí */
+    void setBackground(const RGBColor& color);
+
+    /*! \param type typ akcelerační struktury (bvh, grid, bruteforce) */
+    void setAccelerator(const std::string& type);
+
+    /*! \param bytes rozpočet sdílené TextureCache v bajtech */
+    void setTextureCache(size_t bytes);
+
+    /*!
+     * \param width šířka filmu
+     * \param height výška filmu
+     * \param gamma gamma korekce
+     * \param filter typ filtru (box, gaussian, mitchell)
+     */
+    void setFilm(int width, int height, Real gamma, const std::string& filter);
+
+    /*! Parametry dírkové kamery. */
+    void setCamera(const Vector& eye, const Vector& target, const Vector& up, Real fov);
+
+    /*!
+     * Zaznamená matný materiál.
+     * \param material materiál, na který se odkazují sítě
+     * \param color barva materiálu
+     * \param texture cesta k obrázku textury (už vztažená k adresáři scény) nebo prázdný řetězec
+     */
+    void addMaterial(const Reference<Material>& material, const RGBColor& color,
+                     const std::string& texture = std::string());
+
+    /*! Zaznamená bodové světlo. */
+    void addPointLight(const Vector& position, const RGBColor& intensity);
+
+    /*!
+     * Zaznamená světlo okolí.
+     * \param file cesta k mapě okolí (už vztažená k adresáři scény)
+     * \param scale násobek intenzity
+     */
+    void addEnvironmentLight(const std::string& file, const RGBColor& scale);
+
+    /*!
+     * Zaznamená síť. Ukládají se její vrcholy (a normály) v okamžiku
+     * zápisu, tedy i s případnou transformací.
+     * \param mesh síť
+     * \param emissive jestli je síť plošným světlem
+     * \param emission vyzařování plošného světla
+     * \param shared jestli síť patří sdílenému objektu (není přímo ve scéně)
+     */
+    void addMesh(const Reference<TriangleMesh>& mesh, bool emissive, const RGBColor& emission, bool shared);
+
+    /*!
+     * Zaznamená sdílený objekt.
+     * \param object BVH nad sítěmi objektu
+     */
+    void addObject(const Reference<Primitive>& object);
+
+    /*!
+     * Zaznamená instanci objektu.
+     * \param instance vytvořená instance
+     * \param object instancovaný objekt (už zaznamenaný)
+     * \param transform transformace instance
+     */
+    void addInstance(const Reference<Primitive>& instance, const Reference<Primitive>& object,
+                     const Transform& transform);
+
+    /*!
+     * Zaznamená soubor, ze kterého scéna vznikla (např. síť načtenou ze
+     * souboru). Uloží se jeho velikost a čas změny a po změně souboru
+     * BinarySceneLoader binární soubor nepoužije. Textury a mapy okolí
+     * zaznamenávají addMaterial() a addEnvironmentLight() samy.
+     * \param file cesta k souboru (už vztažená k adresáři scény)
+     */
+    void addDependency(const std::string& file);
+
+    /*!
+     * Zaznamená přehled sloučených sítí, aby ho načtená scéna měla také.
+     * \param report přehled z MeshDeduplicator
+     */
+    void setDeduplicationReport(const DeduplicationReport& report);
+
+    /*!
+     * Zaznamená, že scéna obsahuje něco, co soubor uložit neumí (např.
+     * stránkovanou síť). Metoda write() pak vyhodí výjimku.
+     * \param reason důvod
+     */
+    void setUnsupported(const std::string& reason);
+
+    /*!
+     * Zapíše soubor. Zapisuje se do dočasného souboru, který se nakonec
+     * přejmenuje, souběžně čtoucí procesy tak nikdy neuvidí nedopsaný soubor.
+     * Při chybě vyhodí výjimku std::runtime_error.
+     * \param path cesta k binárnímu souboru
+     * \param source zdrojový soubor scény
+     * \param scene sestavená scéna (kvůli akcelerační struktuře)
+     */
+    void write(const char* path, const char* source, const Scene& scene) const;
+
+private:
+    /*!
+     * Zaznamenaná síť.
+     */
+    struct MeshEntry
+    {
+        Reference<TriangleMesh> mesh; ///< Síť.
+        bool emissive; ///< Jestli je plošným světlem.
+        RGBColor emission; ///< Vyzařování.
+        bool shared; ///< Jestli patří sdílenému objektu.
+    };
+
+    /*!
+     * Zaznamenaný materiál.
+     */
+    struct MaterialEntry
+    {
+        RGBColor color; ///< Barva.
+        std::string texture; ///< Soubor textury nebo prázdný řetězec.
+    };
+
+    /*!
+     * Zaznamenané světlo.
+     */
+    struct LightEntry
+    {
+        uint32_t type; ///< Typ světla.
+        Vector position; ///< Poloha bodového světla.
+        RGBColor color; ///< Intenzita nebo násobek intenzity.
+        std::string file; ///< Soubor mapy okolí.
+    };
+
+    /*!
+     * Zaznamenaný soubor, ze kterého scéna vznikla.
+     */
+    struct DependencyEntry
+    {
+        std::string file; ///< Cesta k souboru.
+        uint64_t size; ///< Velikost souboru.
+        int64_t time; ///< Čas změny souboru v ns.
+    };
+
+    /*!
+     * Zaznamenaná instance.
+     */
+    struct InstanceEntry
+    {
+        Reference<Primitive> instance; ///< Instance.
+        uint32_t object; ///< Index objektu.
+        Transform transform; ///< Transformace.
+    };
+
+    RGBColor background; ///< Barva pozadí.
+    uint32_t accelerator; ///< Typ akcelerační struktury.
+    uint64_t textureCache; ///< Rozpočet cache textur, 0 pokud ho scéna nezadává.
+    DeduplicationReport deduplication; ///< Přehled sloučených sítí.
+    int filmWidth, filmHeight; ///< Rozlišení filmu, 0 pokud film chybí.
+    Real gamma; ///< Gamma korekce filmu.
+    uint32_t filter; ///< Typ filtru.
+    bool hasCamera; ///< Jestli scéna obsahuje kameru.
+    Vector eye, target, up; ///< Parametry kamery.
+    Real fov; ///< Zorný úhel kamery.
+
+    std::vector<MaterialEntry> materials; ///< Materiály.
+    std::unordered_map<const Material*, uint32_t> materialIndices; ///< Indexy materiálů.
+    std::vector<LightEntry> lights; ///< Světla.
+    std::vector<MeshEntry> meshes; ///< Sítě.
+    std::unordered_map<const TriangleMesh*, uint32_t> meshIndices; ///< Indexy sítí.
+    std::vector<Reference<Primitive>> objects; ///< Sdílené objekty.
+    std::unordered_map<const Primitive*, uint32_t> objectIndices; ///< Indexy objektů.
+    std::vector<InstanceEntry> instances; ///< Instance.
+    std::unordered_map<const Primitive*, uint32_t> instanceIndices; ///< Indexy instancí.
+    std::vector<DependencyEntry> dependencies; ///< Soubory, ze kterých scéna vznikla.
+    std::string unsupported; ///< Proč scénu nelze uložit, prázdné pokud lze.
+};
+
+/*!
+ * Načítá scénu z binárního souboru zapsaného třídou BinarySceneWriter.
+ * Soubor se namapuje do paměti a sítě používají jeho pole vrcholů, indexů a normál
+ * na místě. Stránky souboru tak sdílí všechny procesy na stejném stroji
+ * a načítají se až při prvním přístupu. Uložené BVH se nestaví znovu.
+ *
+ * Kontroluje se pouze struktura souboru (hlavička, rozsahy sekcí, odkazy
+ * a uzly BVH), ne hodnoty vrcholů a indexů, které zapsal BinarySceneWriter.
+ */
+class BinarySceneLoader
+{
+public:
+    /*!
+     * Konstruktor.
+     * \param scene scéna, do které se načítá
+     */
+    BinarySceneLoader(Scene& scene);
+
+    /*!
+     * Načte scénu, pokud soubor existuje a odpovídá zdrojovému souboru,
+     * souborům, ze kterých scéna vznikla, i této verzi programu. Nastaví
+     * i Scene::deduplication podle importu, který soubor zapsal. Jinak (i když soubor nejde namapovat) scénu
+     * nezmění.
+     * \param path cesta k binárnímu souboru
+     * \param source zdrojový soubor scény
+     * \return jestli se scéna načetla
+     */
+    bool load(const char* path, const char* source);
+
+private:
+    Scene& scene; ///< Načítaná scéna.
+};
+
+}
@@ -0,0 +1,301 @@
+#include "importers/meshdeduplicator.h"
+
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+#include "acceleration/instance.h"
+
+using namespace tracer;
+
+namespace
+{
+
+inline uint64_t hashWord(uint64_t h, uint32_t word)
+{
+    return (h ^ word) * 0x100000001B3ull;
+}
+
+inline uint64_t hashWords(uint64_t h, const void* data, size_t size)
+{
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i + 4 <= size; i += 4)
+    {
+        uint32_t word;
+        memcpy(&word, bytes + i, sizeof(word));
+        h = hashWord(h, word);
+    }
+    return h;
+}
+
+inline uint64_t hashSize(uint64_t h, uint64_t v)
+{
+    return hashWord(hashWord(h, static_cast<uint32_t>(v)), static_cast<uint32_t>(v >> 32));
+}
+
+/*!
+ * Haš obsahu sítě, který se tuhou transformací nemění.
+ */
+uint64_t contentHash(const TriangleMesh& mesh)
+{
+    Reference<Material> material = mesh.material();
+    uint64_t h = 0xCBF29CE484222325ull;
+    h = hashSize(h, mesh.numVertices());
+    h = hashSize(h, mesh.numTriangles());
+    h = hashSize(h, reinterpret_cast<uintptr_t>(&*material));
+    h = hashWord(h, mesh.vertexNormals() ? 1 : 0);
+    h = hashWord(h, mesh.vertexUVs() ? 1 : 0);
+    h = hashWords(h, mesh.vertexIndices(), mesh.numTriangles() * 3 * sizeof(int));
+    if (mesh.vertexUVs())
+        h = hashWords(h, mesh.vertexUVs(), mesh.numVertices() * 2 * sizeof(Real));
+    return h;
+}
+
+/*!
+ * Ortonormální báze z trojice vrcholů sítě, axes[k] je k-tý vektor báze.
+ */
+void basis(const TriangleMesh& mesh, const size_t frame[3], double axes[3][3])
+{
+    const Vector* p = mesh.vertices();
+    double a[3], b[3];
+    for (int i = 0; i < 3; ++i)
+    {
+        a[i] = static_cast<double>(p[frame[1]][i]) - p[frame[0]][i];
+        b[i] = static_cast<double>(p[frame[2]][i]) - p[frame[0]][i];
+    }
+
+    const double la = std::sqrt(a[0] * a[0] + a[1] * a[1] + a[2] * a[2]);
+    double c[3] = { a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2], a[0] * b[1] - a[1] * b[0] };
+    const double lc = std::sqrt(c[0] * c[0] + c[1] * c[1] + c[2] * c[2]);
+    for (int i = 0; i < 3; ++i)
+    {
+        axes[0][i] = la > 0.0 ? a[i] / la : 0.0;
+        axes[2][i] = lc > 0.0 ? c[i] / lc : 0.0;
+    }
+    axes[1][0] = axes[2][1] * axes[0][2] - axes[2][2] * axes[0][1];
+    axes[1][1] = axes[2][2] * axes[0][0] - axes[2][0] * axes[0][2];
+    axes[1][2] = axes[2][0] * axes[0][1] - axes[2][1] * axes[0][0];
+}
+
+}
+
+MeshDeduplicator::MeshDeduplicator(Real tolerance)
+    : tolerance(tolerance)
+{ }
+
+size_t MeshDeduplicator::meshBytes(const TriangleMesh& mesh)
+{
+    size_t bytes = mesh.numVertices() * sizeof(Vector) + mesh.numTriangles() * (3 * sizeof(int) + sizeof(Triangle));
+    if (mesh.vertexNormals())
+        bytes += mesh.numVertices() * sizeof(Vector);
+    if (mesh.vertexUVs())
+        bytes += mesh.numVertices() * 2 * sizeof(Real);
+    return bytes;
+}
+
+void MeshDeduplicator::moments(const TriangleMesh& mesh, double centroid[3], double& spread, double& radius)
+{
+    const Vector* p = mesh.vertices();
+    const size_t n = mesh.numVertices();
+    centroid[0] = centroid[1] = centroid[2] = 0.0;
+    for (size_t i = 0; i < n; ++i)
+        for (int k = 0; k < 3; ++k)
+            centroid[k] += p[i][k];
+    for (int k = 0; k < 3; ++k)
+        centroid[k] /= static_cast<double>(n);
+
+    double sum = 0.0, maxSq = 0.0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        double d2 = 0.0;
+        for (int k = 0; k < 3; ++k)
+        {
+            const double d = p[i][k] - centroid[k];
+            d2 += d * d;
+        }
+        sum += d2;
+        if (d2 > maxSq)
+            maxSq = d2;
+    }
+    spread = sum / static_cast<double>(n);
+    radius = std::sqrt(maxSq);
+}
+
+bool MeshDeduplicator::chooseFrame(Prototype& proto)
+{
+    const Vector* p = proto.mesh->vertices();
+    const size_t n = proto.mesh->numVertices();
+
+    // Nejvzdálenější vrchol od těžiště, nejvzdálenější od něj a nejvzdálenější od jejich přímky.
+    double best = -1.0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        double d2 = 0.0;
+        for (int k = 0; k < 3; ++k)
+            d2 += (p[i][k] - proto.centroid[k]) * (p[i][k] - proto.centroid[k]);
+        if (d2 > best)
+        {
+            best = d2;
+            proto.frame[0] = i;
+        }
+    }
+
+    const Vector& p0 = p[proto.frame[0]];
+    best = -1.0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        const double d2 = (p[i] - p0).squarredLenght();
+        if (d2 > best)
+        {
+            best = d2;
+            proto.frame[1] = i;
+        }
+    }
+    const double axis2 = best;
+
+    const Vector axis = p[proto.frame[1]] - p0;
+    best = -1.0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        const double d2 = cross(axis, p[i] - p0).squarredLenght();
+        if (d2 > best)
+        {
+            best = d2;
+            proto.frame[2] = i;
+        }
+    }
+
+    // Vzdálenost třetího vrcholu od přímky musí být měřitelná vůči délce sítě.
+    return axis2 > 0.0 && best > 1e-8 * axis2 * axis2;
+}
+
+bool MeshDeduplicator::match(const Prototype& proto, const TriangleMesh& mesh, const double centroid[3],
+                             Transform& transform) const
+{
+    const TriangleMesh& source = *proto.mesh;
+    const size_t n = mesh.numVertices();
+    if (source.numVertices() != n || source.numTriangles() != mesh.numTriangles() ||
+        (source.vertexNormals() == nullptr) != (mesh.vertexNormals() == nullptr) ||
+        (source.vertexUVs() == nullptr) != (mesh.vertexUVs() == nullptr) || source.material() != mesh.material())
+        return false;
+    if (memcmp(source.vertexIndices(), mesh.vertexIndices(), mesh.numTriangles() * 3 * sizeof(int)) != 0)
+        return false;
+    if (mesh.vertexUVs() && memcmp(source.vertexUVs(), mesh.vertexUVs(), n * 2 * sizeof(Real)) != 0)
+        return false;
+
+    // Kromě relativní tolerance se připouští i zaokrouhlení souřadnic daleko od počátku.
+    double magnitude = 0.0;
+    for (int k = 0; k < 3; ++k)
+        magnitude = std::fmax(magnitude, std::fmax(std::fabs(proto.centroid[k]), std::fabs(centroid[k])));
+    const double limit = tolerance * proto.radius + 8.0 * FLT_EPSILON * (magnitude + proto.radius);
+
+    double spread = 0.0;
+    const Vector* p = mesh.vertices();
+    for (size_t i = 0; i < n; ++i)
+        for (int k = 0; k < 3; ++k)
+            spread += (p[i][k] - centroid[k]) * (p[i][k] - centroid[k]);
+    spread /= static_cast<double>(n);
+    if (std::fabs(std::sqrt(spread) - std::sqrt(proto.spread)) > limit)
+        return false;
+
+    double from[3][3], to[3][3];
+    basis(source, proto.frame, from);
+    basis(mesh, proto.frame, to);
+
+    double r[3][3], t[3];
+    for (int i = 0; i < 3; ++i)
+    {
+        for (int j = 0; j < 3; ++j)
+            r[i][j] = to[0][i] * from[0][j] + to[1][i] * from[1][j] + to[2][i] * from[2][j];
+    }
+    for (int i = 0; i < 3; ++i)
+        t[i] = centroid[i] - (r[i][0] * proto.centroid[0] + r[i][1] * proto.centroid[1] + r[i][2] * proto.centroid[2]);
+
+    const Vector* q = source.vertices();
+    const double limit2 = limit * limit;
+    for (size_t v = 0; v < n; ++v)
+    {
+        double d2 = 0.0;
+        for (int i = 0; i < 3; ++i)
+        {
+            const double d = r[i][0] * q[v].x + r[i][1] * q[v].y + r[i][2] * q[v].z + t[i] - p[v][i];
+            d2 += d * d;
+        }
+        if (d2 > limit2)
+            return false;
+    }
+
+    if (mesh.vertexNormals())
+    {
+        const Vector* na = source.vertexNormals();
+        const Vector* nb = mesh.vertexNormals();
+        for (size_t v = 0; v < n; ++v)
+        {
+            double d2 = 0.0;
+            for (int i = 0; i < 3; ++i)
+            {
+                const double d = r[i][0] * na[v].x + r[i][1] * na[v].y + r[i][2] * na[v].z - nb[v][i];
+                d2 += d * d;
+            }
+            if (d2 > 1e-6 * na[v].squarredLenght())
+                return false;
+        }
+    }
+
+    Real m[4][4], inv[4][4];
+    for (int i = 0; i < 3; ++i)
+    {
+        for (int j = 0; j < 3; ++j)
+        {
+            m[i][j] = static_cast<Real>(r[i][j]);
+            inv[i][j] = static_cast<Real>(r[j][i]);
+        }
+        m[i][3] = static_cast<Real>(t[i]);
+        inv[i][3] = static_cast<Real>(-(r[0][i] * t[0] + r[1][i] * t[1] + r[2][i] * t[2]));
+        m[3][i] = inv[3][i] = 0.f;
+    }
+    m[3][3] = inv[3][3] = 1.f;
+    transform = Transform(m, inv);
+    return true;
+}
+
+size_t MeshDeduplicator::add(const Reference<TriangleMesh>& mesh, Transform& transform)
+{
+    Reference<TriangleMesh> m(mesh);
+    ++stats.meshes;
+    transform = Transform();
+
+    Prototype proto;
+    proto.mesh = m;
+    proto.uses = 1;
+    moments(*m, proto.centroid, proto.spread, proto.radius);
+
+    const size_t bytes = meshBytes(*m);
+    if (bytes > 2 * sizeof(Instance) && m->numVertices() > 0)
+    {
+        std::vector<size_t>& bucket = buckets[contentHash(*m)];
+        for (size_t i = 0; i < bucket.size(); ++i)
+        {
+            Prototype& candidate = prototypes[bucket[i]];
+            if (!match(candidate, *m, proto.centroid, transform))
+                continue;
+
+            // Vzor sdílený poprvé potřebuje také vlastní instanci.
+            size_t saved = bytes - sizeof(Instance);
+            if (++candidate.uses == 2)
+            {
+                ++stats.shared;
+                saved -= sizeof(Instance);
+            }
+            ++stats.duplicates;
+            stats.bytesSaved += saved;
+            return bucket[i];
+        }
+
+        if (chooseFrame(proto))
+            bucket.push_back(prototypes.size());
+    }
+
+    prototypes.push_back(proto);
+    return prototypes.size() - 1;
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "core/deduplicationreport.h"
+#include "core/transform.h"
+#include "shapes/trianglemesh.h"
+
+namespace tracer
+{
+
+/*!
+ * Hledá při načítání scény sítě, které jsou kopií dříve načtené sítě
+ * posunuté a otočené do scény (tuhá transformace), aby je šlo nahradit
+ * instancemi jedné sdílené sítě (Instance). Hodí se pro exportované scény,
+ * ve kterých je každá kopie objektu zapsaná jako samostatná síť.
+ *
+ * Sítě se nejprve rozdělí podle haše obsahu, který na transformaci nezávisí
+ * (počty, indexy, texturové souřadnice a materiál). Kandidáti se stejným
+ * hašem se porovnají podle rozptylu vrcholů kolem těžiště a nakonec se
+ * z trojice vzdálených vrcholů odhadne otočení a posunutí, které se
+ * ověří na všech vrcholech a normálách. Zrcadlené kopie ani kopie se změnou
+ * měřítka se nesloučí. Počítá se v dvojnásobné přesnosti s tolerancí
+ * vztaženou k velikosti sítě.
+ *
+ * Sítě, jejichž data jsou menší než dvě instance, se neslučují, instance
+ * by zabraly víc paměti než ušetří.
+ */
+class MeshDeduplicator
+{
+public:
+    /*!
+     * Konstruktor.
+     * \param tolerance největší odchylka vrcholu vztažená k poloměru sítě
+     */
+    MeshDeduplicator(Real tolerance = 1e-5f);
+
+    /*!
+     * Porovná síť s dříve přidanými sítěmi. Pokud je její kopií, síť se
+     * dál nepoužívá a vrátí se index původní sítě (vzoru) spolu
+     * s transformací, která vzor přenese na síť. Jinak se síť sama stane
+     * novým vzorem s identickou transformací.
+     * \param mesh síť ve scéně
+     * \param transform slouží k návratu transformace ze vzoru na síť
+     * \return index vzoru
+     */
+    size_t add(const Reference<TriangleMesh>& mesh, Transform& transform);
+
+    /*!
+     * \return počet vzorů
+     */
+    size_t numPrototypes() const
+    { return prototypes.size(); }
+
+    /*!
+     * \param i index vzoru
+     * \return síť vzoru
+     */
+    Reference<TriangleMesh> prototype(size_t i) const
+    { return prototypes[i].mesh; }
+
+    /*!
+     * \param i index vzoru
+     * \return kolik přidaných sítí vzor nahrazuje (včetně sebe)
+     */
+    size_t uses(size_t i) const
+    { return prototypes[i].uses; }
+
+    /*!
+     * \return přehled sloučených sítí
+     */
+    const DeduplicationReport& report() const
+    { return stats; }
+
+    /*!
+     * Odhad paměti sítě rozložené na trojúhelníky: pole vrcholů, indexů,
+     * normál, texturových souřadnic a objekty trojúhelníků.
+     * \param mesh síť
+     * \return velikost v bajtech
+     */
+    static size_t meshBytes(const TriangleMesh& mesh);
+
+private:
+    /*!
+     * Vzor, se kterým se porovnávají další sítě.
+     */
+    struct Prototype
+    {
+        mutable Reference<TriangleMesh> mesh; ///< Síť vzoru.
+        double centroid[3]; ///< Těžiště vrcholů.
+        double spread; ///< Průměrná druhá mocnina vzdálenosti vrcholů od těžiště.
+        double radius; ///< Největší vzdálenost vrcholu od těžiště.
+        size_t frame[3]; ///< Vrcholy, ze kterých se určuje otočení.
+        size_t uses; ///< Počet nahrazených sítí včetně vzoru.
+    };
+
+    /*!
+     * Spočítá těžiště, rozptyl a poloměr vrcholů sítě.
+     */
+    static void moments(const TriangleMesh& mesh, double centroid[3], double& spread, double& radius);
+
+    /*!
+     * Vybere tři navzájem vzdálené vrcholy vzoru, které určují jeho natočení.
+     * \return false, pokud vrcholy leží na přímce
+     */
+    static bool chooseFrame(Prototype& p);
+
+    /*!
+     * Zkusí najít tuhou transformaci vzoru na síť.
+     * \param p vzor
+     * \param mesh porovnávaná síť
+     * \param centroid těžiště vrcholů sítě
+     * \param transform slouží k návratu transformace
+     * \return jestli je síť kopií vzoru
+     */
+    bool match(const Prototype& p, const TriangleMesh& mesh, const double centroid[3], Transform& transform) const;
+
+    Real tolerance; ///< Relativní tolerance polohy vrcholů.
+    std::vector<Prototype> prototypes; ///< Vzory v pořadí přidání.
+    std::unordered_map<uint64_t, std::vector<size_t>> buckets; ///< Vzory podle haše obsahu.
+    DeduplicationReport stats; ///< Přehled sloučených sítí.
+};
+
+}
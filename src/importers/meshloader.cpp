@@ -0,0 +1,962 @@
+#include "importers/meshloader.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <unordered_map>
+
+#include "core/parallel.h"
+
+using namespace tracer;
+
+namespace
+{
+
+const int NO_INDEX = INT_MIN; ///< Roh stěny bez normály nebo texturové souřadnice.
+
+inline bool isBlank(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+inline bool isDigit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+inline void skipBlank(const char*& p, const char* end)
+{
+    while (p != end && isBlank(*p))
+        ++p;
+}
+
+/*!
+ * Převede reálné číslo z textu. Číslice se skládají do celého čísla
+ * (nejvýše 19 platných) a to se nakonec vynásobí mocninou deseti, pro
+ * přesnost float to stačí.
+ * \param p začátek čísla, posune se za něj
+ * \param end konec textu
+ * \param out slouží k návratu čísla
+ * \return jestli text začínal číslem
+ */
+bool parseReal(const char*& p, const char* end, Real& out)
+{
+    static const double POW10[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+
+    const char* s = p;
+    bool negative = false;
+    if (s != end && (*s == '-' || *s == '+'))
+        negative = *s++ == '-';
+
+    uint64_t mantissa = 0;
+    int nDigits = 0;
+    int exponent = 0;
+    bool any = false;
+    for (; s != end && isDigit(*s); ++s, any = true)
+    {
+        if (nDigits < 19)
+        {
+            mantissa = mantissa * 10 + static_cast<uint64_t>(*s - '0');
+            if (mantissa)
+                ++nDigits;
+        }
+        else
+            ++exponent;
+    }
+    if (s != end && *s == '.')
+    {
+        for (++s; s != end && isDigit(*s); ++s, any = true)
+        {
+            if (nDigits < 19)
+            {
+                mantissa = mantissa * 10 + static_cast<uint64_t>(*s - '0');
+                if (mantissa)
+                    ++nDigits;
+                --exponent;
+            }
+        }
+    }
+    if (!any)
+        return false;
+
+    if (s != end && (*s == 'e' || *s == 'E'))
+    {
+        const char* e = s + 1;
+        bool negativeExponent = false;
+        if (e != end && (*e == '-' || *e == '+'))
+            negativeExponent = *e++ == '-';
+        if (e != end && isDigit(*e))
+        {
+            int value = 0;
+            for (; e != end && isDigit(*e); ++e)
+                if (value < 10000)
+                    value = value * 10 + (*e - '0');
+            exponent += negativeExponent ? -value : value;
+            s = e;
+        }
+    }
+
+    double v = static_cast<double>(mantissa);
+    if (mantissa == 0)
+        v = 0.0;
+    else if (exponent >= 0 && exponent <= 22)
+        v *= POW10[exponent];
+    else if (exponent < 0 && exponent >= -22)
+        v /= POW10[-exponent];
+    else
+        v *= std::pow(10.0, exponent);
+
+    out = static_cast<Real>(negative ? -v : v);
+    p = s;
+    return true;
+}
+
+/*!
+ * Převede celé číslo z textu.
+ * \return jestli text začínal číslem, které se vejde do int
+ */
+bool parseInt(const char*& p, const char* end, int& out)
+{
+    const char* s = p;
+    bool negative = false;
+    if (s != end && (*s == '-' || *s == '+'))
+        negative = *s++ == '-';
+    if (s == end || !isDigit(*s))
+        return false;
+
+    int64_t value = 0;
+    for (; s != end && isDigit(*s); ++s)
+    {
+        value = value * 10 + (*s - '0');
+        if (value > INT_MAX)
+            return false;
+    }
+    out = static_cast<int>(negative ? -value : value);
+    p = s;
+    return true;
+}
+
+/*!
+ * Roh stěny OBJ. Záporné indexy ze souboru se vztahují k počtu vrcholů
+ * přečtených před stěnou, ten ale blok zná jen od svého začátku. Takové
+ * indexy se proto ukládají relativně k prvnímu vrcholu bloku a na
+ * absolutní se převedou až při slévání bloků.
+ */
+struct Corner
+{
+    int v; ///< Index vrcholu.
+    int n; ///< Index normály nebo NO_INDEX.
+    int t; ///< Index texturové souřadnice nebo NO_INDEX.
+    bool relativeV; ///< Jestli je index vrcholu relativní k bloku.
+    bool relativeN; ///< Jestli je index normály relativní k bloku.
+    bool relativeT; ///< Jestli je index texturové souřadnice relativní k bloku.
+};
+
+/*!
+ * Kombinace indexů vrcholu, normály a texturové souřadnice rohu, podle
+ * které se rozdělují vrcholy.
+ */
+struct SplitKey
+{
+    int v, n, t;
+
+    bool operator==(const SplitKey& other) const
+    { return v == other.v && n == other.n && t == other.t; }
+};
+
+struct SplitKeyHash
+{
+    size_t operator()(const SplitKey& key) const
+    {
+        uint64_t h = static_cast<uint32_t>(key.v);
+        h = h * 0x9E3779B97F4A7C15ull ^ static_cast<uint32_t>(key.n);
+        h = h * 0x9E3779B97F4A7C15ull ^ static_cast<uint32_t>(key.t);
+        return static_cast<size_t>(h ^ (h >> 29));
+    }
+};
+
+/*!
+ * Blok souboru OBJ zpracovávaný jedním vláknem.
+ */
+struct OBJChunk
+{
+    const char* begin; ///< Začátek bloku (začátek řádku).
+    const char* end; ///< Konec bloku (za koncem řádku).
+    std::vector<Vector> vertices; ///< Vrcholy bloku.
+    std::vector<Vector> normals; ///< Normály bloku.
+    std::vector<Real> uvs; ///< Texturové souřadnice bloku, dvojice (u, v).
+    std::vector<Corner> corners; ///< Rohy trojúhelníků bloku.
+    size_t nLines; ///< Počet řádků bloku.
+    size_t errorLine; ///< Řádek chyby v rámci bloku.
+    const char* error; ///< Popis chyby nebo nullptr.
+};
+
+/*!
+ * Převede index rohu stěny ze souboru.
+ * \param index index ze souboru (číslováno od 1, záporný od konce)
+ * \param count počet prvků přečtených v bloku
+ * \param out slouží k návratu indexu
+ * \param relative slouží k návratu, jestli je index relativní k bloku
+ */
+bool resolveIndex(int index, size_t count, int& out, bool& relative)
+{
+    if (index == 0)
+        return false;
+    relative = index < 0;
+    out = relative ? static_cast<int>(count) + index : index - 1;
+    return true;
+}
+
+/*!
+ * Zpracuje jeden řádek OBJ.
+ * \return popis chyby nebo nullptr
+ */
+const char* parseOBJLine(OBJChunk& chunk, const char* p, const char* end, std::vector<Corner>& face)
+{
+    skipBlank(p, end);
+    if (p == end || *p == '#')
+        return nullptr;
+
+    const char* keyword = p;
+    while (p != end && !isBlank(*p))
+        ++p;
+    const size_t length = static_cast<size_t>(p - keyword);
+
+    if (length == 1 && keyword[0] == 'v')
+    {
+        Real c[3];
+        for (int i = 0; i < 3; ++i)
+        {
+            skipBlank(p, end);
+            if (!parseReal(p, end, c[i]))
+                return "Invalid vertex";
+        }
+        chunk.vertices.push_back(Vector(c[0], c[1], c[2]));
+    }
+    else if (length == 2 && keyword[0] == 'v' && keyword[1] == 'n')
+    {
+        Real c[3];
+        for (int i = 0; i < 3; ++i)
+        {
+            skipBlank(p, end);
+            if (!parseReal(p, end, c[i]))
+                return "Invalid normal";
+        }
+        chunk.normals.push_back(Vector(c[0], c[1], c[2]));
+    }
+    else if (length == 2 && keyword[0] == 'v' && keyword[1] == 't')
+    {
+        // Třetí souřadnice (w) je nepovinná a nepoužívá se.
+        Real c[2];
+        for (int i = 0; i < 2; ++i)
+        {
+            skipBlank(p, end);
+            if (!parseReal(p, end, c[i]))
+                return "Invalid texture coordinate";
+        }
+        chunk.uvs.push_back(c[0]);
+        chunk.uvs.push_back(c[1]);
+    }
+    else if (length == 1 && keyword[0] == 'f')
+    {
+        face.clear();
+        while (true)
+        {
+            skipBlank(p, end);
+            if (p == end)
+                break;
+
+            Corner corner;
+            int index;
+            if (!parseInt(p, end, index) || !resolveIndex(index, chunk.vertices.size(), corner.v, corner.relativeV))
+                return "Invalid face vertex index";
+            corner.n = NO_INDEX;
+            corner.t = NO_INDEX;
+            corner.relativeN = false;
+            corner.relativeT = false;
+
+            if (p != end && *p == '/')
+            {
+                ++p;
+                if (p != end && *p != '/' &&
+                    (!parseInt(p, end, index) ||
+                     !resolveIndex(index, chunk.uvs.size() / 2, corner.t, corner.relativeT)))
+                    return "Invalid face texture index";
+                if (p != end && *p == '/')
+                {
+                    ++p;
+                    if (!parseInt(p, end, index) ||
+                        !resolveIndex(index, chunk.normals.size(), corner.n, corner.relativeN))
+                        return "Invalid face normal index";
+                }
+            }
+            if (p != end && !isBlank(*p))
+                return "Invalid face";
+            face.push_back(corner);
+        }
+
+        if (face.size() < 3)
+            return "Face must have at least 3 vertices";
+        for (size_t i = 1; i + 1 < face.size(); ++i)
+        {
+            chunk.corners.push_back(face[0]);
+            chunk.corners.push_back(face[i]);
+            chunk.corners.push_back(face[i + 1]);
+        }
+    }
+    return nullptr;
+}
+
+/*!
+ * Zpracuje blok OBJ. Chyba se jen zaznamená, výjimka by z vlákna
+ * parallelFor nevyšla.
+ */
+void parseOBJChunk(OBJChunk& chunk)
+{
+    chunk.nLines = static_cast<size_t>(std::count(chunk.begin, chunk.end, '\n'));
+    chunk.error = nullptr;
+
+    std::vector<Corner> face;
+    size_t line = 0;
+    for (const char* p = chunk.begin; p < chunk.end; ++line)
+    {
+        const char* eol = static_cast<const char*>(memchr(p, '\n', static_cast<size_t>(chunk.end - p)));
+        if (!eol)
+            eol = chunk.end;
+        if ((chunk.error = parseOBJLine(chunk, p, eol, face)))
+        {
+            chunk.errorLine = line;
+            return;
+        }
+        p = eol + 1;
+    }
+}
+
+/*!
+ * Typy hodnot PLY.
+ */
+enum PLYType
+{
+    PLY_INT8, PLY_UINT8, PLY_INT16, PLY_UINT16, PLY_INT32, PLY_UINT32, PLY_FLOAT32, PLY_FLOAT64
+};
+
+const size_t PLY_TYPE_SIZE[] = { 1, 1, 2, 2, 4, 4, 4, 8 };
+
+/*!
+ * Vlastnost elementu PLY.
+ */
+struct PLYProperty
+{
+    std::string name; ///< Jméno.
+    PLYType type; ///< Typ hodnoty (u seznamu typ prvků).
+    bool list; ///< Jestli jde o seznam.
+    PLYType countType; ///< Typ délky seznamu.
+};
+
+/*!
+ * Element PLY.
+ */
+struct PLYElement
+{
+    std::string name; ///< Jméno.
+    size_t count; ///< Počet záznamů.
+    std::vector<PLYProperty> properties; ///< Vlastnosti záznamu.
+
+    /*!
+     * \return velikost záznamu v bajtech nebo 0, pokud obsahuje seznam
+     */
+    size_t recordSize() const
+    {
+        size_t size = 0;
+        for (size_t i = 0; i < properties.size(); ++i)
+        {
+            if (properties[i].list)
+                return 0;
+            size += PLY_TYPE_SIZE[properties[i].type];
+        }
+        return size;
+    }
+};
+
+PLYType plyType(const std::string& name)
+{
+    if (name == "char" || name == "int8")
+        return PLY_INT8;
+    if (name == "uchar" || name == "uint8")
+        return PLY_UINT8;
+    if (name == "short" || name == "int16")
+        return PLY_INT16;
+    if (name == "ushort" || name == "uint16")
+        return PLY_UINT16;
+    if (name == "int" || name == "int32")
+        return PLY_INT32;
+    if (name == "uint" || name == "uint32")
+        return PLY_UINT32;
+    if (name == "float" || name == "float32")
+        return PLY_FLOAT32;
+    if (name == "double" || name == "float64")
+        return PLY_FLOAT64;
+    throw std::runtime_error("Unknown PLY type " + name);
+}
+
+/*!
+ * Přečte hodnotu PLY.
+ * \param p začátek hodnoty
+ * \param type typ hodnoty
+ * \param swap jestli se má otočit pořadí bajtů
+ */
+double readPLY(const char* p, PLYType type, bool swap)
+{
+    unsigned char b[8];
+    const size_t size = PLY_TYPE_SIZE[type];
+    memcpy(b, p, size);
+    if (swap)
+        std::reverse(b, b + size);
+
+    switch (type)
+    {
+    case PLY_INT8: { int8_t v; memcpy(&v, b, 1); return v; }
+    case PLY_UINT8: { uint8_t v; memcpy(&v, b, 1); return v; }
+    case PLY_INT16: { int16_t v; memcpy(&v, b, 2); return v; }
+    case PLY_UINT16: { uint16_t v; memcpy(&v, b, 2); return v; }
+    case PLY_INT32: { int32_t v; memcpy(&v, b, 4); return v; }
+    case PLY_UINT32: { uint32_t v; memcpy(&v, b, 4); return v; }
+    case PLY_FLOAT32: { float v; memcpy(&v, b, 4); return v; }
+    case PLY_FLOAT64: { double v; memcpy(&v, b, 8); return v; }
+    }
+    return 0.0;
+}
+
+/*!
+ * Rozdělí řádek hlavičky na slova.
+ */
+std::vector<std::string> splitWords(const char* p, const char* end)
+{
+    std::vector<std::string> words;
+    while (true)
+    {
+        skipBlank(p, end);
+        if (p == end)
+            return words;
+        const char* begin = p;
+        while (p != end && !isBlank(*p))
+            ++p;
+        words.push_back(std::string(begin, p));
+    }
+}
+
+/*!
+ * Zkontroluje, že indexy odkazují na existující vrcholy.
+ */
+bool validIndices(const std::vector<int>& indices, size_t nVertices)
+{
+    std::atomic<bool> valid(true);
+    parallelFor(indices.size(), [&](size_t i) {
+        if (indices[i] < 0 || static_cast<size_t>(indices[i]) >= nVertices)
+            valid.store(false, std::memory_order_relaxed);
+    }, 1 << 16);
+    return valid;
+}
+
+}
+
+MeshLoader::MeshLoader(size_t chunkSize)
+    : chunkSize(std::max(chunkSize, static_cast<size_t>(1)))
+{ }
+
+void MeshLoader::load(const std::string& path, std::vector<Vector>& vertices, std::vector<int>& indices,
+                      std::vector<Vector>& normals, std::vector<Real>& uvs) const
+{
+    const size_t dot = path.rfind('.');
+    std::string extension = dot == std::string::npos ? std::string() : path.substr(dot + 1);
+    std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+    if (extension != "obj" && extension != "ply")
+        throw std::runtime_error("Unknown mesh format " + path);
+
+    Reference<MappedFile> file(new MappedFile(path.c_str()));
+    vertices.clear();
+    indices.clear();
+    normals.clear();
+    uvs.clear();
+    if (extension == "obj")
+        loadOBJ(*file, path, vertices, indices, normals, uvs);
+    else
+        loadPLY(*file, path, vertices, indices, normals, uvs);
+
+    if (indices.empty())
+        throw std::runtime_error("Mesh " + path + " has no faces");
+    if (vertices.size() > static_cast<size_t>(INT_MAX) || indices.size() > static_cast<size_t>(INT_MAX))
+        throw std::runtime_error("Mesh " + path + " is too large");
+    if (normals.empty())
+        generateNormals(vertices, indices, normals);
+}
+
+/*!
+ * Soubor se rozdělí na nejvýše čtyřnásobek počtu jader bloků, aby se
+ * vlákna s různě složitými bloky vyrovnala, hranice bloků se posunou za
+ * nejbližší konec řádku. Bloky se převedou paralelně, z jejich velikostí
+ * se spočítají posunutí ve výsledných polích a do nich se paralelně
+ * zkopírují, přitom se převedou relativní indexy.
+ *
+ * Normály a texturové souřadnice ze souboru se použijí, pokud je mají
+ * všechny rohy stěn. Když jejich indexy odpovídají indexům vrcholů,
+ * převezmou se přímo, jinak se vrcholy rozdělí podle trojic (vrchol,
+ * normála, texturová souřadnice). Normály vrcholů bez normál ze souboru se
+ * přitom spočítají před rozdělením.
+ */
+void MeshLoader::loadOBJ(const MappedFile& file, const std::string& path, std::vector<Vector>& vertices,
+                         std::vector<int>& indices, std::vector<Vector>& normals, std::vector<Real>& uvs) const
+{
+    const char* data = file.data();
+    const size_t size = file.size();
+
+    const size_t maxChunks = static_cast<size_t>(numSystemCores()) * 4;
+    const size_t nChunks = std::max(static_cast<size_t>(1), std::min(maxChunks, size / chunkSize));
+    std::vector<OBJChunk> chunks(nChunks);
+    const char* begin = data;
+    for (size_t i = 0; i < nChunks; ++i)
+    {
+        const char* end = data + size;
+        if (i + 1 < nChunks)
+        {
+            const char* split = std::max(begin, data + size / nChunks * (i + 1));
+            const char* eol = static_cast<const char*>(memchr(split, '\n', static_cast<size_t>(end - split)));
+            end = eol ? eol + 1 : end;
+        }
+        chunks[i].begin = begin;
+        chunks[i].end = end;
+        begin = end;
+    }
+
+    parallelFor(nChunks, [&](size_t i) { parseOBJChunk(chunks[i]); });
+
+    size_t line = 1;
+    for (size_t i = 0; i < nChunks; ++i)
+    {
+        if (chunks[i].error)
+            throw std::runtime_error(path + " line " + std::to_string(line + chunks[i].errorLine) + ": " +
+                                     chunks[i].error);
+        line += chunks[i].nLines;
+    }
+
+    std::vector<size_t> vertexBase(nChunks + 1, 0), normalBase(nChunks + 1, 0), uvBase(nChunks + 1, 0),
+        cornerBase(nChunks + 1, 0);
+    for (size_t i = 0; i < nChunks; ++i)
+    {
+        vertexBase[i + 1] = vertexBase[i] + chunks[i].vertices.size();
+        normalBase[i + 1] = normalBase[i] + chunks[i].normals.size();
+        uvBase[i + 1] = uvBase[i] + chunks[i].uvs.size() / 2;
+        cornerBase[i + 1] = cornerBase[i] + chunks[i].corners.size();
+    }
+    const size_t nVertices = vertexBase[nChunks];
+    const size_t nNormals = normalBase[nChunks];
+    const size_t nUVs = uvBase[nChunks];
+    if (nVertices > static_cast<size_t>(INT_MAX) || nNormals > static_cast<size_t>(INT_MAX) ||
+        nUVs > static_cast<size_t>(INT_MAX))
+        throw std::runtime_error("Mesh " + path + " is too large");
+
+    vertices.resize(nVertices);
+    indices.resize(cornerBase[nChunks]);
+    std::vector<Vector> fileNormals(nNormals);
+    std::vector<Real> fileUVs(2 * nUVs);
+    std::vector<int> normalIndices(cornerBase[nChunks]), uvIndices(cornerBase[nChunks]);
+    std::atomic<bool> valid(true), allNormals(true), sameNormals(true), allUVs(true), sameUVs(true);
+
+    parallelFor(nChunks, [&](size_t i) {
+        OBJChunk& chunk = chunks[i];
+        std::copy(chunk.vertices.begin(), chunk.vertices.end(), vertices.begin() + vertexBase[i]);
+        std::copy(chunk.normals.begin(), chunk.normals.end(), fileNormals.begin() + normalBase[i]);
+        std::copy(chunk.uvs.begin(), chunk.uvs.end(), fileUVs.begin() + 2 * uvBase[i]);
+
+        bool chunkValid = true, chunkNormals = true, chunkSameNormals = true, chunkUVs = true, chunkSameUVs = true;
+        for (size_t j = 0; j < chunk.corners.size(); ++j)
+        {
+            const Corner& corner = chunk.corners[j];
+            const int64_t v = corner.relativeV ? static_cast<int64_t>(vertexBase[i]) + corner.v : corner.v;
+            chunkValid &= v >= 0 && v < static_cast<int64_t>(nVertices);
+            indices[cornerBase[i] + j] = static_cast<int>(v);
+
+            int64_t n = NO_INDEX;
+            if (corner.n != NO_INDEX)
+            {
+                n = corner.relativeN ? static_cast<int64_t>(normalBase[i]) + corner.n : corner.n;
+                chunkValid &= n >= 0 && n < static_cast<int64_t>(nNormals);
+            }
+            else
+                chunkNormals = false;
+            normalIndices[cornerBase[i] + j] = static_cast<int>(n);
+            chunkSameNormals &= n == v;
+
+            int64_t t = NO_INDEX;
+            if (corner.t != NO_INDEX)
+            {
+                t = corner.relativeT ? static_cast<int64_t>(uvBase[i]) + corner.t : corner.t;
+                chunkValid &= t >= 0 && t < static_cast<int64_t>(nUVs);
+            }
+            else
+                chunkUVs = false;
+            uvIndices[cornerBase[i] + j] = static_cast<int>(t);
+            chunkSameUVs &= t == v;
+        }
+        if (!chunkValid)
+            valid = false;
+        if (!chunkNormals)
+            allNormals = false;
+        if (!chunkSameNormals)
+            sameNormals = false;
+        if (!chunkUVs)
+            allUVs = false;
+        if (!chunkSameUVs)
+            sameUVs = false;
+
+        std::vector<Vector>().swap(chunk.vertices);
+        std::vector<Vector>().swap(chunk.normals);
+        std::vector<Real>().swap(chunk.uvs);
+        std::vector<Corner>().swap(chunk.corners);
+    });
+
+    if (!valid)
+        throw std::runtime_error("Face index out of range in " + path);
+    const bool useNormals = allNormals && nNormals > 0;
+    const bool useUVs = allUVs && nUVs > 0;
+    if (!useNormals && !useUVs)
+        return;
+
+    if ((!useNormals || (sameNormals && nNormals == nVertices)) && (!useUVs || (sameUVs && nUVs == nVertices)))
+    {
+        if (useNormals)
+            normals.swap(fileNormals);
+        if (useUVs)
+            uvs.swap(fileUVs);
+        return;
+    }
+
+    // Chybějící normály se spočítají ještě na nerozdělených vrcholech,
+    // rozdělení podle texturových souřadnic by jinak na švech textury
+    // vytvořilo ostré hrany.
+    std::vector<Vector> positionNormals;
+    if (!useNormals)
+        generateNormals(vertices, indices, positionNormals);
+
+    std::unordered_map<SplitKey, int, SplitKeyHash> split;
+    std::vector<Vector> splitVertices;
+    for (size_t i = 0; i < indices.size(); ++i)
+    {
+        const SplitKey key = { indices[i], useNormals ? normalIndices[i] : NO_INDEX, useUVs ? uvIndices[i] : NO_INDEX };
+        std::pair<std::unordered_map<SplitKey, int, SplitKeyHash>::iterator, bool> it =
+            split.insert(std::make_pair(key, static_cast<int>(splitVertices.size())));
+        if (it.second)
+        {
+            splitVertices.push_back(vertices[key.v]);
+            normals.push_back(useNormals ? fileNormals[key.n] : positionNormals[key.v]);
+            if (useUVs)
+            {
+                uvs.push_back(fileUVs[2 * static_cast<size_t>(key.t)]);
+                uvs.push_back(fileUVs[2 * static_cast<size_t>(key.t) + 1]);
+            }
+        }
+        indices[i] = it.first->second;
+    }
+    vertices.swap(splitVertices);
+}
+
+/*!
+ * Hlavička se čte po řádcích, data za ní se procházejí po elementech.
+ * Element vertex musí mít záznamy pevné délky, převádí se paralelně.
+ * Element face obsahuje v běžných souborech jen seznam indexů, u kterého
+ * se paralelně ověří, že jde samé trojúhelníky, a pak se také převede
+ * paralelně jako pole záznamů pevné délky. Ostatní tvary stěn se procházejí
+ * postupně, ostatní elementy se přeskočí.
+ */
+void MeshLoader::loadPLY(const MappedFile& file, const std::string& path, std::vector<Vector>& vertices,
+                         std::vector<int>& indices, std::vector<Vector>& normals, std::vector<Real>& uvs) const
+{
+    const char* p = file.data();
+    const char* end = p + file.size();
+
+    std::vector<PLYElement> elements;
+    bool swap = false, format = false, first = true;
+    while (true)
+    {
+        const char* eol = static_cast<const char*>(memchr(p, '\n', static_cast<size_t>(end - p)));
+        if (!eol)
+            throw std::runtime_error("Invalid PLY header in " + path);
+        std::vector<std::string> words = splitWords(p, eol);
+        p = eol + 1;
+
+        if (first)
+        {
+            if (words.size() != 1 || words[0] != "ply")
+                throw std::runtime_error("Not a PLY file " + path);
+            first = false;
+        }
+        else if (words.empty() || words[0] == "comment" || words[0] == "obj_info")
+            continue;
+        else if (words[0] == "end_header")
+            break;
+        else if (words[0] == "format" && words.size() == 3)
+        {
+            const uint16_t one = 1;
+            const bool littleHost = *reinterpret_cast<const unsigned char*>(&one) == 1;
+            if (words[1] == "binary_little_endian")
+                swap = !littleHost;
+            else if (words[1] == "binary_big_endian")
+                swap = littleHost;
+            else
+                throw std::runtime_error("Unsupported PLY format " + words[1] + " in " + path);
+            format = true;
+        }
+        else if (words[0] == "element" && words.size() == 3)
+        {
+            PLYElement element;
+            element.name = words[1];
+            const char* count = words[2].c_str();
+            int value;
+            if (!parseInt(count, count + words[2].size(), value) || *count || value < 0)
+                throw std::runtime_error("Invalid PLY element count in " + path);
+            element.count = static_cast<size_t>(value);
+            elements.push_back(element);
+        }
+        else if (words[0] == "property" && !elements.empty() && words.size() == 3)
+        {
+            PLYProperty property = { words[2], plyType(words[1]), false, PLY_UINT8 };
+            elements.back().properties.push_back(property);
+        }
+        else if (words[0] == "property" && !elements.empty() && words.size() == 5 && words[1] == "list")
+        {
+            PLYProperty property = { words[4], plyType(words[3]), true, plyType(words[2]) };
+            if (property.countType == PLY_FLOAT32 || property.countType == PLY_FLOAT64)
+                throw std::runtime_error("Invalid PLY list count type in " + path);
+            elements.back().properties.push_back(property);
+        }
+        else
+            throw std::runtime_error("Invalid PLY header line " + words[0] + " in " + path);
+    }
+    if (!format)
+        throw std::runtime_error("Missing PLY format in " + path);
+
+    bool hasNormals = false, hasUVs = false;
+    for (size_t e = 0; e < elements.size(); ++e)
+    {
+        const PLYElement& element = elements[e];
+        const size_t recordSize = element.recordSize();
+        const size_t remaining = static_cast<size_t>(end - p);
+
+        if (element.name == "vertex")
+        {
+            if (!recordSize)
+                throw std::runtime_error("PLY vertices with lists are not supported in " + path);
+            if (element.count > remaining / recordSize)
+                throw std::runtime_error("Truncated PLY file " + path);
+
+            // Posunutí x, y, z, nx, ny, nz, u, v v záznamu. Texturové souřadnice
+            // se v různých exportérech jmenují u, v nebo s, t nebo texture_u,
+            // texture_v.
+            const char* names[8] = { "x", "y", "z", "nx", "ny", "nz", "u", "v" };
+            const char* altNames[8][2] = {
+                { "", "" }, { "", "" }, { "", "" }, { "", "" }, { "", "" }, { "", "" },
+                { "s", "texture_u" }, { "t", "texture_v" }
+            };
+            size_t offsets[8];
+            PLYType types[8];
+            bool found[8] = { false, false, false, false, false, false, false, false };
+            size_t offset = 0;
+            for (size_t i = 0; i < element.properties.size(); ++i)
+            {
+                const PLYProperty& property = element.properties[i];
+                for (int k = 0; k < 8; ++k)
+                {
+                    if (property.name == names[k] || property.name == altNames[k][0] ||
+                        property.name == altNames[k][1])
+                    {
+                        offsets[k] = offset;
+                        types[k] = property.type;
+                        found[k] = true;
+                    }
+                }
+                offset += PLY_TYPE_SIZE[property.type];
+            }
+            if (!found[0] || !found[1] || !found[2])
+                throw std::runtime_error("PLY vertex without coordinates in " + path);
+            hasNormals = found[3] && found[4] && found[5];
+            hasUVs = found[6] && found[7];
+
+            vertices.resize(element.count);
+            if (hasNormals)
+                normals.resize(element.count);
+            if (hasUVs)
+                uvs.resize(2 * element.count);
+            const char* records = p;
+            parallelFor(element.count, [&](size_t i) {
+                const char* r = records + i * recordSize;
+                Real c[8];
+                for (int k = 0; k < 8; ++k)
+                    if (k < 3 || (k < 6 && hasNormals) || (k >= 6 && hasUVs))
+                        c[k] = static_cast<Real>(readPLY(r + offsets[k], types[k], swap));
+                vertices[i] = Vector(c[0], c[1], c[2]);
+                if (hasNormals)
+                    normals[i] = Vector(c[3], c[4], c[5]);
+                if (hasUVs)
+                {
+                    uvs[2 * i] = c[6];
+                    uvs[2 * i + 1] = c[7];
+                }
+            }, 4096);
+            p += element.count * recordSize;
+        }
+        else if (element.name == "face")
+        {
+            const PLYProperty* list = nullptr;
+            for (size_t i = 0; i < element.properties.size(); ++i)
+                if (element.properties[i].list &&
+                    (element.properties[i].name == "vertex_indices" || element.properties[i].name == "vertex_index"))
+                    list = &element.properties[i];
+            if (!list)
+                throw std::runtime_error("PLY face without vertex indices in " + path);
+
+            const size_t countSize = PLY_TYPE_SIZE[list->countType];
+            const size_t itemSize = PLY_TYPE_SIZE[list->type];
+            const size_t triangleSize = countSize + 3 * itemSize;
+            std::atomic<bool> triangles(element.properties.size() == 1 && element.count <= remaining / triangleSize);
+            const char* records = p;
+            if (triangles)
+            {
+                parallelFor(element.count, [&](size_t i) {
+                    if (readPLY(records + i * triangleSize, list->countType, swap) != 3.0)
+                        triangles.store(false, std::memory_order_relaxed);
+                }, 1 << 14);
+            }
+
+            if (triangles)
+            {
+                indices.resize(element.count * 3);
+                parallelFor(element.count, [&](size_t i) {
+                    const char* r = records + i * triangleSize + countSize;
+                    for (int k = 0; k < 3; ++k)
+                        indices[3 * i + k] = static_cast<int>(readPLY(r + k * itemSize, list->type, swap));
+                }, 4096);
+                p += element.count * triangleSize;
+                continue;
+            }
+
+            std::vector<int> face;
+            for (size_t i = 0; i < element.count; ++i)
+            {
+                for (size_t j = 0; j < element.properties.size(); ++j)
+                {
+                    const PLYProperty& property = element.properties[j];
+                    if (!property.list)
+                    {
+                        if (static_cast<size_t>(end - p) < PLY_TYPE_SIZE[property.type])
+                            throw std::runtime_error("Truncated PLY file " + path);
+                        p += PLY_TYPE_SIZE[property.type];
+                        continue;
+                    }
+
+                    if (static_cast<size_t>(end - p) < PLY_TYPE_SIZE[property.countType])
+                        throw std::runtime_error("Truncated PLY file " + path);
+                    const double count = readPLY(p, property.countType, swap);
+                    p += PLY_TYPE_SIZE[property.countType];
+                    const size_t size = PLY_TYPE_SIZE[property.type];
+                    if (count < 0.0 || static_cast<size_t>(count) > static_cast<size_t>(end - p) / size)
+                        throw std::runtime_error("Truncated PLY file " + path);
+                    const size_t n = static_cast<size_t>(count);
+
+                    if (&property == list)
+                    {
+                        if (n < 3)
+                            throw std::runtime_error("PLY face with less than 3 vertices in " + path);
+                        face.resize(n);
+                        for (size_t k = 0; k < n; ++k)
+                            face[k] = static_cast<int>(readPLY(p + k * size, property.type, swap));
+                        for (size_t k = 1; k + 1 < n; ++k)
+                        {
+                            indices.push_back(face[0]);
+                            indices.push_back(face[k]);
+                            indices.push_back(face[k + 1]);
+                        }
+                    }
+                    p += n * size;
+                }
+            }
+        }
+        else if (recordSize)
+        {
+            if (element.count > remaining / recordSize)
+                throw std::runtime_error("Truncated PLY file " + path);
+            p += element.count * recordSize;
+        }
+        else
+        {
+            for (size_t i = 0; i < element.count; ++i)
+            {
+                for (size_t j = 0; j < element.properties.size(); ++j)
+                {
+                    const PLYProperty& property = element.properties[j];
+                    size_t size = PLY_TYPE_SIZE[property.type];
+                    if (property.list)
+                    {
+                        if (static_cast<size_t>(end - p) < PLY_TYPE_SIZE[property.countType])
+                            throw std::runtime_error("Truncated PLY file " + path);
+                        const double count = readPLY(p, property.countType, swap);
+                        p += PLY_TYPE_SIZE[property.countType];
+                        if (count < 0.0 || static_cast<size_t>(count) > static_cast<size_t>(end - p) / size)
+                            throw std::runtime_error("Truncated PLY file " + path);
+                        size *= static_cast<size_t>(count);
+                    }
+                    if (static_cast<size_t>(end - p) < size)
+                        throw std::runtime_error("Truncated PLY file " + path);
+                    p += size;
+                }
+            }
+        }
+    }
+
+    if (!validIndices(indices, vertices.size()))
+        throw std::runtime_error("Face index out of range in " + path);
+}
+
+/*!
+ * Normály stěn se spočítají paralelně do pole po trojúhelnících. Pro každý
+ * vrchol se pak sestaví seznam jeho stěn vzestupně podle indexu stěny
+ * a normály se sečtou v tomto pořadí, výsledek tak nezávisí na počtu vláken
+ * ani na jejich plánování.
+ */
+void MeshLoader::generateNormals(const std::vector<Vector>& vertices, const std::vector<int>& indices,
+                                 std::vector<Vector>& normals)
+{
+    const size_t nTriangles = indices.size() / 3;
+    std::vector<Vector> faceNormals(nTriangles);
+
+    // Vektorový součin má délku dvojnásobku obsahu, je tedy už vážený.
+    parallelFor(nTriangles, [&](size_t t) {
+        const int* i = &indices[3 * t];
+        faceNormals[t] = cross(vertices[i[1]] - vertices[i[0]], vertices[i[2]] - vertices[i[0]]);
+    }, 1024);
+
+    std::vector<size_t> first(vertices.size() + 1, 0);
+    for (size_t i = 0; i < 3 * nTriangles; ++i)
+        ++first[static_cast<size_t>(indices[i]) + 1];
+    for (size_t v = 0; v < vertices.size(); ++v)
+        first[v + 1] += first[v];
+    std::vector<size_t> next(first.begin(), first.end() - 1);
+    std::vector<size_t> faces(3 * nTriangles);
+    for (size_t i = 0; i < 3 * nTriangles; ++i)
+        faces[next[static_cast<size_t>(indices[i])]++] = i / 3;
+
+    normals.resize(vertices.size());
+    parallelFor(vertices.size(), [&](size_t v) {
+        Vector n;
+        for (size_t j = first[v]; j < first[v + 1]; ++j)
+            n += faceNormals[faces[j]];
+        normals[v] = n.length() > 0.f ? n.normalize() : n;
+    }, 4096);
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "core/geometry.h"
+#include "core/mappedfile.h"
+
+namespace tracer
+{
+
+/*!
+ * Načítá trojúhelníkové sítě ze souborů Wavefront OBJ a PLY. Soubor se
+ * namapuje do paměti a zpracovává paralelně: OBJ se rozdělí na bloky na
+ * hranicích řádků, které se převádějí nezávisle vlastním převodem čísel
+ * (bez iostream a strtod), a výsledky bloků se nakonec slijí do společných
+ * polí vrcholů a indexů. Záznamy binárního PLY mají pevnou délku, převádějí
+ * se tedy rovnou po částech pole.
+ *
+ * Z OBJ se čtou vrcholy (v), normály (vn), texturové souřadnice (vt)
+ * a stěny (f) včetně záporných (relativních) indexů, mnohoúhelníky se
+ * rozloží na trojúhelníky vějířem. Ostatní příkazy se ignorují. Z PLY se
+ * čte element vertex (x, y, z a volitelně nx, ny, nz a u, v) a face
+ * (vertex_indices), podporuje se pouze binární formát. Pokud soubor normály nemá (nebo je nemají všechny
+ * stěny OBJ), dopočítají se paralelně jako průměr normál okolních stěn
+ * vážený jejich obsahem. U OBJ se počítají ještě před rozdělením vrcholů
+ * podle texturových souřadnic, švy textury tak na ploše nejsou vidět.
+ *
+ * Při chybě vyhodí výjimku std::runtime_error.
+ */
+class MeshLoader
+{
+public:
+    /*!
+     * Konstruktor.
+     * \param chunkSize nejmenší velikost bloku OBJ v bajtech, který zpracovává jedno vlákno
+     */
+    MeshLoader(size_t chunkSize = 1 << 20);
+
+    /*!
+     * Načte síť, formát se určí podle přípony souboru (.obj, .ply).
+     * \param path cesta k souboru
+     * \param vertices slouží k návratu vrcholů
+     * \param indices slouží k návratu indexů vrcholů, každá trojice tvoří trojúhelník
+     * \param normals slouží k návratu normál ve vrcholech (stejný počet jako vrcholů)
+     * \param uvs slouží k návratu texturových souřadnic (u, v) vrcholů, prázdné, pokud je soubor nemá
+     */
+    void load(const std::string& path, std::vector<Vector>& vertices, std::vector<int>& indices,
+              std::vector<Vector>& normals, std::vector<Real>& uvs) const;
+
+    /*!
+     * Spočítá normály ve vrcholech jako součet normál stěn vážených jejich
+     * obsahem. Stěny se zpracují paralelně, normály stěn se ale ke každému
+     * vrcholu sčítají v pevném pořadí, výsledek je tedy deterministický.
+     * \param vertices vrcholy
+     * \param indices indexy vrcholů
+     * \param normals slouží k návratu normál
+     */
+    static void generateNormals(const std::vector<Vector>& vertices, const std::vector<int>& indices,
+                                std::vector<Vector>& normals);
+
+private:
+    /*! Načte soubor Wavefront OBJ. */
+    void loadOBJ(const MappedFile& file, const std::string& path, std::vector<Vector>& vertices,
+                 std::vector<int>& indices, std::vector<Vector>& normals, std::vector<Real>& uvs) const;
+
+    /*! Načte binární soubor PLY. */
+    void loadPLY(const MappedFile& file, const std::string& path, std::vector<Vector>& vertices,
+                 std::vector<int>& indices, std::vector<Vector>& normals, std::vector<Real>& uvs) const;
+
+    size_t chunkSize; ///< Nejmenší velikost bloku OBJ.
+};
+
+}
@@ -0,0 +1,715 @@
+#include "importers/xmlsceneimporter.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+#include "acceleration/accelerationcache.h"
+#include "acceleration/instance.h"
+#include "cameras/pinhole.h"
+#include "filters/box.h"
+#include "filters/gaussian.h"
+#include "filters/mitchell.h"
+#include "importers/meshloader.h"
+#include "lights/arealight.h"
+#include "lights/environmentlight.h"
+#include "lights/pointlight.h"
+#include "materials/matte.h"
+#include "textures/image.h"
+#include "shapes/compressedmesh.h"
+#include "shapes/pagedmesh.h"
+#include "shapes/pntrianglesurface.h"
+#include "shapes/subdivisionsurface.h"
+#include "shapes/trianglemesh.h"
+
+using namespace tracer;
+
+namespace
+{
+
+/*!
+ * Přečte z řetězce zadaný počet čísel oddělených bílými znaky.
+ * \return počet přečtených čísel
+ */
+int parseReals(const std::string& s, Real* out, int n)
+{
+    const char* p = s.c_str();
+    int count = 0;
+    while (count < n)
+    {
+        char* end;
+        Real v = strtof(p, &end);
+        if (end == p)
+            break;
+        out[count++] = v;
+        p = end;
+    }
+    while (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')
+        ++p;
+    return *p ? -1 : count;
+}
+
+const std::string& required(const XMLAttributes& attributes, const char* element, const char* name)
+{
+    const std::string* value = attributes.find(name);
+    if (!value)
+        throw std::runtime_error(std::string("Element ") + element + " requires attribute " + name);
+    return *value;
+}
+
+Vector vectorAttribute(const XMLAttributes& attributes, const char* element, const char* name)
+{
+    Real v[3];
+    if (parseReals(required(attributes, element, name), v, 3) != 3)
+        throw std::runtime_error(std::string("Attribute ") + name + " of " + element + " must have 3 numbers");
+    return Vector(v[0], v[1], v[2]);
+}
+
+RGBColor colorAttribute(const XMLAttributes& attributes, const char* element, const char* name)
+{
+    Vector v = vectorAttribute(attributes, element, name);
+    return RGBColor(v.x, v.y, v.z);
+}
+
+Real realAttribute(const XMLAttributes& attributes, const char* element, const char* name)
+{
+    Real v;
+    if (parseReals(required(attributes, element, name), &v, 1) != 1)
+        throw std::runtime_error(std::string("Attribute ") + name + " of " + element + " must be a number");
+    return v;
+}
+
+bool isSpace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+}
+
+XMLSceneImporter::XMLSceneImporter(Scene& scene, BinarySceneWriter* writer)
+    : scene(scene),
+      writer(writer),
+      accelerator("bvh"),
+      geometryCache(new GeometryCache(static_cast<size_t>(1024) << 20)),
+      deduplicate(false),
+      hasCamera(false),
+      fov(45.f),
+      meshEmissive(false),
+      meshFile(false),
+      meshPaged(false),
+      meshLazy(false),
+      meshCompressed(false),
+      meshSmooth(false),
+      meshSubdivide(false),
+      meshDisplacementScale(0.f),
+      meshDicingRate(1.f),
+      content(CONTENT_NONE),
+      tokenLength(0),
+      nCoords(0)
+{ }
+
+XMLSceneImporter::~XMLSceneImporter()
+{ }
+
+void XMLSceneImporter::import(const char* file)
+{
+    std::string path(file);
+    size_t slash = path.find_last_of('/');
+    directory = (slash == std::string::npos) ? std::string() : path.substr(0, slash + 1);
+
+    XMLParser parser(*this);
+    parser.parse(file);
+}
+
+std::string XMLSceneImporter::resolvePath(const std::string& path) const
+{
+    if (path.empty() || path[0] == '/')
+        return path;
+    return directory + path;
+}
+
+/*!
+ * Kontroluje, že se element nachází na povoleném místě dokumentu.
+ */
+void XMLSceneImporter::startElement(const std::string& name, const XMLAttributes& attributes)
+{
+    const std::string parent = elements.empty() ? std::string() : elements.back();
+    elements.push_back(name);
+
+    if (parent.empty())
+    {
+        if (name != "scene")
+            throw std::runtime_error("Root element must be scene, not " + name);
+        startScene(attributes);
+        return;
+    }
+
+    if (parent == "scene")
+    {
+        if (name == "film")
+            startFilm(attributes);
+        else if (name == "camera")
+            startCamera(attributes);
+        else if (name == "material")
+            startMaterial(attributes);
+        else if (name == "light")
+            startLight(attributes);
+        else if (name == "mesh")
+            startMesh(attributes);
+        else if (name == "instance")
+            startInstance(attributes);
+        else if (name == "object")
+        {
+            objectId = required(attributes, "object", "id");
+            if (objects.count(objectId))
+                throw std::runtime_error("Duplicate object " + objectId);
+            objectMeshes.clear();
+        }
+        else
+            throw std::runtime_error("Unknown element " + name + " in scene");
+        return;
+    }
+
+    if (parent == "object" && name == "mesh")
+    {
+        startMesh(attributes);
+        if (meshEmissive)
+            throw std::runtime_error("Meshes of object " + objectId + " cannot be emissive");
+        return;
+    }
+
+    if (parent == "mesh" && (name == "vertices" || name == "indices"))
+    {
+        if (meshFile)
+            throw std::runtime_error("Mesh loaded from a file cannot contain " + name);
+        content = (name == "vertices") ? CONTENT_VERTICES : CONTENT_INDICES;
+        tokenLength = 0;
+        nCoords = 0;
+        return;
+    }
+
+    throw std::runtime_error("Unexpected element " + name + " in " + parent);
+}
+
+void XMLSceneImporter::endElement(const std::string& name)
+{
+    elements.pop_back();
+
+    if (name == "vertices" || name == "indices")
+    {
+        flushToken();
+        if (content == CONTENT_VERTICES && nCoords != 0)
+            throw std::runtime_error("Number of vertex coordinates is not divisible by 3");
+        content = CONTENT_NONE;
+    }
+    else if (name == "mesh")
+        endMesh();
+    else if (name == "object")
+    {
+        if (objectMeshes.empty())
+            throw std::runtime_error("Object " + objectId + " has no meshes");
+        Reference<Primitive> object(AccelerationCache(directory).create("bvh", objectMeshes));
+        objects[objectId] = object;
+        objectMeshes.clear();
+        if (writer)
+            writer->addObject(object);
+    }
+    else if (name == "scene")
+        endScene();
+}
+
+/*!
+ * Čísla se skládají po znacích do pomocného bufferu a převádějí se
+ * na bílých znacích, protože hranice bloku textu může ležet uprostřed čísla.
+ */
+void XMLSceneImporter::characters(const char* data, size_t length)
+{
+    if (content == CONTENT_NONE)
+    {
+        for (size_t i = 0; i < length; ++i)
+            if (!isSpace(data[i]))
+                throw std::runtime_error("Unexpected text in element " + elements.back());
+        return;
+    }
+
+    for (size_t i = 0; i < length; ++i)
+    {
+        const char c = data[i];
+        if (isSpace(c))
+        {
+            flushToken();
+            continue;
+        }
+        if (tokenLength + 1 >= sizeof(token))
+            throw std::runtime_error("Number too long in element " + elements.back());
+        token[tokenLength++] = c;
+    }
+}
+
+void XMLSceneImporter::flushToken()
+{
+    if (tokenLength == 0)
+        return;
+    token[tokenLength] = '\0';
+    tokenLength = 0;
+
+    char* end;
+    if (content == CONTENT_VERTICES)
+    {
+        coords[nCoords++] = strtof(token, &end);
+        if (*end)
+            throw std::runtime_error(std::string("Invalid vertex coordinate ") + token);
+        if (nCoords == 3)
+        {
+            vertices.push_back(Vector(coords[0], coords[1], coords[2]));
+            nCoords = 0;
+        }
+    }
+    else
+    {
+        long index = strtol(token, &end, 10);
+        if (*end || index < 0)
+            throw std::runtime_error(std::string("Invalid vertex index ") + token);
+        indices.push_back(static_cast<int>(index));
+    }
+}
+
+Transform XMLSceneImporter::parseTransform(const XMLAttributes& attributes) const
+{
+    const std::string* matrix = attributes.find("matrix");
+    if (matrix)
+    {
+        Real m[16];
+        if (parseReals(*matrix, m, 16) != 16)
+            throw std::runtime_error("Attribute matrix must have 16 numbers");
+        Real mat[4][4];
+        memcpy(mat, m, sizeof(mat));
+        return Transform(mat);
+    }
+
+    Transform t;
+    if (attributes.find("translate"))
+        t = Transform::translate(vectorAttribute(attributes, "transform", "translate"));
+
+    const std::string* rotate = attributes.find("rotate");
+    if (rotate)
+    {
+        Real r[4];
+        if (parseReals(*rotate, r, 4) != 4)
+            throw std::runtime_error("Attribute rotate must have an angle and an axis");
+        t = t * Transform::rotate(r[0], Vector(r[1], r[2], r[3]));
+    }
+
+    const std::string* scale = attributes.find("scale");
+    if (scale)
+    {
+        Real s[3];
+        int n = parseReals(*scale, s, 3);
+        if (n == 1)
+            s[1] = s[2] = s[0];
+        else if (n != 3)
+            throw std::runtime_error("Attribute scale must have 1 or 3 numbers");
+        t = t * Transform::scale(s[0], s[1], s[2]);
+    }
+
+    return t;
+}
+
+void XMLSceneImporter::startScene(const XMLAttributes& attributes)
+{
+    // Struktura se postaví až na konci, jinak by se aktualizovala po každé síti.
+    if (scene.aggregator)
+        delete scene.aggregator;
+    scene.aggregator = nullptr;
+
+    if (attributes.find("background"))
+        scene.background = colorAttribute(attributes, "scene", "background");
+
+    const std::string* acc = attributes.find("accelerator");
+    if (acc)
+    {
+        if (*acc != "bvh" && *acc != "grid" && *acc != "bruteforce")
+            throw std::runtime_error("Unknown accelerator " + *acc);
+        accelerator = *acc;
+    }
+
+    if (attributes.find("geometryCache"))
+    {
+        const Real megabytes = realAttribute(attributes, "scene", "geometryCache");
+        if (!(megabytes > 0.f))
+            throw std::runtime_error("Invalid geometry cache size");
+        geometryCache->setBudget(static_cast<size_t>(megabytes * (1 << 20)));
+    }
+
+    if (attributes.find("textureCache"))
+    {
+        const Real megabytes = realAttribute(attributes, "scene", "textureCache");
+        if (!(megabytes > 0.f))
+            throw std::runtime_error("Invalid texture cache size");
+        TextureCache::shared()->setBudget(static_cast<size_t>(megabytes * (1 << 20)));
+        if (writer)
+            writer->setTextureCache(static_cast<size_t>(megabytes * (1 << 20)));
+    }
+
+    const std::string* dedup = attributes.find("deduplicate");
+    deduplicate = dedup && *dedup != "false";
+
+    if (writer)
+    {
+        writer->setBackground(scene.background);
+        writer->setAccelerator(accelerator);
+    }
+}
+
+void XMLSceneImporter::startFilm(const XMLAttributes& attributes)
+{
+    if (scene.film)
+        throw std::runtime_error("Scene already has a film");
+
+    const int width = static_cast<int>(realAttribute(attributes, "film", "width"));
+    const int height = static_cast<int>(realAttribute(attributes, "film", "height"));
+    if (width <= 0 || height <= 0)
+        throw std::runtime_error("Invalid film resolution");
+
+    Real gamma = 1.f;
+    if (attributes.find("gamma"))
+        gamma = realAttribute(attributes, "film", "gamma");
+    if (gamma <= 0.f)
+        throw std::runtime_error("Invalid film gamma");
+
+    Filter* filter = nullptr;
+    const std::string* type = attributes.find("filter");
+    if (!type || *type == "box")
+        filter = new BoxFilter();
+    else if (*type == "gaussian")
+        filter = new GaussianFilter();
+    else if (*type == "mitchell")
+        filter = new MitchellFilter();
+    else
+        throw std::runtime_error("Unknown filter " + *type);
+
+    scene.film = new Film(width, height, 1.f, gamma, 1.f / gamma, filter);
+    if (writer)
+        writer->setFilm(width, height, gamma, type ? *type : std::string("box"));
+}
+
+void XMLSceneImporter::startCamera(const XMLAttributes& attributes)
+{
+    const std::string* type = attributes.find("type");
+    if (type && *type != "pinhole")
+        throw std::runtime_error("Unknown camera " + *type);
+
+    eye = vectorAttribute(attributes, "camera", "eye");
+    target = vectorAttribute(attributes, "camera", "target");
+    up = attributes.find("up") ? vectorAttribute(attributes, "camera", "up") : Vector(0.f, 1.f, 0.f);
+    fov = attributes.find("fov") ? realAttribute(attributes, "camera", "fov") : 45.f;
+    if (!(fov > 0.f && fov < 180.f))
+        throw std::runtime_error("Invalid camera field of view");
+    hasCamera = true;
+}
+
+void XMLSceneImporter::startMaterial(const XMLAttributes& attributes)
+{
+    const std::string& id = required(attributes, "material", "id");
+    if (materials.count(id))
+        throw std::runtime_error("Duplicate material " + id);
+
+    const std::string* type = attributes.find("type");
+    if (type && *type != "matte")
+        throw std::runtime_error("Unknown material " + *type);
+
+    const std::string* file = attributes.find("texture");
+    if (!file)
+    {
+        const RGBColor color = colorAttribute(attributes, "material", "color");
+        Reference<Material> material(new MatteMaterial(color));
+        materials[id] = material;
+        if (writer)
+            writer->addMaterial(material, color);
+        return;
+    }
+
+    const RGBColor color = attributes.find("color") ? colorAttribute(attributes, "material", "color") : WHITE;
+    const std::string path = resolvePath(*file);
+    Reference<Material> material(new MatteMaterial(color, texture(path)));
+    materials[id] = material;
+    if (writer)
+        writer->addMaterial(material, color, path);
+}
+
+Reference<Texture> XMLSceneImporter::texture(const std::string& path)
+{
+    std::unordered_map<std::string, Reference<Texture>>::iterator it = textures.find(path);
+    if (it == textures.end())
+        it = textures.insert(std::make_pair(path, Reference<Texture>(new ImageTexture(path)))).first;
+    return it->second;
+}
+
+void XMLSceneImporter::startLight(const XMLAttributes& attributes)
+{
+    const std::string& type = required(attributes, "light", "type");
+    if (type == "point")
+    {
+        const Vector position = vectorAttribute(attributes, "light", "position");
+        const RGBColor intensity = colorAttribute(attributes, "light", "intensity");
+        scene.lights.push_back(new PointLight(position, intensity));
+        if (writer)
+            writer->addPointLight(position, intensity);
+    }
+    else if (type == "environment")
+    {
+        RGBColor scale = attributes.find("scale") ? colorAttribute(attributes, "light", "scale") : WHITE;
+        std::string file = resolvePath(required(attributes, "light", "file"));
+        scene.lights.push_back(new EnvironmentLight(file.c_str(), scale));
+        if (writer)
+            writer->addEnvironmentLight(file, scale);
+    }
+    else
+        throw std::runtime_error("Unknown light " + type);
+}
+
+void XMLSceneImporter::startMesh(const XMLAttributes& attributes)
+{
+    const std::string& id = required(attributes, "mesh", "material");
+    std::unordered_map<std::string, Reference<Material>>::const_iterator it = materials.find(id);
+    if (it == materials.end())
+        throw std::runtime_error("Unknown material " + id);
+
+    meshMaterial = it->second;
+    meshEmissive = attributes.find("emission") != nullptr;
+    if (meshEmissive)
+        meshEmission = colorAttribute(attributes, "mesh", "emission");
+    meshTransform = parseTransform(attributes);
+    vertices.clear();
+    indices.clear();
+    normals.clear();
+    uvs.clear();
+
+    const std::string* file = attributes.find("file");
+    meshFile = file != nullptr;
+    const std::string* paged = attributes.find("paged");
+    meshPaged = paged && *paged != "false";
+    const std::string* lazy = attributes.find("lazy");
+    meshLazy = lazy && *lazy != "false";
+    if (meshLazy)
+    {
+        if (meshPaged)
+            throw std::runtime_error("Paged mesh is always loaded on demand, attribute lazy is not allowed");
+        if (writer)
+            writer->setUnsupported("Lazily refined meshes cannot be stored in the binary scene");
+    }
+    const std::string* compressed = attributes.find("compressed");
+    meshCompressed = compressed && *compressed != "false";
+    if (meshCompressed)
+    {
+        if (meshPaged || meshLazy)
+            throw std::runtime_error("Compressed mesh cannot be paged or lazy");
+        if (meshEmissive)
+            throw std::runtime_error("Compressed mesh cannot be emissive");
+        if (writer)
+            writer->setUnsupported("Compressed meshes cannot be stored in the binary scene");
+    }
+    const std::string* smooth = attributes.find("smooth");
+    meshSmooth = smooth && *smooth != "false";
+    const std::string* subdivide = attributes.find("subdivide");
+    meshSubdivide = subdivide && *subdivide != "false";
+    const std::string* displacement = attributes.find("displacement");
+    if (meshSmooth && meshSubdivide)
+        throw std::runtime_error("Mesh cannot be both smooth and subdivide");
+    if (meshSmooth || meshSubdivide)
+    {
+        if (meshPaged || meshLazy || meshCompressed)
+            throw std::runtime_error("Smooth surface cannot be paged, lazy or compressed");
+        if (meshEmissive)
+            throw std::runtime_error("Smooth surface cannot be emissive");
+        if (elements.size() >= 2 && elements[elements.size() - 2] == "object")
+            throw std::runtime_error("Smooth surface cannot be part of an object");
+        if (displacement)
+        {
+            meshDisplacement = texture(resolvePath(*displacement));
+            meshDisplacementScale = attributes.find("displacementScale") ?
+                                    realAttribute(attributes, "mesh", "displacementScale") : 1.f;
+        }
+        meshDicingRate = attributes.find("dicingRate") ? realAttribute(attributes, "mesh", "dicingRate") : 1.f;
+        if (!(meshDicingRate > 0.f))
+            throw std::runtime_error("Attribute dicingRate must be positive");
+        if (writer)
+            writer->setUnsupported("Smooth surfaces cannot be stored in the binary scene");
+    }
+    else if (displacement)
+        throw std::runtime_error("Attribute displacement requires smooth or subdivide");
+    if (meshPaged)
+    {
+        if (!file)
+            throw std::runtime_error("Paged mesh requires attribute file");
+        if (meshEmissive)
+            throw std::runtime_error("Paged mesh cannot be emissive");
+        pagedMesh = PagedMesh::create(meshMaterial, resolvePath(*file), meshTransform, geometryCache);
+        if (writer)
+            writer->setUnsupported("Paged meshes cannot be stored in the binary scene");
+    }
+    else if (meshFile)
+    {
+        const std::string path = resolvePath(*file);
+        MeshLoader().load(path, vertices, indices, normals, uvs);
+        if (writer)
+            writer->addDependency(path);
+    }
+}
+
+void XMLSceneImporter::endMesh()
+{
+    if (meshPaged)
+    {
+        if (elements.back() == "object")
+            objectMeshes.push_back(pagedMesh);
+        else
+            scene.addObject(pagedMesh);
+        pagedMesh.unset();
+        meshPaged = false;
+        return;
+    }
+
+    if (indices.empty() || indices.size() % 3 != 0)
+        throw std::runtime_error("Mesh indices must form triangles");
+    for (size_t i = 0; i < indices.size(); ++i)
+        if (static_cast<size_t>(indices[i]) >= vertices.size())
+            throw std::runtime_error("Mesh index out of range");
+
+    Reference<TriangleMesh> mesh(new TriangleMesh(meshMaterial, std::move(vertices), std::move(indices),
+                                                  std::move(normals), std::move(uvs)));
+    if (!meshTransform.isIdentity())
+        mesh->setTransform(meshTransform);
+    mesh->setRefineOnDemand(meshLazy);
+
+    vertices = std::vector<Vector>();
+    indices = std::vector<int>();
+    normals = std::vector<Vector>();
+    uvs = std::vector<Real>();
+
+    const bool shared = elements.back() == "object";
+    if (meshSmooth || meshSubdivide)
+    {
+        DicedSurface* surface;
+        if (meshSubdivide)
+            surface = new SubdivisionSurface(mesh, geometryCache, meshDisplacement, meshDisplacementScale,
+                                             meshDicingRate);
+        else
+            surface = new PNTriangleSurface(mesh, geometryCache, meshDisplacement, meshDisplacementScale,
+                                            meshDicingRate);
+        scene.addObject(Reference<Primitive>(surface));
+        smoothSurfaces.push_back(surface);
+        meshDisplacement.unset();
+        return;
+    }
+
+    if (meshCompressed)
+    {
+        Reference<Primitive> compressed(new CompressedMesh(mesh));
+        if (shared)
+            objectMeshes.push_back(compressed);
+        else
+            scene.addObject(compressed);
+        return;
+    }
+
+    if (deduplicate && !shared && !meshEmissive && !meshLazy)
+    {
+        DeduplicatedMesh entry;
+        entry.prototype = deduplicator.add(mesh, entry.transform);
+        deduplicated.push_back(entry);
+        return;
+    }
+
+    if (writer)
+        writer->addMesh(mesh, meshEmissive, meshEmission, shared);
+
+    if (shared)
+    {
+        objectMeshes.push_back(Reference<Primitive>(&*mesh));
+        return;
+    }
+
+    if (meshEmissive)
+        scene.lights.push_back(new AreaLight(mesh, meshEmission));
+    scene.addObject(Reference<Primitive>(&*mesh));
+}
+
+void XMLSceneImporter::startInstance(const XMLAttributes& attributes)
+{
+    const std::string& id = required(attributes, "instance", "object");
+    std::unordered_map<std::string, Reference<Primitive>>::const_iterator it = objects.find(id);
+    if (it == objects.end())
+        throw std::runtime_error("Unknown object " + id);
+
+    const Transform transform = parseTransform(attributes);
+    Reference<Primitive> instance(new Instance(it->second, transform));
+    scene.addObject(instance);
+    if (writer)
+        writer->addInstance(instance, it->second, transform);
+}
+
+void XMLSceneImporter::addDeduplicatedMeshes()
+{
+    std::unordered_map<size_t, Reference<Primitive>> shared;
+    for (size_t i = 0; i < deduplicated.size(); ++i)
+    {
+        const size_t p = deduplicated[i].prototype;
+        Reference<TriangleMesh> mesh = deduplicator.prototype(p);
+        if (deduplicator.uses(p) == 1)
+        {
+            if (writer)
+                writer->addMesh(mesh, false, BLACK, false);
+            scene.addObject(Reference<Primitive>(&*mesh));
+            continue;
+        }
+
+        std::unordered_map<size_t, Reference<Primitive>>::iterator it = shared.find(p);
+        if (it == shared.end())
+        {
+            if (writer)
+                writer->addMesh(mesh, false, BLACK, true);
+            std::vector<Reference<Primitive>> meshes(1, Reference<Primitive>(&*mesh));
+            Reference<Primitive> object(AccelerationCache(directory).create("bvh", meshes));
+            it = shared.insert(std::make_pair(p, object)).first;
+            if (writer)
+                writer->addObject(it->second);
+        }
+
+        const Transform& transform = deduplicated[i].transform;
+        Reference<Primitive> instance(new Instance(it->second, transform));
+        scene.addObject(instance);
+        if (writer)
+            writer->addInstance(instance, it->second, transform);
+    }
+    deduplicated.clear();
+}
+
+void XMLSceneImporter::endScene()
+{
+    addDeduplicatedMeshes();
+    if (writer)
+        writer->setDeduplicationReport(deduplicator.report());
+
+    if (hasCamera)
+    {
+        if (!scene.film)
+            throw std::runtime_error("Camera requires a film");
+        if (scene.camera)
+            delete scene.camera;
+        PinholeCamera* camera = new PinholeCamera(eye, target, up, fov, scene.film->width, scene.film->height);
+        scene.camera = camera;
+        if (writer)
+            writer->setCamera(eye, target, up, fov);
+        for (size_t i = 0; i < smoothSurfaces.size(); ++i)
+            smoothSurfaces[i]->setDicingCamera(eye, camera->pixelSpread());
+    }
+    smoothSurfaces.clear();
+
+    std::vector<Reference<Primitive>> prims;
+    scene.primitives(prims);
+    if (prims.empty())
+        throw std::runtime_error("Scene has no geometry");
+
+    scene.aggregator = AccelerationCache(directory).create(accelerator, prims);
+}
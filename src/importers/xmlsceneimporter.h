@@ -0,0 +1,255 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "core/scene.h"
+#include "core/texture.h"
+#include "core/transform.h"
+#include "core/xmlparser.h"
+#include "importers/binaryscene.h"
+#include "importers/meshdeduplicator.h"
+#include "shapes/pagedmesh.h"
+
+namespace tracer
+{
+
+class DicedSurface;
+
+/*!
+ * Načítá scénu ze souboru XML. Soubor se zpracovává proudově (XMLParser),
+ * souřadnice vrcholů a indexy se převádějí přímo z textu do polí sítě,
+ * takže se v paměti nikdy nedrží celý dokument ani jeho strom.
+ *
+ * Formát souboru:
+ * \code
+ * <scene background="0 0 0" accelerator="bvh" geometryCache="1024" textureCache="512"
+ *        deduplicate="true">  <!-- bvh, grid, bruteforce; MB -->
+ *   <film width="640" height="480" gamma="2.2" filter="mitchell"/>  <!-- box, gaussian -->
+ *   <camera eye="0 1 5" target="0 0 0" up="0 1 0" fov="45"/>
+ *   <material id="red" type="matte" color="0.8 0.1 0.1"/>
+ *   <material id="wood" texture="wood.pfm" color="1 1 1"/>
+ *   <light type="point" position="0 5 0" intensity="10 10 10"/>
+ *   <light type="environment" file="sky.pfm" scale="1 1 1"/>
+ *   <mesh material="red" emission="5 5 5" translate="0 1 0">
+ *     <vertices>x y z x y z ...</vertices>
+ *     <indices>0 1 2 ...</indices>
+ *   </mesh>
+ *   <mesh material="red" file="bunny.obj"/>          <!-- .obj, .ply -->
+ *   <mesh material="red" file="city.ply" paged="true"/>
+ *   <mesh material="red" file="forest.obj" lazy="true"/>
+ *   <mesh material="red" file="statue.ply" compressed="true"/>
+ *   <mesh material="red" file="head.obj" smooth="true" displacement="skin.pfm"
+ *         displacementScale="0.01" dicingRate="1"/>
+ *   <mesh material="red" file="cage.obj" subdivide="true" dicingRate="1"/>
+ *   <object id="tree">                               <!-- sdílená geometrie -->
+ *     <mesh material="red">...</mesh>
+ *   </object>
+ *   <instance object="tree" translate="1 0 0" rotate="90 0 1 0" scale="2"/>
+ * </scene>
+ * \endcode
+ *
+ * Transformaci lze u elementů mesh a instance zadat atributy translate,
+ * rotate (úhel ve stupních a osa) a scale (jedno nebo tři čísla), které se
+ * skládají v pořadí posunutí * otočení * měřítko, nebo atributem matrix
+ * s 16 čísly matice po řádcích. Atribut emission z mesh udělá plošné světlo.
+ * Síť s atributem file se načte ze souboru OBJ nebo PLY (MeshLoader) a nesmí
+ * obsahovat elementy vertices a indices. S atributem paged se síť načítá
+ * po blocích až při výpočtu průsečíků (PagedMesh) do cache, jejíž velikost
+ * v MB určuje atribut geometryCache elementu scene (výchozí 1024). Scéna se
+ * stránkovanými sítěmi se neukládá do binárního souboru. S atributem lazy
+ * se síť rozloží a dostane vlastní BVH až při prvním průsečíku s jejím
+ * obalovým kvádrem (LazyPrimitive), scéna s takovými sítěmi se také
+ * neukládá do binárního souboru. S atributem compressed se síť uloží
+ * s kvantovanými vrcholy a vlastní hierarchií s 8bitovými kvádry
+ * (CompressedMesh), nesmí být plošným světlem a scéna s ní se také
+ * neukládá do binárního souboru. S atributem smooth je síť řídicí sítí
+ * hladké plochy z PN trojúhelníků (PNTriangleSurface), s atributem
+ * subdivide řídicí sítí limitní plochy Loopova dělení
+ * (SubdivisionSurface). Záplaty obou ploch se dělí až při průsečíku do
+ * stejné cache jako bloky stránkovaných sítí. Hustotu dělení určuje
+ * kamera scény a atribut dicingRate (délka dílčí hrany v pixelech, výchozí
+ * 1), atribut displacement obrázek PFM, podle kterého se plocha posune
+ * podél normály o nejvýše displacementScale (výchozí 1). Plocha nesmí být
+ * plošným světlem ani součástí objektu a scéna s ní se neukládá do
+ * binárního souboru.
+ * Atribut texture materiálu určuje obrázek PFM (ImageTexture), kterým se
+ * násobí barva, ta je pak nepovinná. Stejný obrázek v několika materiálech
+ * je jedna textura. Dlaždice textur se načítají do sdílené TextureCache,
+ * jejíž velikost v MB určuje atribut textureCache elementu scene (výchozí
+ * 512). Texturové souřadnice mají jen sítě načtené ze souboru.
+ * S atributem deduplicate elementu scene se sítě, které jsou posunutou nebo
+ * otočenou kopií dříve načtené sítě (MeshDeduplicator), nahradí instancemi
+ * jedné sdílené sítě. Týká se jen sítí přímo ve scéně, které nejsou
+ * plošným světlem, stránkované, komprimované, dělené ani rozkládané až při průsečíku. Ušetřenou
+ * paměť vrací deduplicationReport(), Scene::build() ho ukládá do
+ * Scene::deduplication.
+ * Objekty (object) se nevkládají do scény přímo, ale pouze přes instance,
+ * všechny instance sdílí jednu BVH objektu. Kamera je dírková a používá
+ * rozlišení filmu. Relativní cesty k souborům jsou vztaženy k adresáři
+ * souboru scény. Akcelerační struktury scény i objektů se vytváří přes
+ * AccelerationCache se soubory v adresáři scény.
+ *
+ * Při chybě vyhodí výjimku std::runtime_error.
+ */
+class XMLSceneImporter : public XMLHandler
+{
+public:
+    /*!
+     * Konstruktor.
+     * \param scene scéna, do které se načítá
+     * \param writer pokud není nullptr, popisuje se mu načtená scéna pro
+     *               zápis do binárního souboru
+     */
+    XMLSceneImporter(Scene& scene, BinarySceneWriter* writer = nullptr);
+
+    virtual ~XMLSceneImporter();
+
+    /*!
+     * Načte soubor do scény. Na konci postaví akcelerační strukturu nad
+     * všemi tělesy scény, Scene::preprocess() už ale nevolá.
+     * \param file cesta k souboru
+     */
+    void import(const char* file);
+
+    /*!
+     * \return přehled sítí nahrazených instancemi (s atributem deduplicate)
+     */
+    const DeduplicationReport& deduplicationReport() const
+    { return deduplicator.report(); }
+
+    /*! \copydoc XMLHandler::startElement() */
+    virtual void startElement(const std::string& name, const XMLAttributes& attributes) override;
+
+    /*! \copydoc XMLHandler::endElement() */
+    virtual void endElement(const std::string& name) override;
+
+    /*! \copydoc XMLHandler::characters() */
+    virtual void characters(const char* data, size_t length) override;
+
+private:
+    /*!
+     * Co se právě čte z textového obsahu.
+     */
+    enum Content
+    {
+        CONTENT_NONE, ///< text se ignoruje (smí obsahovat jen bílé znaky)
+        CONTENT_VERTICES, ///< souřadnice vrcholů
+        CONTENT_INDICES ///< indexy vrcholů
+    };
+
+    /*! Zpracuje element scene. */
+    void startScene(const XMLAttributes& attributes);
+
+    /*! Vytvoří film scény. */
+    void startFilm(const XMLAttributes& attributes);
+
+    /*! Uloží parametry kamery, ta se vytvoří až na konci scény. */
+    void startCamera(const XMLAttributes& attributes);
+
+    /*! Vytvoří pojmenovaný materiál. */
+    void startMaterial(const XMLAttributes& attributes);
+
+    /*!
+     * Vrátí texturu obrázku, stejný obrázek se načte jen jednou.
+     * \param path cesta k obrázku
+     */
+    Reference<Texture> texture(const std::string& path);
+
+    /*! Vytvoří bodové světlo nebo světlo okolí. */
+    void startLight(const XMLAttributes& attributes);
+
+    /*! Připraví čtení sítě. */
+    void startMesh(const XMLAttributes& attributes);
+
+    /*! Vloží do scény instanci objektu. */
+    void startInstance(const XMLAttributes& attributes);
+
+    /*! Vytvoří přečtenou síť a vloží ji do scény nebo do objektu. */
+    void endMesh();
+
+    /*!
+     * Vloží do scény sítě odložené kvůli slučování, sdílené sítě jako
+     * instance jejich objektu.
+     */
+    void addDeduplicatedMeshes();
+
+    /*! Vytvoří kameru a akcelerační strukturu. */
+    void endScene();
+
+    /*!
+     * Zpracuje jedno číslo z textového obsahu (uloženo v token).
+     */
+    void flushToken();
+
+    /*!
+     * Sestaví transformaci z atributů translate, rotate, scale nebo matrix.
+     * \param attributes atributy elementu
+     */
+    Transform parseTransform(const XMLAttributes& attributes) const;
+
+    /*!
+     * Vrátí cestu vztaženou k adresáři souboru scény.
+     * \param path cesta ze souboru
+     */
+    std::string resolvePath(const std::string& path) const;
+
+    Scene& scene; ///< Načítaná scéna.
+    BinarySceneWriter* writer; ///< Zápis binárního souboru scény, může být nullptr.
+    std::string directory; ///< Adresář souboru scény.
+    std::vector<std::string> elements; ///< Otevřené elementy.
+    std::unordered_map<std::string, Reference<Material>> materials; ///< Pojmenované materiály.
+    std::unordered_map<std::string, Reference<Texture>> textures; ///< Textury podle cesty k obrázku.
+    std::unordered_map<std::string, Reference<Primitive>> objects; ///< Sdílené objekty pro instance.
+    std::string accelerator; ///< Typ akcelerační struktury.
+    Reference<GeometryCache> geometryCache; ///< Cache bloků stránkovaných sítí a záplat ploch.
+    std::vector<DicedSurface*> smoothSurfaces; ///< Plochy scény čekající na kameru pro dělení.
+
+    /*!
+     * Síť odložená kvůli slučování.
+     */
+    struct DeduplicatedMesh
+    {
+        size_t prototype; ///< Index vzoru v MeshDeduplicator.
+        Transform transform; ///< Transformace vzoru na síť.
+    };
+
+    bool deduplicate; ///< Jestli se mají slučovat kopie sítí.
+    MeshDeduplicator deduplicator; ///< Hledání kopií sítí.
+    std::vector<DeduplicatedMesh> deduplicated; ///< Odložené sítě v pořadí načtení.
+
+    bool hasCamera; ///< Jestli soubor obsahuje kameru.
+    Vector eye, target, up; ///< Parametry kamery.
+    Real fov; ///< Zorný úhel kamery.
+
+    std::string objectId; ///< Identifikátor právě čteného objektu.
+    std::vector<Reference<Primitive>> objectMeshes; ///< Sítě právě čteného objektu.
+
+    Reference<Material> meshMaterial; ///< Materiál právě čtené sítě.
+    bool meshEmissive; ///< Jestli je síť plošným světlem.
+    bool meshFile; ///< Jestli se síť načetla ze souboru.
+    bool meshPaged; ///< Jestli je síť stránkovaná.
+    bool meshLazy; ///< Jestli se má síť rozložit až při prvním průsečíku.
+    bool meshCompressed; ///< Jestli se má síť uložit komprimovaně.
+    bool meshSmooth; ///< Jestli je síť řídicí sítí plochy PNTriangleSurface.
+    bool meshSubdivide; ///< Jestli je síť řídicí sítí plochy SubdivisionSurface.
+    Reference<Texture> meshDisplacement; ///< Výšková textura plochy.
+    Real meshDisplacementScale; ///< Posunutí plochy pro výšku 1.
+    Real meshDicingRate; ///< Požadovaná délka dílčí hrany plochy v pixelech.
+    Reference<Primitive> pagedMesh; ///< Právě čtená stránkovaná síť.
+    RGBColor meshEmission; ///< Vyzařování sítě.
+    Transform meshTransform; ///< Transformace sítě.
+    std::vector<Vector> vertices; ///< Vrcholy právě čtené sítě.
+    std::vector<int> indices; ///< Indexy právě čtené sítě.
+    std::vector<Vector> normals; ///< Normály ve vrcholech právě čtené sítě (jen ze souboru).
+    std::vector<Real> uvs; ///< Texturové souřadnice právě čtené sítě (jen ze souboru).
+
+    Content content; ///< Co se čte z textového obsahu.
+    char token[64]; ///< Rozpracované číslo z textu (může přesahovat hranici bloku).
+    size_t tokenLength; ///< Délka rozpracovaného čísla.
+    Real coords[3]; ///< Rozpracovaný vrchol.
+    int nCoords; ///< Počet přečtených souřadnic rozpracovaného vrcholu.
+};
+
+}
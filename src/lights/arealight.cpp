@@ -0,0 +1,83 @@
+#include "lights/arealight.h"
+
+using namespace tracer;
+
+AreaLight::AreaLight(const Reference<TriangleMesh>& mesh, const RGBColor& le)
+    : mesh(mesh),
+      le(le)
+{
+    build();
+}
+
+AreaLight::~AreaLight()
+{ }
+
+void AreaLight::preprocess(const Scene& scene)
+{
+    build();
+}
+
+void AreaLight::build()
+{
+    center = Vector();
+    const size_t n = this->mesh->numTriangles();
+    std::vector<Real> areas(n);
+    for (size_t i = 0; i < n; ++i)
+    {
+        areas[i] = this->mesh->area(i);
+        const Vector& p0 = this->mesh->vertex(i, 0);
+        center += areas[i] * (p0 + this->mesh->vertex(i, 1) + this->mesh->vertex(i, 2)) / 3.f;
+    }
+
+    triangles.build(areas);
+    if (triangles.sum() > 0.f)
+        center /= triangles.sum();
+}
+
+Vector AreaLight::direction(const Intersection& inter) const
+{
+    Vector d = center - inter.hitPoint;
+    return d.normalize();
+}
+
+RGBColor AreaLight::l(const Intersection& inter) const
+{
+    return le;
+}
+
+/*!
+ * Trojúhelník je vybrán s pravděpodobností A_i / A a bod na něm s hustotou
+ * 1 / A_i, hustota vzhledem k ploše je tedy 1 / A. Ta se převede na hustotu
+ * vzhledem k prostorovému úhlu.
+ */
+RGBColor AreaLight::sampleL(const Intersection& inter, const LightSample& sample,
+                            Vector& wi, Real& pdf, Ray& shadowRay) const
+{
+    pdf = 0.f;
+    if (triangles.size() == 0 || triangles.sum() <= 0.f)
+        return BLACK;
+
+    size_t tri = triangles.sample(sample.uComponent);
+    Vector n;
+    Vector p = mesh->sample(tri, sample.uPos[0], sample.uPos[1], n);
+
+    wi = p - inter.hitPoint;
+    Real dist2 = wi.squarredLenght();
+    if (dist2 == 0.f)
+        return BLACK;
+    Real dist = std::sqrt(dist2);
+    wi /= dist;
+
+    Real cosLight = -dot(n, wi);
+    if (cosLight <= 0.f)
+        return BLACK;
+
+    pdf = dist2 / (cosLight * triangles.sum());
+    shadowRay = Ray(inter.hitPoint, wi, EPSILON, dist * (1.f - EPSILON));
+    return le;
+}
+
+Real AreaLight::power() const
+{
+    return le.luminance() * triangles.sum() * static_cast<Real>(M_PI);
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "core/light.h"
+#include "core/distribution.h"
+#include "shapes/trianglemesh.h"
+
+namespace tracer
+{
+
+/*!
+ * Plošné světlo tvořené sítí trojúhelníků, která rovnoměrně vyzařuje
+ * do poloprostoru ve směru své normály. Trojúhelníky se vybírají úměrně
+ * své ploše pomocí tabulky aliasů, vzorkování tak trvá stejně dlouho
+ * bez ohledu na jemnost sítě.
+ */
+class AreaLight : public Light
+{
+public:
+    AreaLight() = delete;
+
+    /*!
+     * Konstruktor. Sestaví tabulku aliasů nad plochami trojúhelníků.
+     * \param mesh vyzařující síť
+     * \param le vyzařovaná radiance
+     */
+    AreaLight(const Reference<TriangleMesh>& mesh, const RGBColor& le);
+
+    virtual ~AreaLight();
+
+    /*!
+     * Směr k těžišti sítě.
+     * \copydoc Light::direction()
+     */
+    virtual Vector direction(const Intersection& inter) const override;
+
+    /*! \copydoc Light::l() */
+    virtual RGBColor l(const Intersection& inter) const override;
+
+    /*! \copydoc Light::sampleL() */
+    virtual RGBColor sampleL(const Intersection& inter, const LightSample& sample,
+                             Vector& wi, Real& pdf, Ray& shadowRay) const override;
+
+    /*!
+     * Výkon odpovídá součinu jasu radiance, plochy a PI.
+     * \return výkon světla
+     */
+    virtual Real power() const override;
+
+    /*!
+     * Znovu spočítá plochy trojúhelníků a těžiště, síť se mohla přesunout
+     * (Scene::setTransform()) nebo deformovat.
+     * \copydoc Light::preprocess()
+     */
+    virtual void preprocess(const Scene& scene) override;
+
+    /*!
+     * \return celková plocha sítě
+     */
+    Real area() const
+    { return triangles.sum(); }
+
+private:
+    /*!
+     * Sestaví tabulku aliasů nad plochami trojúhelníků a spočítá těžiště.
+     */
+    void build();
+
+    mutable Reference<TriangleMesh> mesh; ///< Vyzařující síť.
+    RGBColor le; ///< Vyzařovaná radiance.
+    Vector center; ///< Těžiště sítě.
+    AliasTable triangles; ///< Rozdělení pravděpodobnosti výběru trojúhelníků podle plochy.
+};
+
+}
@@ -0,0 +1,140 @@
+#include "lights/environmentlight.h"
+
+#include "core/imageio.h"
+#include "core/parallel.h"
+#include "core/scene.h"
+
+using namespace tracer;
+
+EnvironmentLight::EnvironmentLight(const char* file, const RGBColor& scale)
+    : scale(scale),
+      worldRadius(1.f),
+      distribution(nullptr)
+{
+    pixels = readPFM(file, width, height);
+    buildDistribution();
+}
+
+EnvironmentLight::EnvironmentLight(const std::vector<RGBColor>& pixels, int width, int height,
+                                   const RGBColor& scale)
+    : pixels(pixels),
+      width(width),
+      height(height),
+      scale(scale),
+      worldRadius(1.f),
+      distribution(nullptr)
+{
+    buildDistribution();
+}
+
+EnvironmentLight::~EnvironmentLight()
+{
+    if (distribution)
+        delete distribution;
+}
+
+void EnvironmentLight::buildDistribution()
+{
+    std::vector<Real> func(pixels.size());
+    parallelFor(static_cast<size_t>(height), [&](size_t y)
+    {
+        Real sinTheta = std::sin(static_cast<Real>(M_PI) * (y + 0.5f) / height);
+        const RGBColor* row = &pixels[y * width];
+        Real* out = &func[y * width];
+        for (int x = 0; x < width; ++x)
+            out[x] = row[x].luminance() * sinTheta;
+    }, 16);
+
+    distribution = new Distribution2D(&func[0], width, height);
+}
+
+RGBColor EnvironmentLight::lookup(Real u, Real v) const
+{
+    int x = clamp(static_cast<int>(u * width), 0, width - 1);
+    int y = clamp(static_cast<int>(v * height), 0, height - 1);
+    return scale * pixels[y * width + x];
+}
+
+Vector EnvironmentLight::direction(const Intersection& inter) const
+{
+    return inter.normal;
+}
+
+RGBColor EnvironmentLight::l(const Intersection& inter) const
+{
+    return le(Ray(inter.hitPoint, inter.normal));
+}
+
+/*!
+ * Vzorek (u, v) z rozdělení se převede na sférické souřadnice
+ * theta = v * PI a phi = u * 2 * PI. Hustota se převádí z plochy obrázku
+ * na prostorový úhel dělením 2 * PI^2 * sin(theta).
+ */
+RGBColor EnvironmentLight::sampleL(const Intersection& inter, const LightSample& sample,
+                                   Vector& wi, Real& pdf, Ray& shadowRay) const
+{
+    Real uv[2], mapPdf;
+    distribution->sampleContinuous(sample.uPos[0], sample.uPos[1], uv, &mapPdf);
+
+    Real theta = uv[1] * static_cast<Real>(M_PI);
+    Real phi = uv[0] * 2.f * static_cast<Real>(M_PI);
+    Real sinTheta = std::sin(theta);
+
+    pdf = 0.f;
+    if (mapPdf == 0.f || sinTheta == 0.f)
+        return BLACK;
+
+    wi = Vector(sinTheta * std::cos(phi), std::cos(theta), sinTheta * std::sin(phi));
+    pdf = mapPdf / (2.f * static_cast<Real>(M_PI * M_PI) * sinTheta);
+    shadowRay = Ray(inter.hitPoint, wi, EPSILON);
+
+    return lookup(uv[0], uv[1]);
+}
+
+Real EnvironmentLight::pdf(const Vector& w) const
+{
+    Real theta = std::acos(clamp(w.y, -1.f, 1.f));
+    Real phi = std::atan2(w.z, w.x);
+    if (phi < 0.f)
+        phi += 2.f * static_cast<Real>(M_PI);
+
+    Real sinTheta = std::sin(theta);
+    if (sinTheta == 0.f)
+        return 0.f;
+
+    Real u = phi / (2.f * static_cast<Real>(M_PI));
+    Real v = theta / static_cast<Real>(M_PI);
+    return distribution->pdf(u, v) / (2.f * static_cast<Real>(M_PI * M_PI) * sinTheta);
+}
+
+Real EnvironmentLight::power() const
+{
+    Real sum = 0.f;
+    for (size_t i = 0; i < pixels.size(); ++i)
+        sum += pixels[i].luminance();
+
+    Real avg = pixels.empty() ? 0.f : sum / pixels.size();
+    return static_cast<Real>(M_PI) * worldRadius * worldRadius * avg * scale.luminance();
+}
+
+RGBColor EnvironmentLight::le(const Ray& ray) const
+{
+    Vector d = ray.d;
+    d.normalize();
+
+    Real theta = std::acos(clamp(d.y, -1.f, 1.f));
+    Real phi = std::atan2(d.z, d.x);
+    if (phi < 0.f)
+        phi += 2.f * static_cast<Real>(M_PI);
+
+    return lookup(phi / (2.f * static_cast<Real>(M_PI)), theta / static_cast<Real>(M_PI));
+}
+
+void EnvironmentLight::preprocess(const Scene& scene)
+{
+    if (!scene.aggregator)
+        return;
+
+    BBox b = scene.bounds();
+    worldRadius = 0.5f * b.diagonal().length();
+}
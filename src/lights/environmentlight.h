@@ -0,0 +1,102 @@
+#pragma once
+
+#include <vector>
+
+#include "core/light.h"
+#include "core/distribution.h"
+
+namespace tracer
+{
+
+/*!
+ * Světlo v nekonečnu, jehož radiance je dána HDR obrázkem v projekci
+ * lat-long (zeměpisná délka a šířka). Osa y míří vzhůru. Směry se vzorkují
+ * úměrně jasu obrázku pomocí předpočítaného dvourozměrného rozdělení,
+ * takže i malé jasné zdroje (slunce) konvergují při nízkém počtu vzorků.
+ */
+class EnvironmentLight : public Light
+{
+public:
+    EnvironmentLight() = delete;
+
+    /*!
+     * Konstruktor. Načte obrázek ve formátu PFM a paralelně sestaví
+     * rozdělení pro vzorkování.
+     * \param file cesta k obrázku
+     * \param scale násobitel radiance
+     */
+    EnvironmentLight(const char* file, const RGBColor& scale = WHITE);
+
+    /*!
+     * Konstruktor z již načtených pixelů.
+     * \param pixels pixely po řádcích od levého horního rohu
+     * \param width šířka obrázku
+     * \param height výška obrázku
+     * \param scale násobitel radiance
+     */
+    EnvironmentLight(const std::vector<RGBColor>& pixels, int width, int height,
+                     const RGBColor& scale = WHITE);
+
+    virtual ~EnvironmentLight();
+
+    EnvironmentLight(const EnvironmentLight&) = delete;
+    EnvironmentLight& operator=(const EnvironmentLight&) = delete;
+
+    /*!
+     * Směr normály v místě průsečíku, tedy střed osvětlené polokoule.
+     * \copydoc Light::direction()
+     */
+    virtual Vector direction(const Intersection& inter) const override;
+
+    /*!
+     * Radiance přicházející ve směru normály.
+     * \copydoc Light::l()
+     */
+    virtual RGBColor l(const Intersection& inter) const override;
+
+    /*! \copydoc Light::sampleL() */
+    virtual RGBColor sampleL(const Intersection& inter, const LightSample& sample,
+                             Vector& wi, Real& pdf, Ray& shadowRay) const override;
+
+    /*! \copydoc Light::power() */
+    virtual Real power() const override;
+
+    /*! \copydoc Light::le() */
+    virtual RGBColor le(const Ray& ray) const override;
+
+    /*!
+     * Zjistí poloměr scény, potřebný pro odhad výkonu.
+     * \copydoc Light::preprocess()
+     */
+    virtual void preprocess(const Scene& scene) override;
+
+    /*!
+     * Hustota pravděpodobnosti, se kterou metoda sampleL() vybere zadaný směr.
+     * \param w normalizovaný směr
+     * \return hustota vzhledem k prostorovému úhlu
+     */
+    Real pdf(const Vector& w) const;
+
+private:
+    /*!
+     * Sestaví rozdělení pro vzorkování. Každý pixel má váhu danou jasem
+     * a sinem zeměpisné šířky, který kompenzuje zhuštění pixelů u pólů.
+     */
+    void buildDistribution();
+
+    /*!
+     * Radiance v zadaných souřadnicích obrázku.
+     * \param u vodorovná souřadnice z intervalu <0; 1)
+     * \param v svislá souřadnice z intervalu <0; 1)
+     */
+    RGBColor lookup(Real u, Real v) const;
+
+    std::vector<RGBColor> pixels; ///< Pixely obrázku.
+    int width; ///< Šířka obrázku.
+    int height; ///< Výška obrázku.
+    RGBColor scale; ///< Násobitel radiance.
+    Real worldRadius; ///< Poloměr koule opsané scéně.
+    Distribution2D* distribution; ///< Rozdělení pro vzorkování směrů.
+};
+
+}
@@ -0,0 +1,44 @@
+#include "lights/pointlight.h"
+
+using namespace tracer;
+
+PointLight::PointLight(const Vector& position, const RGBColor& intensity)
+    : position(position),
+      intensity(intensity)
+{ }
+
+PointLight::~PointLight()
+{ }
+
+Vector PointLight::direction(const Intersection& inter) const
+{
+    Vector d = position - inter.hitPoint;
+    return d.normalize();
+}
+
+RGBColor PointLight::l(const Intersection& inter) const
+{
+    Real dist2 = (position - inter.hitPoint).squarredLenght();
+    return dist2 > 0.f ? intensity / dist2 : BLACK;
+}
+
+RGBColor PointLight::sampleL(const Intersection& inter, const LightSample& sample,
+                             Vector& wi, Real& pdf, Ray& shadowRay) const
+{
+    wi = position - inter.hitPoint;
+    Real dist2 = wi.squarredLenght();
+    pdf = 0.f;
+    if (dist2 == 0.f)
+        return BLACK;
+
+    Real dist = std::sqrt(dist2);
+    wi /= dist;
+    pdf = 1.f;
+    shadowRay = Ray(inter.hitPoint, wi, EPSILON, dist * (1.f - EPSILON));
+    return intensity / dist2;
+}
+
+Real PointLight::power() const
+{
+    return 4.f * static_cast<Real>(M_PI) * intensity.luminance();
+}
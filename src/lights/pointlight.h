@@ -0,0 +1,47 @@
+#pragma once
+
+#include "core/light.h"
+
+namespace tracer
+{
+
+/*!
+ * Bodové světlo vyzařující do všech směrů stejně. Intenzita klesá
+ * s druhou mocninou vzdálenosti.
+ */
+class PointLight : public Light
+{
+public:
+    PointLight() = delete;
+
+    /*!
+     * Konstruktor.
+     * \param position poloha světla
+     * \param intensity zářivá intenzita
+     */
+    PointLight(const Vector& position, const RGBColor& intensity);
+
+    virtual ~PointLight();
+
+    /*! \copydoc Light::direction() */
+    virtual Vector direction(const Intersection& inter) const override;
+
+    /*! \copydoc Light::l() */
+    virtual RGBColor l(const Intersection& inter) const override;
+
+    /*!
+     * \copydoc Light::sampleL()
+     * Stínový paprsek končí těsně před světlem.
+     */
+    virtual RGBColor sampleL(const Intersection& inter, const LightSample& sample,
+                             Vector& wi, Real& pdf, Ray& shadowRay) const override;
+
+    /*! Výkon 4 pi I (z jasu intenzity). */
+    virtual Real power() const override;
+
+private:
+    Vector position; ///< Poloha světla.
+    RGBColor intensity; ///< Zářivá intenzita.
+};
+
+}
@@ -0,0 +1,33 @@
+#include "materials/matte.h"
+
+#include "brdfs/lambertian.h"
+#include "textures/constant.h"
+
+using namespace tracer;
+
+MatteMaterial::MatteMaterial(const RGBColor& color)
+    : kd(color),
+      texture(new ConstantTexture(WHITE))
+{ }
+
+MatteMaterial::MatteMaterial(const RGBColor& color, const Reference<Texture>& texture)
+    : kd(color),
+      texture(texture)
+{ }
+
+MatteMaterial::~MatteMaterial()
+{ }
+
+BSDF* MatteMaterial::getBSDF(const Vector& normal, const Vector& incident) const
+{
+    BSDF* bsdf = new BSDF();
+    bsdf->add(new Lambertian(kd));
+    return bsdf;
+}
+
+BSDF* MatteMaterial::getBSDF(const Intersection& in) const
+{
+    BSDF* bsdf = new BSDF();
+    bsdf->add(new Lambertian(kd * texture->evaluate(in)));
+    return bsdf;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "core/material.h"
+#include "core/texture.h"
+
+namespace tracer
+{
+
+/*!
+ * Matný materiál s jedinou difúzní složkou (Lambertian). Barvu povrchu
+ * může násobit textura, ta se ale vyhodnotí jen při vytváření BSDF
+ * z průsečíku.
+ */
+class MatteMaterial : public Material
+{
+public:
+    /*!
+     * Konstruktor.
+     * \param color barva (odrazivost) povrchu
+     */
+    MatteMaterial(const RGBColor& color);
+
+    /*!
+     * Konstruktor texturovaného materiálu.
+     * \param color barva (odrazivost) povrchu, násobí texturu
+     * \param texture textura barvy povrchu
+     */
+    MatteMaterial(const RGBColor& color, const Reference<Texture>& texture);
+
+    virtual ~MatteMaterial();
+
+    /*! \copydoc Material::getBSDF(const Vector&, const Vector&) const */
+    virtual BSDF* getBSDF(const Vector& normal, const Vector& incident) const override;
+
+    /*! \copydoc Material::getBSDF(const Intersection&) const */
+    virtual BSDF* getBSDF(const Intersection& in) const override;
+
+    /*!
+     * \return barva povrchu
+     */
+    const RGBColor& color() const
+    { return kd; }
+
+private:
+    RGBColor kd; ///< Difúzní odrazivost.
+    mutable Reference<Texture> texture; ///< Textura odrazivosti, u netexturovaného materiálu konstantní bílá.
+};
+
+}
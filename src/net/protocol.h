@@ -0,0 +1,94 @@
+#pragma once
+
+/*!
+ * \file
+ * V souboru jsou definovány zprávy protokolu mezi koordinátorem
+ * (CoordinatorRenderer) a pracovními procesy (WorkerRenderer) při
+ * distribuovaném vykreslování po dlaždicích.
+ *
+ * Průběh komunikace:
+ *  - pracovník se připojí a pošle MESSAGE_HELLO s rozměry svého filmu,
+ *  - koordinátor odpoví MESSAGE_WELCOME s velikostí dlaždic,
+ *  - pracovník žádá o dlaždice zprávou MESSAGE_REQUEST a koordinátor
+ *    odpovídá zprávou MESSAGE_TILES se seznamem dlaždic,
+ *  - každou hotovou dlaždici pracovník ihned pošle zprávou MESSAGE_RESULT,
+ *  - po dokončení snímku pošle koordinátor všem MESSAGE_DONE.
+ *
+ * Dále jsou zde zprávy pro komunikaci klienta s vykreslovacím serverem
+ * (ServerRenderer): klient posílá MESSAGE_RENDER a server odpovídá
+ * MESSAGE_IMAGE, nebo MESSAGE_ERROR s textem chyby. Zpráva MESSAGE_SHUTDOWN
+ * server ukončí.
+ */
+
+#include <cstdint>
+
+namespace tracer
+{
+
+/*!
+ * Typy zpráv.
+ */
+enum MessageType : uint32_t
+{
+    MESSAGE_HELLO = 1, ///< pracovník -> koordinátor, data HelloMessage
+    MESSAGE_WELCOME, ///< koordinátor -> pracovník, data WelcomeMessage
+    MESSAGE_REQUEST, ///< pracovník -> koordinátor, data RequestMessage
+    MESSAGE_TILES, ///< koordinátor -> pracovník, data pole TileRect
+    MESSAGE_RESULT, ///< pracovník -> koordinátor, data TileRect a FilmTile::serialize()
+    MESSAGE_DONE, ///< koordinátor -> pracovník, bez dat
+    MESSAGE_RENDER, ///< klient -> server, data RenderRequest
+    MESSAGE_IMAGE, ///< server -> klient, data TileRect oblasti a hodnoty pixelů RGB jako float
+    MESSAGE_ERROR, ///< server -> klient, text chyby
+    MESSAGE_SHUTDOWN ///< klient -> server, bez dat
+};
+
+/*!
+ * Představení pracovníka. Rozměry filmu musí souhlasit s koordinátorem.
+ */
+struct HelloMessage
+{
+    int width; ///< šířka filmu pracovníka
+    int height; ///< výška filmu pracovníka
+};
+
+/*!
+ * Odpověď koordinátora na představení.
+ */
+struct WelcomeMessage
+{
+    int tileSize; ///< velikost strany dlaždice
+};
+
+/*!
+ * Žádost o další dlaždice.
+ */
+struct RequestMessage
+{
+    int count; ///< maximální počet dlaždic
+};
+
+/*!
+ * Oblast vzorků dlaždice [x0; x1) x [y0; y1).
+ */
+struct TileRect
+{
+    int x0, y0, x1, y1;
+};
+
+/*!
+ * Požadavek na vykreslení pro vykreslovací server. Kamera je dírková
+ * (PinholeCamera).
+ */
+struct RenderRequest
+{
+    float eye[3]; ///< bod pozorovatele
+    float target[3]; ///< cíl pozorování
+    float up[3]; ///< vektor natočení
+    float fov; ///< svislý zorný úhel ve stupních
+    int width; ///< šířka obrázku
+    int height; ///< výška obrázku
+    int samplesPerPixel; ///< počet vzorků na pixel
+    TileRect region; ///< vykreslovaná oblast, prázdná oblast znamená celý obrázek
+};
+
+}
@@ -0,0 +1,48 @@
+#include "net/renderclient.h"
+
+#include <cstring>
+#include <stdexcept>
+
+using namespace tracer;
+
+RenderClient::RenderClient(const std::string& address)
+    : socket(Socket::connect(address))
+{ }
+
+std::vector<RGBColor> RenderClient::render(const RenderRequest& request, TileRect* region)
+{
+    socket.send(MESSAGE_RENDER, &request, sizeof(request));
+
+    uint32_t type;
+    std::vector<unsigned char> data;
+    if (!socket.receive(type, data))
+        throw std::runtime_error("Render server closed the connection");
+    if (type == MESSAGE_ERROR)
+        throw std::runtime_error("Render server error: " + std::string(data.begin(), data.end()));
+    if (type != MESSAGE_IMAGE || data.size() < sizeof(TileRect))
+        throw std::runtime_error("Unexpected message from render server");
+
+    TileRect rect;
+    memcpy(&rect, &data[0], sizeof(rect));
+    const size_t count = static_cast<size_t>(rect.x1 - rect.x0) * (rect.y1 - rect.y0);
+    if (data.size() != sizeof(TileRect) + count * 3 * sizeof(float))
+        throw std::runtime_error("Invalid image from render server");
+
+    std::vector<RGBColor> pixels(count);
+    const unsigned char* in = &data[sizeof(TileRect)];
+    for (size_t i = 0; i < count; ++i, in += 3 * sizeof(float))
+    {
+        float rgb[3];
+        memcpy(rgb, in, sizeof(rgb));
+        pixels[i] = RGBColor(rgb[0], rgb[1], rgb[2]);
+    }
+
+    if (region)
+        *region = rect;
+    return pixels;
+}
+
+void RenderClient::shutdown()
+{
+    socket.send(MESSAGE_SHUTDOWN, nullptr, 0);
+}
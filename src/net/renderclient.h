@@ -0,0 +1,44 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "core/color.h"
+#include "net/protocol.h"
+#include "net/socket.h"
+
+namespace tracer
+{
+
+/*!
+ * Klient vykreslovacího serveru (ServerRenderer). Spojení zůstává otevřené
+ * mezi požadavky. Při chybě spojení nebo chybě hlášené serverem metody
+ * vyhazují výjimku std::runtime_error.
+ */
+class RenderClient
+{
+public:
+    /*!
+     * Konstruktor. Připojí se k serveru.
+     * \param address adresa serveru ("unix:/cesta" nebo "host:port")
+     */
+    RenderClient(const std::string& address);
+
+    /*!
+     * Odešle požadavek a počká na výsledek.
+     * \param request požadavek na vykreslení
+     * \param region slouží k návratu skutečně vykreslené oblasti, může být nullptr
+     * \return pixely oblasti uložené po řádcích
+     */
+    std::vector<RGBColor> render(const RenderRequest& request, TileRect* region = nullptr);
+
+    /*!
+     * Požádá server o ukončení.
+     */
+    void shutdown();
+
+private:
+    Socket socket; ///< Spojení se serverem.
+};
+
+}
@@ -0,0 +1,252 @@
+#include "net/socket.h"
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace tracer;
+
+namespace
+{
+
+const char UNIX_PREFIX[] = "unix:";
+
+/// Největší přijatá zpráva, větší se považuje za poškozená data.
+const uint32_t MAX_MESSAGE_SIZE = 1u << 30;
+
+/*!
+ * Hlavička zprávy.
+ */
+struct MessageHeader
+{
+    uint32_t type; ///< typ zprávy
+    uint32_t size; ///< velikost dat v bajtech
+};
+
+bool isUnixAddress(const std::string& address)
+{
+    return address.compare(0, sizeof(UNIX_PREFIX) - 1, UNIX_PREFIX) == 0;
+}
+
+sockaddr_un unixAddress(const std::string& address)
+{
+    std::string path = address.substr(sizeof(UNIX_PREFIX) - 1);
+
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(addr.sun_path))
+        throw std::runtime_error("Invalid socket path " + path);
+    strcpy(addr.sun_path, path.c_str());
+    return addr;
+}
+
+/*!
+ * Přeloží adresu "host:port" pomocí getaddrinfo.
+ */
+addrinfo* tcpAddress(const std::string& address, bool passive)
+{
+    size_t colon = address.rfind(':');
+    if (colon == std::string::npos)
+        throw std::runtime_error("Invalid address " + address);
+
+    std::string host = address.substr(0, colon);
+    std::string port = address.substr(colon + 1);
+
+    addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = passive ? AI_PASSIVE : 0;
+
+    addrinfo* result = nullptr;
+    if (getaddrinfo(host.empty() ? nullptr : host.c_str(), port.c_str(), &hints, &result) != 0)
+        throw std::runtime_error("Cannot resolve address " + address);
+    return result;
+}
+
+}
+
+Socket::Socket()
+    : fd(-1)
+{ }
+
+Socket::Socket(int fd)
+    : fd(fd)
+{ }
+
+Socket::Socket(Socket&& socket)
+    : fd(socket.fd)
+{
+    socket.fd = -1;
+}
+
+Socket& Socket::operator=(Socket&& socket)
+{
+    if (this != &socket)
+    {
+        close();
+        fd = socket.fd;
+        socket.fd = -1;
+    }
+    return *this;
+}
+
+Socket::~Socket()
+{
+    close();
+}
+
+Socket Socket::connect(const std::string& address)
+{
+    if (isUnixAddress(address))
+    {
+        sockaddr_un addr = unixAddress(address);
+        Socket s(::socket(AF_UNIX, SOCK_STREAM, 0));
+        if (s.fd < 0 || ::connect(s.fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0)
+            throw std::runtime_error("Cannot connect to " + address);
+        return s;
+    }
+
+    addrinfo* info = tcpAddress(address, false);
+    for (addrinfo* ai = info; ai; ai = ai->ai_next)
+    {
+        Socket s(::socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol));
+        if (s.fd >= 0 && ::connect(s.fd, ai->ai_addr, ai->ai_addrlen) == 0)
+        {
+            freeaddrinfo(info);
+            return s;
+        }
+    }
+
+    freeaddrinfo(info);
+    throw std::runtime_error("Cannot connect to " + address);
+}
+
+Socket Socket::listen(const std::string& address)
+{
+    if (isUnixAddress(address))
+    {
+        sockaddr_un addr = unixAddress(address);
+        unlink(addr.sun_path);
+
+        Socket s(::socket(AF_UNIX, SOCK_STREAM, 0));
+        if (s.fd < 0 ||
+            bind(s.fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+            ::listen(s.fd, SOMAXCONN) != 0)
+            throw std::runtime_error("Cannot listen on " + address);
+        return s;
+    }
+
+    addrinfo* info = tcpAddress(address, true);
+    for (addrinfo* ai = info; ai; ai = ai->ai_next)
+    {
+        Socket s(::socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol));
+        if (s.fd < 0)
+            continue;
+
+        int yes = 1;
+        setsockopt(s.fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+        if (bind(s.fd, ai->ai_addr, ai->ai_addrlen) == 0 && ::listen(s.fd, SOMAXCONN) == 0)
+        {
+            freeaddrinfo(info);
+            return s;
+        }
+    }
+
+    freeaddrinfo(info);
+    throw std::runtime_error("Cannot listen on " + address);
+}
+
+Socket Socket::accept() const
+{
+    int client = ::accept(fd, nullptr, nullptr);
+    if (client < 0)
+        throw std::runtime_error(std::string("Cannot accept connection: ") + strerror(errno));
+    return Socket(client);
+}
+
+void Socket::setReceiveTimeout(double seconds)
+{
+    timeval tv;
+    tv.tv_sec = static_cast<time_t>(seconds);
+    tv.tv_usec = static_cast<suseconds_t>((seconds - tv.tv_sec) * 1e6);
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+}
+
+/*!
+ * Používá se MSG_NOSIGNAL, aby zápis do spojení ukončeného protistranou
+ * nevyvolal signál SIGPIPE, ale pouze výjimku.
+ */
+void Socket::send(uint32_t type, const void* data, size_t size)
+{
+    if (size > MAX_MESSAGE_SIZE)
+        throw std::runtime_error("Message too large");
+
+    MessageHeader header = { type, static_cast<uint32_t>(size) };
+    const unsigned char* parts[2] = { reinterpret_cast<const unsigned char*>(&header),
+                                      static_cast<const unsigned char*>(data) };
+    const size_t sizes[2] = { sizeof(header), size };
+
+    for (int i = 0; i < 2; ++i)
+    {
+        size_t sent = 0;
+        while (sent < sizes[i])
+        {
+            ssize_t n = ::send(fd, parts[i] + sent, sizes[i] - sent, MSG_NOSIGNAL);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                throw std::runtime_error("Connection lost while sending");
+            sent += static_cast<size_t>(n);
+        }
+    }
+}
+
+bool Socket::receive(uint32_t& type, std::vector<unsigned char>& data)
+{
+    MessageHeader header;
+    if (!readAll(&header, sizeof(header)))
+        return false;
+    if (header.size > MAX_MESSAGE_SIZE)
+        throw std::runtime_error("Invalid message size");
+
+    type = header.type;
+    data.resize(header.size);
+    if (header.size > 0 && !readAll(&data[0], header.size))
+        throw std::runtime_error("Connection lost while receiving");
+    return true;
+}
+
+void Socket::close()
+{
+    if (fd >= 0)
+    {
+        ::close(fd);
+        fd = -1;
+    }
+}
+
+bool Socket::readAll(void* data, size_t size)
+{
+    unsigned char* bytes = static_cast<unsigned char*>(data);
+    size_t received = 0;
+    while (received < size)
+    {
+        ssize_t n = ::recv(fd, bytes + received, size - received, 0);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n == 0 && received == 0)
+            return false;
+        if (n <= 0)
+            throw std::runtime_error("Connection lost while receiving");
+        received += static_cast<size_t>(n);
+    }
+    return true;
+}
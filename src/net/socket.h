@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace tracer
+{
+
+/*!
+ * Spojení přes socket (TCP nebo Unix domain) přenášející zprávy. Každá zpráva
+ * má hlavičku s typem a délkou dat, po které následují samotná data.
+ * Data se přenášejí v pořadí bajtů hostitele, všechny stroje proto musí mít
+ * stejnou architekturu.
+ *
+ * Adresy se zadávají jako "unix:/cesta/k/socketu" nebo "host:port"
+ * (při naslouchání může být host prázdný, pak se naslouchá na všech rozhraních).
+ * Při chybě metody vyhazují výjimku std::runtime_error.
+ */
+class Socket
+{
+public:
+    /*!
+     * Vytvoří nepřipojený socket.
+     */
+    Socket();
+
+    /*!
+     * Převezme existující deskriptor.
+     * \param fd deskriptor socketu
+     */
+    explicit Socket(int fd);
+
+    Socket(Socket&& socket);
+    Socket& operator=(Socket&& socket);
+
+    Socket(const Socket&) = delete;
+    Socket& operator=(const Socket&) = delete;
+
+    /*!
+     * Destruktor. Zavře socket.
+     */
+    ~Socket();
+
+    /*!
+     * Připojí se na zadanou adresu.
+     * \param address adresa protistrany
+     * \return připojený socket
+     */
+    static Socket connect(const std::string& address);
+
+    /*!
+     * Začne naslouchat na zadané adrese.
+     * \param address adresa, na které se naslouchá
+     * \return naslouchající socket
+     */
+    static Socket listen(const std::string& address);
+
+    /*!
+     * Přijme příchozí spojení. Blokuje, dokud nějaké nepřijde.
+     * \return socket nového spojení
+     */
+    Socket accept() const;
+
+    /*!
+     * Nastaví časový limit pro příjem. Pokud během něj nepřijdou žádná
+     * data, receive() vyhodí výjimku.
+     * \param seconds limit v sekundách, 0 znamená bez omezení
+     */
+    void setReceiveTimeout(double seconds);
+
+    /*!
+     * Odešle zprávu.
+     * \param type typ zprávy
+     * \param data data zprávy
+     * \param size velikost dat v bajtech
+     */
+    void send(uint32_t type, const void* data, size_t size);
+
+    /*!
+     * Přijme celou zprávu. Blokuje, dokud nepřijde.
+     * \param type slouží k návratu typu zprávy
+     * \param data slouží k návratu dat zprávy
+     * \return false, pokud protistrana spojení řádně uzavřela
+     */
+    bool receive(uint32_t& type, std::vector<unsigned char>& data);
+
+    /*!
+     * Zavře socket.
+     */
+    void close();
+
+    /*!
+     * \return deskriptor socketu, -1 pokud není otevřený
+     */
+    int descriptor() const
+    { return fd; }
+
+private:
+    /*!
+     * Přečte přesně size bajtů.
+     * \return false, pokud bylo spojení uzavřeno před prvním bajtem
+     */
+    bool readAll(void* data, size_t size);
+
+    int fd; ///< Deskriptor socketu.
+};
+
+}
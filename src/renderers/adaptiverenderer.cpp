@@ -0,0 +1,101 @@
+#include "renderers/adaptiverenderer.h"
+
+#include "core/parallel.h"
+
+using namespace tracer;
+
+AdaptiveRenderer::AdaptiveRenderer(Scene* sc, Integrator* integrator, Sampler* sampler, Real threshold,
+                                   int minSamples, int maxSamples,
+                                   int samplesPerPass, int tileSize)
+    : Renderer(sc),
+      integrator(integrator),
+      sampler(sampler),
+      threshold(threshold),
+      minSamples(max(minSamples, 2)),
+      maxSamples(max(maxSamples, this->minSamples)),
+      samplesPerPass(max(samplesPerPass, 1)),
+      tileSize(max(tileSize, 1)),
+      totalSamples(0)
+{ }
+
+AdaptiveRenderer::~AdaptiveRenderer()
+{
+    if (integrator)
+        delete integrator;
+    if (sampler)
+        delete sampler;
+}
+
+void AdaptiveRenderer::render() const
+{
+    checkFilm(*integrator, true, "AdaptiveRenderer");
+    const size_t failedBefore = failedLoads();
+    film->clear();
+    totalSamples = 0;
+
+    const int nx = (film->width + tileSize - 1) / tileSize;
+    const int ny = (film->height + tileSize - 1) / tileSize;
+
+    for (int pass = 0; ; ++pass)
+    {
+        std::atomic<size_t> active(0);
+        parallelFor(static_cast<size_t>(nx) * ny, [&](size_t tile)
+        {
+            int x0 = static_cast<int>(tile % nx) * tileSize;
+            int y0 = static_cast<int>(tile / nx) * tileSize;
+            Sampler* tileSampler = sampler->clone();
+            active += renderTile(x0, y0, pass, *tileSampler);
+            delete tileSampler;
+        });
+
+        if (active == 0)
+            break;
+    }
+    reportFailedLoads(failedBefore);
+}
+
+/*!
+ * Index vzorku navazuje na počet vzorků, které už pixel má. Vzorky jsou
+ * tak určeny pouze pixelem a pořadím, výsledek nezávisí na tom,
+ * které vlákno dlaždici zpracuje.
+ */
+size_t AdaptiveRenderer::renderTile(int x0, int y0, int pass, Sampler& tileSampler) const
+{
+    const int x1 = min(x0 + tileSize, film->width);
+    const int y1 = min(y0 + tileSize, film->height);
+    size_t active = 0;
+    FilmTile* tile = film->getFilmTile(x0, y0, x1, y1);
+
+    for (int y = y0; y < y1; ++y)
+    {
+        for (int x = x0; x < x1; ++x)
+        {
+            int count = static_cast<int>(film->sampleCount(x, y));
+            int n = minSamples;
+            if (pass > 0)
+            {
+                if (count >= maxSamples || film->relativeError(x, y) <= threshold)
+                    continue;
+                n = min(samplesPerPass, maxSamples - count);
+            }
+
+            for (int i = 0; i < n; ++i)
+            {
+                tileSampler.startPixelSample(x, y, static_cast<uint64_t>(count + i));
+                CameraSample sample = tileSampler.getCameraSample(x, y);
+
+                Ray ray;
+                cam->generateRay(sample, &ray);
+                tile->addSample(sample.x, sample.y, radiance(*integrator, ray));
+            }
+
+            totalSamples += n;
+            ++active;
+        }
+    }
+
+    film->mergeFilmTile(*tile);
+    delete tile;
+
+    return active;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <atomic>
+
+#include "core/renderer.h"
+#include "core/sampler.h"
+
+namespace tracer
+{
+
+/*!
+ * Renderer s adaptivním vzorkováním. Místo pevného počtu vzorků na pixel
+ * se zadává požadovaná kvalita: po úvodním průchodu se další vzorky
+ * přidávají pouze do pixelů, jejichž relativní chyba (viz Film::relativeError())
+ * je větší než zadaný práh. Obraz se zpracovává po dlaždicích paralelně.
+ */
+class AdaptiveRenderer : public Renderer
+{
+public:
+    /*!
+     * Konstruktor.
+     * \param sc vykreslovaná scéna
+     * \param integrator integrátor pro výpočet světelného příspěvku
+     * \param sampler generátor vzorků, každá dlaždice dostane jeho kopii
+     * \param threshold požadovaná relativní chyba pixelu (např. 0.01)
+     * \param minSamples počet vzorků v úvodním průchodu (alespoň 2)
+     * \param maxSamples maximální počet vzorků na pixel
+     * \param samplesPerPass počet vzorků přidaných nekonvergovanému pixelu v jednom průchodu
+     * \param tileSize velikost strany dlaždice v pixelech
+     */
+    AdaptiveRenderer(Scene* sc, Integrator* integrator, Sampler* sampler, Real threshold,
+                     int minSamples = 4, int maxSamples = 1024,
+                     int samplesPerPass = 4, int tileSize = 16);
+
+    /*!
+     * Destruktor. Kromě scény maže i integrátor a sampler.
+     */
+    virtual ~AdaptiveRenderer();
+
+    /*!
+     * Vykresluje, dokud nejsou všechny pixely konvergované
+     * nebo nedosáhly maximálního počtu vzorků.
+     */
+    virtual void render() const override;
+
+    /*!
+     * \return celkový počet vzorků spočítaných při posledním vykreslení
+     */
+    size_t samplesTaken() const
+    { return totalSamples; }
+
+private:
+    /*!
+     * Zpracuje jeden průchod přes dlaždici.
+     * \param x0 levý okraj dlaždice
+     * \param y0 horní okraj dlaždice
+     * \param pass číslo průchodu
+     * \param tileSampler kopie sampleru pro tuto dlaždici
+     * \return počet pixelů, do kterých byly přidány vzorky
+     */
+    size_t renderTile(int x0, int y0, int pass, Sampler& tileSampler) const;
+
+    Integrator* integrator; ///< Integrátor pro výpočet světelného příspěvku.
+    Sampler* sampler; ///< Generátor vzorků.
+    Real threshold; ///< Požadovaná relativní chyba.
+    int minSamples; ///< Počet vzorků v úvodním průchodu.
+    int maxSamples; ///< Maximální počet vzorků na pixel.
+    int samplesPerPass; ///< Počet vzorků přidaných v dalších průchodech.
+    int tileSize; ///< Velikost dlaždice.
+    mutable std::atomic<size_t> totalSamples; ///< Počet spočítaných vzorků.
+};
+
+}
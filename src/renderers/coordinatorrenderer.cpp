@@ -0,0 +1,259 @@
+#include "renderers/coordinatorrenderer.h"
+
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <stdexcept>
+#include <vector>
+
+#include <poll.h>
+
+#include "net/protocol.h"
+#include "net/socket.h"
+
+using namespace tracer;
+
+namespace
+{
+
+typedef std::chrono::steady_clock Clock;
+
+/*!
+ * Stav připojeného pracovníka.
+ */
+struct Worker
+{
+    Socket socket; ///< spojení s pracovníkem
+    std::vector<int> inFlight; ///< indexy přidělených nedokončených dlaždic
+    int requested; ///< počet dlaždic, o které pracovník žádá a zatím je nedostal
+    bool welcomed; ///< pracovník se představil a byl přijat
+    Clock::time_point lastMessage; ///< čas poslední přijaté zprávy
+};
+
+}
+
+CoordinatorRenderer::CoordinatorRenderer(Scene* sc, const std::string& address, ImageWriter* writer,
+                                         int tileSize, double timeout)
+    : Renderer(sc),
+      address(address),
+      writer(writer),
+      tileSize(max(tileSize, 1)),
+      timeout(timeout)
+{ }
+
+CoordinatorRenderer::~CoordinatorRenderer()
+{ }
+
+/*!
+ * Všechny sockety obsluhuje jediné vlákno pomocí poll(). Čtení zprávy je
+ * blokující s časovým limitem, takže ani pracovník, který přestane
+ * odesílat uprostřed zprávy, koordinátor nezablokuje.
+ */
+void CoordinatorRenderer::render() const
+{
+    film->clear();
+
+    const int nx = (film->width + tileSize - 1) / tileSize;
+    const int ny = (film->height + tileSize - 1) / tileSize;
+    const int tileCount = nx * ny;
+
+    std::deque<int> pending;
+    for (int i = 0; i < tileCount; ++i)
+        pending.push_back(i);
+    std::vector<bool> done(tileCount, false);
+    int remaining = tileCount;
+
+    Socket server = Socket::listen(address);
+    std::vector<Worker*> workers;
+
+    auto tileRect = [&](int index)
+    {
+        int x0 = (index % nx) * tileSize;
+        int y0 = (index / nx) * tileSize;
+        return TileRect{ x0, y0, min(x0 + tileSize, film->width), min(y0 + tileSize, film->height) };
+    };
+
+    // Nedokončené dlaždice ztraceného pracovníka se vrátí na začátek fronty.
+    auto dropWorker = [&](size_t w)
+    {
+        for (int index : workers[w]->inFlight)
+            if (!done[index])
+                pending.push_front(index);
+        delete workers[w];
+        workers.erase(workers.begin() + w);
+    };
+
+    auto handleMessage = [&](Worker& worker, uint32_t type, const std::vector<unsigned char>& data)
+    {
+        if (type == MESSAGE_HELLO && data.size() == sizeof(HelloMessage))
+        {
+            HelloMessage hello;
+            memcpy(&hello, &data[0], sizeof(hello));
+            if (hello.width != film->width || hello.height != film->height)
+                return false;
+
+            WelcomeMessage welcome = { tileSize };
+            worker.socket.send(MESSAGE_WELCOME, &welcome, sizeof(welcome));
+            worker.welcomed = true;
+            return true;
+        }
+
+        if (!worker.welcomed)
+            return false;
+
+        if (type == MESSAGE_REQUEST && data.size() == sizeof(RequestMessage))
+        {
+            RequestMessage request;
+            memcpy(&request, &data[0], sizeof(request));
+            worker.requested = max(request.count, 1);
+            return true;
+        }
+
+        if (type == MESSAGE_RESULT && data.size() >= sizeof(TileRect))
+        {
+            TileRect rect;
+            memcpy(&rect, &data[0], sizeof(rect));
+            if (rect.x0 < 0 || rect.y0 < 0 || rect.x0 >= film->width || rect.y0 >= film->height ||
+                rect.x0 % tileSize != 0 || rect.y0 % tileSize != 0)
+                return false;
+
+            int index = (rect.y0 / tileSize) * nx + rect.x0 / tileSize;
+            for (size_t i = 0; i < worker.inFlight.size(); ++i)
+            {
+                if (worker.inFlight[i] == index)
+                {
+                    worker.inFlight.erase(worker.inFlight.begin() + i);
+                    break;
+                }
+            }
+
+            // Dlaždice mohla být mezitím přidělena a dokončena jinde.
+            if (done[index])
+                return true;
+
+            TileRect expected = tileRect(index);
+            FilmTile* tile = film->getFilmTile(expected.x0, expected.y0, expected.x1, expected.y1);
+            try
+            {
+                tile->deserialize(&data[sizeof(TileRect)], data.size() - sizeof(TileRect));
+            }
+            catch (const std::runtime_error&)
+            {
+                delete tile;
+                return false;
+            }
+
+            film->mergeFilmTile(*tile);
+            delete tile;
+
+            done[index] = true;
+            --remaining;
+            if (writer)
+                writer->tileDone(expected.x0, expected.y0, expected.x1, expected.y1);
+            return true;
+        }
+
+        return false;
+    };
+
+    std::vector<pollfd> fds;
+    std::vector<unsigned char> data;
+
+    while (remaining > 0)
+    {
+        fds.clear();
+        fds.push_back(pollfd{ server.descriptor(), POLLIN, 0 });
+        for (Worker* worker : workers)
+            fds.push_back(pollfd{ worker->socket.descriptor(), POLLIN, 0 });
+
+        poll(&fds[0], fds.size(), 100);
+        const Clock::time_point now = Clock::now();
+
+        // Pracovníci se procházejí odzadu, aby jejich odebrání neposunulo zbylé indexy.
+        for (size_t w = workers.size(); w-- > 0; )
+        {
+            Worker& worker = *workers[w];
+            const short events = fds[w + 1].revents;
+            bool alive = true;
+
+            if (events & (POLLIN | POLLHUP | POLLERR))
+            {
+                try
+                {
+                    uint32_t type;
+                    alive = worker.socket.receive(type, data) && handleMessage(worker, type, data);
+                }
+                catch (const std::runtime_error&)
+                {
+                    alive = false;
+                }
+                worker.lastMessage = now;
+            }
+            else if (!worker.inFlight.empty() &&
+                     std::chrono::duration<double>(now - worker.lastMessage).count() > timeout)
+            {
+                alive = false;
+            }
+
+            if (!alive)
+                dropWorker(w);
+        }
+
+        if (fds[0].revents & POLLIN)
+        {
+            Worker* worker = new Worker();
+            worker->socket = server.accept();
+            worker->socket.setReceiveTimeout(timeout);
+            worker->requested = 0;
+            worker->welcomed = false;
+            worker->lastMessage = now;
+            workers.push_back(worker);
+        }
+
+        for (size_t w = workers.size(); w-- > 0; )
+        {
+            Worker& worker = *workers[w];
+            if (worker.requested == 0 || pending.empty())
+                continue;
+
+            std::vector<TileRect> rects;
+            while (static_cast<int>(rects.size()) < worker.requested && !pending.empty())
+            {
+                int index = pending.front();
+                pending.pop_front();
+                if (done[index])
+                    continue;
+                rects.push_back(tileRect(index));
+                worker.inFlight.push_back(index);
+            }
+
+            if (rects.empty())
+                continue;
+
+            try
+            {
+                worker.socket.send(MESSAGE_TILES, &rects[0], rects.size() * sizeof(TileRect));
+                worker.requested = 0;
+                worker.lastMessage = Clock::now();
+            }
+            catch (const std::runtime_error&)
+            {
+                dropWorker(w);
+            }
+        }
+    }
+
+    for (Worker* worker : workers)
+    {
+        try
+        {
+            worker->socket.send(MESSAGE_DONE, nullptr, 0);
+        }
+        catch (const std::runtime_error&)
+        { }
+        delete worker;
+    }
+
+    if (writer)
+        writer->close();
+}
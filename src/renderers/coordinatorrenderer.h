@@ -0,0 +1,52 @@
+#pragma once
+
+#include <string>
+
+#include "core/imagewriter.h"
+#include "core/renderer.h"
+
+namespace tracer
+{
+
+/*!
+ * Koordinátor distribuovaného vykreslování. Sám nevykresluje, pouze
+ * naslouchá na zadané adrese, rozdává dlaždice připojeným pracovníkům
+ * (WorkerRenderer) a jejich výsledky slučuje do filmu scény. Protokol je
+ * popsán v souboru net/protocol.h.
+ *
+ * Pracovník je považován za ztracený, když se spojení přeruší nebo když
+ * má rozdělené dlaždice a po dobu timeout nepošle žádnou zprávu. Jeho
+ * nedokončené dlaždice se vrátí do fronty a přidělí ostatním. Pracovníci
+ * se mohou připojovat i během vykreslování.
+ */
+class CoordinatorRenderer : public Renderer
+{
+public:
+    /*!
+     * Konstruktor.
+     * \param sc scéna, z níž se používá pouze film
+     * \param address adresa, na které se naslouchá ("unix:/cesta" nebo "host:port")
+     * \param writer výstup obrázku, může být nullptr; renderer ho nemaže
+     * \param tileSize velikost strany dlaždice v pixelech
+     * \param timeout časový limit odpovědi pracovníka v sekundách
+     */
+    CoordinatorRenderer(Scene* sc, const std::string& address, ImageWriter* writer = nullptr,
+                        int tileSize = 32, double timeout = 60.0);
+
+    virtual ~CoordinatorRenderer();
+
+    /*!
+     * Čeká na pracovníky a rozděluje jim dlaždice, dokud není celý film
+     * hotový. Nakonec zavře výstup obrázku. Při chybě naslouchání vyhodí
+     * výjimku std::runtime_error.
+     */
+    virtual void render() const override;
+
+private:
+    std::string address; ///< Adresa, na které se naslouchá.
+    ImageWriter* writer; ///< Výstup obrázku.
+    int tileSize; ///< Velikost dlaždice.
+    double timeout; ///< Časový limit odpovědi pracovníka v sekundách.
+};
+
+}
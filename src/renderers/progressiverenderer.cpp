@@ -0,0 +1,302 @@
+#include "renderers/progressiverenderer.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+#include "core/parallel.h"
+
+using namespace tracer;
+
+namespace
+{
+
+/// Identifikace souboru se stavem progresivního rendereru.
+const char CHECKPOINT_MAGIC[8] = { 'P', 'R', 'O', 'G', 'C', 'K', 'P', '2' };
+
+/*!
+ * Hlavička souboru se stavem. Kromě počtu průchodů obsahuje nastavení,
+ * které musí při navázání souhlasit, aby byl výsledek bitově shodný.
+ */
+struct CheckpointHeader
+{
+    char magic[8]; ///< CHECKPOINT_MAGIC
+    int passes; ///< počet hotových průchodů
+    int samplesPerPixel; ///< Sampler::samplesPerPixel()
+    int tileSize; ///< velikost dlaždice
+    char sampler[16]; ///< Sampler::name()
+    uint64_t seed; ///< Sampler::getSeed()
+    char filter[16]; ///< Filter::name()
+    float filterWidth[2]; ///< Filter::xWidth, Filter::yWidth
+    int width; ///< šířka filmu
+    int height; ///< výška filmu
+};
+
+/*!
+ * Vyplní hlavičku nastavením, které musí při navázání souhlasit.
+ * \param header vyplňovaná hlavička
+ * \param sampler sampler rendereru
+ * \param film film rendereru
+ * \param tileSize velikost dlaždice
+ */
+void fillSettings(CheckpointHeader& header, const Sampler& sampler, const Film& film, int tileSize)
+{
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC));
+    header.samplesPerPixel = sampler.samplesPerPixel();
+    header.tileSize = tileSize;
+    strncpy(header.sampler, sampler.name(), sizeof(header.sampler) - 1);
+    header.seed = sampler.getSeed();
+    strncpy(header.filter, film.filter().name(), sizeof(header.filter) - 1);
+    header.filterWidth[0] = static_cast<float>(film.filter().xWidth);
+    header.filterWidth[1] = static_cast<float>(film.filter().yWidth);
+    header.width = film.width;
+    header.height = film.height;
+}
+
+}
+
+ProgressiveRenderer::ProgressiveRenderer(Scene* sc, Integrator* integrator, Sampler* sampler,
+                                         int maxPasses, double timeBudget, int tileSize)
+    : Renderer(sc),
+      integrator(integrator),
+      sampler(sampler),
+      maxPasses(max(maxPasses, 0)),
+      timeBudget(timeBudget),
+      tileSize(max(tileSize, 1)),
+      callbackInterval(0.0),
+      stopRequested(false),
+      completedPasses(0),
+      resumedPasses(0),
+      checkpointInterval(0.0),
+      checkpointBusy(false)
+{ }
+
+ProgressiveRenderer::~ProgressiveRenderer()
+{
+    if (checkpointThread.joinable())
+        checkpointThread.join();
+    if (integrator)
+        delete integrator;
+    if (sampler)
+        delete sampler;
+}
+
+void ProgressiveRenderer::setCallback(const Callback& callback, double interval)
+{
+    this->callback = callback;
+    callbackInterval = interval;
+}
+
+void ProgressiveRenderer::stop()
+{
+    stopRequested = true;
+}
+
+void ProgressiveRenderer::setCheckpoint(const std::string& file, double interval)
+{
+    checkpointFile = file;
+    checkpointInterval = interval;
+}
+
+void ProgressiveRenderer::resume(const std::string& file)
+{
+    FILE* f = fopen(file.c_str(), "rb");
+    if (!f)
+        throw std::runtime_error("Cannot open checkpoint " + file);
+
+    CheckpointHeader header;
+    if (fread(&header, sizeof(header), 1, f) != 1 ||
+        memcmp(header.magic, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC)) != 0)
+    {
+        fclose(f);
+        throw std::runtime_error("Invalid checkpoint " + file);
+    }
+
+    CheckpointHeader expected;
+    fillSettings(expected, *sampler, *film, tileSize);
+    if (header.samplesPerPixel != expected.samplesPerPixel || header.tileSize != expected.tileSize ||
+        strncmp(header.sampler, expected.sampler, sizeof(header.sampler)) != 0 ||
+        header.seed != expected.seed ||
+        strncmp(header.filter, expected.filter, sizeof(header.filter)) != 0 ||
+        header.filterWidth[0] != expected.filterWidth[0] || header.filterWidth[1] != expected.filterWidth[1] ||
+        header.width != expected.width || header.height != expected.height)
+    {
+        fclose(f);
+        throw std::runtime_error("Checkpoint " + file + " was made with different sampler, filter, film or tile settings");
+    }
+
+    try
+    {
+        film->read(f);
+    }
+    catch (...)
+    {
+        fclose(f);
+        throw;
+    }
+
+    fclose(f);
+    resumedPasses = header.passes;
+}
+
+/*!
+ * Dlaždice, jejichž indexy se v obou směrech shodují modulo phaseStride,
+ * jsou od sebe vzdálené alespoň o (phaseStride - 1) dlaždic, což stačí,
+ * aby se jejich pixely včetně okraje filtru nepřekrývaly.
+ */
+void ProgressiveRenderer::render() const
+{
+    typedef std::chrono::steady_clock Clock;
+
+    checkFilm(*integrator, true, "ProgressiveRenderer");
+    const size_t failedBefore = failedLoads();
+
+    const int firstPass = resumedPasses;
+    resumedPasses = 0;
+
+    if (firstPass == 0)
+        film->clear();
+    completedPasses = firstPass;
+
+    const int nx = (film->width + tileSize - 1) / tileSize;
+    const int ny = (film->height + tileSize - 1) / tileSize;
+
+    const Filter& filter = film->filter();
+    const int border = static_cast<int>(std::ceil(max(filter.xWidth, filter.yWidth) + 0.5f));
+    const int phaseStride = 1 + (2 * border + tileSize - 1) / tileSize;
+
+    const Clock::time_point start = Clock::now();
+    Clock::time_point lastPublish = start;
+    Clock::time_point lastCheckpoint = start;
+
+    for (int pass = firstPass; ; ++pass)
+    {
+        if (maxPasses > 0 && pass >= maxPasses)
+            break;
+
+        for (int phase = 0; phase < phaseStride * phaseStride; ++phase)
+        {
+            const int tx0 = phase % phaseStride;
+            const int ty0 = phase / phaseStride;
+            const int cx = (nx - tx0 + phaseStride - 1) / phaseStride;
+            const int cy = (ny - ty0 + phaseStride - 1) / phaseStride;
+            if (cx <= 0 || cy <= 0)
+                continue;
+
+            parallelFor(static_cast<size_t>(cx) * cy, [&](size_t tile)
+            {
+                int x0 = (tx0 + static_cast<int>(tile % cx) * phaseStride) * tileSize;
+                int y0 = (ty0 + static_cast<int>(tile / cx) * phaseStride) * tileSize;
+                Sampler* tileSampler = sampler->clone();
+                renderTile(x0, y0, pass, *tileSampler);
+                delete tileSampler;
+            });
+        }
+        completedPasses = pass + 1;
+
+        const Clock::time_point now = Clock::now();
+        const double elapsed = std::chrono::duration<double>(now - start).count();
+        const bool done = stopRequested ||
+                          (maxPasses > 0 && pass + 1 >= maxPasses) ||
+                          (timeBudget > 0.0 && elapsed >= timeBudget);
+
+        if (!checkpointFile.empty() &&
+            (done || std::chrono::duration<double>(now - lastCheckpoint).count() >= checkpointInterval))
+        {
+            // Na konci (i při přerušení) se čeká na zápis, jinak by se poslední průchody ztratily.
+            if (done && checkpointThread.joinable())
+                checkpointThread.join();
+
+            if (!checkpointBusy)
+            {
+                saveCheckpoint(pass + 1);
+                lastCheckpoint = now;
+            }
+
+            if (done)
+                checkpointThread.join();
+        }
+
+        if (callback && (pass == firstPass || done ||
+                         std::chrono::duration<double>(now - lastPublish).count() >= callbackInterval))
+        {
+            callback(*film, pass + 1);
+            lastPublish = now;
+        }
+
+        if (done)
+            break;
+    }
+
+    // Požadavek se spotřebuje až ukončením, stop() před startem se tak neztratí.
+    stopRequested = false;
+    reportFailedLoads(failedBefore);
+}
+
+void ProgressiveRenderer::renderTile(int x0, int y0, int pass, Sampler& tileSampler) const
+{
+    const int x1 = min(x0 + tileSize, film->width);
+    const int y1 = min(y0 + tileSize, film->height);
+    FilmTile* tile = film->getFilmTile(x0, y0, x1, y1);
+
+    for (int y = y0; y < y1; ++y)
+    {
+        for (int x = x0; x < x1; ++x)
+        {
+            tileSampler.startPixelSample(x, y, static_cast<uint64_t>(pass));
+            CameraSample sample = tileSampler.getCameraSample(x, y);
+
+            Ray ray;
+            cam->generateRay(sample, &ray);
+            tile->addSample(sample.x, sample.y, radiance(*integrator, ray));
+        }
+    }
+
+    film->mergeFilmTile(*tile);
+    delete tile;
+}
+
+void ProgressiveRenderer::saveCheckpoint(int passes) const
+{
+    if (checkpointThread.joinable())
+        checkpointThread.join();
+
+    checkpointBusy = true;
+    Film* snapshot = film->clone();
+    const std::string file = checkpointFile;
+    CheckpointHeader header;
+    fillSettings(header, *sampler, *film, tileSize);
+    header.passes = passes;
+
+    checkpointThread = std::thread([this, snapshot, file, header]()
+    {
+        const std::string tmp = file + ".tmp";
+        FILE* f = fopen(tmp.c_str(), "wb");
+        if (f)
+        {
+
+            bool ok = fwrite(&header, sizeof(header), 1, f) == 1;
+            try
+            {
+                if (ok)
+                    snapshot->write(f);
+            }
+            catch (const std::runtime_error&)
+            {
+                ok = false;
+            }
+
+            ok = fclose(f) == 0 && ok;
+            if (ok)
+                rename(tmp.c_str(), file.c_str());
+            else
+                remove(tmp.c_str());
+        }
+
+        delete snapshot;
+        checkpointBusy = false;
+    });
+}
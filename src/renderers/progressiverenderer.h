@@ -0,0 +1,138 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <string>
+#include <thread>
+
+#include "core/renderer.h"
+#include "core/sampler.h"
+
+namespace tracer
+{
+
+/*!
+ * Progresivní renderer. Obraz se vykresluje v průchodech po jednom vzorku
+ * na pixel přes celý film, vzorky se průběžně sčítají ve filmu. Po průchodu
+ * se aktuální odhad předá zpětnému volání, první náhled je tak k dispozici
+ * po jediném vzorku na pixel. Vykreslování končí po dosažení počtu
+ * průchodů, vyčerpání času nebo zavoláním stop().
+ *
+ * Dlaždice průchodu se vykreslují v několika fázích tak, aby se dlaždice
+ * jedné fáze nepřekrývaly ani přes okraj filtru. Každý pixel tak dostává
+ * příspěvky vždy ve stejném pořadí a výsledek nezávisí na počtu vláken
+ * ani na jejich plánování.
+ *
+ * Po průchodech lze stav ukládat do souboru (setCheckpoint()) a vykreslování
+ * z něj později navázat (resume()). Výsledek navázaného vykreslování je
+ * bitově shodný s vykreslováním bez přerušení.
+ */
+class ProgressiveRenderer : public Renderer
+{
+public:
+    /*!
+     * Funkce volaná po dokončení průchodu. Dostává film s aktuálním
+     * odhadem a počet dokončených průchodů.
+     */
+    typedef std::function<void(const Film& film, int passes)> Callback;
+
+    /*!
+     * Konstruktor.
+     * \param sc vykreslovaná scéna
+     * \param integrator integrátor pro výpočet světelného příspěvku
+     * \param sampler generátor vzorků, každá dlaždice dostane jeho kopii
+     * \param maxPasses maximální počet průchodů (vzorků na pixel), 0 znamená bez omezení
+     * \param timeBudget časový limit v sekundách, 0 znamená bez omezení
+     * \param tileSize velikost strany dlaždice v pixelech
+     */
+    ProgressiveRenderer(Scene* sc, Integrator* integrator, Sampler* sampler,
+                        int maxPasses = 0, double timeBudget = 0.0, int tileSize = 16);
+
+    /*!
+     * Destruktor. Kromě scény maže i integrátor a sampler.
+     */
+    virtual ~ProgressiveRenderer();
+
+    /*!
+     * Vykresluje průchody, dokud není splněna některá z podmínek ukončení.
+     * Pokud nejsou zadány limity ani není zavoláno stop(), nikdy neskončí.
+     */
+    virtual void render() const override;
+
+    /*!
+     * Nastaví funkci volanou po průchodech.
+     * \param callback volaná funkce
+     * \param interval minimální odstup dvou volání v sekundách; první
+     *        a poslední průchod se předají vždy
+     */
+    void setCallback(const Callback& callback, double interval = 0.0);
+
+    /*!
+     * Požádá o ukončení vykreslování. Rozpracovaný průchod se dokončí.
+     * Lze volat z jiného vlákna, i ještě před spuštěním render(), pak se
+     * vykreslí jediný průchod. Požadavek se zruší ukončením render().
+     */
+    void stop();
+
+    /*!
+     * Zapne ukládání stavu po průchodech. Stav tvoří film (nasčítané
+     * hodnoty, statistiky pixelů, splat buffer) a počet hotových průchodů,
+     * který zároveň určuje index dalšího vzorku sampleru. Film se po
+     * průchodu zkopíruje a do souboru zapisuje jiné vlákno, vykreslování
+     * tak nečeká na disk. Pokud předchozí zápis ještě běží, stav se neuloží.
+     * Soubor se zapisuje pod dočasným jménem a přejmenuje se až po dokončení,
+     * přerušení během zápisu tedy nepoškodí předchozí uložený stav.
+     * \param file cesta k souboru se stavem
+     * \param interval minimální odstup dvou uložení v sekundách
+     */
+    void setCheckpoint(const std::string& file, double interval);
+
+    /*!
+     * Načte stav uložený při ukládání stavu (viz setCheckpoint()). Následující
+     * render() pokračuje dalším průchodem místo vymazání filmu. Při chybě
+     * nebo nesouhlasném nastavení (typ a semínko sampleru, počet vzorků,
+     * typ a poloměr filtru, rozměry filmu, velikost dlaždice) vyhodí
+     * výjimku std::runtime_error.
+     * \param file cesta k souboru se stavem
+     */
+    void resume(const std::string& file);
+
+    /*!
+     * \return počet dokončených průchodů
+     */
+    int passes() const
+    { return completedPasses; }
+
+private:
+    /*!
+     * Přidá jeden vzorek do každého pixelu dlaždice.
+     * \param x0 levý okraj dlaždice
+     * \param y0 horní okraj dlaždice
+     * \param pass číslo průchodu, slouží jako index vzorku
+     * \param tileSampler kopie sampleru pro tuto dlaždici
+     */
+    void renderTile(int x0, int y0, int pass, Sampler& tileSampler) const;
+
+    /*!
+     * Zkopíruje film a spustí jeho zápis do souboru se stavem v jiném vlákně.
+     * \param passes počet hotových průchodů
+     */
+    void saveCheckpoint(int passes) const;
+
+    Integrator* integrator; ///< Integrátor pro výpočet světelného příspěvku.
+    Sampler* sampler; ///< Generátor vzorků.
+    int maxPasses; ///< Maximální počet průchodů.
+    double timeBudget; ///< Časový limit v sekundách.
+    int tileSize; ///< Velikost dlaždice.
+    Callback callback; ///< Funkce volaná po průchodech.
+    double callbackInterval; ///< Minimální odstup volání v sekundách.
+    mutable std::atomic<bool> stopRequested; ///< Příznak požadavku na ukončení.
+    mutable std::atomic<int> completedPasses; ///< Počet dokončených průchodů.
+    mutable int resumedPasses; ///< Počet průchodů načtených ze stavu, od kterého render() pokračuje.
+    std::string checkpointFile; ///< Soubor se stavem, prázdný pokud se stav neukládá.
+    double checkpointInterval; ///< Minimální odstup uložení stavu v sekundách.
+    mutable std::thread checkpointThread; ///< Vlákno zapisující stav.
+    mutable std::atomic<bool> checkpointBusy; ///< Příznak probíhajícího zápisu stavu.
+};
+
+}
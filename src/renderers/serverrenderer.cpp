@@ -0,0 +1,179 @@
+#include "renderers/serverrenderer.h"
+
+#include <cstring>
+#include <stdexcept>
+
+#include "cameras/pinhole.h"
+#include "core/parallel.h"
+#include "filters/box.h"
+#include "net/socket.h"
+
+using namespace tracer;
+
+namespace
+{
+
+/// Největší povolený rozměr obrázku požadavku.
+const int MAX_RESOLUTION = 1 << 15;
+
+}
+
+ServerRenderer::ServerRenderer(Scene* sc, Integrator* integrator, Sampler* sampler,
+                               const std::string& address, Filter* filter, int tileSize)
+    : Renderer(sc),
+      integrator(integrator),
+      sampler(sampler),
+      address(address),
+      filter(filter ? filter : new BoxFilter()),
+      tileSize(max(tileSize, 1)),
+      jobFilm(nullptr),
+      jobs(0)
+{ }
+
+ServerRenderer::~ServerRenderer()
+{
+    if (integrator)
+        delete integrator;
+    if (sampler)
+        delete sampler;
+    if (jobFilm)
+        delete jobFilm;
+}
+
+/*!
+ * Chyba v požadavku se klientovi vrátí jako MESSAGE_ERROR, chyba spojení
+ * pouze ukončí obsluhu daného klienta.
+ */
+void ServerRenderer::render() const
+{
+    Socket server = Socket::listen(address);
+    std::vector<unsigned char> data;
+    std::vector<unsigned char> reply;
+
+    for (;;)
+    {
+        Socket client = server.accept();
+
+        try
+        {
+            uint32_t type;
+            while (client.receive(type, data))
+            {
+                if (type == MESSAGE_SHUTDOWN)
+                    return;
+
+                if (type != MESSAGE_RENDER || data.size() != sizeof(RenderRequest))
+                {
+                    const char message[] = "Unknown request";
+                    client.send(MESSAGE_ERROR, message, sizeof(message) - 1);
+                    continue;
+                }
+
+                RenderRequest request;
+                memcpy(&request, &data[0], sizeof(request));
+
+                try
+                {
+                    renderJob(request, reply);
+                }
+                catch (const std::runtime_error& e)
+                {
+                    client.send(MESSAGE_ERROR, e.what(), strlen(e.what()));
+                    continue;
+                }
+
+                client.send(MESSAGE_IMAGE, &reply[0], reply.size());
+                ++jobs;
+            }
+        }
+        catch (const std::runtime_error&)
+        {
+            // Klient se odpojil uprostřed zprávy, čeká se na dalšího.
+        }
+    }
+}
+
+void ServerRenderer::renderJob(const RenderRequest& request, std::vector<unsigned char>& data) const
+{
+    if (request.width <= 0 || request.height <= 0 ||
+        request.width > MAX_RESOLUTION || request.height > MAX_RESOLUTION)
+        throw std::runtime_error("Invalid resolution");
+    if (request.samplesPerPixel <= 0)
+        throw std::runtime_error("Invalid sample count");
+    if (!(request.fov > 0.f && request.fov < 180.f))
+        throw std::runtime_error("Invalid field of view");
+
+    TileRect region = request.region;
+    if (region.x1 <= region.x0 || region.y1 <= region.y0)
+        region = TileRect{ 0, 0, request.width, request.height };
+    region.x0 = max(region.x0, 0);
+    region.y0 = max(region.y0, 0);
+    region.x1 = min(region.x1, request.width);
+    region.y1 = min(region.y1, request.height);
+    if (region.x1 <= region.x0 || region.y1 <= region.y0)
+        throw std::runtime_error("Region lies outside the image");
+
+    if (!jobFilm || jobFilm->width != request.width || jobFilm->height != request.height)
+    {
+        delete jobFilm;
+        jobFilm = new Film(request.width, request.height, 1.f, 1.f, 1.f, &*filter);
+    }
+    else
+    {
+        jobFilm->clear();
+    }
+
+    const PinholeCamera camera(Vector(request.eye[0], request.eye[1], request.eye[2]),
+                               Vector(request.target[0], request.target[1], request.target[2]),
+                               Vector(request.up[0], request.up[1], request.up[2]),
+                               request.fov, request.width, request.height);
+
+    const int regionWidth = region.x1 - region.x0;
+    const int regionHeight = region.y1 - region.y0;
+    const int nx = (regionWidth + tileSize - 1) / tileSize;
+    const int ny = (regionHeight + tileSize - 1) / tileSize;
+
+    parallelFor(static_cast<size_t>(nx) * ny, [&](size_t index)
+    {
+        const int x0 = region.x0 + static_cast<int>(index % nx) * tileSize;
+        const int y0 = region.y0 + static_cast<int>(index / nx) * tileSize;
+        const int x1 = min(x0 + tileSize, region.x1);
+        const int y1 = min(y0 + tileSize, region.y1);
+
+        Sampler* tileSampler = sampler->clone();
+        FilmTile* tile = jobFilm->getFilmTile(x0, y0, x1, y1);
+
+        for (int y = y0; y < y1; ++y)
+        {
+            for (int x = x0; x < x1; ++x)
+            {
+                for (int i = 0; i < request.samplesPerPixel; ++i)
+                {
+                    tileSampler->startPixelSample(x, y, static_cast<uint64_t>(i));
+                    CameraSample sample = tileSampler->getCameraSample(x, y);
+
+                    Ray ray;
+                    camera.generateRay(sample, &ray);
+                    tile->addSample(sample.x, sample.y, radiance(*integrator, ray));
+                }
+            }
+        }
+
+        jobFilm->mergeFilmTile(*tile);
+        delete tile;
+        delete tileSampler;
+    });
+
+    const size_t rowFloats = static_cast<size_t>(regionWidth) * 3;
+    data.resize(sizeof(TileRect) + rowFloats * regionHeight * sizeof(float));
+    memcpy(&data[0], &region, sizeof(TileRect));
+
+    std::vector<Real> row(static_cast<size_t>(request.width) * 3);
+    float* out = reinterpret_cast<float*>(&data[sizeof(TileRect)]);
+    for (int y = region.y0; y < region.y1; ++y, out += rowFloats)
+    {
+        jobFilm->getRow(y, &row[0]);
+        for (size_t i = 0; i < rowFloats; ++i)
+            out[i] = static_cast<float>(row[region.x0 * 3 + i]);
+    }
+}
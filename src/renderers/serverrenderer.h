@@ -0,0 +1,77 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "core/filter.h"
+#include "core/reference.h"
+#include "core/renderer.h"
+#include "core/sampler.h"
+#include "net/protocol.h"
+
+namespace tracer
+{
+
+/*!
+ * Vykreslovací server. Scéna (včetně akcelerační struktury a světel) se
+ * sestaví jednou a zůstává v paměti, server pak na zadané adrese přijímá
+ * požadavky (RenderRequest) s kamerou, rozlišením, počtem vzorků a oblastí
+ * obrázku a vrací vykreslené pixely. Protokol je popsán v souboru net/protocol.h,
+ * na straně klienta ho implementuje třída RenderClient.
+ *
+ * Film a kamera scény se nepoužívají, každý požadavek má vlastní dírkovou
+ * kameru. Film se mezi požadavky se stejným rozlišením znovu používá.
+ * Klienti se obsluhují postupně, jeden klient může poslat libovolně
+ * mnoho požadavků.
+ */
+class ServerRenderer : public Renderer
+{
+public:
+    /*!
+     * Konstruktor.
+     * \param sc vykreslovaná scéna, musí být připravená (Scene::preprocess())
+     * \param integrator integrátor pro výpočet světelného příspěvku
+     * \param sampler generátor vzorků, každá dlaždice dostane jeho kopii
+     * \param address adresa, na které se naslouchá ("unix:/cesta" nebo "host:port")
+     * \param filter rekonstrukční filtr filmů, pokud je nullptr, použije se krabicový filtr
+     * \param tileSize velikost strany dlaždice v pixelech
+     */
+    ServerRenderer(Scene* sc, Integrator* integrator, Sampler* sampler, const std::string& address,
+                   Filter* filter = nullptr, int tileSize = 16);
+
+    /*!
+     * Destruktor. Kromě scény maže i integrátor, sampler a film požadavků.
+     */
+    virtual ~ServerRenderer();
+
+    /*!
+     * Obsluhuje klienty, dokud některý nepošle MESSAGE_SHUTDOWN. Pokud
+     * nelze naslouchat na adrese, vyhodí výjimku std::runtime_error.
+     */
+    virtual void render() const override;
+
+    /*!
+     * \return počet vyřízených požadavků
+     */
+    int jobsServed() const
+    { return jobs; }
+
+private:
+    /*!
+     * Vykreslí jeden požadavek. Při neplatném požadavku vyhodí výjimku
+     * std::runtime_error.
+     * \param request požadavek
+     * \param data slouží k návratu dat zprávy MESSAGE_IMAGE
+     */
+    void renderJob(const RenderRequest& request, std::vector<unsigned char>& data) const;
+
+    Integrator* integrator; ///< Integrátor pro výpočet světelného příspěvku.
+    Sampler* sampler; ///< Generátor vzorků.
+    std::string address; ///< Adresa, na které se naslouchá.
+    mutable Reference<Filter> filter; ///< Rekonstrukční filtr filmů.
+    int tileSize; ///< Velikost dlaždice.
+    mutable Film* jobFilm; ///< Film posledního požadavku.
+    mutable int jobs; ///< Počet vyřízených požadavků.
+};
+
+}
@@ -0,0 +1,75 @@
+#include "renderers/tilerenderer.h"
+
+#include "core/parallel.h"
+
+using namespace tracer;
+
+TileRenderer::TileRenderer(Scene* sc, Integrator* integrator, Sampler* sampler,
+                           ImageWriter* writer, int tileSize)
+    : Renderer(sc),
+      integrator(integrator),
+      sampler(sampler),
+      writer(writer),
+      tileSize(max(tileSize, 1))
+{ }
+
+TileRenderer::~TileRenderer()
+{
+    if (integrator)
+        delete integrator;
+    if (sampler)
+        delete sampler;
+}
+
+void TileRenderer::render() const
+{
+    checkFilm(*integrator, false, "TileRenderer");
+    const size_t failedBefore = failedLoads();
+    film->clear();
+
+    const int nx = (film->width + tileSize - 1) / tileSize;
+    const int ny = (film->height + tileSize - 1) / tileSize;
+
+    parallelFor(static_cast<size_t>(nx) * ny, [&](size_t tile)
+    {
+        int x0 = static_cast<int>(tile % nx) * tileSize;
+        int y0 = static_cast<int>(tile / nx) * tileSize;
+        Sampler* tileSampler = sampler->clone();
+        renderTile(x0, y0, *tileSampler);
+        delete tileSampler;
+    });
+
+    if (writer)
+        writer->close();
+    reportFailedLoads(failedBefore);
+}
+
+void TileRenderer::renderTile(int x0, int y0, Sampler& tileSampler) const
+{
+    const int x1 = min(x0 + tileSize, film->width);
+    const int y1 = min(y0 + tileSize, film->height);
+    const int spp = tileSampler.samplesPerPixel();
+    FilmTile* tile = film->getFilmTile(x0, y0, x1, y1);
+
+    for (int y = y0; y < y1; ++y)
+    {
+        for (int x = x0; x < x1; ++x)
+        {
+            for (int i = 0; i < spp; ++i)
+            {
+                tileSampler.startPixelSample(x, y, static_cast<uint64_t>(i));
+                CameraSample sample = tileSampler.getCameraSample(x, y);
+
+                Ray ray;
+                cam->generateRay(sample, &ray);
+                tile->addSample(sample.x, sample.y, radiance(*integrator, ray));
+            }
+        }
+    }
+
+    film->mergeFilmTile(*tile);
+    delete tile;
+
+    if (writer)
+        writer->tileDone(x0, y0, x1, y1);
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "core/imagewriter.h"
+#include "core/renderer.h"
+#include "core/sampler.h"
+
+namespace tracer
+{
+
+/*!
+ * Renderer s pevným počtem vzorků na pixel (Sampler::samplesPerPixel()).
+ * Obraz se vykresluje jediným průchodem po dlaždicích paralelně. Dlaždice
+ * se vlákny odebírají po řádcích shora dolů, takže spodní část obrazu
+ * se dokončuje postupně. Pokud je nastaven ImageWriter, hotové řádky se
+ * zapisují na disk ještě během vykreslování.
+ */
+class TileRenderer : public Renderer
+{
+public:
+    /*!
+     * Konstruktor.
+     * \param sc vykreslovaná scéna
+     * \param integrator integrátor pro výpočet světelného příspěvku
+     * \param sampler generátor vzorků, každá dlaždice dostane jeho kopii
+     * \param writer výstup obrázku, může být nullptr; renderer ho nemaže
+     * \param tileSize velikost strany dlaždice v pixelech
+     */
+    TileRenderer(Scene* sc, Integrator* integrator, Sampler* sampler,
+                 ImageWriter* writer = nullptr, int tileSize = 16);
+
+    /*!
+     * Destruktor. Kromě scény maže i integrátor a sampler.
+     */
+    virtual ~TileRenderer();
+
+    /*!
+     * Vykreslí obraz a nakonec zavře výstup obrázku.
+     */
+    virtual void render() const override;
+
+private:
+    /*!
+     * Spočítá všechny vzorky dlaždice.
+     * \param x0 levý okraj dlaždice
+     * \param y0 horní okraj dlaždice
+     * \param tileSampler kopie sampleru pro tuto dlaždici
+     */
+    void renderTile(int x0, int y0, Sampler& tileSampler) const;
+
+    Integrator* integrator; ///< Integrátor pro výpočet světelného příspěvku.
+    Sampler* sampler; ///< Generátor vzorků.
+    ImageWriter* writer; ///< Výstup obrázku.
+    int tileSize; ///< Velikost dlaždice.
+};
+
+}
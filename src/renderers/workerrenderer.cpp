@@ -0,0 +1,141 @@
+#include "renderers/workerrenderer.h"
+
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+
+#include "core/parallel.h"
+#include "net/socket.h"
+
+using namespace tracer;
+
+WorkerRenderer::WorkerRenderer(Scene* sc, Integrator* integrator, Sampler* sampler,
+                               const std::string& address)
+    : Renderer(sc),
+      integrator(integrator),
+      sampler(sampler),
+      address(address),
+      renderedTiles(0)
+{ }
+
+WorkerRenderer::~WorkerRenderer()
+{
+    if (integrator)
+        delete integrator;
+    if (sampler)
+        delete sampler;
+}
+
+/*!
+ * Žádá se o dvojnásobek počtu jader, aby vlákna neměla prostoje
+ * kvůli nerovnoměrně náročným dlaždicím.
+ */
+void WorkerRenderer::render() const
+{
+    renderedTiles = 0;
+
+    Socket socket = Socket::connect(address);
+
+    HelloMessage hello = { film->width, film->height };
+    socket.send(MESSAGE_HELLO, &hello, sizeof(hello));
+
+    uint32_t type;
+    std::vector<unsigned char> data;
+    if (!socket.receive(type, data) || type != MESSAGE_WELCOME || data.size() != sizeof(WelcomeMessage))
+        throw std::runtime_error("Coordinator at " + address + " rejected this worker");
+
+    const RequestMessage request = { numSystemCores() * 2 };
+    std::mutex sendMutex;
+    std::atomic<bool> lost(false);
+
+    // Koordinátor mohl snímek mezitím dokončit s pomocí ostatních pracovníků,
+    // pak před uzavřením spojení poslal zprávu MESSAGE_DONE.
+    auto finished = [&]()
+    {
+        try
+        {
+            return socket.receive(type, data) && type == MESSAGE_DONE;
+        }
+        catch (const std::runtime_error&)
+        {
+            return false;
+        }
+    };
+
+    for (;;)
+    {
+        try
+        {
+            socket.send(MESSAGE_REQUEST, &request, sizeof(request));
+        }
+        catch (const std::runtime_error&)
+        {
+            lost = true;
+        }
+
+        if (lost || !socket.receive(type, data) || type == MESSAGE_DONE)
+            break;
+        if (type != MESSAGE_TILES || data.empty() || data.size() % sizeof(TileRect) != 0)
+            throw std::runtime_error("Unexpected message from coordinator");
+
+        std::vector<TileRect> rects(data.size() / sizeof(TileRect));
+        memcpy(&rects[0], &data[0], data.size());
+
+        parallelFor(rects.size(), [&](size_t i)
+        {
+            if (lost)
+                return;
+
+            Sampler* tileSampler = sampler->clone();
+            std::vector<unsigned char> result;
+            renderTile(rects[i], *tileSampler, result);
+            delete tileSampler;
+
+            std::lock_guard<std::mutex> lock(sendMutex);
+            try
+            {
+                socket.send(MESSAGE_RESULT, &result[0], result.size());
+                ++renderedTiles;
+            }
+            catch (const std::runtime_error&)
+            {
+                lost = true;
+            }
+        });
+
+        if (lost)
+            break;
+    }
+
+    if (lost && !finished())
+        throw std::runtime_error("Connection to coordinator at " + address + " lost");
+}
+
+void WorkerRenderer::renderTile(const TileRect& rect, Sampler& tileSampler,
+                                std::vector<unsigned char>& data) const
+{
+    const int spp = tileSampler.samplesPerPixel();
+    FilmTile* tile = film->getFilmTile(rect.x0, rect.y0, rect.x1, rect.y1);
+
+    for (int y = rect.y0; y < rect.y1; ++y)
+    {
+        for (int x = rect.x0; x < rect.x1; ++x)
+        {
+            for (int i = 0; i < spp; ++i)
+            {
+                tileSampler.startPixelSample(x, y, static_cast<uint64_t>(i));
+                CameraSample sample = tileSampler.getCameraSample(x, y);
+
+                Ray ray;
+                cam->generateRay(sample, &ray);
+                tile->addSample(sample.x, sample.y, radiance(*integrator, ray));
+            }
+        }
+    }
+
+    data.resize(sizeof(TileRect));
+    memcpy(&data[0], &rect, sizeof(TileRect));
+    tile->serialize(data);
+    delete tile;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "core/renderer.h"
+#include "core/sampler.h"
+#include "net/protocol.h"
+
+namespace tracer
+{
+
+/*!
+ * Pracovní proces distribuovaného vykreslování. Připojí se ke koordinátorovi
+ * (CoordinatorRenderer), žádá o dlaždice a vykresluje je paralelně na
+ * všech jádrech s pevným počtem vzorků na pixel (Sampler::samplesPerPixel()).
+ * Každá hotová dlaždice se ihned odešle zpět, do vlastního filmu se nic
+ * neslučuje. Film scény slouží pouze k určení rozměrů a filtru, musí
+ * proto odpovídat filmu koordinátora.
+ */
+class WorkerRenderer : public Renderer
+{
+public:
+    /*!
+     * Konstruktor.
+     * \param sc vykreslovaná scéna
+     * \param integrator integrátor pro výpočet světelného příspěvku
+     * \param sampler generátor vzorků, každá dlaždice dostane jeho kopii
+     * \param address adresa koordinátora ("unix:/cesta" nebo "host:port")
+     */
+    WorkerRenderer(Scene* sc, Integrator* integrator, Sampler* sampler, const std::string& address);
+
+    /*!
+     * Destruktor. Kromě scény maže i integrátor a sampler.
+     */
+    virtual ~WorkerRenderer();
+
+    /*!
+     * Vykresluje dlaždice, dokud koordinátor nepošle zprávu o dokončení
+     * nebo neukončí spojení. Pokud se ke koordinátorovi nelze připojit
+     * nebo spojení selže během přenosu, vyhodí výjimku std::runtime_error.
+     */
+    virtual void render() const override;
+
+    /*!
+     * \return počet dlaždic vykreslených při posledním volání render()
+     */
+    int tilesRendered() const
+    { return renderedTiles; }
+
+private:
+    /*!
+     * Vykreslí dlaždici a připraví zprávu s výsledkem.
+     * \param rect oblast dlaždice
+     * \param tileSampler kopie sampleru pro tuto dlaždici
+     * \param data slouží k návratu dat zprávy MESSAGE_RESULT
+     */
+    void renderTile(const TileRect& rect, Sampler& tileSampler, std::vector<unsigned char>& data) const;
+
+    Integrator* integrator; ///< Integrátor pro výpočet světelného příspěvku.
+    Sampler* sampler; ///< Generátor vzorků.
+    std::string address; ///< Adresa koordinátora.
+    mutable int renderedTiles; ///< Počet vykreslených dlaždic.
+};
+
+}
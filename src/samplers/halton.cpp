@@ -0,0 +1,99 @@
+#include "samplers/halton.h"
+
+#include "core/rng.h"
+
+using namespace tracer;
+
+namespace
+{
+
+const int PRIMES[HaltonSampler::MAX_DIMENSION] = {
+    2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37, 41, 43, 47, 53,
+    59, 61, 67, 71, 73, 79, 83, 89, 97, 101, 103, 107, 109, 113, 127, 131
+};
+
+/*!
+ * Radikální inverze s permutovanými číslicemi. Nulové číslice za nejvyšší
+ * nenulovou číslicí se permutují také, jejich příspěvek tvoří geometrickou
+ * řadu, která je sečtena najednou.
+ */
+Real scrambledRadicalInverse(int base, uint64_t a, const uint16_t* perm)
+{
+    const double invBase = 1.0 / base;
+    double invBaseN = 1.0;
+    uint64_t reversed = 0;
+
+    while (a)
+    {
+        uint64_t next = a / base;
+        uint64_t digit = a - next * base;
+        reversed = reversed * base + perm[digit];
+        invBaseN *= invBase;
+        a = next;
+    }
+
+    double v = invBaseN * (reversed + invBase * perm[0] / (1.0 - invBase));
+    return min(static_cast<Real>(v), ONE_MINUS_EPSILON);
+}
+
+}
+
+/************************************************************************/
+/* HaltonTables methods                                                 */
+/************************************************************************/
+
+HaltonTables::HaltonTables(uint64_t seed)
+{
+    size_t total = 0;
+    for (int d = 0; d < HaltonSampler::MAX_DIMENSION; ++d)
+    {
+        offsets.push_back(total);
+        total += PRIMES[d];
+    }
+
+    permutations.resize(total);
+    RNG rng(seed);
+    for (int d = 0; d < HaltonSampler::MAX_DIMENSION; ++d)
+    {
+        uint16_t* perm = &permutations[offsets[d]];
+        for (int i = 0; i < PRIMES[d]; ++i)
+            perm[i] = static_cast<uint16_t>(i);
+
+        // Fisher-Yates
+        for (int i = PRIMES[d] - 1; i > 0; --i)
+        {
+            int j = static_cast<int>(rng.uniformUInt32() % (i + 1));
+            std::swap(perm[i], perm[j]);
+        }
+    }
+}
+
+/************************************************************************/
+/* HaltonSampler methods                                                */
+/************************************************************************/
+
+HaltonSampler::HaltonSampler(int samplesPerPixel, uint64_t seed)
+    : Sampler(samplesPerPixel, seed),
+      tables(new HaltonTables(seed))
+{ }
+
+HaltonSampler::~HaltonSampler()
+{ }
+
+Sampler* HaltonSampler::clone() const
+{
+    return new HaltonSampler(*this);
+}
+
+Real HaltonSampler::sample(int dim) const
+{
+    const uint64_t h = pixelSeed(dim);
+    if (dim >= MAX_DIMENSION)
+        return hashToFloat(hashValues(h, sampleIndex));
+
+    Real v = scrambledRadicalInverse(PRIMES[dim], sampleIndex, &tables->permutations[tables->offsets[dim]]);
+    v += hashToFloat(h);
+    if (v >= 1.f)
+        v -= 1.f;
+    return min(v, ONE_MINUS_EPSILON);
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <vector>
+
+#include "core/sampler.h"
+#include "core/reference.h"
+
+namespace tracer
+{
+
+/*!
+ * Předpočítané tabulky Haltonovy posloupnosti: náhodné permutace číslic
+ * pro každou dimenzi (scrambling). Tabulky jsou sdílené mezi kopiemi sampleru.
+ */
+struct HaltonTables : public ReferenceCounted
+{
+    /*!
+     * Vygeneruje permutace pro všechny podporované dimenze.
+     * \param seed semínko permutací
+     */
+    HaltonTables(uint64_t seed);
+
+    std::vector<uint16_t> permutations; ///< permutace číslic všech dimenzí za sebou
+    std::vector<size_t> offsets; ///< začátek permutace dané dimenze v poli permutations
+};
+
+/*!
+ * Sampler založený na Haltonově posloupnosti s permutovanými číslicemi.
+ * Dimenze d používá radikální inverzi o základu rovném d-tému prvočíslu.
+ * Každý pixel má vlastní Cranley-Pattersonovu rotaci, odvozenou
+ * z jeho polohy, takže sousední pixely nejsou korelované.
+ */
+class HaltonSampler : public Sampler
+{
+public:
+    /*!
+     * Konstruktor. Vygeneruje tabulky permutací.
+     * \param samplesPerPixel předpokládaný počet vzorků na pixel
+     * \param seed semínko
+     */
+    HaltonSampler(int samplesPerPixel, uint64_t seed = 0);
+
+    virtual ~HaltonSampler();
+
+    /*! \copydoc Sampler::clone() */
+    virtual Sampler* clone() const override;
+
+    /*! \copydoc Sampler::name() */
+    virtual const char* name() const override
+    { return "halton"; }
+
+    /*!
+     * Počet dimenzí, pro které jsou předpočítané tabulky. Další dimenze
+     * se vzorkují pseudonáhodně.
+     */
+    static const int MAX_DIMENSION = 32;
+
+protected:
+    /*! \copydoc Sampler::sample() */
+    virtual Real sample(int dim) const override;
+
+private:
+    mutable Reference<HaltonTables> tables; ///< Sdílené tabulky permutací.
+};
+
+}
@@ -0,0 +1,143 @@
+#include "samplers/sobol.h"
+
+#include "core/rng.h"
+
+using namespace tracer;
+
+namespace
+{
+
+/*!
+ * Směrová čísla podle Joe a Kuo (new-joe-kuo-6.21201) pro dimenze 2 až 16.
+ * Dimenze 1 je van der Corputova posloupnost.
+ */
+struct DirectionNumbers
+{
+    int s; ///< stupeň primitivního polynomu
+    uint32_t a; ///< koeficienty polynomu
+    uint32_t m[6]; ///< počáteční směrová čísla
+};
+
+const DirectionNumbers JOE_KUO[SobolSampler::MAX_DIMENSION - 1] = {
+    {1, 0, {1}},
+    {2, 1, {1, 3}},
+    {3, 1, {1, 3, 1}},
+    {3, 2, {1, 1, 1}},
+    {4, 1, {1, 1, 3, 3}},
+    {4, 4, {1, 3, 5, 13}},
+    {5, 2, {1, 1, 5, 5, 17}},
+    {5, 4, {1, 1, 5, 5, 5}},
+    {5, 7, {1, 1, 7, 11, 19}},
+    {5, 11, {1, 1, 5, 1, 1}},
+    {5, 13, {1, 1, 1, 3, 11}},
+    {5, 14, {1, 3, 5, 5, 31}},
+    {6, 1, {1, 3, 3, 9, 7, 49}},
+    {6, 13, {1, 1, 1, 15, 21, 21}},
+    {6, 16, {1, 3, 1, 13, 27, 49}}
+};
+
+/*!
+ * Tabulka generujících matic. Sloupec i dimenze d je 32bitové číslo,
+ * jehož nejvyšší bit odpovídá první číslici výsledku.
+ */
+struct SobolMatrices
+{
+    SobolMatrices()
+    {
+        for (int i = 0; i < 32; ++i)
+            columns[0][i] = 1u << (31 - i);
+
+        for (int d = 1; d < SobolSampler::MAX_DIMENSION; ++d)
+        {
+            const DirectionNumbers& dn = JOE_KUO[d - 1];
+            uint32_t m[32];
+            for (int k = 0; k < dn.s; ++k)
+                m[k] = dn.m[k];
+
+            for (int k = dn.s; k < 32; ++k)
+            {
+                m[k] = m[k - dn.s] ^ (m[k - dn.s] << dn.s);
+                for (int j = 1; j < dn.s; ++j)
+                    if ((dn.a >> (dn.s - 1 - j)) & 1)
+                        m[k] ^= m[k - j] << j;
+            }
+
+            for (int k = 0; k < 32; ++k)
+                columns[d][k] = m[k] << (31 - k);
+        }
+    }
+
+    uint32_t columns[SobolSampler::MAX_DIMENSION][32];
+};
+
+/*!
+ * Tabulka se sestaví jednou při prvním použití (inicializace lokální
+ * statické proměnné je od C++11 bezpečná vůči vláknům).
+ */
+const SobolMatrices& sobolMatrices()
+{
+    static const SobolMatrices matrices;
+    return matrices;
+}
+
+uint32_t sobolSample(uint32_t index, int dim)
+{
+    const uint32_t* c = sobolMatrices().columns[dim];
+    uint32_t v = 0;
+    for (int i = 0; index; index >>= 1, ++i)
+        if (index & 1)
+            v ^= c[i];
+    return v;
+}
+
+/*!
+ * Permutace Laine-Karras ve variantě N. Vegdahla. Pracuje s čísly
+ * s obráceným pořadím bitů, změna bitu tak ovlivňuje jen vyšší bity.
+ */
+uint32_t laineKarrasPermutation(uint32_t x, uint32_t seed)
+{
+    x ^= x * 0x3d20adea;
+    x += seed;
+    x *= (seed >> 16) | 1;
+    x ^= x * 0x05526c56;
+    x ^= x * 0x53a22864;
+    return x;
+}
+
+/*!
+ * Owenův scrambling (nested uniform scramble) pomocí hashe.
+ */
+uint32_t nestedUniformScramble(uint32_t x, uint32_t seed)
+{
+    return reverseBits32(laineKarrasPermutation(reverseBits32(x), seed));
+}
+
+}
+
+SobolSampler::SobolSampler(int samplesPerPixel, uint64_t seed)
+    : Sampler(samplesPerPixel, seed)
+{
+    sobolMatrices();
+}
+
+SobolSampler::~SobolSampler()
+{ }
+
+Sampler* SobolSampler::clone() const
+{
+    return new SobolSampler(*this);
+}
+
+Real SobolSampler::sample(int dim) const
+{
+    const uint64_t h = pixelSeed(dim);
+    if (dim >= MAX_DIMENSION)
+        return hashToFloat(hashValues(h, sampleIndex));
+
+    // Zamíchání pořadí vzorků je společné pro všechny dimenze pixelu.
+    uint32_t shuffle = static_cast<uint32_t>(pixelSeed(-1));
+    uint32_t index = nestedUniformScramble(static_cast<uint32_t>(sampleIndex), shuffle);
+
+    uint32_t v = nestedUniformScramble(sobolSample(index, dim), static_cast<uint32_t>(h));
+    return min(v * 2.3283064365386963e-10f, ONE_MINUS_EPSILON);
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "core/sampler.h"
+
+namespace tracer
+{
+
+/*!
+ * Sampler založený na Sobolově posloupnosti. Generující matice pro všechny
+ * podporované dimenze jsou předpočítané v tabulce, vzorek se tak získá
+ * pouze XORem sloupců odpovídajících jedničkovým bitům indexu.
+ *
+ * Každý pixel má vlastní Owenův scrambling (hashovaná varianta Laine-Karras),
+ * odvozený z polohy pixelu a dimenze, a vlastní zamíchání pořadí vzorků.
+ * Při počtu vzorků rovném mocnině dvou zůstává zachována stratifikace.
+ */
+class SobolSampler : public Sampler
+{
+public:
+    /*!
+     * Konstruktor.
+     * \param samplesPerPixel předpokládaný počet vzorků na pixel (nejlépe mocnina dvou)
+     * \param seed semínko
+     */
+    SobolSampler(int samplesPerPixel, uint64_t seed = 0);
+
+    virtual ~SobolSampler();
+
+    /*! \copydoc Sampler::clone() */
+    virtual Sampler* clone() const override;
+
+    /*! \copydoc Sampler::name() */
+    virtual const char* name() const override
+    { return "sobol"; }
+
+    /*!
+     * Počet dimenzí, pro které jsou předpočítané generující matice.
+     * Další dimenze se vzorkují pseudonáhodně.
+     */
+    static const int MAX_DIMENSION = 16;
+
+protected:
+    /*! \copydoc Sampler::sample() */
+    virtual Real sample(int dim) const override;
+};
+
+}
@@ -0,0 +1,29 @@
+#include "samplers/stratified.h"
+
+#include "core/rng.h"
+
+using namespace tracer;
+
+StratifiedSampler::StratifiedSampler(int samplesPerPixel, uint64_t seed)
+    : Sampler(samplesPerPixel, seed)
+{ }
+
+StratifiedSampler::~StratifiedSampler()
+{ }
+
+Sampler* StratifiedSampler::clone() const
+{
+    return new StratifiedSampler(*this);
+}
+
+Real StratifiedSampler::sample(int dim) const
+{
+    const uint64_t round = sampleIndex / spp;
+    const uint32_t index = static_cast<uint32_t>(sampleIndex % spp);
+    const uint64_t h = hashValues(pixelSeed(dim), round);
+
+    uint32_t stratum = permutationElement(index, static_cast<uint32_t>(spp), static_cast<uint32_t>(h));
+    Real jitter = hashToFloat(mixBits(h ^ (static_cast<uint64_t>(index) << 32)));
+
+    return min((stratum + jitter) / spp, ONE_MINUS_EPSILON);
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "core/sampler.h"
+
+namespace tracer
+{
+
+/*!
+ * Stratifikovaný sampler. Každá dimenze je rozdělena na tolik intervalů,
+ * kolik je vzorků na pixel, a každý vzorek padne do jiného intervalu
+ * (náhodně posunut uvnitř něj). Pořadí intervalů je v každé dimenzi
+ * a pixelu jinak permutováno, takže dvojice dimenzí tvoří latinský čtverec.
+ */
+class StratifiedSampler : public Sampler
+{
+public:
+    /*!
+     * Konstruktor.
+     * \param samplesPerPixel počet vzorků na pixel, tj. počet intervalů
+     * \param seed semínko
+     */
+    StratifiedSampler(int samplesPerPixel, uint64_t seed = 0);
+
+    virtual ~StratifiedSampler();
+
+    /*! \copydoc Sampler::clone() */
+    virtual Sampler* clone() const override;
+
+    /*! \copydoc Sampler::name() */
+    virtual const char* name() const override
+    { return "stratified"; }
+
+protected:
+    /*!
+     * Vzorky s indexem větším než počet vzorků na pixel patří do dalšího
+     * kola, které má vlastní permutaci.
+     * \copydoc Sampler::sample()
+     */
+    virtual Real sample(int dim) const override;
+};
+
+}
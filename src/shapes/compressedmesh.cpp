@@ -0,0 +1,552 @@
+#include "shapes/compressedmesh.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <unordered_map>
+
+#include "acceleration/bvh.h"
+
+using namespace tracer;
+
+namespace
+{
+
+/// Největší počet trojúhelníků bloku, index v bloku má 14 bitů.
+const size_t MAX_CHUNK_TRIANGLES = 1 << 14;
+
+/// Potomek uzlu, který neexistuje (kořen s jediným listem).
+const uint32_t NO_CHILD = 0xFFFFFFFFu;
+
+/// Maximální hloubka zásobníku při průchodu stromem.
+const int MAX_TODO = 64;
+
+/*!
+ * Dekóduje souřadnici kvádru potomka. Krajní hodnoty dávají přesně meze
+ * rodiče, aby se kvádr při zaokrouhlení nezmenšil.
+ * \param lo dolní mez rodiče
+ * \param hi horní mez rodiče
+ * \param step (hi - lo) / 255
+ * \param q zakódovaná hodnota
+ */
+inline Real dequantize(Real lo, Real hi, Real step, uint8_t q)
+{
+    return q == 255 ? hi : lo + q * step;
+}
+
+/*!
+ * Zakóduje interval [cMin; cMax] relativně k [lo; hi] tak, aby ho
+ * dekódovaný interval vždy obsahoval.
+ */
+void quantizeRange(Real lo, Real hi, Real cMin, Real cMax, uint8_t& qMin, uint8_t& qMax)
+{
+    const Real step = (hi - lo) * (1.f / 255.f);
+    int a = 0, b = 255;
+    if (step > 0.f)
+    {
+        a = clamp(static_cast<int>(std::floor((cMin - lo) / step)), 0, 255);
+        b = clamp(static_cast<int>(std::ceil((cMax - lo) / step)), 0, 255);
+        while (a > 0 && dequantize(lo, hi, step, static_cast<uint8_t>(a)) > cMin)
+            --a;
+        while (b < 255 && dequantize(lo, hi, step, static_cast<uint8_t>(b)) < cMax)
+            ++b;
+    }
+    qMin = static_cast<uint8_t>(a);
+    qMax = static_cast<uint8_t>(b);
+}
+
+inline Vector decodeVertex(const Vector& origin, const Vector& scale, const uint16_t* q)
+{
+    return Vector(origin.x + q[0] * scale.x, origin.y + q[1] * scale.y, origin.z + q[2] * scale.z);
+}
+
+inline Real signNotZero(Real v)
+{
+    return v < 0.f ? -1.f : 1.f;
+}
+
+/*!
+ * Oktaedrické kódování normály do dvou 16bitových čísel.
+ */
+void encodeNormal(Vector n, int16_t* out)
+{
+    const Real l1 = std::fabs(n.x) + std::fabs(n.y) + std::fabs(n.z);
+    if (!(l1 > 0.f))
+    {
+        out[0] = out[1] = 0;
+        return;
+    }
+    Real x = n.x / l1, y = n.y / l1;
+    if (n.z < 0.f)
+    {
+        const Real ox = x;
+        x = (1.f - std::fabs(y)) * signNotZero(ox);
+        y = (1.f - std::fabs(ox)) * signNotZero(y);
+    }
+    out[0] = static_cast<int16_t>(std::lround(clamp(x, -1.f, 1.f) * 32767.f));
+    out[1] = static_cast<int16_t>(std::lround(clamp(y, -1.f, 1.f) * 32767.f));
+}
+
+inline Vector decodeNormal(const int16_t* in)
+{
+    Real x = in[0] * (1.f / 32767.f), y = in[1] * (1.f / 32767.f);
+    const Real z = 1.f - std::fabs(x) - std::fabs(y);
+    if (z < 0.f)
+    {
+        const Real ox = x;
+        x = (1.f - std::fabs(y)) * signNotZero(ox);
+        y = (1.f - std::fabs(ox)) * signNotZero(y);
+    }
+    return Vector(x, y, z);
+}
+
+/*!
+ * Test paprsku s kvádrem, vrací i vzdálenost vstupu do kvádru.
+ */
+inline bool hitBox(const BBox& b, const Ray& ray, const Vector& invDir, const int dirIsNeg[3], Real& tNear)
+{
+    Real tMin = ((dirIsNeg[0] ? b.pMax : b.pMin).x - ray.o.x) * invDir.x;
+    Real tMax = ((dirIsNeg[0] ? b.pMin : b.pMax).x - ray.o.x) * invDir.x;
+    Real tyMin = ((dirIsNeg[1] ? b.pMax : b.pMin).y - ray.o.y) * invDir.y;
+    Real tyMax = ((dirIsNeg[1] ? b.pMin : b.pMax).y - ray.o.y) * invDir.y;
+    if (tMin > tyMax || tyMin > tMax)
+        return false;
+    if (tyMin > tMin) tMin = tyMin;
+    if (tyMax < tMax) tMax = tyMax;
+
+    Real tzMin = ((dirIsNeg[2] ? b.pMax : b.pMin).z - ray.o.z) * invDir.z;
+    Real tzMax = ((dirIsNeg[2] ? b.pMin : b.pMax).z - ray.o.z) * invDir.z;
+    if (tMin > tzMax || tzMin > tMax)
+        return false;
+    if (tzMin > tMin) tMin = tzMin;
+    if (tzMax < tMax) tMax = tzMax;
+
+    tNear = tMin;
+    return tMin < ray.maxt && tMax > ray.mint;
+}
+
+/*!
+ * Rozsah trojúhelníků (v pořadí listů) podstromu BVH.
+ */
+void subtreeRange(const std::vector<BVHNode>& nodes, uint32_t index, uint32_t& start, uint32_t& end)
+{
+    uint32_t first = index, last = index;
+    while (!nodes[first].nPrimitives)
+        ++first;
+    while (!nodes[last].nPrimitives)
+        last = nodes[last].offset;
+    start = nodes[first].offset;
+    end = nodes[last].offset + nodes[last].nPrimitives;
+}
+
+}
+
+/*!
+ * Trojúhelníky se nejprve rozloží a postaví se nad nimi dočasná BVH.
+ * Bloky tvoří největší podstromy, které se vejdou do limitu, takže jejich
+ * trojúhelníky leží v pořadí listů za sebou. Po kvantování se spočítají
+ * kvádry uzlů z dekódovaných vrcholů a strom se zakóduje shora dolů.
+ */
+CompressedMesh::CompressedMesh(const Reference<TriangleMesh>& mesh, size_t chunkTriangles)
+    : GeometricPrimitive(Reference<TriangleMesh>(mesh)->material())
+{
+    Reference<TriangleMesh> source(mesh);
+    if (source->numTriangles() == 0)
+        throw std::runtime_error("Cannot compress an empty mesh");
+    chunkTriangles = clamp(chunkTriangles, static_cast<size_t>(1), MAX_CHUNK_TRIANGLES);
+
+    std::vector<Reference<Primitive>> triangles;
+    source->refine(triangles);
+    BVH bvh(triangles);
+    triangles.clear();
+
+    const std::vector<BVHNode>& tree = bvh.nodeArray();
+    const std::vector<Reference<Primitive>>& ordered = bvh.orderedPrimitives();
+    std::vector<uint32_t> order(ordered.size());
+    for (size_t i = 0; i < ordered.size(); ++i)
+    {
+        Reference<Primitive> p(ordered[i]);
+        order[i] = static_cast<uint32_t>(static_cast<const Triangle&>(*p).index());
+    }
+
+    // Bloky jako největší podstromy do limitu, v pořadí listů.
+    std::vector<std::pair<uint32_t, uint32_t>> ranges;
+    std::vector<uint32_t> stack(1, 0);
+    while (!stack.empty())
+    {
+        const uint32_t index = stack.back();
+        stack.pop_back();
+        uint32_t start, end;
+        subtreeRange(tree, index, start, end);
+        if (end - start <= chunkTriangles)
+            ranges.push_back(std::make_pair(start, end));
+        else if (tree[index].nPrimitives)
+            throw std::runtime_error("Mesh has too many triangles with a common centroid to compress");
+        else
+        {
+            stack.push_back(tree[index].offset);
+            stack.push_back(index + 1);
+        }
+    }
+    if (ranges.size() > (NO_CHILD >> 14))
+        throw std::runtime_error("Mesh has too many chunks to compress");
+
+    const Vector* p = source->vertices();
+    const int* idx = source->vertexIndices();
+    const Vector* n = source->vertexNormals();
+    const Real* uv = source->vertexUVs();
+    std::vector<uint32_t> chunkOf(ordered.size());
+    indices.resize(3 * ordered.size());
+
+    chunks.resize(ranges.size());
+    for (size_t c = 0; c < ranges.size(); ++c)
+    {
+        Chunk& chunk = chunks[c];
+        chunk.firstVertex = static_cast<uint32_t>(positions.size() / 3);
+        chunk.firstTriangle = ranges[c].first;
+
+        std::unordered_map<int, uint16_t> local;
+        std::vector<int> used;
+        BBox b;
+        for (uint32_t t = ranges[c].first; t < ranges[c].second; ++t)
+        {
+            chunkOf[t] = static_cast<uint32_t>(c);
+            for (int k = 0; k < 3; ++k)
+            {
+                const int v = idx[3 * order[t] + k];
+                std::unordered_map<int, uint16_t>::iterator it = local.find(v);
+                if (it == local.end())
+                {
+                    it = local.insert(std::make_pair(v, static_cast<uint16_t>(used.size()))).first;
+                    used.push_back(v);
+                    b = unite(b, p[v]);
+                }
+                indices[3 * t + k] = it->second;
+            }
+        }
+
+        const Vector extent = b.diagonal();
+        chunk.origin = b.pMin;
+        chunk.scale = Vector(extent.x / 65535.f, extent.y / 65535.f, extent.z / 65535.f);
+        for (size_t i = 0; i < used.size(); ++i)
+        {
+            const Vector& v = p[used[i]];
+            for (int k = 0; k < 3; ++k)
+            {
+                const Real q = chunk.scale[k] > 0.f ? (v[k] - chunk.origin[k]) / chunk.scale[k] : 0.f;
+                positions.push_back(static_cast<uint16_t>(clamp(std::lround(q), 0L, 65535L)));
+            }
+            if (n)
+            {
+                int16_t e[2];
+                encodeNormal(n[used[i]], e);
+                normals.push_back(e[0]);
+                normals.push_back(e[1]);
+            }
+            if (uv)
+            {
+                uvs.push_back(uv[2 * used[i]]);
+                uvs.push_back(uv[2 * used[i] + 1]);
+            }
+        }
+    }
+
+    // Kvádry uzlů z dekódovaných vrcholů, potomci leží za rodičem.
+    std::vector<BBox> exact(tree.size());
+    std::vector<uint32_t> leaves(tree.size(), 0);
+    for (size_t i = tree.size(); i-- > 0;)
+    {
+        const BVHNode& node = tree[i];
+        if (!node.nPrimitives)
+        {
+            exact[i] = unite(exact[i + 1], exact[node.offset]);
+            continue;
+        }
+
+        const Chunk& chunk = chunks[chunkOf[node.offset]];
+        for (uint32_t t = node.offset; t < node.offset + node.nPrimitives; ++t)
+            for (int k = 0; k < 3; ++k)
+                exact[i] = unite(exact[i], decodeVertex(chunk.origin, chunk.scale,
+                                                        &positions[3 * (chunk.firstVertex + indices[3 * t + k])]));
+        leaves[i] = leaf(chunkOf[node.offset], node.offset - chunk.firstTriangle);
+    }
+
+    box = exact[0];
+    nodes.reserve(tree.size() / 2 + 1);
+    if (!tree[0].nPrimitives)
+    {
+        encode(tree, exact, leaves, 0, box);
+        return;
+    }
+
+    // Kořen je list, uzel má jediného potomka s kvádrem celé sítě.
+    CompressedBVHNode root;
+    for (int k = 0; k < 3; ++k)
+    {
+        root.lo[0][k] = root.lo[1][k] = 0;
+        root.hi[0][k] = root.hi[1][k] = 255;
+    }
+    root.nTriangles[0] = tree[0].nPrimitives;
+    root.child[0] = leaves[0];
+    root.nTriangles[1] = 0;
+    root.child[1] = NO_CHILD;
+    nodes.push_back(root);
+}
+
+CompressedMesh::~CompressedMesh()
+{ }
+
+uint32_t CompressedMesh::encode(const std::vector<BVHNode>& source, const std::vector<BBox>& exact,
+                                const std::vector<uint32_t>& leaves, uint32_t index, const BBox& decoded)
+{
+    const uint32_t nodeIndex = static_cast<uint32_t>(nodes.size());
+    nodes.push_back(CompressedBVHNode());
+
+    const uint32_t children[2] = { index + 1, source[index].offset };
+    for (int c = 0; c < 2; ++c)
+    {
+        const BBox& b = exact[children[c]];
+        for (int k = 0; k < 3; ++k)
+            quantizeRange(decoded.pMin[k], decoded.pMax[k], b.pMin[k], b.pMax[k],
+                          nodes[nodeIndex].lo[c][k], nodes[nodeIndex].hi[c][k]);
+
+        nodes[nodeIndex].nTriangles[c] = source[children[c]].nPrimitives;
+        nodes[nodeIndex].child[c] = leaves[children[c]];
+    }
+
+    BBox childBoxes[2];
+    childBounds(nodes[nodeIndex], decoded, childBoxes);
+    for (int c = 0; c < 2; ++c)
+    {
+        if (!source[children[c]].nPrimitives)
+        {
+            const uint32_t encoded = encode(source, exact, leaves, children[c], childBoxes[c]);
+            nodes[nodeIndex].child[c] = encoded;
+        }
+    }
+    return nodeIndex;
+}
+
+void CompressedMesh::childBounds(const CompressedBVHNode& node, const BBox& parent, BBox children[2])
+{
+    for (int k = 0; k < 3; ++k)
+    {
+        const Real lo = parent.pMin[k], hi = parent.pMax[k];
+        const Real step = (hi - lo) * (1.f / 255.f);
+        for (int c = 0; c < 2; ++c)
+        {
+            children[c].pMin[k] = dequantize(lo, hi, step, node.lo[c][k]);
+            children[c].pMax[k] = dequantize(lo, hi, step, node.hi[c][k]);
+        }
+    }
+}
+
+bool CompressedMesh::intersectLeaf(uint32_t child, uint32_t count, const Ray& ray, Intersection& sr) const
+{
+    const Chunk& chunk = chunks[child >> 14];
+    const uint32_t first = chunk.firstTriangle + (child & 0x3FFF);
+    bool found = false;
+    for (uint32_t t = first; t < first + count; ++t)
+    {
+        const uint16_t* i = &indices[3 * t];
+        const Vector p0 = decodeVertex(chunk.origin, chunk.scale, &positions[3 * (chunk.firstVertex + i[0])]);
+        const Vector p1 = decodeVertex(chunk.origin, chunk.scale, &positions[3 * (chunk.firstVertex + i[1])]);
+        const Vector p2 = decodeVertex(chunk.origin, chunk.scale, &positions[3 * (chunk.firstVertex + i[2])]);
+
+        Real th, b1, b2;
+        if (!Triangle::hit(p0, p1, p2, ray, th, b1, b2) || th >= sr.t)
+            continue;
+
+        const uint32_t v[3] = { chunk.firstVertex + i[0], chunk.firstVertex + i[1], chunk.firstVertex + i[2] };
+        Vector n[3];
+        Real tc[3][2];
+        for (int k = 0; k < 3; ++k)
+        {
+            if (!normals.empty())
+                n[k] = decodeNormal(&normals[2 * v[k]]);
+            if (!uvs.empty())
+            {
+                tc[k][0] = uvs[2 * v[k]];
+                tc[k][1] = uvs[2 * v[k] + 1];
+            }
+        }
+
+        Triangle::shade(p0, p1, p2, normals.empty() ? nullptr : n, uvs.empty() ? nullptr : tc,
+                        th, b1, b2, ray, _material, sr);
+        found = true;
+    }
+    return found;
+}
+
+/*!
+ * V každém uzlu se otestují kvádry obou potomků. Listy se protnou hned,
+ * z vnitřních potomků se pokračuje bližším a vzdálenější se odloží
+ * i s dekódovaným kvádrem.
+ */
+bool CompressedMesh::intersect(const Ray& ray, Intersection& sr)
+{
+    Vector invDir(1.f / ray.d.x, 1.f / ray.d.y, 1.f / ray.d.z);
+    int dirIsNeg[3] = { invDir.x < 0.f, invDir.y < 0.f, invDir.z < 0.f };
+
+    Real tNear;
+    if (!hitBox(box, ray, invDir, dirIsNeg, tNear))
+        return false;
+
+    StackEntry todo[MAX_TODO];
+    int todoOffset = 0;
+    uint32_t current = 0;
+    BBox currentBox = box;
+    bool hit = false;
+    while (true)
+    {
+        const CompressedBVHNode& node = nodes[current];
+        uint32_t next[2];
+        Real nextT[2];
+        BBox nextBox[2];
+        int nNext = 0;
+        BBox boxes[2];
+        childBounds(node, currentBox, boxes);
+        for (int c = 0; c < 2; ++c)
+        {
+            if (node.child[c] == NO_CHILD)
+                continue;
+            const BBox& b = boxes[c];
+            Real t;
+            if (!hitBox(b, ray, invDir, dirIsNeg, t))
+                continue;
+            if (node.nTriangles[c])
+                hit |= intersectLeaf(node.child[c], node.nTriangles[c], ray, sr);
+            else
+            {
+                next[nNext] = node.child[c];
+                nextT[nNext] = t;
+                nextBox[nNext] = b;
+                ++nNext;
+            }
+        }
+
+        // Listy mohly paprsek zkrátit až po testu kvádrů.
+        if (nNext == 2 && !(nextT[1] < ray.maxt))
+            nNext = 1;
+        if (nNext >= 1 && !(nextT[0] < ray.maxt))
+        {
+            --nNext;
+            next[0] = next[1];
+            nextT[0] = nextT[1];
+            nextBox[0] = nextBox[1];
+        }
+
+        if (nNext == 2)
+        {
+            const int nearer = nextT[1] < nextT[0] ? 1 : 0;
+            todo[todoOffset].node = next[1 - nearer];
+            todo[todoOffset].tMin = nextT[1 - nearer];
+            todo[todoOffset].bounds = nextBox[1 - nearer];
+            ++todoOffset;
+            current = next[nearer];
+            currentBox = nextBox[nearer];
+            continue;
+        }
+        if (nNext == 1)
+        {
+            current = next[0];
+            currentBox = nextBox[0];
+            continue;
+        }
+
+        // Odložený uzel může být už za nalezeným průsečíkem.
+        while (todoOffset > 0 && !(todo[todoOffset - 1].tMin < ray.maxt))
+            --todoOffset;
+        if (todoOffset == 0)
+            break;
+        --todoOffset;
+        current = todo[todoOffset].node;
+        currentBox = todo[todoOffset].bounds;
+    }
+
+    return hit;
+}
+
+bool CompressedMesh::intersectP(const Ray& ray)
+{
+    Vector invDir(1.f / ray.d.x, 1.f / ray.d.y, 1.f / ray.d.z);
+    int dirIsNeg[3] = { invDir.x < 0.f, invDir.y < 0.f, invDir.z < 0.f };
+
+    Real t;
+    if (!hitBox(box, ray, invDir, dirIsNeg, t))
+        return false;
+
+    StackEntry todo[MAX_TODO];
+    int todoOffset = 0;
+    uint32_t current = 0;
+    BBox currentBox = box;
+    while (true)
+    {
+        const CompressedBVHNode& node = nodes[current];
+        BBox boxes[2];
+        childBounds(node, currentBox, boxes);
+        for (int c = 0; c < 2; ++c)
+        {
+            if (node.child[c] == NO_CHILD)
+                continue;
+            const BBox& b = boxes[c];
+            if (!hitBox(b, ray, invDir, dirIsNeg, t))
+                continue;
+            if (!node.nTriangles[c])
+            {
+                todo[todoOffset].node = node.child[c];
+                todo[todoOffset].bounds = b;
+                ++todoOffset;
+                continue;
+            }
+
+            const Chunk& chunk = chunks[node.child[c] >> 14];
+            const uint32_t first = chunk.firstTriangle + (node.child[c] & 0x3FFF);
+            for (uint32_t tri = first; tri < first + node.nTriangles[c]; ++tri)
+            {
+                const uint16_t* i = &indices[3 * tri];
+                Real th, b1, b2;
+                if (Triangle::hit(decodeVertex(chunk.origin, chunk.scale, &positions[3 * (chunk.firstVertex + i[0])]),
+                                  decodeVertex(chunk.origin, chunk.scale, &positions[3 * (chunk.firstVertex + i[1])]),
+                                  decodeVertex(chunk.origin, chunk.scale, &positions[3 * (chunk.firstVertex + i[2])]),
+                                  ray, th, b1, b2))
+                    return true;
+            }
+        }
+
+        if (todoOffset == 0)
+            break;
+        --todoOffset;
+        current = todo[todoOffset].node;
+        currentBox = todo[todoOffset].bounds;
+    }
+
+    return false;
+}
+
+BBox CompressedMesh::bounds() const
+{
+    return box;
+}
+
+size_t CompressedMesh::memoryUsage() const
+{
+    return sizeof(*this) + chunks.size() * sizeof(Chunk) + positions.size() * sizeof(uint16_t) +
+           normals.size() * sizeof(int16_t) + uvs.size() * sizeof(Real) + indices.size() * sizeof(uint16_t) +
+           nodes.size() * sizeof(CompressedBVHNode);
+}
+
+Vector CompressedMesh::vertex(size_t tri, int i) const
+{
+    size_t lo = 0, hi = chunks.size();
+    while (hi - lo > 1)
+    {
+        const size_t mid = (lo + hi) / 2;
+        if (chunks[mid].firstTriangle <= tri)
+            lo = mid;
+        else
+            hi = mid;
+    }
+    const Chunk& chunk = chunks[lo];
+    return decodeVertex(chunk.origin, chunk.scale, &positions[3 * (chunk.firstVertex + indices[3 * tri + i])]);
+}
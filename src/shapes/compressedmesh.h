@@ -0,0 +1,185 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "core/primitive.h"
+#include "shapes/trianglemesh.h"
+
+namespace tracer
+{
+
+struct BVHNode;
+
+/*!
+ * Uzel hierarchie komprimované sítě se dvěma potomky. Obalové kvádry
+ * potomků jsou uložené v 8 bitech na souřadnici jako násobky 1/255
+ * kvádru uzlu, ten se při průchodu dekóduje z rodiče (kořen je uložen
+ * zvlášť v plné přesnosti). Dolní rohy se zaokrouhlují dolů a horní
+ * nahoru, dekódovaný kvádr tak vždy obsahuje celý podstrom.
+ */
+struct CompressedBVHNode
+{
+    uint8_t lo[2][3]; ///< Dolní rohy kvádrů potomků.
+    uint8_t hi[2][3]; ///< Horní rohy kvádrů potomků.
+    uint16_t nTriangles[2]; ///< Počet trojúhelníků listu, 0 u vnitřního uzlu.
+    uint32_t child[2]; ///< Index uzlu, u listu blok a první trojúhelník v bloku (CompressedMesh::leaf()).
+};
+
+/*!
+ * Síť trojúhelníků uložená v komprimovaném tvaru pro velké scény, jejichž
+ * vykreslování je omezené pamětí. Trojúhelníky se rozdělí na bloky podle
+ * podstromů BVH. Vrcholy bloku jsou uloženy v 16 bitech na souřadnici
+ * relativně k obalovému kvádru bloku a indexy v 16 bitech v rámci bloku,
+ * normály v 2 x 16 bitech (oktaedrické kódování). Síť počítá průsečík sama
+ * přes vlastní hierarchii s uzly CompressedBVHNode, bez objektů Triangle.
+ *
+ * Oproti TriangleMesh rozložené na trojúhelníky v BVH zabírá síť zhruba
+ * čtvrtinu paměti, za cenu dekódování vrcholů a kvádrů při průchodu.
+ * Trojúhelníky se protínají v kvantovaných polohách vrcholů (odchylka je
+ * nejvýše 1/131070 rozměru bloku) a kvádry uzlů se počítají z nich, žádný
+ * průsečík s kvantovanou sítí se tedy nevynechá.
+ *
+ * Síť se vytvoří z hotové TriangleMesh (i s její transformací), tu pak
+ * už není potřeba držet. Transformace ani rozklad nejsou podporovány.
+ */
+class CompressedMesh : public GeometricPrimitive
+{
+public:
+    /*!
+     * Zkomprimuje síť. Při chybě vyhodí výjimku std::runtime_error.
+     * \param mesh zdrojová síť
+     * \param chunkTriangles největší počet trojúhelníků v bloku (nejvýše 16384)
+     */
+    CompressedMesh(const Reference<TriangleMesh>& mesh, size_t chunkTriangles = 4096);
+
+    virtual ~CompressedMesh();
+
+    /*! \copydoc Primitive::intersect() */
+    virtual bool intersect(const Ray& ray, Intersection& sr) override;
+
+    /*! \copydoc Primitive::intersectP() */
+    virtual bool intersectP(const Ray& ray) override;
+
+    /*!
+     * Síť počítá průsečík sama přes vlastní hierarchii.
+     * \return true
+     */
+    virtual bool canIntersect() const override
+    { return true; }
+
+    /*! Síť se nerozkládá, trojúhelníky existují jen v komprimovaném tvaru. */
+    virtual void refine(std::vector<Reference<Primitive>>& refined) override
+    { return; }
+
+    /*! \copydoc Primitive::bounds() */
+    virtual BBox bounds() const override;
+
+    /*!
+     * \return počet trojúhelníků sítě
+     */
+    size_t numTriangles() const
+    { return indices.size() / 3; }
+
+    /*!
+     * \return počet bloků
+     */
+    size_t numChunks() const
+    { return chunks.size(); }
+
+    /*!
+     * \return počet uzlů hierarchie
+     */
+    size_t numNodes() const
+    { return nodes.size(); }
+
+    /*!
+     * \return velikost polí sítě v bajtech
+     */
+    size_t memoryUsage() const;
+
+    /*!
+     * Dekóduje vrchol trojúhelníku. Blok trojúhelníku se hledá půlením,
+     * metoda neslouží k výpočtu průsečíků.
+     * \param tri index trojúhelníku (v pořadí listů)
+     * \param i pořadí vrcholu v trojúhelníku (0 - 2)
+     */
+    Vector vertex(size_t tri, int i) const;
+
+private:
+    /*!
+     * Blok trojúhelníků se společným kvantováním vrcholů.
+     */
+    struct Chunk
+    {
+        Vector origin; ///< Dolní roh obalového kvádru bloku.
+        Vector scale; ///< Velikost kroku kvantování v každé ose.
+        uint32_t firstVertex; ///< První vrchol bloku.
+        uint32_t firstTriangle; ///< První trojúhelník bloku.
+    };
+
+    /*!
+     * Položka zásobníku při průchodu hierarchií.
+     */
+    struct StackEntry
+    {
+        uint32_t node; ///< Index uzlu.
+        Real tMin; ///< Vzdálenost vstupu do kvádru uzlu.
+        BBox bounds; ///< Dekódovaný kvádr uzlu.
+    };
+
+    /*!
+     * Zakóduje odkaz listu na blok a první trojúhelník v něm.
+     * \param chunk index bloku
+     * \param first index trojúhelníku v bloku
+     */
+    static uint32_t leaf(uint32_t chunk, uint32_t first)
+    { return (chunk << 14) | first; }
+
+    /*!
+     * \param child odkaz listu
+     * \return index prvního trojúhelníku listu v poli sítě
+     */
+    uint32_t leafTriangle(uint32_t child) const
+    { return chunks[child >> 14].firstTriangle + (child & 0x3FFF); }
+
+    /*!
+     * Dekóduje kvádry obou potomků uzlu.
+     * \param node uzel
+     * \param parent dekódovaný kvádr uzlu
+     * \param children slouží k návratu kvádrů potomků
+     */
+    static void childBounds(const CompressedBVHNode& node, const BBox& parent, BBox children[2]);
+
+    /*!
+     * Rekurzivně zakóduje podstrom dočasné BVH.
+     * \param source uzly dočasné BVH
+     * \param exact kvádry uzlů dočasné BVH spočítané z kvantovaných vrcholů
+     * \param leaves odkazy listů dočasné BVH na bloky
+     * \param index uzel dočasné BVH (vnitřní)
+     * \param decoded dekódovaný kvádr uzlu
+     * \return index nového uzlu
+     */
+    uint32_t encode(const std::vector<BVHNode>& source, const std::vector<BBox>& exact,
+                    const std::vector<uint32_t>& leaves, uint32_t index, const BBox& decoded);
+
+    /*!
+     * Průsečík s trojúhelníky listu.
+     * \param child odkaz listu
+     * \param count počet trojúhelníků
+     * \param ray paprsek, při zásahu se zkrátí
+     * \param sr průsečík
+     * \return jestli se našel bližší průsečík
+     */
+    bool intersectLeaf(uint32_t child, uint32_t count, const Ray& ray, Intersection& sr) const;
+
+    std::vector<Chunk> chunks; ///< Bloky.
+    std::vector<uint16_t> positions; ///< Kvantované vrcholy (3 na vrchol).
+    std::vector<int16_t> normals; ///< Oktaedricky zakódované normály (2 na vrchol) nebo prázdné.
+    std::vector<Real> uvs; ///< Texturové souřadnice (2 na vrchol) nebo prázdné.
+    std::vector<uint16_t> indices; ///< Indexy vrcholů v rámci bloku (3 na trojúhelník).
+    std::vector<CompressedBVHNode> nodes; ///< Uzly hierarchie v pořadí průchodu do hloubky.
+    BBox box; ///< Obalový kvádr sítě (kořene).
+};
+
+}
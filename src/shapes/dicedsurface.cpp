@@ -0,0 +1,394 @@
+#include "shapes/dicedsurface.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+#include "acceleration/bvh.h"
+#include "core/intersection.h"
+
+using namespace tracer;
+
+namespace
+{
+
+/*!
+ * Hash polohy vrcholu podle bitů souřadnic, pro spojení vrcholů se
+ * stejnou polohou.
+ */
+struct PositionHash
+{
+    size_t operator()(const Vector& p) const
+    {
+        uint32_t bits[3];
+        memcpy(&bits[0], &p.x, sizeof(uint32_t));
+        memcpy(&bits[1], &p.y, sizeof(uint32_t));
+        memcpy(&bits[2], &p.z, sizeof(uint32_t));
+        uint64_t h = 0xCBF29CE484222325ull;
+        for (int k = 0; k < 3; ++k)
+            h = (h ^ bits[k]) * 0x100000001B3ull;
+        return static_cast<size_t>(h);
+    }
+};
+
+struct PositionEqual
+{
+    bool operator()(const Vector& a, const Vector& b) const
+    { return a.x == b.x && a.y == b.y && a.z == b.z; }
+};
+
+/*!
+ * Zástupce záplaty v horní BVH. Drží jen obalový kvádr, rozdělenou
+ * záplatu si při průsečíku vyžádá z cache.
+ */
+class PatchProxy : public Primitive
+{
+public:
+    PatchProxy(const DicedSurface* surface, size_t index, const BBox& box)
+        : surface(surface), index(index), box(box)
+    { }
+
+    virtual bool intersect(const Ray& ray, Intersection& sr) override
+    {
+        const Real maxt = ray.maxt;
+        Reference<GeometryChunk> patch = surface->patch(index);
+        patch->bvh->intersect(ray, sr);
+        return ray.maxt < maxt;
+    }
+
+    virtual bool intersectP(const Ray& ray) override
+    {
+        Reference<GeometryChunk> patch = surface->patch(index);
+        return patch->bvh->intersectP(ray);
+    }
+
+    virtual bool canIntersect() const override
+    { return true; }
+
+    virtual void refine(std::vector<Reference<Primitive>>& refined) override
+    { return; }
+
+    virtual BBox bounds() const override
+    { return box; }
+
+private:
+    const DicedSurface* surface; ///< Plocha, ke které záplata patří (zástupce ji přežívá jen uvnitř ní).
+    size_t index; ///< Index záplaty.
+    BBox box; ///< Obalový kvádr záplaty.
+};
+
+}
+
+DicedSurface::DicedSurface(const Reference<TriangleMesh>& control, const Reference<GeometryCache>& cache,
+                           const Reference<Texture>& displacement, Real displacementScale, Real rate)
+    : GeometricPrimitive(Reference<TriangleMesh>(control)->material()),
+      control(control),
+      displaced(false),
+      displacementScale(displacementScale),
+      cache(cache),
+      displacement(displacement),
+      rate(rate),
+      hasCamera(false),
+      spread(0.f),
+      id(GeometryChunk::newOwnerId()),
+      top(nullptr),
+      tessellations(0)
+{
+    const size_t nVertices = this->control->numVertices();
+    const size_t nPatches = this->control->numTriangles();
+    if (nPatches == 0)
+        throw std::runtime_error("Cannot tessellate an empty mesh");
+    if (!(rate > 0.f))
+        throw std::runtime_error("Dicing rate must be positive");
+    displaced = &*this->displacement != nullptr && displacementScale != 0.f;
+    if (displaced && !this->control->vertexUVs())
+        throw std::runtime_error("Displacement requires texture coordinates");
+
+    const Vector* p = this->control->vertices();
+    const int* indices = this->control->vertexIndices();
+
+    // Vrcholy se stejnou polohou se spojí, záplaty se na společné hraně
+    // shodnou, i když je síť rozdělená podle normál nebo souřadnic.
+    weld.resize(nVertices);
+    {
+        std::unordered_map<Vector, int, PositionHash, PositionEqual> first;
+        for (size_t i = 0; i < nVertices; ++i)
+            weld[i] = first.insert(std::make_pair(p[i], static_cast<int>(i))).first->second;
+    }
+
+    if (displaced)
+    {
+        // Hrany a vrcholy, jejichž záplaty mají různé texturové souřadnice.
+        const Real* uv = this->control->vertexUVs();
+        std::unordered_map<uint64_t, std::vector<Real>> edges;
+        std::unordered_map<int, std::vector<Real>> corners;
+        for (size_t i = 0; i < nPatches; ++i)
+        {
+            const int* v = indices + 3 * i;
+            for (int k = 0; k < 3; ++k)
+            {
+                int a = v[k], b = v[(k + 1) % 3];
+                if (!before(a, b))
+                    std::swap(a, b);
+                const Real ends[4] = { uv[2 * a], uv[2 * a + 1], uv[2 * b], uv[2 * b + 1] };
+                addUnique(edges[edgeKey(a, b)], ends, 4);
+                addUnique(corners[weld[v[k]]], uv + 2 * v[k], 2);
+            }
+        }
+        for (std::unordered_map<uint64_t, std::vector<Real>>::iterator it = edges.begin(); it != edges.end(); ++it)
+            if (it->second.size() > 4)
+                seamEdges.insert(*it);
+        for (std::unordered_map<int, std::vector<Real>>::iterator it = corners.begin(); it != corners.end(); ++it)
+            if (it->second.size() > 2)
+                seamVertices.insert(*it);
+    }
+}
+
+DicedSurface::~DicedSurface()
+{
+    delete top;
+    for (size_t i = 0; i < patchBounds.size(); ++i)
+        cache->erase((id << 32) | i);
+}
+
+void DicedSurface::build()
+{
+    // Posunutí vzdálí plochu od obalu záplaty nejvýše o |displacementScale|.
+    const Real offset = displaced ? std::fabs(displacementScale) : 0.f;
+    const size_t nPatches = control->numTriangles();
+    patchBounds.resize(nPatches);
+    std::vector<Reference<Primitive>> proxies;
+    proxies.reserve(nPatches);
+    for (size_t i = 0; i < nPatches; ++i)
+    {
+        BBox b = patchHull(i);
+        Real magnitude = 1.f;
+        for (int k = 0; k < 3; ++k)
+            magnitude = std::max(magnitude, std::max(std::fabs(b.pMin[k]), std::fabs(b.pMax[k])));
+        const Real pad = offset + 1e-5f * magnitude;
+        b.pMin = b.pMin - Vector(pad, pad, pad);
+        b.pMax = b.pMax + Vector(pad, pad, pad);
+
+        patchBounds[i] = b;
+        box = unite(box, b);
+        proxies.push_back(new PatchProxy(this, i, b));
+    }
+    top = new BVH(proxies, 1);
+}
+
+bool DicedSurface::intersect(const Ray& ray, Intersection& sr)
+{
+    const Real maxt = ray.maxt;
+    top->intersect(ray, sr);
+    return ray.maxt < maxt;
+}
+
+bool DicedSurface::intersectP(const Ray& ray)
+{
+    return top->intersectP(ray);
+}
+
+BBox DicedSurface::bounds() const
+{
+    return box;
+}
+
+void DicedSurface::setDicingCamera(const Vector& eye, Real spread)
+{
+    this->eye = eye;
+    this->spread = spread;
+    hasCamera = true;
+    for (size_t i = 0; i < patchBounds.size(); ++i)
+        cache->erase((id << 32) | i);
+}
+
+int DicedSurface::level(size_t i) const
+{
+    const int* v = control->vertexIndices() + 3 * i;
+    return std::max(std::max(edgeLevel(v[0], v[1]), edgeLevel(v[1], v[2])), edgeLevel(v[2], v[0]));
+}
+
+Reference<GeometryChunk> DicedSurface::patch(size_t i) const
+{
+    return cache->get((id << 32) | i, [this, i](size_t& size) { return tessellate(i, size); });
+}
+
+DicedSurface::SurfacePoint DicedSurface::lerp(const SurfacePoint& a, const SurfacePoint& b, Real f)
+{
+    SurfacePoint sp = a;
+    sp.p = sp.p + f * (b.p - sp.p);
+    sp.n = sp.n + f * (b.n - sp.n);
+    if (sp.n.length() > 0.f)
+        sp.n.normalize();
+    sp.uv[0] += f * (b.uv[0] - sp.uv[0]);
+    sp.uv[1] += f * (b.uv[1] - sp.uv[1]);
+    return sp;
+}
+
+void DicedSurface::addUnique(std::vector<Real>& list, const Real* values, size_t n)
+{
+    for (size_t i = 0; i < list.size(); i += n)
+        if (std::equal(values, values + n, list.begin() + i))
+            return;
+    list.insert(list.end(), values, values + n);
+}
+
+bool DicedSurface::before(int a, int b) const
+{
+    const Vector& pa = control->vertices()[a];
+    const Vector& pb = control->vertices()[b];
+    if (pa.x != pb.x)
+        return pa.x < pb.x;
+    if (pa.y != pb.y)
+        return pa.y < pb.y;
+    if (pa.z != pb.z)
+        return pa.z < pb.z;
+    return weld[a] < weld[b];
+}
+
+/*!
+ * Vzdálenost od kamery se měří od středu hrany (edgeExtent()) zmenšená
+ * o největší posunutí. Počet dílků se zaokrouhlí nahoru na mocninu dvou,
+ * hrubší dělení hrany tak vždy dělí jemnější dělení vnitřku záplaty.
+ */
+int DicedSurface::edgeLevel(int a, int b) const
+{
+    if (!hasCamera)
+        return DEFAULT_LEVEL;
+    if (!before(a, b))
+        std::swap(a, b);
+
+    Vector mid;
+    Real length;
+    edgeExtent(a, b, mid, length);
+    const Real distance = (mid - eye).length() - (displaced ? std::fabs(displacementScale) : 0.f);
+
+    const Real target = rate * spread * distance;
+    if (!(target > 0.f))
+        return MAX_LEVEL;
+    const Real segments = length / target;
+    int level = 1;
+    while (level < MAX_LEVEL && level < segments)
+        level *= 2;
+    return level;
+}
+
+/*!
+ * Seznamy švů jsou stejné pro všechny záplaty hrany i vrcholu a sčítají
+ * se ve stejném pořadí, výška tak vyjde na bit stejná.
+ */
+Real DicedSurface::edgeHeight(int a, int b, int k, int level, const SurfacePoint& s) const
+{
+    if (k == 0 || k == level)
+    {
+        std::unordered_map<int, std::vector<Real>>::const_iterator it = seamVertices.find(weld[k == 0 ? a : b]);
+        if (it == seamVertices.end())
+            return height(s, s.uv[0], s.uv[1]);
+        Real sum = 0.f;
+        for (size_t i = 0; i < it->second.size(); i += 2)
+            sum += height(s, it->second[i], it->second[i + 1]);
+        return sum / static_cast<Real>(it->second.size() / 2);
+    }
+
+    std::unordered_map<uint64_t, std::vector<Real>>::const_iterator it = seamEdges.find(edgeKey(a, b));
+    if (it == seamEdges.end())
+        return height(s, s.uv[0], s.uv[1]);
+    const Real f = static_cast<Real>(k) / static_cast<Real>(level);
+    Real sum = 0.f;
+    for (size_t i = 0; i < it->second.size(); i += 4)
+    {
+        const Real* e = &it->second[i];
+        sum += height(s, (1.f - f) * e[0] + f * e[2], (1.f - f) * e[1] + f * e[3]);
+    }
+    return sum / static_cast<Real>(it->second.size() / 4);
+}
+
+void DicedSurface::displace(SurfacePoint& sp) const
+{
+    if (!displaced)
+        return;
+
+    sp.p = sp.p + (height(sp, sp.uv[0], sp.uv[1]) * displacementScale) * sp.d;
+}
+
+Real DicedSurface::height(const SurfacePoint& s, Real u, Real v) const
+{
+    Intersection in;
+    in.hitPoint = s.p;
+    in.normal = s.d;
+    in.u = u;
+    in.v = v;
+    const RGBColor c = displacement->evaluate(in);
+    return clamp((c.r + c.g + c.b) / 3.f, 0.f, 1.f);
+}
+
+void DicedSurface::patchUVs(size_t i, Real uvs[3][2]) const
+{
+    const int* v = control->vertexIndices() + 3 * i;
+    const Real* uv = control->vertexUVs();
+    const Real defaults[3][2] = { { 0.f, 0.f }, { 1.f, 0.f }, { 1.f, 1.f } };
+    for (int k = 0; k < 3; ++k)
+    {
+        uvs[k][0] = uv ? uv[2 * v[k]] : defaults[k][0];
+        uvs[k][1] = uv ? uv[2 * v[k] + 1] : defaults[k][1];
+    }
+}
+
+/*!
+ * Posunuté záplaty nemají normály ve vrcholech, stínuje se podle normál
+ * dílčích trojúhelníků.
+ */
+GeometryChunk* DicedSurface::tessellate(size_t i, size_t& size) const
+{
+    tessellations.fetch_add(1);
+
+    const int levels = level(i);
+    const size_t nVertices = gridSize(levels);
+    std::vector<SurfacePoint> points(nVertices);
+    evaluate(i, levels, points);
+
+    std::vector<Vector> vertices(nVertices);
+    std::vector<Vector> vertexNormals(displaced ? 0 : nVertices);
+    std::vector<Real> vertexUVs(2 * nVertices);
+    for (size_t k = 0; k < nVertices; ++k)
+    {
+        vertices[k] = points[k].p;
+        if (!displaced)
+            vertexNormals[k] = points[k].n;
+        vertexUVs[2 * k] = points[k].uv[0];
+        vertexUVs[2 * k + 1] = points[k].uv[1];
+    }
+
+    std::vector<int> indices;
+    indices.reserve(3 * static_cast<size_t>(levels) * levels);
+    for (int r = 0; r < levels; ++r)
+    {
+        for (int c = 0; c < levels - r; ++c)
+        {
+            const int i00 = static_cast<int>(gridIndex(levels, r, c)), i01 = i00 + 1;
+            const int i10 = static_cast<int>(gridIndex(levels, r + 1, c)), i11 = i10 + 1;
+            indices.push_back(i00);
+            indices.push_back(i01);
+            indices.push_back(i10);
+            if (c + 1 < levels - r)
+            {
+                indices.push_back(i01);
+                indices.push_back(i11);
+                indices.push_back(i10);
+            }
+        }
+    }
+
+    const size_t nTriangles = indices.size() / 3;
+    Reference<TriangleMesh> mesh(new TriangleMesh(_material, std::move(vertices), std::move(indices),
+                                                  std::move(vertexNormals), std::move(vertexUVs)));
+    std::vector<Reference<Primitive>> triangles;
+    mesh->refine(triangles);
+    BVH* bvh = new BVH(triangles);
+
+    size = nVertices * ((displaced ? 1 : 2) * sizeof(Vector) + 2 * sizeof(Real)) +
+           nTriangles * (3 * sizeof(int) + sizeof(Triangle) + 2 * sizeof(Reference<Primitive>)) +
+           bvh->numNodes() * sizeof(BVHNode);
+    return new GeometryChunk(mesh, bvh);
+}
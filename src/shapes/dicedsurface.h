@@ -0,0 +1,284 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "core/primitive.h"
+#include "core/texture.h"
+#include "shapes/pagedmesh.h"
+#include "shapes/trianglemesh.h"
+
+namespace tracer
+{
+
+class BVH;
+
+/*!
+ * Společný základ hladkých ploch zadaných řídicí sítí trojúhelníků, které
+ * se dělí na drobné trojúhelníky až ve chvíli, kdy paprsek dojde
+ * k obalovému kvádru záplaty. Každý trojúhelník řídicí sítě je jedna
+ * záplata. Tvar plochy v záplatě určuje potomek (evaluate()), základ se
+ * stará o hustotu dělení, posunutí výškovou texturou a cache.
+ *
+ * Hustota dělení se řídí kamerou pro dělení (setDicingCamera()): hrana
+ * záplaty se rozdělí tak, aby dílčí hrany měly na obrazovce přibližně
+ * zadaný počet pixelů. Počty dílků hran jsou mocniny dvou a počítají se
+ * jen z dat hrany, sousední záplaty se na společné hraně shodnou. Vnitřek
+ * záplaty se dělí rovnoměrně podle nejjemnější hrany a vrcholy na hrubších
+ * hranách se posunou na lomenou čáru hrubšího dělení, plocha tak nemá
+ * trhliny.
+ *
+ * Vrcholy řídicí sítě se stejnou polohou (MeshLoader je rozdělí podle
+ * normál a texturových souřadnic) se pro vyhodnocení hran spojí (weld).
+ * Na švech textury se výška posunutí hrany počítá jako průměr výšek pro
+ * texturové souřadnice všech záplat hrany (u vrcholu všech jeho záplat),
+ * vnitřek záplaty používá její vlastní souřadnice.
+ *
+ * Rozdělené záplaty (síť a BVH) drží GeometryCache s pevným rozpočtem,
+ * vyřazená záplata se při dalším zásahu rozdělí znovu. V paměti trvale
+ * zůstává jen řídicí síť, obalové kvádry záplat a horní BVH nad nimi.
+ */
+class DicedSurface : public GeometricPrimitive
+{
+public:
+    static const int DEFAULT_LEVEL = 8; ///< Počet dílků hrany bez kamery pro dělení.
+    static const int MAX_LEVEL = 64; ///< Největší počet dílků hrany.
+
+    virtual ~DicedSurface();
+
+    DicedSurface(const DicedSurface&) = delete;
+    DicedSurface& operator=(const DicedSurface&) = delete;
+
+    /*! \copydoc Primitive::intersect() */
+    virtual bool intersect(const Ray& ray, Intersection& sr) override;
+
+    /*! \copydoc Primitive::intersectP() */
+    virtual bool intersectP(const Ray& ray) override;
+
+    /*!
+     * Plocha počítá průsečík sama přes horní BVH nad záplatami.
+     * \return true
+     */
+    virtual bool canIntersect() const override
+    { return true; }
+
+    /*! Plocha se nerozkládá, záplaty se dělí až při průsečíku. */
+    virtual void refine(std::vector<Reference<Primitive>>& refined) override
+    { return; }
+
+    /*! \copydoc Primitive::bounds() */
+    virtual BBox bounds() const override;
+
+    /*!
+     * Nastaví kameru, podle které se určuje hustota dělení, a zahodí už
+     * rozdělené záplaty. Volá se před vykreslováním.
+     * \param eye bod pozorovatele
+     * \param spread šířka pixelu ve vzdálenosti 1 od kamery (jako Ray::spread)
+     */
+    void setDicingCamera(const Vector& eye, Real spread);
+
+    /*!
+     * \return počet záplat (trojúhelníků řídicí sítě)
+     */
+    size_t numPatches() const
+    { return patchBounds.size(); }
+
+    /*!
+     * \return kolikrát se záplata rozdělila, včetně opakování po vyřazení z cache
+     */
+    size_t numTessellations() const
+    { return tessellations.load(); }
+
+    /*!
+     * \param i index záplaty
+     * \return počet dílků hran vnitřku záplaty
+     */
+    int level(size_t i) const;
+
+    /*!
+     * Vrátí rozdělenou záplatu, pokud není v cache, rozdělí ji.
+     * \param i index záplaty
+     */
+    Reference<GeometryChunk> patch(size_t i) const;
+
+protected:
+    /*!
+     * Bod plochy s normálou a texturovými souřadnicemi.
+     */
+    struct SurfacePoint
+    {
+        Vector p; ///< Poloha.
+        Vector n; ///< Normála pro stínování.
+        Vector d; ///< Směr posunutí, na hranách společný všem záplatám hrany.
+        Real uv[2]; ///< Texturové souřadnice.
+    };
+
+    /*!
+     * Konstruktor. Ověří parametry, spojí vrcholy a najde švy textury.
+     * Potomek po přípravě vlastních dat zavolá build(). Při chybě vyhodí
+     * výjimku std::runtime_error.
+     * \param control řídicí síť
+     * \param cache cache rozdělených záplat
+     * \param displacement výšková textura (průměr složek oříznutý na <0; 1>)
+     *                     nebo nullptr, s texturou musí mít řídicí síť
+     *                     texturové souřadnice
+     * \param displacementScale posunutí podél normály pro výšku 1
+     * \param rate požadovaná délka dílčí hrany v pixelech
+     */
+    DicedSurface(const Reference<TriangleMesh>& control, const Reference<GeometryCache>& cache,
+                 const Reference<Texture>& displacement, Real displacementScale, Real rate);
+
+    /*!
+     * Spočítá obalové kvádry záplat (patchHull() rozšířený o největší
+     * posunutí) a postaví nad nimi horní BVH.
+     */
+    void build();
+
+    /*!
+     * Obalový kvádr záplaty bez posunutí.
+     * \param i index záplaty
+     */
+    virtual BBox patchHull(size_t i) const = 0;
+
+    /*!
+     * Odhad tvaru hrany pro hustotu dělení. Musí záviset jen na hraně,
+     * ne na záplatě. Volá se s vrcholy v pořadí before().
+     * \param a první vrchol hrany
+     * \param b druhý vrchol hrany
+     * \param mid slouží k návratu středu hrany
+     * \param length slouží k návratu délky hrany
+     */
+    virtual void edgeExtent(int a, int b, Vector& mid, Real& length) const = 0;
+
+    /*!
+     * Vyhodnotí posunuté vrcholy dělení záplaty. Vrcholy tvoří
+     * trojúhelníkovou mřížku (gridIndex()): řádek r má barycentrickou
+     * souřadnici třetího vrcholu r / levels, sloupec c druhého vrcholu
+     * c / levels. Vrcholy na hranách musí vyjít stejně ze všech záplat hrany.
+     * \param i index záplaty
+     * \param levels počet dílků hran vnitřku záplaty (level())
+     * \param points slouží k návratu vrcholů, má velikost gridSize(levels)
+     */
+    virtual void evaluate(size_t i, int levels, std::vector<SurfacePoint>& points) const = 0;
+
+    /*!
+     * \param levels počet dílků hrany
+     * \return počet vrcholů trojúhelníkové mřížky
+     */
+    static size_t gridSize(int levels)
+    { return static_cast<size_t>(levels + 1) * (levels + 2) / 2; }
+
+    /*!
+     * \param levels počet dílků hrany
+     * \param r řádek
+     * \param c sloupec
+     * \return index vrcholu mřížky
+     */
+    static size_t gridIndex(int levels, int r, int c)
+    { return static_cast<size_t>(r) * (levels + 1) - static_cast<size_t>(r) * (r - 1) / 2 + c; }
+
+    /*!
+     * Lineární interpolace bodů plochy, pro vrcholy vnitřku ležící
+     * na hrubší hraně.
+     * \param a bod pro f = 0
+     * \param b bod pro f = 1
+     * \param f parametr
+     */
+    static SurfacePoint lerp(const SurfacePoint& a, const SurfacePoint& b, Real f);
+
+    /*!
+     * Přidá do seznamu n-tici hodnot, pokud v něm ještě není.
+     * \param list seznam n-tic
+     * \param values přidávaná n-tice
+     * \param n délka n-tice
+     */
+    static void addUnique(std::vector<Real>& list, const Real* values, size_t n);
+
+    /*!
+     * Pořadí koncových vrcholů hrany, ve kterém se hrana vyhodnocuje. Řadí
+     * se podle polohy a spojených vrcholů, takže se shodnou i záplaty,
+     * jejichž vrcholy na hraně jsou rozdělené kvůli normálám nebo
+     * texturovým souřadnicím.
+     * \return jestli se hrana vyhodnocuje od vrcholu a k vrcholu b
+     */
+    bool before(int a, int b) const;
+
+    /*!
+     * Počet dílků hrany. Závisí jen na koncových vrcholech, nikoli na záplatě.
+     * \param a index vrcholu řídicí sítě
+     * \param b index vrcholu řídicí sítě
+     */
+    int edgeLevel(int a, int b) const;
+
+    /*!
+     * Klíč hrany mezi spojenými vrcholy.
+     * \param a první vrchol hrany (v pořadí before())
+     * \param b druhý vrchol hrany
+     */
+    uint64_t edgeKey(int a, int b) const
+    { return (static_cast<uint64_t>(weld[a]) << 32) | static_cast<uint32_t>(weld[b]); }
+
+    /*!
+     * Posune bod podél směru posunutí podle výškové textury.
+     */
+    void displace(SurfacePoint& s) const;
+
+    /*!
+     * Výška výškové textury v bodě.
+     * \param s bod plochy (poloha a směr posunutí)
+     * \param u vodorovná texturová souřadnice
+     * \param v svislá texturová souřadnice
+     * \return výška oříznutá na <0; 1>
+     */
+    Real height(const SurfacePoint& s, Real u, Real v) const;
+
+    /*!
+     * Výška bodu hrany společná všem záplatám hrany. Mimo švy textury je
+     * to výška pro souřadnice bodu.
+     * \param a první vrchol hrany (v pořadí before())
+     * \param b druhý vrchol hrany
+     * \param k pořadí bodu na hraně
+     * \param level počet dílků hrany
+     * \param s bod hrany před posunutím
+     */
+    Real edgeHeight(int a, int b, int k, int level, const SurfacePoint& s) const;
+
+    /*!
+     * Texturové souřadnice vrcholů záplaty, bez nich parametrizace
+     * (0,0), (1,0), (1,1) jako u Triangle.
+     * \param i index záplaty
+     * \param uvs slouží k návratu souřadnic
+     */
+    void patchUVs(size_t i, Real uvs[3][2]) const;
+
+    mutable Reference<TriangleMesh> control; ///< Řídicí síť.
+    std::vector<int> weld; ///< Pro každý vrchol řídicí sítě první vrchol se stejnou polohou.
+    bool displaced; ///< Jestli se plocha posouvá.
+    Real displacementScale; ///< Posunutí pro výšku 1.
+
+private:
+    /*!
+     * Rozdělí záplatu.
+     * \param i index záplaty
+     * \param size slouží k návratu odhadu paměti záplaty
+     */
+    GeometryChunk* tessellate(size_t i, size_t& size) const;
+
+    std::unordered_map<uint64_t, std::vector<Real>> seamEdges; ///< Různé souřadnice konců hran na švech textury (po čtveřicích).
+    std::unordered_map<int, std::vector<Real>> seamVertices; ///< Různé souřadnice spojených vrcholů na švech textury (po dvojicích).
+    mutable Reference<GeometryCache> cache; ///< Cache rozdělených záplat.
+    mutable Reference<Texture> displacement; ///< Výšková textura.
+    Real rate; ///< Požadovaná délka dílčí hrany v pixelech.
+    bool hasCamera; ///< Jestli je nastavena kamera pro dělení.
+    Vector eye; ///< Bod pozorovatele kamery pro dělení.
+    Real spread; ///< Šířka pixelu ve vzdálenosti 1 od kamery.
+    uint64_t id; ///< Identifikátor plochy v cache.
+    std::vector<BBox> patchBounds; ///< Obalové kvádry záplat.
+    BBox box; ///< Obalový kvádr plochy.
+    BVH* top; ///< Horní BVH nad záplatami.
+    mutable std::atomic<size_t> tessellations; ///< Počet rozdělení záplat.
+};
+
+}
@@ -0,0 +1,511 @@
+#include "shapes/pagedmesh.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "acceleration/bvh.h"
+#include "core/parallel.h"
+#include "importers/meshloader.h"
+
+using namespace tracer;
+
+namespace
+{
+
+const char MAGIC[8] = { 'T', 'R', 'P', 'A', 'G', 'E', 'D', '\0' };
+const uint32_t VERSION = 2;
+
+/*!
+ * Hlavička souboru bloků, za ní následuje tabulka bloků a data bloků.
+ */
+struct Header
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t recordSize; ///< sizeof(ChunkRecord), kontrola rozložení
+    uint64_t key;
+    uint64_t nChunks;
+    uint64_t nTriangles;
+    uint64_t fileSize;
+};
+
+inline uint64_t hashWord(uint64_t h, uint32_t word)
+{
+    return (h ^ word) * 0x100000001B3ull;
+}
+
+inline uint64_t hashBytes(uint64_t h, const void* data, size_t size)
+{
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; ++i)
+        h = hashWord(h, bytes[i]);
+    return h;
+}
+
+/*!
+ * Přečte ze souboru přesně zadaný počet bajtů.
+ */
+bool readAt(int fd, void* data, size_t size, uint64_t offset)
+{
+    char* p = static_cast<char*>(data);
+    while (size > 0)
+    {
+        const ssize_t n = pread(fd, p, size, static_cast<off_t>(offset));
+        if (n <= 0)
+            return false;
+        p += n;
+        size -= static_cast<size_t>(n);
+        offset += static_cast<uint64_t>(n);
+    }
+    return true;
+}
+
+/*!
+ * Zapíše do souboru přesně zadaný počet bajtů.
+ */
+bool writeAt(int fd, const void* data, size_t size, uint64_t offset)
+{
+    const char* p = static_cast<const char*>(data);
+    while (size > 0)
+    {
+        const ssize_t n = pwrite(fd, p, size, static_cast<off_t>(offset));
+        if (n <= 0)
+            return false;
+        p += n;
+        size -= static_cast<size_t>(n);
+        offset += static_cast<uint64_t>(n);
+    }
+    return true;
+}
+
+/*!
+ * Zástupce bloku v horní BVH. Má obalový kvádr bloku, průsečík počítá
+ * s blokem, který si teprve při tom vyžádá z cache.
+ */
+class ChunkProxy : public Primitive
+{
+public:
+    ChunkProxy(const PagedMesh* mesh, size_t index, const BBox& box)
+        : mesh(mesh), index(index), box(box)
+    { }
+
+    virtual bool intersect(const Ray& ray, Intersection& sr) override
+    {
+        const Real maxt = ray.maxt;
+        Reference<GeometryChunk> chunk = mesh->chunk(index);
+        if (chunk->bvh)
+            chunk->bvh->intersect(ray, sr);
+        return ray.maxt < maxt;
+    }
+
+    virtual bool intersectP(const Ray& ray) override
+    {
+        Reference<GeometryChunk> chunk = mesh->chunk(index);
+        return chunk->bvh && chunk->bvh->intersectP(ray);
+    }
+
+    virtual bool canIntersect() const override
+    { return true; }
+
+    virtual void refine(std::vector<Reference<Primitive>>& refined) override
+    { return; }
+
+    virtual BBox bounds() const override
+    { return box; }
+
+private:
+    const PagedMesh* mesh; ///< Síť, ke které blok patří (zástupce ji přežívá jen uvnitř ní).
+    size_t index; ///< Index bloku.
+    BBox box; ///< Obalový kvádr bloku.
+};
+
+}
+
+/************************************************************************/
+/* GeometryChunk methods                                                */
+/************************************************************************/
+
+GeometryChunk::GeometryChunk(const Reference<TriangleMesh>& mesh, BVH* bvh)
+    : mesh(mesh),
+      bvh(bvh)
+{ }
+
+GeometryChunk::~GeometryChunk()
+{
+    delete bvh;
+}
+
+uint64_t GeometryChunk::newOwnerId()
+{
+    static std::atomic<uint32_t> nextId(0);
+    return nextId.fetch_add(1);
+}
+
+/************************************************************************/
+/* PagedMesh methods                                                    */
+/************************************************************************/
+
+PagedMesh* PagedMesh::create(const Reference<Material>& mat, const std::string& source, const Transform& transform,
+                             const Reference<GeometryCache>& cache, size_t chunkTriangles)
+{
+    struct stat st;
+    if (stat(source.c_str(), &st) != 0)
+        throw std::runtime_error("Cannot open mesh " + source);
+
+    chunkTriangles = std::max(chunkTriangles, static_cast<size_t>(1));
+    const uint64_t size = static_cast<uint64_t>(st.st_size);
+    const int64_t time = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+    const uint64_t chunk = chunkTriangles;
+    uint64_t key = 0xCBF29CE484222325ull;
+    key = hashWord(key, VERSION);
+    key = hashBytes(key, &size, sizeof(size));
+    key = hashBytes(key, &time, sizeof(time));
+    key = hashBytes(key, &chunk, sizeof(chunk));
+    key = hashBytes(key, &transform, sizeof(Transform));
+    key ^= key >> 33;
+    key *= 0xFF51AFD7ED558CCDull;
+    key ^= key >> 33;
+
+    char name[32];
+    snprintf(name, sizeof(name), ".%016llx.chunks", static_cast<unsigned long long>(key));
+    const std::string path = source + name;
+
+    try
+    {
+        return new PagedMesh(mat, path, key, cache);
+    }
+    catch (const std::runtime_error&)
+    {
+        // Soubor bloků chybí nebo neodpovídá, vytvoří se znovu.
+    }
+
+    std::vector<Vector> vertices, normals;
+    std::vector<int> indices;
+    std::vector<Real> uvs;
+    MeshLoader().load(source, vertices, indices, normals, uvs);
+    if (!transform.isIdentity())
+    {
+        parallelFor(vertices.size(), [&](size_t i) {
+            vertices[i] = transform.point(vertices[i]);
+            normals[i] = transform.normal(normals[i]).normalize();
+        }, 4096);
+    }
+
+    write(path, key, vertices, indices, normals, uvs, chunkTriangles);
+    return new PagedMesh(mat, path, key, cache);
+}
+
+/*!
+ * Trojúhelníky se dělí podle těžišť mediánem v nejdelší ose jejich
+ * obalového kvádru, dokud úsek nemá nejvýše chunkTriangles trojúhelníků.
+ * Bloky se pak sestaví (přečíslování vrcholů, stavba BVH) paralelně a
+ * zapisují se do souboru v pořadí dokončení, jejich pozici určuje tabulka.
+ * Soubor se zapisuje pod dočasným jménem a nakonec se přejmenuje.
+ */
+void PagedMesh::write(const std::string& path, uint64_t key, const std::vector<Vector>& vertices,
+                      const std::vector<int>& indices, const std::vector<Vector>& normals,
+                      const std::vector<Real>& uvs, size_t chunkTriangles)
+{
+    const size_t nTriangles = indices.size() / 3;
+    if (nTriangles == 0 || (!normals.empty() && normals.size() != vertices.size()) ||
+        (!uvs.empty() && uvs.size() != 2 * vertices.size()))
+        throw std::runtime_error("Invalid paged mesh " + path);
+
+    std::vector<Vector> centroids(nTriangles);
+    parallelFor(nTriangles, [&](size_t t) {
+        centroids[t] = (vertices[indices[3 * t]] + vertices[indices[3 * t + 1]] + vertices[indices[3 * t + 2]]) * (1.f / 3.f);
+    }, 4096);
+
+    std::vector<int> order(nTriangles);
+    for (size_t t = 0; t < nTriangles; ++t)
+        order[t] = static_cast<int>(t);
+
+    std::vector<std::pair<size_t, size_t>> ranges;
+    std::vector<std::pair<size_t, size_t>> stack(1, std::make_pair(static_cast<size_t>(0), nTriangles));
+    while (!stack.empty())
+    {
+        const std::pair<size_t, size_t> range = stack.back();
+        stack.pop_back();
+        if (range.second - range.first <= chunkTriangles)
+        {
+            ranges.push_back(range);
+            continue;
+        }
+
+        BBox b;
+        for (size_t i = range.first; i < range.second; ++i)
+            b = unite(b, centroids[order[i]]);
+        const int axis = b.maxDimensionIndex();
+        const size_t mid = (range.first + range.second) / 2;
+        std::nth_element(order.begin() + range.first, order.begin() + mid, order.begin() + range.second,
+                         [&](int a, int c) { return centroids[a][axis] < centroids[c][axis]; });
+        stack.push_back(std::make_pair(mid, range.second));
+        stack.push_back(std::make_pair(range.first, mid));
+    }
+    std::vector<Vector>().swap(centroids);
+
+    const std::string tmp = path + ".tmp" + std::to_string(getpid());
+    const int fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        throw std::runtime_error("Cannot create " + tmp);
+
+    std::vector<ChunkRecord> records(ranges.size());
+    uint64_t offset = sizeof(Header) + records.size() * sizeof(ChunkRecord);
+    std::mutex mutex;
+    std::atomic<bool> ok(true);
+
+    parallelFor(ranges.size(), [&](size_t c) {
+        const size_t first = ranges[c].first;
+        const size_t count = ranges[c].second - first;
+
+        std::unordered_map<int, int> local;
+        std::vector<Vector> p, n;
+        std::vector<Real> uv;
+        std::vector<int> idx(3 * count);
+        for (size_t t = 0; t < count; ++t)
+        {
+            for (int k = 0; k < 3; ++k)
+            {
+                const int v = indices[3 * static_cast<size_t>(order[first + t]) + k];
+                std::pair<std::unordered_map<int, int>::iterator, bool> it =
+                    local.insert(std::make_pair(v, static_cast<int>(p.size())));
+                if (it.second)
+                {
+                    p.push_back(vertices[v]);
+                    if (!normals.empty())
+                        n.push_back(normals[v]);
+                    if (!uvs.empty())
+                    {
+                        uv.push_back(uvs[2 * static_cast<size_t>(v)]);
+                        uv.push_back(uvs[2 * static_cast<size_t>(v) + 1]);
+                    }
+                }
+                idx[3 * t + k] = it.first->second;
+            }
+        }
+
+        ChunkRecord& r = records[c];
+        r = ChunkRecord();
+        r.nVertices = static_cast<uint32_t>(p.size());
+        r.nTriangles = static_cast<uint32_t>(count);
+        r.hasNormals = n.empty() ? 0 : 1;
+        r.hasUVs = uv.empty() ? 0 : 1;
+        for (size_t i = 0; i < p.size(); ++i)
+            r.bounds = unite(r.bounds, p[i]);
+
+        std::vector<char> blob(p.size() * sizeof(Vector) + idx.size() * sizeof(int) + n.size() * sizeof(Vector) +
+                               uv.size() * sizeof(Real));
+        char* out = blob.data();
+        memcpy(out, p.data(), p.size() * sizeof(Vector));
+        out += p.size() * sizeof(Vector);
+        memcpy(out, idx.data(), idx.size() * sizeof(int));
+        out += idx.size() * sizeof(int);
+        memcpy(out, n.data(), n.size() * sizeof(Vector));
+        out += n.size() * sizeof(Vector);
+        memcpy(out, uv.data(), uv.size() * sizeof(Real));
+
+        // Na texturových souřadnicích BVH nezávisí, síť pro stavbu je nepotřebuje.
+        Reference<TriangleMesh> mesh(new TriangleMesh(Reference<Material>(), std::move(p), std::move(idx),
+                                                      std::move(n)));
+        std::vector<Reference<Primitive>> triangles;
+        mesh->refine(triangles);
+        std::unordered_map<const Primitive*, uint32_t> triangleIndices;
+        for (size_t t = 0; t < triangles.size(); ++t)
+            triangleIndices[&*triangles[t]] = static_cast<uint32_t>(t);
+
+        std::vector<Reference<Primitive>> prims(triangles);
+        BVH bvh(prims);
+        std::vector<char> serialized;
+        if (!bvh.serialize(triangleIndices, serialized))
+        {
+            ok = false;
+            return;
+        }
+        r.bvhSize = serialized.size();
+        blob.insert(blob.end(), serialized.begin(), serialized.end());
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            r.offset = offset;
+            offset += blob.size();
+        }
+        if (!writeAt(fd, blob.data(), blob.size(), r.offset))
+            ok = false;
+    });
+
+    Header h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, MAGIC, sizeof(MAGIC));
+    h.version = VERSION;
+    h.recordSize = sizeof(ChunkRecord);
+    h.key = key;
+    h.nChunks = records.size();
+    h.nTriangles = nTriangles;
+    h.fileSize = offset;
+
+    bool written = ok && writeAt(fd, &h, sizeof(h), 0) &&
+                   writeAt(fd, records.data(), records.size() * sizeof(ChunkRecord), sizeof(h));
+    written = (close(fd) == 0) && written;
+    if (!written || rename(tmp.c_str(), path.c_str()) != 0)
+    {
+        remove(tmp.c_str());
+        throw std::runtime_error("Cannot write " + path);
+    }
+}
+
+PagedMesh::PagedMesh(const Reference<Material>& mat, const std::string& path, uint64_t key,
+                     const Reference<GeometryCache>& cache)
+    : GeometricPrimitive(mat),
+      path(path),
+      fd(open(path.c_str(), O_RDONLY)),
+      id(GeometryChunk::newOwnerId()),
+      cache(cache),
+      nTriangles(0),
+      top(nullptr),
+      failedLoads(0)
+{
+    if (fd < 0)
+        throw std::runtime_error("Cannot open " + path);
+
+    struct stat st;
+    Header h;
+    memset(&h, 0, sizeof(h));
+    bool valid = fstat(fd, &st) == 0 && readAt(fd, &h, sizeof(h), 0) &&
+                 memcmp(h.magic, MAGIC, sizeof(MAGIC)) == 0 && h.version == VERSION &&
+                 h.recordSize == sizeof(ChunkRecord) && h.key == key &&
+                 h.fileSize == static_cast<uint64_t>(st.st_size) && h.nChunks > 0 &&
+                 h.nChunks <= (h.fileSize - sizeof(Header)) / sizeof(ChunkRecord);
+    if (valid)
+    {
+        chunks.resize(h.nChunks);
+        valid = readAt(fd, chunks.data(), chunks.size() * sizeof(ChunkRecord), sizeof(h));
+    }
+
+    // Rozsahy bloků se ověří hned, aby načítání při výpočtu průsečíků nemohlo selhat.
+    const uint64_t dataStart = sizeof(Header) + h.nChunks * sizeof(ChunkRecord);
+    for (size_t i = 0; valid && i < chunks.size(); ++i)
+    {
+        const ChunkRecord& r = chunks[i];
+        const uint64_t size = static_cast<uint64_t>(r.nVertices) * sizeof(Vector) * (r.hasNormals ? 2 : 1) +
+                              static_cast<uint64_t>(r.nVertices) * 2 * sizeof(Real) * (r.hasUVs ? 1 : 0) +
+                              static_cast<uint64_t>(r.nTriangles) * 3 * sizeof(int) + r.bvhSize;
+        valid = r.nTriangles > 0 && r.nVertices > 0 && r.offset >= dataStart && r.offset <= h.fileSize &&
+                size <= h.fileSize - r.offset;
+        nTriangles += r.nTriangles;
+    }
+    if (!valid || nTriangles != h.nTriangles)
+    {
+        close(fd);
+        throw std::runtime_error("Invalid paged mesh file " + path);
+    }
+
+    std::vector<Reference<Primitive>> proxies;
+    proxies.reserve(chunks.size());
+    for (size_t i = 0; i < chunks.size(); ++i)
+    {
+        proxies.push_back(new ChunkProxy(this, i, chunks[i].bounds));
+        box = unite(box, chunks[i].bounds);
+    }
+    top = new BVH(proxies, 1);
+}
+
+PagedMesh::~PagedMesh()
+{
+    delete top;
+    for (size_t i = 0; i < chunks.size(); ++i)
+        cache->erase((id << 32) | i);
+    close(fd);
+}
+
+bool PagedMesh::intersect(const Ray& ray, Intersection& sr)
+{
+    const Real maxt = ray.maxt;
+    top->intersect(ray, sr);
+    return ray.maxt < maxt;
+}
+
+bool PagedMesh::intersectP(const Ray& ray)
+{
+    return top->intersectP(ray);
+}
+
+BBox PagedMesh::bounds() const
+{
+    return box;
+}
+
+/*!
+ * \return čítač neúspěšných načtení bloků všech sítí
+ */
+static std::atomic<size_t>& failedLoadCounter()
+{
+    static std::atomic<size_t> counter(0);
+    return counter;
+}
+
+size_t PagedMesh::totalFailedLoads()
+{
+    return failedLoadCounter().load();
+}
+
+Reference<GeometryChunk> PagedMesh::chunk(size_t i) const
+{
+    try
+    {
+        return cache->get((id << 32) | i, [this, i](size_t& size) {
+            return load(i, size);
+        });
+    }
+    catch (const std::runtime_error&)
+    {
+        // Prázdný blok se do cache nevloží, příští přístup čtení zopakuje.
+        failedLoads.fetch_add(1);
+        failedLoadCounter().fetch_add(1);
+        return Reference<GeometryChunk>(new GeometryChunk(Reference<TriangleMesh>(), nullptr));
+    }
+}
+
+GeometryChunk* PagedMesh::load(size_t i, size_t& size) const
+{
+    const ChunkRecord& r = chunks[i];
+    const size_t vertexBytes = r.nVertices * sizeof(Vector);
+    const size_t indexBytes = static_cast<size_t>(r.nTriangles) * 3 * sizeof(int);
+    const size_t normalBytes = r.hasNormals ? vertexBytes : 0;
+    const size_t uvBytes = r.hasUVs ? r.nVertices * 2 * sizeof(Real) : 0;
+
+    std::vector<char> blob(vertexBytes + indexBytes + normalBytes + uvBytes + r.bvhSize);
+    if (!readAt(fd, blob.data(), blob.size(), r.offset))
+        throw std::runtime_error("Cannot read " + path);
+
+    const char* in = blob.data();
+    const Vector* p = reinterpret_cast<const Vector*>(in);
+    const int* idx = reinterpret_cast<const int*>(in + vertexBytes);
+    const Vector* n = reinterpret_cast<const Vector*>(in + vertexBytes + indexBytes);
+    const Real* uv = reinterpret_cast<const Real*>(in + vertexBytes + indexBytes + normalBytes);
+    for (size_t k = 0; k < 3 * static_cast<size_t>(r.nTriangles); ++k)
+        if (idx[k] < 0 || static_cast<uint32_t>(idx[k]) >= r.nVertices)
+            throw std::runtime_error("Invalid chunk in " + path);
+
+    Reference<TriangleMesh> mesh(new TriangleMesh(_material, std::vector<Vector>(p, p + r.nVertices),
+                                                  std::vector<int>(idx, idx + 3 * r.nTriangles),
+                                                  std::vector<Vector>(n, n + (r.hasNormals ? r.nVertices : 0)),
+                                                  std::vector<Real>(uv, uv + uvBytes / sizeof(Real))));
+
+    std::vector<Reference<Primitive>> triangles;
+    mesh->refine(triangles);
+    BVH* bvh = BVH::deserialize(in + vertexBytes + indexBytes + normalBytes + uvBytes, r.bvhSize, triangles);
+    if (!bvh)
+        throw std::runtime_error("Invalid chunk in " + path);
+
+    size = blob.size() + triangles.size() * (sizeof(Triangle) + 2 * sizeof(Reference<Primitive>));
+    return new GeometryChunk(mesh, bvh);
+}
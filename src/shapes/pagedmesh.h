@@ -0,0 +1,212 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "core/lrucache.h"
+#include "core/primitive.h"
+#include "shapes/trianglemesh.h"
+
+namespace tracer
+{
+
+class BVH;
+
+/*!
+ * Blok sítě načtený do paměti: síť bloku a BVH nad jejími trojúhelníky.
+ */
+class GeometryChunk : public ReferenceCounted
+{
+public:
+    /*!
+     * Konstruktor.
+     * \param mesh síť bloku
+     * \param bvh hierarchie nad trojúhelníky sítě, blok ji vlastní
+     */
+    GeometryChunk(const Reference<TriangleMesh>& mesh, BVH* bvh);
+
+    ~GeometryChunk();
+
+    GeometryChunk(const GeometryChunk&) = delete;
+    GeometryChunk& operator=(const GeometryChunk&) = delete;
+
+    /*!
+     * Přidělí nový identifikátor vlastníka bloků pro horních 32 bitů klíče
+     * GeometryCache, takže se bloky různých sítí v cache nepřekrývají.
+     */
+    static uint64_t newOwnerId();
+
+    Reference<TriangleMesh> mesh; ///< Síť bloku.
+    BVH* bvh; ///< Hierarchie nad trojúhelníky sítě.
+};
+
+/*!
+ * Cache bloků geometrie sdílená všemi stránkovanými sítěmi a plochami
+ * DicedSurface scény. Klíčem je identifikátor sítě
+ * (GeometryChunk::newOwnerId()) v horních 32 bitech a index bloku v dolních.
+ */
+typedef LRUCache<uint64_t, GeometryChunk> GeometryCache;
+
+/*!
+ * Síť trojúhelníků, jejíž geometrie leží na disku a do paměti se načítá
+ * po blocích až ve chvíli, kdy paprsek dojde k jejich obalovému kvádru.
+ * Načtené bloky drží GeometryCache s pevným rozpočtem, takže scéna může být
+ * větší než paměť a při nedostatku paměti se jen zpomalí. To platí pro
+ * scénu z mnoha sítí: při vytváření souboru bloků (create()) musí být celá
+ * zdrojová síť i s těžišti a pořadím trojúhelníků v paměti, jediná síť
+ * větší než paměť tedy stránkovat nejde.
+ *
+ * Blok, který nejde přečíst (chyba disku, poškozený soubor), se pro daný
+ * paprsek nahradí prázdným blokem, paprsky jím projdou. Výjimka by jinak
+ * ukončila vykreslovací vlákno a celý proces. Prázdný blok se do cache
+ * nevkládá, další přístup se o načtení pokusí znovu. Neúspěšná načtení
+ * počítá numFailedLoads() a za všechny sítě totalFailedLoads(), renderery
+ * je na konci snímku ohlásí.
+ *
+ * Trojúhelníky sítě se při vytvoření prostorově rozdělí na bloky o zadaném
+ * maximálním počtu. Každý blok se uloží do souboru i s vlastními vrcholy,
+ * normálami, texturovými souřadnicemi a uloženou BVH (BVH::serialize()), načtení bloku tedy znamená
+ * jedno čtení ze souboru bez stavby. V paměti zůstávají jen obalové kvádry
+ * bloků a horní BVH nad nimi.
+ *
+ * Bloky se načítají mimo zámek cache, během čtení z disku tak ostatní
+ * vykreslovací vlákna dál počítají průsečíky. Transformace se do souboru
+ * zapíše při vytvoření, setTransform() není podporováno.
+ *
+ * Formát souboru: hlavička, tabulka bloků a data bloků (vrcholy, indexy,
+ * normály, texturové souřadnice a BVH). Soubor je vázán na zdrojový soubor sítě, transformaci
+ * a velikost bloků klíčem v hlavičce i ve jméně souboru.
+ */
+class PagedMesh : public GeometricPrimitive
+{
+public:
+    /*!
+     * Vytvoří stránkovanou síť ze souboru OBJ nebo PLY (MeshLoader). Pokud
+     * vedle zdrojového souboru existuje odpovídající soubor bloků, použije
+     * se a zdrojová síť se vůbec nenačítá. Jinak se síť načte, rozdělí na
+     * bloky, zapíše a uvolní. Při chybě vyhodí výjimku std::runtime_error.
+     * \param mat materiál sítě
+     * \param source cesta ke zdrojové síti
+     * \param transform transformace vrcholů a normál
+     * \param cache cache bloků
+     * \param chunkTriangles největší počet trojúhelníků v bloku
+     * \return nová síť
+     */
+    static PagedMesh* create(const Reference<Material>& mat, const std::string& source, const Transform& transform,
+                             const Reference<GeometryCache>& cache, size_t chunkTriangles = 8192);
+
+    /*!
+     * Rozdělí síť na bloky a zapíše je do souboru. Při chybě vyhodí výjimku
+     * std::runtime_error.
+     * \param path cesta k souboru bloků
+     * \param key klíč souboru
+     * \param vertices vrcholy
+     * \param indices indexy vrcholů
+     * \param normals normály ve vrcholech nebo prázdné pole
+     * \param uvs texturové souřadnice (u, v) vrcholů nebo prázdné pole
+     * \param chunkTriangles největší počet trojúhelníků v bloku
+     */
+    static void write(const std::string& path, uint64_t key, const std::vector<Vector>& vertices,
+                      const std::vector<int>& indices, const std::vector<Vector>& normals,
+                      const std::vector<Real>& uvs, size_t chunkTriangles);
+
+    /*!
+     * Otevře soubor bloků. Při chybě vyhodí výjimku std::runtime_error.
+     * \param mat materiál sítě
+     * \param path cesta k souboru bloků
+     * \param key očekávaný klíč souboru
+     * \param cache cache bloků
+     */
+    PagedMesh(const Reference<Material>& mat, const std::string& path, uint64_t key,
+              const Reference<GeometryCache>& cache);
+
+    virtual ~PagedMesh();
+
+    PagedMesh(const PagedMesh&) = delete;
+    PagedMesh& operator=(const PagedMesh&) = delete;
+
+    /*! \copydoc Primitive::intersect() */
+    virtual bool intersect(const Ray& ray, Intersection& sr) override;
+
+    /*! \copydoc Primitive::intersectP() */
+    virtual bool intersectP(const Ray& ray) override;
+
+    /*!
+     * Síť počítá průsečík sama přes horní BVH nad bloky.
+     * \return true
+     */
+    virtual bool canIntersect() const override
+    { return true; }
+
+    /*! Síť se nerozkládá, jinak by se musela celá načíst. */
+    virtual void refine(std::vector<Reference<Primitive>>& refined) override
+    { return; }
+
+    /*! \copydoc Primitive::bounds() */
+    virtual BBox bounds() const override;
+
+    /*!
+     * \return počet bloků
+     */
+    size_t numChunks() const
+    { return chunks.size(); }
+
+    /*!
+     * \return počet trojúhelníků sítě
+     */
+    size_t numTriangles() const
+    { return nTriangles; }
+
+    /*!
+     * Vrátí blok, pokud není v paměti, načte ho.
+     * \param i index bloku
+     */
+    Reference<GeometryChunk> chunk(size_t i) const;
+
+    /*!
+     * \return kolikrát se blok nepodařilo načíst a nahradil se prázdným
+     */
+    size_t numFailedLoads() const
+    { return failedLoads.load(); }
+
+    /*!
+     * \return kolikrát se nepodařilo načíst blok kterékoli sítě od spuštění procesu
+     */
+    static size_t totalFailedLoads();
+
+private:
+    /*!
+     * Záznam tabulky bloků, v souboru i v paměti.
+     */
+    struct ChunkRecord
+    {
+        BBox bounds; ///< Obalový kvádr bloku.
+        uint64_t offset; ///< Pozice dat bloku v souboru.
+        uint64_t bvhSize; ///< Velikost uložené BVH v bajtech.
+        uint32_t nVertices; ///< Počet vrcholů.
+        uint32_t nTriangles; ///< Počet trojúhelníků.
+        uint32_t hasNormals; ///< Jestli blok obsahuje normály.
+        uint32_t hasUVs; ///< Jestli blok obsahuje texturové souřadnice.
+    };
+
+    /*!
+     * Načte blok ze souboru. Při chybě vyhodí výjimku std::runtime_error.
+     * \param i index bloku
+     * \param size slouží k návratu odhadu paměti bloku
+     */
+    GeometryChunk* load(size_t i, size_t& size) const;
+
+    std::string path; ///< Soubor bloků.
+    int fd; ///< Otevřený soubor bloků.
+    uint64_t id; ///< Identifikátor sítě v cache.
+    mutable Reference<GeometryCache> cache; ///< Cache bloků.
+    std::vector<ChunkRecord> chunks; ///< Tabulka bloků.
+    size_t nTriangles; ///< Počet trojúhelníků.
+    BBox box; ///< Obalový kvádr sítě.
+    BVH* top; ///< Horní BVH nad bloky.
+    mutable std::atomic<size_t> failedLoads; ///< Počet nenačtených bloků.
+};
+
+}
@@ -0,0 +1,325 @@
+#include "shapes/pntrianglesurface.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "importers/meshloader.h"
+
+using namespace tracer;
+
+namespace
+{
+
+/*!
+ * Řídicí bod kubické hrany PN trojúhelníku u vrcholu a: třetina hrany
+ * promítnutá do tečné roviny vrcholu.
+ */
+inline Vector edgeControl(const Vector& pa, const Vector& pb, const Vector& na)
+{
+    return (2.f * pa + pb - dot(pb - pa, na) * na) / 3.f;
+}
+
+/*!
+ * Řídicí bod hrany u vrcholu a, na které se potkávají záplaty s různými
+ * normálami (ostrá hrana). Třetina hrany se promítne na průsečnici
+ * tečných rovin obou záplat, takže ostrá hrana sleduje zakřivení, např.
+ * obvod podstavy válce. Hrana se třemi a více dvojicemi normál nebo
+ * s rovnoběžnými normálami je rovná.
+ * \param normals různé dvojice normál konců hrany (po šesticích)
+ * \param end 0 pro vrchol a, 3 pro vrchol b
+ */
+Vector creaseControl(const Vector& pa, const Vector& pb, const std::vector<Real>& normals, int end)
+{
+    if (normals.size() == 12)
+    {
+        const Vector n1(normals[end], normals[end + 1], normals[end + 2]);
+        const Vector n2(normals[6 + end], normals[7 + end], normals[8 + end]);
+        if (n1.x == n2.x && n1.y == n2.y && n1.z == n2.z)
+            return edgeControl(pa, pb, n1);
+        Vector t = cross(n1, n2);
+        if (t.length() > 1e-4f)
+        {
+            t.normalize();
+            return pa + (dot(pb - pa, t) / 3.f) * t;
+        }
+    }
+    return (2.f * pa + pb) / 3.f;
+}
+
+/*!
+ * Prostřední normála kvadratické interpolace normál PN trojúhelníku,
+ * průměr normál vrcholů zrcadlený podle roviny kolmé na hranu.
+ */
+inline Vector edgeNormal(const Vector& pa, const Vector& pb, const Vector& na, const Vector& nb)
+{
+    const Vector d = pb - pa;
+    const Real len2 = dot(d, d);
+    Vector n = na + nb;
+    if (len2 > 0.f)
+        n = n - (2.f * dot(d, n) / len2) * d;
+    const Real len = n.length();
+    return len > 0.f ? n / len : na;
+}
+
+}
+
+PNTriangleSurface::PNTriangleSurface(const Reference<TriangleMesh>& control, const Reference<GeometryCache>& cache,
+                                     const Reference<Texture>& displacement, Real displacementScale, Real rate)
+    : DicedSurface(control, cache, displacement, displacementScale, rate)
+{
+    const size_t nVertices = this->control->numVertices();
+    const size_t nPatches = this->control->numTriangles();
+    const Vector* p = this->control->vertices();
+    const int* indices = this->control->vertexIndices();
+
+    if (const Vector* n = this->control->vertexNormals())
+    {
+        normals.assign(n, n + nVertices);
+        for (size_t i = 0; i < nVertices; ++i)
+            if (normals[i].length() > 0.f)
+                normals[i].normalize();
+    }
+    else
+    {
+        std::vector<int> welded(3 * nPatches);
+        for (size_t i = 0; i < welded.size(); ++i)
+            welded[i] = weld[indices[i]];
+        MeshLoader::generateNormals(std::vector<Vector>(p, p + nVertices), welded, normals);
+        for (size_t i = 0; i < nVertices; ++i)
+            normals[i] = normals[weld[i]];
+    }
+
+    // Tvar hrany určují normály všech jejích záplat, hrana se tak
+    // vyhodnotí stejně, ať ji dělí kterákoli záplata. Ostré hrany ze
+    // souboru zůstanou ostré, stínuje se normálami vrcholů záplaty.
+    {
+        std::unordered_map<uint64_t, std::vector<Real>> edgeNormals;
+        for (size_t i = 0; i < nPatches; ++i)
+        {
+            const int* v = indices + 3 * i;
+            for (int k = 0; k < 3; ++k)
+            {
+                int a = v[k], b = v[(k + 1) % 3];
+                if (!before(a, b))
+                    std::swap(a, b);
+                const Real ends[6] = { normals[a].x, normals[a].y, normals[a].z,
+                                       normals[b].x, normals[b].y, normals[b].z };
+                addUnique(edgeNormals[edgeKey(a, b)], ends, 6);
+            }
+        }
+        for (std::unordered_map<uint64_t, std::vector<Real>>::iterator it = edgeNormals.begin();
+             it != edgeNormals.end(); ++it)
+        {
+            const Vector& pa = p[it->first >> 32];
+            const Vector& pb = p[it->first & 0xFFFFFFFFu];
+            const std::vector<Real>& n = it->second;
+            EdgeCurve& curve = curves[it->first];
+            if (n.size() == 6)
+            {
+                curve.control[0] = edgeControl(pa, pb, Vector(n[0], n[1], n[2]));
+                curve.control[1] = edgeControl(pb, pa, Vector(n[3], n[4], n[5]));
+            }
+            else
+            {
+                curve.control[0] = creaseControl(pa, pb, n, 0);
+                curve.control[1] = creaseControl(pb, pa, n, 3);
+            }
+        }
+    }
+
+    if (displaced)
+    {
+        // Směr posunutí je průměr různých normál spojeného vrcholu, vrchol
+        // se tak posune stejně ze všech svých záplat.
+        std::unordered_map<int, std::vector<Real>> distinct;
+        for (size_t i = 0; i < nVertices; ++i)
+        {
+            const Real n[3] = { normals[i].x, normals[i].y, normals[i].z };
+            addUnique(distinct[weld[i]], n, 3);
+        }
+        directions.resize(nVertices);
+        for (std::unordered_map<int, std::vector<Real>>::iterator it = distinct.begin(); it != distinct.end(); ++it)
+        {
+            Vector d(0.f, 0.f, 0.f);
+            for (size_t j = 0; j < it->second.size(); j += 3)
+                d += Vector(it->second[j], it->second[j + 1], it->second[j + 2]);
+            directions[it->first] = d.length() > 0.f ? d.normalize() : d;
+        }
+        for (size_t i = 0; i < nVertices; ++i)
+            directions[i] = directions[weld[i]];
+    }
+
+    build();
+}
+
+void PNTriangleSurface::edgeControls(int a, int b, Vector& ca, Vector& cb) const
+{
+    const bool forward = before(a, b);
+    const EdgeCurve& curve = curves.find(forward ? edgeKey(a, b) : edgeKey(b, a))->second;
+    ca = curve.control[forward ? 0 : 1];
+    cb = curve.control[forward ? 1 : 0];
+}
+
+/*!
+ * Plocha záplaty leží v konvexním obalu řídicích bodů.
+ */
+BBox PNTriangleSurface::patchHull(size_t i) const
+{
+    const Vector* p = control->vertices();
+    const int* v = control->vertexIndices() + 3 * i;
+    BBox b(p[v[0]]);
+    Vector e(0.f, 0.f, 0.f);
+    for (int k = 0; k < 3; ++k)
+    {
+        const int a = v[k], c = v[(k + 1) % 3];
+        Vector ca, cc;
+        edgeControls(a, c, ca, cc);
+        b = unite(unite(unite(b, p[c]), ca), cc);
+        e = e + ca + cc;
+    }
+    e = e / 6.f;
+    return unite(b, e + (e - (p[v[0]] + p[v[1]] + p[v[2]]) / 3.f) * 0.5f);
+}
+
+/*!
+ * Délka hrany se odhadne délkou lomené čáry přes řídicí body, střed je
+ * bod kubické hrany pro parametr 1/2.
+ */
+void PNTriangleSurface::edgeExtent(int a, int b, Vector& mid, Real& length) const
+{
+    const Vector* p = control->vertices();
+    Vector c1, c2;
+    edgeControls(a, b, c1, c2);
+    length = (c1 - p[a]).length() + (c2 - c1).length() + (p[b] - c2).length();
+    mid = (p[a] + 3.f * c1 + 3.f * c2 + p[b]) * 0.125f;
+}
+
+PNTriangleSurface::SurfacePoint PNTriangleSurface::edgePoint(int a, int b, int k, int level,
+                                                             const Real uvs[2][2]) const
+{
+    const Vector* p = control->vertices();
+    const Vector& na = normals[a];
+    const Vector& nb = normals[b];
+    const Real s = static_cast<Real>(k) / static_cast<Real>(level);
+    const Real t = 1.f - s;
+    Vector ca, cb;
+    edgeControls(a, b, ca, cb);
+
+    SurfacePoint sp;
+    sp.p = (t * t * t) * p[a] + (3.f * t * t * s) * ca + (3.f * t * s * s) * cb + (s * s * s) * p[b];
+    sp.n = (t * t) * na + (s * s) * nb + (t * s) * edgeNormal(p[a], p[b], na, nb);
+    if (sp.n.length() > 0.f)
+        sp.n.normalize();
+    sp.d = sp.n;
+    sp.uv[0] = t * uvs[0][0] + s * uvs[1][0];
+    sp.uv[1] = t * uvs[0][1] + s * uvs[1][1];
+    if (displaced)
+    {
+        // Směr posunutí hrany je společný všem záplatám hrany.
+        const Vector& da = directions[a];
+        const Vector& db = directions[b];
+        sp.d = (t * t) * da + (s * s) * db + (t * s) * edgeNormal(p[a], p[b], da, db);
+        if (sp.d.length() > 0.f)
+            sp.d.normalize();
+        sp.p = sp.p + (edgeHeight(a, b, k, level, sp) * displacementScale) * sp.d;
+    }
+    return sp;
+}
+
+PNTriangleSurface::SurfacePoint PNTriangleSurface::boundaryPoint(int a, int b, int i, int n,
+                                                                 const Real uvs[2][2]) const
+{
+    Real ends[2][2] = { { uvs[0][0], uvs[0][1] }, { uvs[1][0], uvs[1][1] } };
+    if (!before(a, b))
+    {
+        std::swap(a, b);
+        std::swap(ends[0][0], ends[1][0]);
+        std::swap(ends[0][1], ends[1][1]);
+        i = n - i;
+    }
+
+    const int e = edgeLevel(a, b);
+    const int step = n / e;
+    SurfacePoint sp = edgePoint(a, b, i / step, e, ends);
+    if (i % step == 0)
+        return sp;
+
+    const SurfacePoint next = edgePoint(a, b, i / step + 1, e, ends);
+    return lerp(sp, next, static_cast<Real>(i % step) / static_cast<Real>(step));
+}
+
+/*!
+ * Vrcholy na hranách se počítají z hrany (boundaryPoint()), vnitřní
+ * z PN trojúhelníku.
+ */
+void PNTriangleSurface::evaluate(size_t i, int levels, std::vector<SurfacePoint>& points) const
+{
+    const int* v = control->vertexIndices() + 3 * i;
+    const Vector* cp = control->vertices();
+    const Vector p[3] = { cp[v[0]], cp[v[1]], cp[v[2]] };
+    const Vector n[3] = { normals[v[0]], normals[v[1]], normals[v[2]] };
+    Real uvs[3][2];
+    patchUVs(i, uvs);
+
+    // Řídicí body PN trojúhelníku, bij k odpovídá mocninám vah vrcholů 0, 1, 2.
+    Vector b210, b120, b021, b012, b102, b201;
+    edgeControls(v[0], v[1], b210, b120);
+    edgeControls(v[1], v[2], b021, b012);
+    edgeControls(v[2], v[0], b102, b201);
+    const Vector e = (b210 + b120 + b021 + b012 + b102 + b201) / 6.f;
+    const Vector b111 = e + (e - (p[0] + p[1] + p[2]) / 3.f) * 0.5f;
+    const Vector n110 = edgeNormal(p[0], p[1], n[0], n[1]);
+    const Vector n011 = edgeNormal(p[1], p[2], n[1], n[2]);
+    const Vector n101 = edgeNormal(p[2], p[0], n[2], n[0]);
+    Vector geometric = cross(p[1] - p[0], p[2] - p[0]);
+    if (geometric.length() > 0.f)
+        geometric.normalize();
+
+    auto edgeUVs = [&uvs](int a, int b, Real out[2][2]) {
+        out[0][0] = uvs[a][0];
+        out[0][1] = uvs[a][1];
+        out[1][0] = uvs[b][0];
+        out[1][1] = uvs[b][1];
+    };
+
+    for (int r = 0; r <= levels; ++r)
+    {
+        for (int c = 0; c <= levels - r; ++c)
+        {
+            SurfacePoint& sp = points[gridIndex(levels, r, c)];
+            Real ends[2][2];
+            if (r == 0)
+            {
+                edgeUVs(0, 1, ends);
+                sp = boundaryPoint(v[0], v[1], c, levels, ends);
+            }
+            else if (c == 0)
+            {
+                edgeUVs(0, 2, ends);
+                sp = boundaryPoint(v[0], v[2], r, levels, ends);
+            }
+            else if (c == levels - r)
+            {
+                edgeUVs(1, 2, ends);
+                sp = boundaryPoint(v[1], v[2], r, levels, ends);
+            }
+            else
+            {
+                const Real bv = static_cast<Real>(r) / levels;
+                const Real bu = static_cast<Real>(c) / levels;
+                const Real bw = 1.f - bu - bv;
+                sp.p = (bw * bw * bw) * p[0] + (bu * bu * bu) * p[1] + (bv * bv * bv) * p[2] +
+                       (3.f * bw * bw * bu) * b210 + (3.f * bw * bu * bu) * b120 +
+                       (3.f * bw * bw * bv) * b201 + (3.f * bu * bu * bv) * b021 +
+                       (3.f * bw * bv * bv) * b102 + (3.f * bu * bv * bv) * b012 + (6.f * bw * bu * bv) * b111;
+                sp.n = (bw * bw) * n[0] + (bu * bu) * n[1] + (bv * bv) * n[2] +
+                       (bw * bu) * n110 + (bu * bv) * n011 + (bw * bv) * n101;
+                sp.n = sp.n.length() > 0.f ? sp.n.normalize() : geometric;
+                sp.d = sp.n;
+                sp.uv[0] = bw * uvs[0][0] + bu * uvs[1][0] + bv * uvs[2][0];
+                sp.uv[1] = bw * uvs[0][1] + bu * uvs[1][1] + bv * uvs[2][1];
+                displace(sp);
+            }
+        }
+    }
+}
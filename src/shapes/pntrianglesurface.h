@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "shapes/dicedsurface.h"
+
+namespace tracer
+{
+
+/*!
+ * Hladká plocha zadaná řídicí sítí trojúhelníků, dělená až při průsečíku
+ * (DicedSurface). Plocha v záplatě je kubický PN trojúhelník (Vlachos
+ * a kol.) určený jen vrcholy a normálami trojúhelníku, záplatu tedy jde
+ * vyhodnotit bez okolních trojúhelníků. Nejde o limitní plochu dělení
+ * (tu počítá SubdivisionSurface): plocha prochází vrcholy řídicí sítě
+ * a záplaty na sebe navazují jen spojitě, bez spojité tečné roviny.
+ *
+ * Tvar hrany se počítá jednou z normál všech jejích záplat, záplaty se
+ * na ní tedy shodnou. Pokud se normály záplat hrany liší (ostrá hrana ze
+ * souboru), řídicí body hrany leží na průsečnici tečných rovin obou
+ * záplat a hrana zůstane ostrá. Stínuje se normálami vrcholů záplaty ze
+ * souboru, bez normál v souboru se dopočítají na spojené síti. Posouvá se
+ * podél průměru různých normál spojeného vrcholu. Obalový kvádr záplaty
+ * obsahuje řídicí body PN trojúhelníku.
+ */
+class PNTriangleSurface : public DicedSurface
+{
+public:
+    /*!
+     * Konstruktor. Při chybě vyhodí výjimku std::runtime_error.
+     * \param control řídicí síť, pokud nemá normály, dopočítají se na síti se spojenými vrcholy
+     * \param cache cache rozdělených záplat
+     * \param displacement výšková textura (průměr složek oříznutý na <0; 1>)
+     *                     nebo nullptr, s texturou musí mít řídicí síť
+     *                     texturové souřadnice
+     * \param displacementScale posunutí podél normály pro výšku 1
+     * \param rate požadovaná délka dílčí hrany v pixelech
+     */
+    PNTriangleSurface(const Reference<TriangleMesh>& control, const Reference<GeometryCache>& cache,
+                      const Reference<Texture>& displacement = Reference<Texture>(),
+                      Real displacementScale = 0.f, Real rate = 1.f);
+
+protected:
+    /*! \copydoc DicedSurface::patchHull() */
+    virtual BBox patchHull(size_t i) const override;
+
+    /*! \copydoc DicedSurface::edgeExtent() */
+    virtual void edgeExtent(int a, int b, Vector& mid, Real& length) const override;
+
+    /*! \copydoc DicedSurface::evaluate() */
+    virtual void evaluate(size_t i, int levels, std::vector<SurfacePoint>& points) const override;
+
+private:
+    /*!
+     * Vnitřní řídicí body kubické hrany, v pořadí before().
+     */
+    struct EdgeCurve
+    {
+        Vector control[2]; ///< Řídicí bod u prvního a u druhého vrcholu.
+    };
+
+    /*!
+     * Vnitřní řídicí body hrany záplaty.
+     * \param a první vrchol hrany
+     * \param b druhý vrchol hrany
+     * \param ca slouží k návratu řídicího bodu u vrcholu a
+     * \param cb slouží k návratu řídicího bodu u vrcholu b
+     */
+    void edgeControls(int a, int b, Vector& ca, Vector& cb) const;
+
+    /*!
+     * Vyhodnotí hranu v bodě k / level (včetně posunutí). Počítá se vždy
+     * v pořadí before(), obě záplaty hrany tak dostanou stejný bod.
+     * \param a první vrchol hrany
+     * \param b druhý vrchol hrany
+     * \param k pořadí bodu na hraně
+     * \param level počet dílků hrany
+     * \param uvs texturové souřadnice koncových vrcholů
+     */
+    SurfacePoint edgePoint(int a, int b, int k, int level, const Real uvs[2][2]) const;
+
+    /*!
+     * Vrchol dělení záplaty na hraně. Leží na lomené čáře dělení hrany.
+     * \param a počáteční vrchol hrany
+     * \param b koncový vrchol hrany
+     * \param i pořadí vrcholu od vrcholu a
+     * \param n počet dílků vnitřku záplaty
+     * \param uvs texturové souřadnice vrcholů a, b
+     */
+    SurfacePoint boundaryPoint(int a, int b, int i, int n, const Real uvs[2][2]) const;
+
+    std::vector<Vector> normals; ///< Normály ve vrcholech řídicí sítě pro stínování.
+    std::unordered_map<uint64_t, EdgeCurve> curves; ///< Řídicí body hran podle edgeKey().
+    std::vector<Vector> directions; ///< Směry posunutí ve vrcholech, stejné pro spojené vrcholy.
+};
+
+}
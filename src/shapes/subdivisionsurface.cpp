@@ -0,0 +1,651 @@
+#include "shapes/subdivisionsurface.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+using namespace tracer;
+
+namespace
+{
+
+const int NO_COORD = -1; ///< Vrchol mimo oblast nemá celočíselné souřadnice.
+
+/*!
+ * Klíč neorientované hrany, menší index ve vyšších bitech.
+ */
+inline uint64_t pairKey(int a, int b)
+{
+    if (a > b)
+        std::swap(a, b);
+    return (static_cast<uint64_t>(a) << 32) | static_cast<uint32_t>(b);
+}
+
+/*!
+ * Váha sousedů hladkého vrcholu s n sousedy (Loop).
+ */
+inline Real loopBeta(size_t n)
+{
+    const Real c = 0.375f + 0.25f * std::cos(2.f * static_cast<Real>(M_PI) / static_cast<Real>(n));
+    return (0.625f - c * c) / static_cast<Real>(n);
+}
+
+inline bool sameNormal(const Vector& a, const Vector& b)
+{
+    return a.x == b.x && a.y == b.y && a.z == b.z;
+}
+
+}
+
+/*!
+ * Lokální síť kolem oblasti (záplaty nebo hrany) dělená Loopovými
+ * pravidly. Drží trojúhelníky oblasti a trojúhelníky, které s oblastí
+ * sdílejí vrchol, pro vrcholy oblasti tak má úplné okolí a dělí je
+ * i posouvá na limitní plochu přesně. Vrcholy oblasti mají celočíselné
+ * souřadnice, které se při dělení zdvojnásobují, vrchol na hraně
+ * dostane součet souřadnic jejích konců.
+ */
+class SubdivisionSurface::LoopMesh
+{
+public:
+    /*!
+     * Spočítá sousednosti. Volá se po změně trojúhelníků.
+     */
+    void connect();
+
+    /*!
+     * Rozdělí síť jedním krokem Loopova dělení. Potomek trojúhelníku
+     * oblasti patří do oblasti, pokud má vrchol se souřadnicemi, ostatní
+     * potomci se nechají, jen pokud s oblastí sdílejí vrchol.
+     */
+    void subdivide();
+
+    /*!
+     * \param v vrchol s úplným okolím
+     * \return poloha vrcholu na limitní ploše
+     */
+    Vector limit(int v) const;
+
+    /*!
+     * Normála limitní plochy z tečných masek. U ostrých vrcholů
+     * a neuzavřeného okolí normalizovaný součet normál trojúhelníků.
+     * \param v vrchol s úplným okolím
+     * \param regionOnly jestli se u ostrých vrcholů sčítají jen trojúhelníky oblasti
+     * \return jednotková normála nebo nulový vektor u zdegenerovaného okolí
+     */
+    Vector normal(int v, bool regionOnly) const;
+
+    std::vector<Vector> p; ///< Polohy vrcholů.
+    std::vector<int> coords; ///< Souřadnice vrcholů (po dvojicích), NO_COORD mimo oblast.
+    std::vector<int> triangles; ///< Vrcholy trojúhelníků (po trojicích).
+    std::vector<char> region; ///< Jestli trojúhelník patří do oblasti.
+    std::unordered_set<uint64_t> creases; ///< Ostré hrany podle pairKey().
+
+private:
+    /*!
+     * Trojúhelníky hrany.
+     */
+    struct Edge
+    {
+        Edge()
+            : faces(0)
+        { }
+
+        int opposite[2]; ///< Protější vrcholy prvních dvou trojúhelníků.
+        int faces; ///< Počet trojúhelníků.
+    };
+
+    Vector vertexRule(int v) const;
+    Vector edgeRule(int a, int b) const;
+
+    /*!
+     * \return vrchol, který v trojúhelníku okolí v následuje po w, nebo -1
+     */
+    int following(int v, int w) const;
+
+    std::vector<int> fanStart; ///< Začátky seznamů trojúhelníků vrcholů ve fan.
+    std::vector<int> fan; ///< Trojúhelníky vrcholů.
+    std::vector<int> ringStart; ///< Začátky seznamů sousedů vrcholů v ring.
+    std::vector<int> ring; ///< Sousední vrcholy.
+    std::vector<int> creaseCount; ///< Počet ostrých hran vrcholu.
+    std::vector<int> creaseEnds; ///< První dva sousedé po ostrých hranách (po dvojicích).
+    std::unordered_map<uint64_t, Edge> edges; ///< Hrany podle pairKey().
+};
+
+void SubdivisionSurface::LoopMesh::connect()
+{
+    const size_t nVertices = p.size();
+    const size_t nTriangles = triangles.size() / 3;
+
+    fanStart.assign(nVertices + 1, 0);
+    for (size_t i = 0; i < triangles.size(); ++i)
+        ++fanStart[triangles[i] + 1];
+    for (size_t v = 0; v < nVertices; ++v)
+        fanStart[v + 1] += fanStart[v];
+    fan.resize(triangles.size());
+    std::vector<int> fill(fanStart.begin(), fanStart.end() - 1);
+    for (size_t t = 0; t < nTriangles; ++t)
+        for (int k = 0; k < 3; ++k)
+            fan[fill[triangles[3 * t + k]]++] = static_cast<int>(t);
+
+    edges.clear();
+    for (size_t t = 0; t < nTriangles; ++t)
+    {
+        for (int k = 0; k < 3; ++k)
+        {
+            Edge& e = edges[pairKey(triangles[3 * t + k], triangles[3 * t + (k + 1) % 3])];
+            if (e.faces < 2)
+                e.opposite[e.faces] = triangles[3 * t + (k + 2) % 3];
+            ++e.faces;
+        }
+    }
+
+    ringStart.assign(nVertices + 1, 0);
+    ring.clear();
+    creaseCount.assign(nVertices, 0);
+    creaseEnds.assign(2 * nVertices, -1);
+    for (size_t v = 0; v < nVertices; ++v)
+    {
+        ringStart[v] = static_cast<int>(ring.size());
+        for (int j = fanStart[v]; j < fanStart[v + 1]; ++j)
+        {
+            for (int k = 0; k < 3; ++k)
+            {
+                const int w = triangles[3 * fan[j] + k];
+                if (w == static_cast<int>(v) || std::find(ring.begin() + ringStart[v], ring.end(), w) != ring.end())
+                    continue;
+                ring.push_back(w);
+                if (creases.count(pairKey(static_cast<int>(v), w)))
+                {
+                    if (creaseCount[v] < 2)
+                        creaseEnds[2 * v + creaseCount[v]] = w;
+                    ++creaseCount[v];
+                }
+            }
+        }
+    }
+    ringStart[nVertices] = static_cast<int>(ring.size());
+}
+
+void SubdivisionSurface::LoopMesh::subdivide()
+{
+    const int nVertices = static_cast<int>(p.size());
+    const size_t nTriangles = triangles.size() / 3;
+
+    // Dočasné indexy potomků: sudý vrchol má index rodiče, lichý
+    // nVertices + pořadí hrany.
+    std::unordered_map<uint64_t, int> odd;
+    std::vector<int> oddEnds;
+    auto midpoint = [&](int a, int b) {
+        const std::pair<std::unordered_map<uint64_t, int>::iterator, bool> r =
+            odd.insert(std::make_pair(pairKey(a, b), nVertices + static_cast<int>(oddEnds.size() / 2)));
+        if (r.second)
+        {
+            oddEnds.push_back(a);
+            oddEnds.push_back(b);
+        }
+        return r.first->second;
+    };
+    std::vector<int> children(12 * nTriangles);
+    for (size_t t = 0; t < nTriangles; ++t)
+    {
+        const int* v = &triangles[3 * t];
+        const int m01 = midpoint(v[0], v[1]), m12 = midpoint(v[1], v[2]), m20 = midpoint(v[2], v[0]);
+        const int c[12] = { v[0], m01, m20, m01, v[1], m12, m20, m12, v[2], m01, m12, m20 };
+        std::copy(c, c + 12, children.begin() + 12 * t);
+    }
+
+    const size_t nTemporary = nVertices + oddEnds.size() / 2;
+    std::vector<int> temporaryCoords(2 * nTemporary, NO_COORD);
+    for (int v = 0; v < nVertices; ++v)
+    {
+        if (coords[2 * v] == NO_COORD)
+            continue;
+        temporaryCoords[2 * v] = 2 * coords[2 * v];
+        temporaryCoords[2 * v + 1] = 2 * coords[2 * v + 1];
+    }
+    for (size_t j = 0; j < oddEnds.size() / 2; ++j)
+    {
+        const int a = oddEnds[2 * j], b = oddEnds[2 * j + 1];
+        if (coords[2 * a] == NO_COORD || coords[2 * b] == NO_COORD)
+            continue;
+        temporaryCoords[2 * (nVertices + j)] = coords[2 * a] + coords[2 * b];
+        temporaryCoords[2 * (nVertices + j) + 1] = coords[2 * a + 1] + coords[2 * b + 1];
+    }
+
+    std::vector<char> childRegion(4 * nTriangles, 0);
+    std::vector<char> touched(nTemporary, 0);
+    for (size_t t = 0; t < 4 * nTriangles; ++t)
+    {
+        const int* c = &children[3 * t];
+        if (!region[t / 4] || (temporaryCoords[2 * c[0]] == NO_COORD && temporaryCoords[2 * c[1]] == NO_COORD &&
+                               temporaryCoords[2 * c[2]] == NO_COORD))
+            continue;
+        childRegion[t] = 1;
+        touched[c[0]] = touched[c[1]] = touched[c[2]] = 1;
+    }
+
+    // Nové polohy se počítají jen pro vrcholy ponechaných trojúhelníků,
+    // jejich okolí v síti je podle invariantu úplné.
+    std::vector<int> index(nTemporary, -1);
+    std::vector<Vector> nextP;
+    std::vector<int> nextCoords;
+    std::vector<int> nextTriangles;
+    std::vector<char> nextRegion;
+    for (size_t t = 0; t < 4 * nTriangles; ++t)
+    {
+        const int* c = &children[3 * t];
+        if (!childRegion[t] && !touched[c[0]] && !touched[c[1]] && !touched[c[2]])
+            continue;
+        for (int k = 0; k < 3; ++k)
+        {
+            int& id = index[c[k]];
+            if (id < 0)
+            {
+                id = static_cast<int>(nextP.size());
+                if (c[k] < nVertices)
+                    nextP.push_back(vertexRule(c[k]));
+                else
+                    nextP.push_back(edgeRule(oddEnds[2 * (c[k] - nVertices)], oddEnds[2 * (c[k] - nVertices) + 1]));
+                nextCoords.push_back(temporaryCoords[2 * c[k]]);
+                nextCoords.push_back(temporaryCoords[2 * c[k] + 1]);
+            }
+            nextTriangles.push_back(id);
+        }
+        nextRegion.push_back(childRegion[t]);
+    }
+
+    std::unordered_set<uint64_t> nextCreases;
+    for (std::unordered_set<uint64_t>::const_iterator it = creases.begin(); it != creases.end(); ++it)
+    {
+        std::unordered_map<uint64_t, int>::const_iterator m = odd.find(*it);
+        if (m == odd.end() || index[m->second] < 0)
+            continue;
+        const int a = static_cast<int>(*it >> 32), b = static_cast<int>(*it & 0xFFFFFFFFu);
+        if (index[a] >= 0)
+            nextCreases.insert(pairKey(index[a], index[m->second]));
+        if (index[b] >= 0)
+            nextCreases.insert(pairKey(index[b], index[m->second]));
+    }
+
+    p.swap(nextP);
+    coords.swap(nextCoords);
+    triangles.swap(nextTriangles);
+    region.swap(nextRegion);
+    creases.swap(nextCreases);
+    connect();
+}
+
+Vector SubdivisionSurface::LoopMesh::vertexRule(int v) const
+{
+    if (creaseCount[v] > 2)
+        return p[v];
+    if (creaseCount[v] == 2)
+        return 0.75f * p[v] + 0.125f * (p[creaseEnds[2 * v]] + p[creaseEnds[2 * v + 1]]);
+
+    const size_t n = ringStart[v + 1] - ringStart[v];
+    const Real beta = loopBeta(n);
+    Vector sum;
+    for (int j = ringStart[v]; j < ringStart[v + 1]; ++j)
+        sum += p[ring[j]];
+    return (1.f - n * beta) * p[v] + beta * sum;
+}
+
+Vector SubdivisionSurface::LoopMesh::edgeRule(int a, int b) const
+{
+    const uint64_t key = pairKey(a, b);
+    const Edge& e = edges.find(key)->second;
+    if (e.faces != 2 || creases.count(key))
+        return 0.5f * (p[a] + p[b]);
+    return 0.375f * (p[a] + p[b]) + 0.125f * (p[e.opposite[0]] + p[e.opposite[1]]);
+}
+
+Vector SubdivisionSurface::LoopMesh::limit(int v) const
+{
+    if (creaseCount[v] > 2)
+        return p[v];
+    if (creaseCount[v] == 2)
+        return (4.f * p[v] + p[creaseEnds[2 * v]] + p[creaseEnds[2 * v + 1]]) / 6.f;
+
+    const size_t n = ringStart[v + 1] - ringStart[v];
+    const Real w = 3.f / (8.f * loopBeta(n));
+    Vector sum;
+    for (int j = ringStart[v]; j < ringStart[v + 1]; ++j)
+        sum += p[ring[j]];
+    return (w * p[v] + sum) / (w + static_cast<Real>(n));
+}
+
+int SubdivisionSurface::LoopMesh::following(int v, int w) const
+{
+    for (int j = fanStart[v]; j < fanStart[v + 1]; ++j)
+    {
+        const int* t = &triangles[3 * fan[j]];
+        for (int k = 0; k < 3; ++k)
+            if (t[k] == v && t[(k + 1) % 3] == w)
+                return t[(k + 2) % 3];
+    }
+    return -1;
+}
+
+Vector SubdivisionSurface::LoopMesh::normal(int v, bool regionOnly) const
+{
+    Vector all, side;
+    for (int j = fanStart[v]; j < fanStart[v + 1]; ++j)
+    {
+        const int* t = &triangles[3 * fan[j]];
+        const Vector n = cross(p[t[1]] - p[t[0]], p[t[2]] - p[t[0]]);
+        all += n;
+        if (!regionOnly || region[fan[j]])
+            side += n;
+    }
+
+    // Tečné masky na sousedech v pořadí obíhání trojúhelníků.
+    const int n = ringStart[v + 1] - ringStart[v];
+    if (creaseCount[v] < 2 && fanStart[v + 1] - fanStart[v] == n)
+    {
+        const int first = ring[ringStart[v]];
+        Vector t1, t2;
+        int w = first;
+        for (int i = 0; i < n && w >= 0; ++i)
+        {
+            const Real angle = 2.f * static_cast<Real>(M_PI) * static_cast<Real>(i) / static_cast<Real>(n);
+            t1 += std::cos(angle) * p[w];
+            t2 += std::sin(angle) * p[w];
+            w = following(v, w);
+        }
+        Vector normal = cross(t1, t2);
+        if (w == first && normal.length() > 0.f)
+            return dot(normal, all) < 0.f ? -normal.normalize() : normal.normalize();
+    }
+
+    if (side.length() > 0.f)
+        return side.normalize();
+    return all.length() > 0.f ? all.normalize() : all;
+}
+
+SubdivisionSurface::SubdivisionSurface(const Reference<TriangleMesh>& control, const Reference<GeometryCache>& cache,
+                                       const Reference<Texture>& displacement, Real displacementScale, Real rate)
+    : DicedSurface(control, cache, displacement, displacementScale, rate)
+{
+    const size_t nVertices = this->control->numVertices();
+    const size_t nPatches = this->control->numTriangles();
+    const int* indices = this->control->vertexIndices();
+
+    for (size_t i = 0; i < nPatches; ++i)
+    {
+        const int w0 = weld[indices[3 * i]], w1 = weld[indices[3 * i + 1]], w2 = weld[indices[3 * i + 2]];
+        if (w0 == w1 || w1 == w2 || w2 == w0)
+            throw std::runtime_error("Cannot subdivide a mesh with degenerate triangles");
+    }
+
+    faceStart.assign(nVertices + 1, 0);
+    for (size_t i = 0; i < 3 * nPatches; ++i)
+        ++faceStart[weld[indices[i]] + 1];
+    for (size_t v = 0; v < nVertices; ++v)
+        faceStart[v + 1] += faceStart[v];
+    faces.resize(3 * nPatches);
+    {
+        std::vector<int> fill(faceStart.begin(), faceStart.end() - 1);
+        for (size_t i = 0; i < 3 * nPatches; ++i)
+            faces[fill[weld[indices[i]]]++] = static_cast<int>(i / 3);
+    }
+
+    // Ostré hrany: okraje, hrany s více než dvěma trojúhelníky a hrany,
+    // jejichž záplaty mají u některého konce různé normály ze souboru.
+    const Vector* n = this->control->vertexNormals();
+    std::unordered_map<uint64_t, std::vector<int>> edgeCorners;
+    for (size_t i = 0; i < 3 * nPatches; ++i)
+    {
+        const int next = static_cast<int>(i - i % 3 + (i + 1) % 3);
+        edgeCorners[pairKey(weld[indices[i]], weld[indices[next]])].push_back(static_cast<int>(i));
+    }
+    for (std::unordered_map<uint64_t, std::vector<int>>::iterator it = edgeCorners.begin(); it != edgeCorners.end(); ++it)
+    {
+        const std::vector<int>& c = it->second;
+        bool crease = c.size() != 2;
+        if (!crease && n)
+        {
+            const int a1 = indices[c[0]], b1 = indices[c[0] - c[0] % 3 + (c[0] + 1) % 3];
+            int a2 = indices[c[1]], b2 = indices[c[1] - c[1] % 3 + (c[1] + 1) % 3];
+            if (weld[a1] != weld[a2])
+                std::swap(a2, b2);
+            crease = !sameNormal(n[a1], n[a2]) || !sameNormal(n[b1], n[b2]);
+        }
+        if (crease)
+            creases.insert(it->first);
+    }
+
+    build();
+}
+
+void SubdivisionSurface::addFaces(int w, std::vector<int>& list) const
+{
+    list.insert(list.end(), faces.begin() + faceStart[w], faces.begin() + faceStart[w + 1]);
+}
+
+/*!
+ * Hodnoty Loopova dělení jsou konvexní kombinace vrcholů okolí záplaty.
+ */
+BBox SubdivisionSurface::patchHull(size_t i) const
+{
+    const Vector* p = control->vertices();
+    const int* indices = control->vertexIndices();
+    std::vector<int> ring;
+    for (int k = 0; k < 3; ++k)
+        addFaces(weld[indices[3 * i + k]], ring);
+
+    BBox b(p[indices[3 * i]]);
+    for (size_t j = 0; j < ring.size(); ++j)
+        for (int k = 0; k < 3; ++k)
+            b = unite(b, p[indices[3 * ring[j] + k]]);
+    return b;
+}
+
+/*!
+ * Hrana se odhadne hranou řídicí sítě, limitní plocha leží uvnitř řídicí sítě.
+ */
+void SubdivisionSurface::edgeExtent(int a, int b, Vector& mid, Real& length) const
+{
+    const Vector* p = control->vertices();
+    mid = 0.5f * (p[a] + p[b]);
+    length = (p[b] - p[a]).length();
+}
+
+void SubdivisionSurface::seed(const std::vector<int>& region, LoopMesh& mesh, std::unordered_map<int, int>& local) const
+{
+    const Vector* p = control->vertices();
+    const int* indices = control->vertexIndices();
+
+    std::vector<int> triangles(region);
+    for (size_t j = 0; j < region.size(); ++j)
+        for (int k = 0; k < 3; ++k)
+            addFaces(weld[indices[3 * region[j] + k]], triangles);
+    std::sort(triangles.begin(), triangles.end());
+    triangles.erase(std::unique(triangles.begin(), triangles.end()), triangles.end());
+
+    local.clear();
+    for (size_t j = 0; j < triangles.size(); ++j)
+    {
+        const int t = triangles[j];
+        for (int k = 0; k < 3; ++k)
+        {
+            const int w = weld[indices[3 * t + k]];
+            const std::pair<std::unordered_map<int, int>::iterator, bool> r =
+                local.insert(std::make_pair(w, static_cast<int>(mesh.p.size())));
+            if (r.second)
+            {
+                mesh.p.push_back(p[w]);
+                mesh.coords.push_back(NO_COORD);
+                mesh.coords.push_back(NO_COORD);
+            }
+            mesh.triangles.push_back(r.first->second);
+        }
+        mesh.region.push_back(std::binary_search(region.begin(), region.end(), t));
+    }
+
+    for (size_t j = 0; j < triangles.size(); ++j)
+    {
+        const int* v = indices + 3 * triangles[j];
+        for (int k = 0; k < 3; ++k)
+        {
+            const int wa = weld[v[k]], wb = weld[v[(k + 1) % 3]];
+            if (creases.count(pairKey(wa, wb)))
+                mesh.creases.insert(pairKey(local[wa], local[wb]));
+        }
+    }
+    mesh.connect();
+}
+
+/*!
+ * Okolí vrcholu se nedělí, limitní poloha i normála se počítají přímo
+ * z řídicí sítě.
+ */
+DicedSurface::SurfacePoint SubdivisionSurface::vertexPoint(int a) const
+{
+    const int w = weld[a];
+    std::vector<int> region;
+    addFaces(w, region);
+    LoopMesh mesh;
+    std::unordered_map<int, int> local;
+    seed(region, mesh, local);
+
+    const int v = local[w];
+    SurfacePoint sp;
+    sp.p = mesh.limit(v);
+    sp.d = mesh.normal(v, false);
+    sp.n = sp.d;
+    sp.uv[0] = sp.uv[1] = 0.f;
+    return sp;
+}
+
+/*!
+ * Oblastí jsou trojúhelníky u konců hrany a po dělení trojúhelníky
+ * s vrcholem na hraně. Síť závisí jen na hraně, obě záplaty tak dostanou
+ * stejné body. Koncové body jsou vertexPoint().
+ */
+void SubdivisionSurface::edgePoints(int a, int b, int level, std::vector<SurfacePoint>& points) const
+{
+    const int wa = weld[a], wb = weld[b];
+    std::vector<int> region;
+    addFaces(wa, region);
+    addFaces(wb, region);
+    std::sort(region.begin(), region.end());
+    region.erase(std::unique(region.begin(), region.end()), region.end());
+
+    LoopMesh mesh;
+    std::unordered_map<int, int> local;
+    seed(region, mesh, local);
+    const int la = local[wa], lb = local[wb];
+    mesh.coords[2 * la] = mesh.coords[2 * la + 1] = 0;
+    mesh.coords[2 * lb] = 1;
+    mesh.coords[2 * lb + 1] = 0;
+    for (int k = 1; k < level; k *= 2)
+        mesh.subdivide();
+
+    points.resize(level + 1);
+    for (size_t v = 0; v < mesh.p.size(); ++v)
+    {
+        if (mesh.coords[2 * v] == NO_COORD)
+            continue;
+        SurfacePoint& sp = points[mesh.coords[2 * v]];
+        sp.p = mesh.limit(static_cast<int>(v));
+        sp.d = mesh.normal(static_cast<int>(v), false);
+        sp.n = sp.d;
+        sp.uv[0] = sp.uv[1] = 0.f;
+    }
+    points[0] = vertexPoint(a);
+    points[level] = vertexPoint(b);
+}
+
+/*!
+ * Vnitřní vrcholy se počítají z okolí záplaty, vrcholy na hranách
+ * z edgePoints() (na hrubších hranách na lomené čáře dělení hrany)
+ * s normálami strany záplaty.
+ */
+void SubdivisionSurface::evaluate(size_t i, int levels, std::vector<SurfacePoint>& points) const
+{
+    const int* v = control->vertexIndices() + 3 * i;
+    const Vector* cp = control->vertices();
+    Real uvs[3][2];
+    patchUVs(i, uvs);
+    Vector geometric = cross(cp[v[1]] - cp[v[0]], cp[v[2]] - cp[v[0]]);
+    if (geometric.length() > 0.f)
+        geometric.normalize();
+
+    LoopMesh mesh;
+    std::unordered_map<int, int> local;
+    seed(std::vector<int>(1, static_cast<int>(i)), mesh, local);
+    const int corners[3][2] = { { 0, 0 }, { 1, 0 }, { 0, 1 } };
+    for (int k = 0; k < 3; ++k)
+    {
+        const int l = local[weld[v[k]]];
+        mesh.coords[2 * l] = corners[k][0];
+        mesh.coords[2 * l + 1] = corners[k][1];
+    }
+    for (int k = 1; k < levels; k *= 2)
+        mesh.subdivide();
+
+    for (size_t u = 0; u < mesh.p.size(); ++u)
+    {
+        const int c = mesh.coords[2 * u], r = mesh.coords[2 * u + 1];
+        if (c == NO_COORD)
+            continue;
+        SurfacePoint& sp = points[gridIndex(levels, r, c)];
+        sp.n = mesh.normal(static_cast<int>(u), true);
+        if (!(sp.n.length() > 0.f))
+            sp.n = geometric;
+        if (r == 0 || c == 0 || r + c == levels)
+            continue;
+
+        const Real bv = static_cast<Real>(r) / levels;
+        const Real bu = static_cast<Real>(c) / levels;
+        const Real bw = 1.f - bu - bv;
+        sp.p = mesh.limit(static_cast<int>(u));
+        sp.d = sp.n;
+        sp.uv[0] = bw * uvs[0][0] + bu * uvs[1][0] + bv * uvs[2][0];
+        sp.uv[1] = bw * uvs[0][1] + bu * uvs[1][1] + bv * uvs[2][1];
+        displace(sp);
+    }
+
+    const int sides[3][2] = { { 0, 1 }, { 0, 2 }, { 1, 2 } };
+    std::vector<SurfacePoint> edge;
+    for (int s = 0; s < 3; ++s)
+    {
+        int a = v[sides[s][0]], b = v[sides[s][1]];
+        Real ends[2][2] = { { uvs[sides[s][0]][0], uvs[sides[s][0]][1] },
+                            { uvs[sides[s][1]][0], uvs[sides[s][1]][1] } };
+        const bool forward = before(a, b);
+        if (!forward)
+        {
+            std::swap(a, b);
+            std::swap(ends[0][0], ends[1][0]);
+            std::swap(ends[0][1], ends[1][1]);
+        }
+
+        const int e = edgeLevel(a, b);
+        edgePoints(a, b, e, edge);
+        for (int k = 0; k <= e; ++k)
+        {
+            SurfacePoint& ep = edge[k];
+            const Real f = static_cast<Real>(k) / static_cast<Real>(e);
+            const Real g = 1.f - f;
+            ep.uv[0] = g * ends[0][0] + f * ends[1][0];
+            ep.uv[1] = g * ends[0][1] + f * ends[1][1];
+            if (displaced)
+                ep.p = ep.p + (edgeHeight(a, b, k, e, ep) * displacementScale) * ep.d;
+        }
+
+        const int step = levels / e;
+        for (int j = 0; j <= levels; ++j)
+        {
+            const int k = forward ? j : levels - j;
+            const int r = s == 0 ? 0 : j;
+            const int c = s == 0 ? j : (s == 1 ? 0 : levels - j);
+            SurfacePoint& sp = points[gridIndex(levels, r, c)];
+            const Vector n = sp.n;
+            sp = k % step == 0 ? edge[k / step]
+                               : lerp(edge[k / step], edge[k / step + 1], static_cast<Real>(k % step) / step);
+            sp.n = n;
+        }
+    }
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "shapes/dicedsurface.h"
+
+namespace tracer
+{
+
+/*!
+ * Limitní plocha Loopova dělení řídicí sítě trojúhelníků, dělená až při
+ * průsečíku (DicedSurface). Záplatou je trojúhelník řídicí sítě. Při
+ * rozdělení záplaty na n dílků hrany se její okolí (záplata a trojúhelníky,
+ * které s ní sdílejí vrchol) rozdělí log2(n)-krát Loopovými pravidly
+ * a vrcholy se posunou na limitní plochu, normály se počítají z tečných
+ * masek. Po každém kroku se zahodí trojúhelníky, které už záplatu
+ * neovlivňují, práce tak roste jen s počtem vrcholů záplaty.
+ *
+ * Ostré hrany (Hoppe a kol.) jsou okraje sítě, hrany s více než dvěma
+ * trojúhelníky a hrany, na kterých se liší normály ze souboru u záplat
+ * hrany. Vrchol se dvěma ostrými hranami se dělí jako křivka, se třemi
+ * a více zůstává na místě.
+ *
+ * Body na hraně záplaty se počítají z okolí hrany a vrcholy řídicí sítě
+ * z okolí vrcholu, vždy ve stejném pořadí, takže je obě záplaty hrany
+ * dostanou na bit stejné. Stínuje se normálami limitní plochy, na ostrých
+ * hranách normálou strany záplaty. Posouvá se podél normály, na hranách
+ * podél průměru normál obou stran.
+ */
+class SubdivisionSurface : public DicedSurface
+{
+public:
+    /*!
+     * Konstruktor. Při chybě vyhodí výjimku std::runtime_error.
+     * \param control řídicí síť, normály ze souboru určují jen ostré hrany
+     * \param cache cache rozdělených záplat
+     * \param displacement výšková textura (průměr složek oříznutý na <0; 1>)
+     *                     nebo nullptr, s texturou musí mít řídicí síť
+     *                     texturové souřadnice
+     * \param displacementScale posunutí podél normály pro výšku 1
+     * \param rate požadovaná délka dílčí hrany v pixelech
+     */
+    SubdivisionSurface(const Reference<TriangleMesh>& control, const Reference<GeometryCache>& cache,
+                       const Reference<Texture>& displacement = Reference<Texture>(),
+                       Real displacementScale = 0.f, Real rate = 1.f);
+
+protected:
+    /*!
+     * Limitní plocha záplaty leží v konvexním obalu vrcholů jejího okolí.
+     * \copydoc DicedSurface::patchHull()
+     */
+    virtual BBox patchHull(size_t i) const override;
+
+    /*! \copydoc DicedSurface::edgeExtent() */
+    virtual void edgeExtent(int a, int b, Vector& mid, Real& length) const override;
+
+    /*! \copydoc DicedSurface::evaluate() */
+    virtual void evaluate(size_t i, int levels, std::vector<SurfacePoint>& points) const override;
+
+private:
+    class LoopMesh;
+
+    /*!
+     * Připraví lokální síť z trojúhelníků oblasti a všech trojúhelníků,
+     * které s oblastí sdílejí vrchol.
+     * \param region trojúhelníky oblasti (vzestupně)
+     * \param mesh slouží k návratu lokální sítě
+     * \param local slouží k návratu indexů spojených vrcholů v lokální síti
+     */
+    void seed(const std::vector<int>& region, LoopMesh& mesh, std::unordered_map<int, int>& local) const;
+
+    /*!
+     * Trojúhelníky se spojeným vrcholem (vzestupně) připojí k seznamu.
+     * \param w spojený vrchol
+     * \param list seznam trojúhelníků
+     */
+    void addFaces(int w, std::vector<int>& list) const;
+
+    /*!
+     * Bod limitní plochy ve vrcholu řídicí sítě, bez posunutí. Závisí
+     * jen na spojeném vrcholu.
+     * \param a index vrcholu řídicí sítě
+     */
+    SurfacePoint vertexPoint(int a) const;
+
+    /*!
+     * Body limitní plochy na hraně po level dílcích, bez posunutí
+     * a texturových souřadnic.
+     * \param a první vrchol hrany (v pořadí before())
+     * \param b druhý vrchol hrany
+     * \param level počet dílků hrany
+     * \param points slouží k návratu level + 1 bodů od vrcholu a
+     */
+    void edgePoints(int a, int b, int level, std::vector<SurfacePoint>& points) const;
+
+    std::vector<int> faceStart; ///< Začátky seznamů trojúhelníků spojených vrcholů ve faces.
+    std::vector<int> faces; ///< Trojúhelníky spojených vrcholů, vzestupně.
+    std::unordered_set<uint64_t> creases; ///< Ostré hrany mezi spojenými vrcholy (menší index ve vyšších bitech).
+};
+
+}
@@ -0,0 +1,241 @@
+#include "shapes/trianglemesh.h"
+
+using namespace tracer;
+
+/************************************************************************/
+/* TriangleMesh methods                                                 */
+/************************************************************************/
+
+TriangleMesh::TriangleMesh(const Reference<Material>& mat, std::vector<Vector> p,
+                           std::vector<int> indices, std::vector<Vector> normals, std::vector<Real> uvs)
+    : GeometricPrimitive(mat),
+      nVertices(p.size()),
+      nIndices(indices.size()),
+      ownedP(std::move(p)),
+      ownedIndices(std::move(indices)),
+      ownedN(std::move(normals)),
+      ownedUV(std::move(uvs)),
+      lazy(false)
+{
+    assert(nIndices % 3 == 0);
+    assert(ownedN.empty() || ownedN.size() == nVertices);
+    assert(ownedUV.empty() || ownedUV.size() == 2 * nVertices);
+    this->p = ownedP.data();
+    this->indices = ownedIndices.data();
+    n = ownedN.empty() ? nullptr : ownedN.data();
+    uv = ownedUV.empty() ? nullptr : ownedUV.data();
+}
+
+TriangleMesh::TriangleMesh(const Reference<Material>& mat, Vector* p, size_t nVertices,
+                           int* indices, size_t nIndices, Vector* normals, Real* uvs,
+                           const Reference<MappedFile>& storage)
+    : GeometricPrimitive(mat),
+      p(p),
+      indices(indices),
+      nVertices(nVertices),
+      nIndices(nIndices),
+      n(normals),
+      uv(uvs),
+      storage(storage),
+      lazy(false)
+{
+    assert(nIndices % 3 == 0);
+}
+
+TriangleMesh::~TriangleMesh()
+{ }
+
+bool TriangleMesh::intersect(const Ray& ray, Intersection& sr)
+{
+    assert(false);
+    return false;
+}
+
+bool TriangleMesh::intersectP(const Ray& ray)
+{
+    assert(false);
+    return false;
+}
+
+void TriangleMesh::refine(std::vector<Reference<Primitive>>& refined)
+{
+    Reference<TriangleMesh> self(this);
+    for (size_t i = 0; i < numTriangles(); ++i)
+        refined.push_back(new Triangle(_material, self, i));
+}
+
+BBox TriangleMesh::bounds() const
+{
+    BBox b;
+    for (size_t i = 0; i < nVertices; ++i)
+        b = unite(b, p[i]);
+    return b;
+}
+
+bool TriangleMesh::setTransform(const Transform& t)
+{
+    if (objectP.empty())
+        objectP.assign(p, p + nVertices);
+
+    for (size_t i = 0; i < nVertices; ++i)
+        p[i] = t.point(objectP[i]);
+
+    if (n)
+    {
+        if (objectN.empty())
+            objectN.assign(n, n + nVertices);
+        for (size_t i = 0; i < nVertices; ++i)
+            n[i] = t.normal(objectN[i]).normalize();
+    }
+
+    return true;
+}
+
+Real TriangleMesh::area(size_t tri) const
+{
+    const Vector& p0 = vertex(tri, 0);
+    const Vector& p1 = vertex(tri, 1);
+    const Vector& p2 = vertex(tri, 2);
+    return 0.5f * cross(p1 - p0, p2 - p0).length();
+}
+
+/*!
+ * Rovnoměrné rozložení bodů na trojúhelníku se získá
+ * transformací (u1, u2) -> (1 - sqrt(u1), u2 * sqrt(u1)).
+ */
+Vector TriangleMesh::sample(size_t tri, Real u1, Real u2, Vector& n) const
+{
+    const Vector& p0 = vertex(tri, 0);
+    const Vector& p1 = vertex(tri, 1);
+    const Vector& p2 = vertex(tri, 2);
+
+    Real su1 = std::sqrt(u1);
+    Real b0 = 1.f - su1;
+    Real b1 = u2 * su1;
+
+    n = cross(p1 - p0, p2 - p0);
+    n.normalize();
+
+    return b0 * p0 + b1 * p1 + (1.f - b0 - b1) * p2;
+}
+
+/************************************************************************/
+/* Triangle methods                                                     */
+/************************************************************************/
+
+Triangle::Triangle(const Reference<Material>& mat, const Reference<TriangleMesh>& mesh, size_t n)
+    : GeometricPrimitive(mat),
+      mesh(mesh),
+      n(n)
+{ }
+
+Triangle::~Triangle()
+{ }
+
+bool Triangle::hit(const Ray& ray, Real& t, Real& b1, Real& b2) const
+{
+    return hit(mesh->vertex(n, 0), mesh->vertex(n, 1), mesh->vertex(n, 2), ray, t, b1, b2);
+}
+
+bool Triangle::hit(const Vector& p0, const Vector& p1, const Vector& p2, const Ray& ray,
+                   Real& t, Real& b1, Real& b2)
+{
+    Vector e1 = p1 - p0;
+    Vector e2 = p2 - p0;
+    Vector s1 = cross(ray.d, e2);
+    Real det = dot(s1, e1);
+    if (std::fabs(det) < EPSILON * EPSILON)
+        return false;
+    Real invDet = 1.f / det;
+
+    Vector d = ray.o - p0;
+    b1 = dot(d, s1) * invDet;
+    if (b1 < 0.f || b1 > 1.f)
+        return false;
+
+    Vector s2 = cross(d, e1);
+    b2 = dot(ray.d, s2) * invDet;
+    if (b2 < 0.f || b1 + b2 > 1.f)
+        return false;
+
+    t = dot(e2, s2) * invDet;
+    return t > ray.mint + ray.rayEpsilon && t < ray.maxt;
+}
+
+bool Triangle::intersect(const Ray& ray, Intersection& sr)
+{
+    Real t, b1, b2;
+    if (!hit(ray, t, b1, b2) || t >= sr.t)
+        return false;
+
+    const int* i = mesh->vertexIndices() + 3 * n;
+    Vector normals[3];
+    if (const Vector* vn = mesh->vertexNormals())
+    {
+        for (int k = 0; k < 3; ++k)
+            normals[k] = vn[i[k]];
+    }
+    Real uv[3][2];
+    if (const Real* uvs = mesh->vertexUVs())
+    {
+        for (int k = 0; k < 3; ++k)
+        {
+            uv[k][0] = uvs[2 * i[k]];
+            uv[k][1] = uvs[2 * i[k] + 1];
+        }
+    }
+
+    shade(mesh->vertex(n, 0), mesh->vertex(n, 1), mesh->vertex(n, 2),
+          mesh->vertexNormals() ? normals : nullptr, mesh->vertexUVs() ? uv : nullptr,
+          t, b1, b2, ray, _material, sr);
+    return true;
+}
+
+void Triangle::shade(const Vector& p0, const Vector& p1, const Vector& p2, const Vector* normals,
+                     const Real (*uv)[2], Real t, Real b1, Real b2, const Ray& ray,
+                     const Reference<Material>& material, Intersection& sr)
+{
+    const Real b0 = 1.f - b1 - b2;
+    const Vector geometric = cross(p1 - p0, p2 - p0);
+
+    Vector normal = geometric;
+    if (normals)
+        normal = b0 * normals[0] + b1 * normals[1] + b2 * normals[2];
+
+    // Bez texturových souřadnic se použije parametrizace (0,0), (1,0), (1,1).
+    static const Real defaultUV[3][2] = { { 0.f, 0.f }, { 1.f, 0.f }, { 1.f, 1.f } };
+    if (!uv)
+        uv = defaultUV;
+    sr.u = b0 * uv[0][0] + b1 * uv[1][0] + b2 * uv[2][0];
+    sr.v = b0 * uv[0][1] + b1 * uv[1][1] + b2 * uv[2][1];
+
+    // Šířka stopy se převede do texturových souřadnic poměrem obsahů
+    // trojúhelníku v nich a v prostoru.
+    sr.footprint = 0.f;
+    const Real area = geometric.length();
+    if (ray.spread > 0.f && area > 0.f)
+    {
+        const Real uvArea = std::fabs((uv[1][0] - uv[0][0]) * (uv[2][1] - uv[0][1]) -
+                                      (uv[2][0] - uv[0][0]) * (uv[1][1] - uv[0][1]));
+        sr.footprint = t * ray.spread * ray.d.length() * std::sqrt(uvArea / area);
+    }
+
+    ray.maxt = t;
+    sr.hitObject = true;
+    sr.t = t;
+    sr.hitPoint = ray(t);
+    sr.normal = normal.normalize();
+    sr.ray = ray;
+    sr.material = material;
+}
+
+bool Triangle::intersectP(const Ray& ray)
+{
+    Real t, b1, b2;
+    return hit(ray, t, b1, b2);
+}
+
+BBox Triangle::bounds() const
+{
+    return unite(BBox(mesh->vertex(n, 0), mesh->vertex(n, 1)), mesh->vertex(n, 2));
+}
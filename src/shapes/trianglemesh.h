@@ -0,0 +1,268 @@
+#pragma once
+
+#include <vector>
+
+#include "core/mappedfile.h"
+#include "core/primitive.h"
+
+namespace tracer
+{
+
+/*!
+ * Síť trojúhelníků se sdílenými vrcholy. Sama o sobě průsečík nepočítá,
+ * pomocí metody refine() se rozloží na jednotlivé trojúhelníky (třída Triangle),
+ * které se odkazují do jejích polí. Volitelně má normály ve vrcholech,
+ * a texturové souřadnice, které trojúhelníky v průsečíku interpolují.
+ */
+class TriangleMesh : public GeometricPrimitive
+{
+public:
+    /*!
+     * Konstruktor.
+     * \param mat materiál sítě
+     * \param p pole vrcholů
+     * \param indices indexy vrcholů, každá trojice tvoří jeden trojúhelník
+     * \param normals normály ve vrcholech, prázdné pole nebo stejný počet jako vrcholů
+     * \param uvs texturové souřadnice (u, v) vrcholů, prázdné pole nebo dvojnásobek počtu vrcholů
+     */
+    TriangleMesh(const Reference<Material>& mat, std::vector<Vector> p,
+                 std::vector<int> indices, std::vector<Vector> normals = std::vector<Vector>(),
+                 std::vector<Real> uvs = std::vector<Real>());
+
+    /*!
+     * Konstruktor nad poli v namapovaném souboru. Pole se nekopírují,
+     * síť je používá přímo a drží na soubor referenci.
+     * \param mat materiál sítě
+     * \param p pole vrcholů
+     * \param nVertices počet vrcholů
+     * \param indices indexy vrcholů, každá trojice tvoří jeden trojúhelník
+     * \param nIndices počet indexů
+     * \param normals normály ve vrcholech (nVertices prvků) nebo nullptr
+     * \param uvs texturové souřadnice vrcholů (2 * nVertices prvků) nebo nullptr
+     * \param storage soubor, do kterého pole ukazují
+     */
+    TriangleMesh(const Reference<Material>& mat, Vector* p, size_t nVertices,
+                 int* indices, size_t nIndices, Vector* normals, Real* uvs,
+                 const Reference<MappedFile>& storage);
+
+    virtual ~TriangleMesh();
+
+    /*!
+     * Síť není možné přímo protnout.
+     * \return false
+     */
+    virtual bool canIntersect() const override
+    { return false; }
+
+    /*! Nevolá se, síť je nejprve nutné rozložit metodou refine(). */
+    virtual bool intersect(const Ray& ray, Intersection& sr) override;
+
+    /*! Nevolá se, síť je nejprve nutné rozložit metodou refine(). */
+    virtual bool intersectP(const Ray& ray) override;
+
+    /*!
+     * Rozloží síť na jednotlivé trojúhelníky.
+     * \param refined std::vector, do kterého se trojúhelníky vloží
+     */
+    virtual void refine(std::vector<Reference<Primitive>>& refined) override;
+
+    /*!
+     * \copydoc Primitive::refineOnDemand()
+     * Ve výchozím stavu se síť rozkládá hned, viz setRefineOnDemand().
+     */
+    virtual bool refineOnDemand() const override
+    { return lazy; }
+
+    /*!
+     * Nastaví, jestli se má síť rozložit až při prvním průsečíku s jejím
+     * obalovým kvádrem. Síť pak dostane vlastní BVH (LazyPrimitive).
+     * \param onDemand jestli se má rozložení odložit
+     */
+    void setRefineOnDemand(bool onDemand)
+    { lazy = onDemand; }
+
+    /*! Obalová krychle všech vrcholů. */
+    virtual BBox bounds() const override;
+
+    /*!
+     * \copydoc Primitive::setTransform()
+     * Transformují se vrcholy a normály sítě. Trojúhelníky se odkazují do pole vrcholů,
+     * takže se změna projeví i v nich. Při prvním volání se uloží původní
+     * vrcholy, ze kterých se vychází i při dalších voláních.
+     */
+    virtual bool setTransform(const Transform& t) override;
+
+    /*!
+     * \return počet trojúhelníků sítě
+     */
+    size_t numTriangles() const
+    { return nIndices / 3; }
+
+    /*!
+     * \return počet vrcholů sítě
+     */
+    size_t numVertices() const
+    { return nVertices; }
+
+    /*!
+     * \return pole vrcholů sítě
+     */
+    const Vector* vertices() const
+    { return p; }
+
+    /*!
+     * \return pole indexů vrcholů, trojice tvoří trojúhelníky
+     */
+    const int* vertexIndices() const
+    { return indices; }
+
+    /*!
+     * \return pole normál ve vrcholech nebo nullptr, pokud je síť nemá
+     */
+    const Vector* vertexNormals() const
+    { return n; }
+
+    /*!
+     * \return pole texturových souřadnic (u, v) vrcholů nebo nullptr, pokud je síť nemá
+     */
+    const Real* vertexUVs() const
+    { return uv; }
+
+    /*!
+     * Vrátí vrchol trojúhelníku.
+     * \param tri index trojúhelníku
+     * \param i pořadí vrcholu v trojúhelníku (0 - 2)
+     */
+    const Vector& vertex(size_t tri, int i) const
+    { return p[indices[3 * tri + i]]; }
+
+    /*!
+     * Plocha zadaného trojúhelníku.
+     * \param tri index trojúhelníku
+     */
+    Real area(size_t tri) const;
+
+    /*!
+     * Rovnoměrně vybere bod na povrchu trojúhelníku.
+     * \param tri index trojúhelníku
+     * \param u1 náhodná hodnota z intervalu <0; 1)
+     * \param u2 náhodná hodnota z intervalu <0; 1)
+     * \param n slouží k návratu normály v bodě
+     * \return bod na povrchu trojúhelníku
+     */
+    Vector sample(size_t tri, Real u1, Real u2, Vector& n) const;
+
+private:
+    Vector* p; ///< Vrcholy sítě.
+    int* indices; ///< Indexy vrcholů trojúhelníků.
+    size_t nVertices; ///< Počet vrcholů.
+    size_t nIndices; ///< Počet indexů.
+    Vector* n; ///< Normály ve vrcholech, nullptr pokud je síť nemá.
+    Real* uv; ///< Texturové souřadnice vrcholů, nullptr pokud je síť nemá.
+    std::vector<Vector> ownedP; ///< Vlastní pole vrcholů, pokud síť nevznikla nad souborem.
+    std::vector<int> ownedIndices; ///< Vlastní pole indexů, pokud síť nevznikla nad souborem.
+    std::vector<Vector> ownedN; ///< Vlastní pole normál, pokud síť nevznikla nad souborem.
+    std::vector<Real> ownedUV; ///< Vlastní pole texturových souřadnic, pokud síť nevznikla nad souborem.
+    Reference<MappedFile> storage; ///< Soubor, do kterého ukazují pole sítě.
+    std::vector<Vector> objectP; ///< Původní vrcholy před transformací, prázdné dokud se síť nepřesunula.
+    std::vector<Vector> objectN; ///< Původní normály před transformací.
+    bool lazy; ///< Jestli se má síť rozložit až při prvním průsečíku.
+};
+
+/*!
+ * Jeden trojúhelník sítě. Vrcholy nekopíruje, drží pouze referenci na síť
+ * a svůj index v ní.
+ */
+class Triangle : public GeometricPrimitive
+{
+public:
+    /*!
+     * Konstruktor.
+     * \param mat materiál trojúhelníku
+     * \param mesh síť, do které trojúhelník patří
+     * \param n index trojúhelníku v síti
+     */
+    Triangle(const Reference<Material>& mat, const Reference<TriangleMesh>& mesh, size_t n);
+
+    virtual ~Triangle();
+
+    /*!
+     * Trojúhelník lze protnout přímo.
+     * \return true
+     */
+    virtual bool canIntersect() const override
+    { return true; }
+
+    /*! \copydoc Primitive::intersect() Využívá Möller-Trumbore algoritmu. */
+    virtual bool intersect(const Ray& ray, Intersection& sr) override;
+
+    /*! \copydoc Primitive::intersectP() */
+    virtual bool intersectP(const Ray& ray) override;
+
+    /*! Trojúhelník už dále nedělí. */
+    virtual void refine(std::vector<Reference<Primitive>>& refined) override
+    { return; }
+
+    virtual BBox bounds() const override;
+
+    /*!
+     * \return síť, do které trojúhelník patří
+     */
+    const TriangleMesh* triangleMesh() const
+    { return &*mesh; }
+
+    /*!
+     * \return index trojúhelníku v síti
+     */
+    size_t index() const
+    { return n; }
+
+    /*!
+     * Průsečík paprsku s trojúhelníkem zadaným vrcholy (Möller-Trumbore).
+     * \param p0 první vrchol
+     * \param p1 druhý vrchol
+     * \param p2 třetí vrchol
+     * \param ray paprsek
+     * \param t slouží k návratu parametru t průsečíku
+     * \param b1 slouží k návratu barycentrické souřadnice druhého vrcholu
+     * \param b2 slouží k návratu barycentrické souřadnice třetího vrcholu
+     * \return jestli paprsek trojúhelník protnul mezi ray.mint a ray.maxt
+     */
+    static bool hit(const Vector& p0, const Vector& p1, const Vector& p2, const Ray& ray,
+                    Real& t, Real& b1, Real& b2);
+
+    /*!
+     * Vyplní průsečík nalezený metodou hit(): interpolovanou normálu,
+     * texturové souřadnice a stopu paprsku, a zkrátí paprsek.
+     * \param p0 první vrchol
+     * \param p1 druhý vrchol
+     * \param p2 třetí vrchol
+     * \param normals normály ve vrcholech nebo nullptr (použije se normála roviny)
+     * \param uv texturové souřadnice vrcholů nebo nullptr (parametrizace (0,0), (1,0), (1,1))
+     * \param t parametr t průsečíku
+     * \param b1 barycentrická souřadnice druhého vrcholu
+     * \param b2 barycentrická souřadnice třetího vrcholu
+     * \param ray paprsek
+     * \param material materiál tělesa
+     * \param sr průsečík
+     */
+    static void shade(const Vector& p0, const Vector& p1, const Vector& p2, const Vector* normals,
+                      const Real (*uv)[2], Real t, Real b1, Real b2, const Ray& ray,
+                      const Reference<Material>& material, Intersection& sr);
+
+private:
+    /*!
+     * Výpočet průsečíku paprsku s rovinou trojúhelníku.
+     * \param ray paprsek
+     * \param t slouží k návratu parametru t průsečíku
+     * \param b1 slouží k návratu barycentrické souřadnice druhého vrcholu
+     * \param b2 slouží k návratu barycentrické souřadnice třetího vrcholu
+     * \return jestli paprsek trojúhelník protnul
+     */
+    bool hit(const Ray& ray, Real& t, Real& b1, Real& b2) const;
+
+    mutable Reference<TriangleMesh> mesh; ///< Síť, do které trojúhelník patří.
+    size_t n; ///< Index trojúhelníku v síti.
+};
+
+}
@@ -0,0 +1,15 @@
+#include "textures/constant.h"
+
+using namespace tracer;
+
+ConstantTexture::ConstantTexture(const RGBColor& color)
+    : color(color)
+{ }
+
+ConstantTexture::~ConstantTexture()
+{ }
+
+RGBColor ConstantTexture::evaluate(const Intersection& in) const
+{
+    return color;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "core/texture.h"
+
+namespace tracer
+{
+
+/*!
+ * Textura se stejnou barvou v celém povrchu.
+ */
+class ConstantTexture : public Texture
+{
+public:
+    /*!
+     * Konstruktor.
+     * \param color barva textury
+     */
+    ConstantTexture(const RGBColor& color);
+
+    virtual ~ConstantTexture();
+
+    /*! \copydoc Texture::evaluate() */
+    virtual RGBColor evaluate(const Intersection& in) const override;
+
+private:
+    RGBColor color; ///< Barva textury.
+};
+
+}
@@ -0,0 +1,347 @@
+#include "textures/image.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "core/imageio.h"
+
+using namespace tracer;
+
+namespace
+{
+
+const char MAGIC[8] = { 'T', 'R', 'T', 'E', 'X', 'T', 'R', '\0' };
+const uint32_t VERSION = 1;
+
+/// Velikost dlaždice v souboru v bajtech.
+const size_t TILE_BYTES = static_cast<size_t>(ImageTexture::TILE_SIZE) * ImageTexture::TILE_SIZE * 3 * sizeof(float);
+
+/// Nejvyšší počet dlaždic v jednom směru, který se vejde do klíče dlaždice.
+const int MAX_TILES = 1 << 17;
+
+/*!
+ * Hlavička souboru dlaždic, za ní následuje tabulka úrovní a dlaždice.
+ */
+struct Header
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t tileSize;
+    uint64_t key;
+    uint32_t nLevels;
+    uint32_t padding;
+    uint64_t fileSize;
+};
+
+inline uint64_t hashBytes(uint64_t h, const void* data, size_t size)
+{
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; ++i)
+        h = (h ^ bytes[i]) * 0x100000001B3ull;
+    return h;
+}
+
+/*!
+ * Přečte ze souboru přesně zadaný počet bajtů.
+ */
+bool readAt(int fd, void* data, size_t size, uint64_t offset)
+{
+    char* p = static_cast<char*>(data);
+    while (size > 0)
+    {
+        const ssize_t n = pread(fd, p, size, static_cast<off_t>(offset));
+        if (n <= 0)
+            return false;
+        p += n;
+        size -= static_cast<size_t>(n);
+        offset += static_cast<uint64_t>(n);
+    }
+    return true;
+}
+
+inline int wrap(int x, int size)
+{
+    x %= size;
+    return x < 0 ? x + size : x;
+}
+
+}
+
+ImageTexture::ImageTexture(const std::string& file, const Reference<TextureCache>& cache)
+    : fd(-1),
+      id(TextureCache::newTextureId() & 0xFFFFFF),
+      cache(cache),
+      failedReads(0)
+{
+    struct stat st;
+    if (stat(file.c_str(), &st) != 0)
+        throw std::runtime_error("Cannot open texture " + file);
+
+    const uint64_t size = static_cast<uint64_t>(st.st_size);
+    const int64_t time = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+    const uint32_t tileSize = TILE_SIZE;
+    uint64_t key = 0xCBF29CE484222325ull;
+    key = hashBytes(key, &VERSION, sizeof(VERSION));
+    key = hashBytes(key, &tileSize, sizeof(tileSize));
+    key = hashBytes(key, &size, sizeof(size));
+    key = hashBytes(key, &time, sizeof(time));
+    key ^= key >> 33;
+    key *= 0xFF51AFD7ED558CCDull;
+    key ^= key >> 33;
+
+    char name[32];
+    snprintf(name, sizeof(name), ".%016llx.tex", static_cast<unsigned long long>(key));
+    path = file + name;
+
+    if (open(key))
+        return;
+    build(file, path, key);
+    if (!open(key))
+        throw std::runtime_error("Invalid texture file " + path);
+}
+
+ImageTexture::~ImageTexture()
+{
+    if (fd >= 0)
+        close(fd);
+}
+
+/*!
+ * Úrovně se zmenšují na polovinu, dokud obě strany nemají jeden texel.
+ * Úroveň se zapisuje po řádcích dlaždic, v paměti jsou tak jen dvě úrovně
+ * najednou. Soubor se zapisuje pod dočasným jménem a nakonec se přejmenuje.
+ */
+void ImageTexture::build(const std::string& source, const std::string& path, uint64_t key)
+{
+    int width, height;
+    std::vector<RGBColor> image = readPFM(source.c_str(), width, height);
+
+    std::vector<LevelRecord> records;
+    for (int w = width, h = height; ; w = std::max(1, w / 2), h = std::max(1, h / 2))
+    {
+        LevelRecord r;
+        memset(&r, 0, sizeof(r));
+        r.width = w;
+        r.height = h;
+        r.tilesX = (w + TILE_SIZE - 1) / TILE_SIZE;
+        r.tilesY = (h + TILE_SIZE - 1) / TILE_SIZE;
+        if (r.tilesX >= MAX_TILES || r.tilesY >= MAX_TILES)
+            throw std::runtime_error("Texture " + source + " is too large");
+        records.push_back(r);
+        if (w == 1 && h == 1)
+            break;
+    }
+
+    uint64_t offset = sizeof(Header) + records.size() * sizeof(LevelRecord);
+    for (size_t l = 0; l < records.size(); ++l)
+    {
+        records[l].offset = offset;
+        offset += static_cast<uint64_t>(records[l].tilesX) * records[l].tilesY * TILE_BYTES;
+    }
+
+    Header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.tileSize = TILE_SIZE;
+    header.key = key;
+    header.nLevels = static_cast<uint32_t>(records.size());
+    header.fileSize = offset;
+
+    const std::string tmp = path + ".tmp" + std::to_string(getpid());
+    FILE* f = fopen(tmp.c_str(), "wb");
+    if (!f)
+        throw std::runtime_error("Cannot create " + tmp);
+
+    bool ok = fwrite(&header, sizeof(header), 1, f) == 1 &&
+              fwrite(records.data(), sizeof(LevelRecord), records.size(), f) == records.size();
+
+    std::vector<float> tile(TILE_BYTES / sizeof(float));
+    for (size_t l = 0; ok && l < records.size(); ++l)
+    {
+        const LevelRecord& r = records[l];
+        for (int ty = 0; ok && ty < r.tilesY; ++ty)
+        {
+            for (int tx = 0; ok && tx < r.tilesX; ++tx)
+            {
+                float* out = tile.data();
+                for (int y = 0; y < TILE_SIZE; ++y)
+                {
+                    const int sy = std::min(ty * TILE_SIZE + y, r.height - 1);
+                    for (int x = 0; x < TILE_SIZE; ++x)
+                    {
+                        const int sx = std::min(tx * TILE_SIZE + x, r.width - 1);
+                        const RGBColor& c = image[static_cast<size_t>(sy) * r.width + sx];
+                        *out++ = c.r;
+                        *out++ = c.g;
+                        *out++ = c.b;
+                    }
+                }
+                ok = fwrite(tile.data(), 1, TILE_BYTES, f) == TILE_BYTES;
+            }
+        }
+
+        if (l + 1 == records.size())
+            break;
+
+        // Další úroveň je průměrem čtveřic, lichý okrajový řádek nebo sloupec se vynechá.
+        const LevelRecord& next = records[l + 1];
+        std::vector<RGBColor> smaller(static_cast<size_t>(next.width) * next.height);
+        for (int y = 0; y < next.height; ++y)
+        {
+            const int y0 = std::min(2 * y, r.height - 1), y1 = std::min(2 * y + 1, r.height - 1);
+            for (int x = 0; x < next.width; ++x)
+            {
+                const int x0 = std::min(2 * x, r.width - 1), x1 = std::min(2 * x + 1, r.width - 1);
+                smaller[static_cast<size_t>(y) * next.width + x] =
+                    (image[static_cast<size_t>(y0) * r.width + x0] + image[static_cast<size_t>(y0) * r.width + x1] +
+                     image[static_cast<size_t>(y1) * r.width + x0] + image[static_cast<size_t>(y1) * r.width + x1]) * 0.25f;
+            }
+        }
+        image.swap(smaller);
+    }
+
+    ok = (fclose(f) == 0) && ok;
+    if (!ok || rename(tmp.c_str(), path.c_str()) != 0)
+    {
+        remove(tmp.c_str());
+        throw std::runtime_error("Cannot write " + path);
+    }
+}
+
+bool ImageTexture::open(uint64_t key)
+{
+    fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    Header h;
+    memset(&h, 0, sizeof(h));
+    bool valid = fstat(fd, &st) == 0 && readAt(fd, &h, sizeof(h), 0) &&
+                 memcmp(h.magic, MAGIC, sizeof(MAGIC)) == 0 && h.version == VERSION &&
+                 h.tileSize == static_cast<uint32_t>(TILE_SIZE) && h.key == key &&
+                 h.fileSize == static_cast<uint64_t>(st.st_size) && h.nLevels > 0 && h.nLevels < 64 &&
+                 h.nLevels <= (h.fileSize - sizeof(Header)) / sizeof(LevelRecord);
+    if (valid)
+    {
+        levels.resize(h.nLevels);
+        valid = readAt(fd, levels.data(), levels.size() * sizeof(LevelRecord), sizeof(h));
+    }
+
+    // Rozsahy úrovní se ověří hned, aby čtení dlaždic při vykreslování nemohlo selhat.
+    for (size_t l = 0; valid && l < levels.size(); ++l)
+    {
+        const LevelRecord& r = levels[l];
+        valid = r.width > 0 && r.height > 0 && r.tilesX == (r.width + TILE_SIZE - 1) / TILE_SIZE &&
+                r.tilesY == (r.height + TILE_SIZE - 1) / TILE_SIZE && r.tilesX < MAX_TILES && r.tilesY < MAX_TILES &&
+                r.offset <= h.fileSize &&
+                static_cast<uint64_t>(r.tilesX) * r.tilesY * TILE_BYTES <= h.fileSize - r.offset;
+    }
+    if (!valid)
+    {
+        levels.clear();
+        close(fd);
+        fd = -1;
+    }
+    return valid;
+}
+
+RGBColor ImageTexture::evaluate(const Intersection& in) const
+{
+    // Stopa o šířce jednoho texelu úrovně l má v texturových souřadnicích šířku 2^l / rozměr.
+    Real lod = 0.f;
+    if (in.footprint > 0.f)
+        lod = std::log2(in.footprint * std::max(width(), height()));
+    lod = std::min(std::max(lod, 0.f), static_cast<Real>(levels.size() - 1));
+
+    const int level = static_cast<int>(lod);
+    const Real fraction = lod - level;
+    const RGBColor c = bilinear(level, in.u, in.v);
+    if (fraction <= 0.f || level + 1 >= numLevels())
+        return c;
+    return c * (1.f - fraction) + bilinear(level + 1, in.u, in.v) * fraction;
+}
+
+RGBColor ImageTexture::bilinear(int level, Real u, Real v) const
+{
+    if (!std::isfinite(u) || !std::isfinite(v))
+        return BLACK;
+
+    // Souřadnice se nejprve zabalí do [0; 1), aby převod na int nepřetekl.
+    const LevelRecord& r = levels[level];
+    const Real x = (u - std::floor(u)) * r.width - 0.5f;
+    const Real y = (1.f - (v - std::floor(v))) * r.height - 0.5f;
+    const int x0 = static_cast<int>(std::floor(x));
+    const int y0 = static_cast<int>(std::floor(y));
+    const Real dx = x - x0;
+    const Real dy = y - y0;
+
+    return texel(level, x0, y0) * ((1.f - dx) * (1.f - dy)) +
+           texel(level, x0 + 1, y0) * (dx * (1.f - dy)) +
+           texel(level, x0, y0 + 1) * ((1.f - dx) * dy) +
+           texel(level, x0 + 1, y0 + 1) * (dx * dy);
+}
+
+/*!
+ * \return čítač nepřečtených dlaždic všech textur
+ */
+static std::atomic<size_t>& failedReadCounter()
+{
+    static std::atomic<size_t> counter(0);
+    return counter;
+}
+
+size_t ImageTexture::totalFailedReads()
+{
+    return failedReadCounter().load();
+}
+
+RGBColor ImageTexture::texel(int level, int x, int y) const
+{
+    const LevelRecord& r = levels[level];
+    x = wrap(x, r.width);
+    y = wrap(y, r.height);
+    const int tx = x / TILE_SIZE;
+    const int ty = y / TILE_SIZE;
+
+    const uint64_t key = (id << 40) | (static_cast<uint64_t>(level) << 34) |
+                         (static_cast<uint64_t>(ty) << 17) | static_cast<uint64_t>(tx);
+    Reference<TextureTile> tile;
+    try
+    {
+        tile = cache->tile(key, [this, level, tx, ty](size_t& size) {
+            return load(level, tx, ty, size);
+        });
+    }
+    catch (const std::runtime_error&)
+    {
+        // Dlaždice se do cache nevloží, příští přístup čtení zopakuje.
+        failedReads.fetch_add(1);
+        failedReadCounter().fetch_add(1);
+        return RGBColor();
+    }
+    return tile->texels[static_cast<size_t>(y % TILE_SIZE) * TILE_SIZE + x % TILE_SIZE];
+}
+
+TextureTile* ImageTexture::load(int level, int tx, int ty, size_t& size) const
+{
+    const LevelRecord& r = levels[level];
+    std::vector<float> data(TILE_BYTES / sizeof(float));
+    const uint64_t offset = r.offset + (static_cast<uint64_t>(ty) * r.tilesX + tx) * TILE_BYTES;
+    if (!readAt(fd, data.data(), TILE_BYTES, offset))
+        throw std::runtime_error("Cannot read " + path);
+
+    TextureTile* tile = new TextureTile(TILE_SIZE);
+    for (size_t i = 0; i < tile->texels.size(); ++i)
+        tile->texels[i] = RGBColor(data[3 * i], data[3 * i + 1], data[3 * i + 2]);
+    size = sizeof(TextureTile) + tile->texels.size() * sizeof(RGBColor);
+    return tile;
+}
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "core/texture.h"
+#include "core/texturecache.h"
+
+namespace tracer
+{
+
+/*!
+ * Textura z obrázku PFM, uložená jako MIP pyramida rozdělená na dlaždice.
+ *
+ * Při prvním použití obrázku se pyramida sestaví (každá úroveň je průměrem
+ * čtveřic texelů předchozí) a zapíše vedle obrázku do souboru dlaždic,
+ * příště se obrázek vůbec nenačítá. Dlaždice se čtou ze souboru až při
+ * vyhodnocení textury do TextureCache s pevným rozpočtem, v paměti tak
+ * zůstává jen tabulka úrovní a čte se jen to, co je vidět, v úrovni
+ * detailu, ve které je to vidět.
+ *
+ * Úroveň se volí podle šířky stopy paprsku v texturových souřadnicích
+ * (Intersection::footprint), mezi sousedními úrovněmi se interpoluje
+ * a v rámci úrovně se filtruje bilineárně (trilineární filtrování). Textura
+ * se opakuje, v = 0 odpovídá spodnímu okraji obrázku.
+ *
+ * Dlaždice, kterou při vykreslování nejde přečíst, se vyhodnotí jako černá
+ * a počítá ji numFailedReads(), resp. za všechny textury totalFailedReads(),
+ * výjimka by ukončila vykreslovací vlákno i proces. Do cache se nevloží,
+ * další přístup se o přečtení pokusí znovu.
+ *
+ * Formát souboru: hlavička, tabulka úrovní a dlaždice úrovní po řádcích,
+ * každá o TILE_SIZE x TILE_SIZE texelech RGB (float). Krajní dlaždice jsou
+ * doplněné opakováním okraje, všechny mají stejnou velikost. Soubor je
+ * vázán na obrázek klíčem v hlavičce i ve jméně souboru.
+ */
+class ImageTexture : public Texture
+{
+public:
+    /// Délka strany dlaždice v texelech.
+    static const int TILE_SIZE = 64;
+
+    /*!
+     * Otevře soubor dlaždic obrázku, pokud chybí nebo neodpovídá, vytvoří
+     * ho. Při chybě vyhodí výjimku std::runtime_error.
+     * \param file cesta k obrázku PFM
+     * \param cache cache dlaždic
+     */
+    ImageTexture(const std::string& file, const Reference<TextureCache>& cache = TextureCache::shared());
+
+    virtual ~ImageTexture();
+
+    ImageTexture(const ImageTexture&) = delete;
+    ImageTexture& operator=(const ImageTexture&) = delete;
+
+    /*! \copydoc Texture::evaluate() */
+    virtual RGBColor evaluate(const Intersection& in) const override;
+
+    /*!
+     * Vrátí texel zadané úrovně, souřadnice se opakují.
+     * \param level úroveň pyramidy, 0 je plné rozlišení
+     * \param x sloupec
+     * \param y řádek od horního okraje
+     */
+    RGBColor texel(int level, int x, int y) const;
+
+    /*!
+     * Bilineárně filtrovaná hodnota úrovně.
+     * \param level úroveň pyramidy
+     * \param u vodorovná texturová souřadnice
+     * \param v svislá texturová souřadnice
+     */
+    RGBColor bilinear(int level, Real u, Real v) const;
+
+    /*! \return šířka obrázku */
+    int width() const
+    { return levels[0].width; }
+
+    /*! \return výška obrázku */
+    int height() const
+    { return levels[0].height; }
+
+    /*! \return počet úrovní pyramidy */
+    int numLevels() const
+    { return static_cast<int>(levels.size()); }
+
+    /*! \return kolikrát se dlaždici nepodařilo přečíst */
+    size_t numFailedReads() const
+    { return failedReads.load(); }
+
+    /*! \return kolikrát se nepodařilo přečíst dlaždici kterékoli textury od spuštění procesu */
+    static size_t totalFailedReads();
+
+private:
+    /*!
+     * Záznam tabulky úrovní, v souboru i v paměti.
+     */
+    struct LevelRecord
+    {
+        int32_t width; ///< Šířka úrovně v texelech.
+        int32_t height; ///< Výška úrovně v texelech.
+        int32_t tilesX; ///< Počet dlaždic v řádku.
+        int32_t tilesY; ///< Počet řádků dlaždic.
+        uint64_t offset; ///< Pozice první dlaždice v souboru.
+    };
+
+    /*!
+     * Sestaví pyramidu obrázku a zapíše soubor dlaždic.
+     * \param source cesta k obrázku
+     * \param path cesta k souboru dlaždic
+     * \param key klíč souboru
+     */
+    static void build(const std::string& source, const std::string& path, uint64_t key);
+
+    /*!
+     * Otevře soubor dlaždic a načte tabulku úrovní.
+     * \return jestli je soubor platný
+     */
+    bool open(uint64_t key);
+
+    /*!
+     * Načte dlaždici ze souboru. Při chybě vyhodí výjimku std::runtime_error.
+     * \param level úroveň
+     * \param tx sloupec dlaždice
+     * \param ty řádek dlaždice
+     * \param size slouží k návratu velikosti dlaždice v paměti
+     */
+    TextureTile* load(int level, int tx, int ty, size_t& size) const;
+
+    std::string path; ///< Soubor dlaždic.
+    int fd; ///< Otevřený soubor dlaždic.
+    uint64_t id; ///< Identifikátor textury v cache.
+    std::vector<LevelRecord> levels; ///< Tabulka úrovní.
+    mutable Reference<TextureCache> cache; ///< Cache dlaždic.
+    mutable std::atomic<size_t> failedReads; ///< Počet nepřečtených dlaždic.
+};
+
+}
@@ -0,0 +1,32 @@
+#include "writers/pfmwriter.h"
+
+using namespace tracer;
+
+PFMWriter::PFMWriter(const char* file, const Film& film)
+    : ImageWriter(film)
+{
+    open(file);
+}
+
+PFMWriter::~PFMWriter()
+{ }
+
+/*!
+ * Záporné měřítko v hlavičce značí little-endian data.
+ */
+std::string PFMWriter::header() const
+{
+    const unsigned int one = 1;
+    const bool littleEndian = *reinterpret_cast<const unsigned char*>(&one) == 1;
+
+    return "PF\n" + std::to_string(film.width) + " " + std::to_string(film.height) +
+           (littleEndian ? "\n-1.0\n" : "\n1.0\n");
+}
+
+void PFMWriter::convertRow(const Real* rgb, unsigned char* out) const
+{
+    const size_t n = static_cast<size_t>(film.width) * 3;
+    float* row = reinterpret_cast<float*>(out);
+    for (size_t i = 0; i < n; ++i)
+        row[i] = static_cast<float>(rgb[i]);
+}
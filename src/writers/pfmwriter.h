@@ -0,0 +1,40 @@
+#pragma once
+
+#include "core/imagewriter.h"
+
+namespace tracer
+{
+
+/*!
+ * Zápis obrázku ve formátu PFM (Portable Float Map). Hodnoty se ukládají
+ * bez úprav jako 32bitová čísla s plovoucí čárkou v pořadí bajtů hostitele.
+ */
+class PFMWriter : public ImageWriter
+{
+public:
+    /*!
+     * Konstruktor. Otevře soubor a zapíše hlavičku.
+     * \param file cesta k souboru
+     * \param film film, ze kterého se obrázek zapisuje
+     */
+    PFMWriter(const char* file, const Film& film);
+
+    virtual ~PFMWriter();
+
+protected:
+    /*! \copydoc ImageWriter::header() */
+    virtual std::string header() const override;
+
+    /*! \copydoc ImageWriter::bytesPerPixel() */
+    virtual size_t bytesPerPixel() const override
+    { return 3 * sizeof(float); }
+
+    /*! \copydoc ImageWriter::bottomUp() */
+    virtual bool bottomUp() const override
+    { return true; }
+
+    /*! \copydoc ImageWriter::convertRow() */
+    virtual void convertRow(const Real* rgb, unsigned char* out) const override;
+};
+
+}
@@ -0,0 +1,64 @@
+#include "writers/ppmwriter.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+using namespace tracer;
+
+namespace
+{
+
+/// Bity čísla 2^-24, začátku tabulky gamma křivky.
+const uint32_t TABLE_MIN_BITS = (127u - PPM_GAMMA_OCTAVES) << 23;
+
+/// Počet bitů mantisy pod bity určujícími úsek oktávy.
+const int STEP_SHIFT = 23 - 4;
+
+static_assert(PPM_GAMMA_STEPS == 1 << (23 - STEP_SHIFT), "PPM_GAMMA_STEPS must match STEP_SHIFT");
+
+}
+
+PPMWriter::PPMWriter(const char* file, const Film& film)
+    : ImageWriter(film)
+{
+    for (int i = 0; i < TABLE_SIZE; ++i)
+    {
+        int octave = i / PPM_GAMMA_STEPS - PPM_GAMMA_OCTAVES;
+        int step = i % PPM_GAMMA_STEPS;
+        Real lo = std::ldexp(1.f + static_cast<Real>(step) / PPM_GAMMA_STEPS, octave);
+        Real hi = std::ldexp(1.f + static_cast<Real>(step + 1) / PPM_GAMMA_STEPS, octave);
+        Real glo = std::pow(lo, film.invGamma);
+        base[i] = 255.f * glo + 0.5f;
+        slope[i] = 255.f * (std::pow(hi, film.invGamma) - glo);
+    }
+
+    open(file);
+}
+
+PPMWriter::~PPMWriter()
+{ }
+
+std::string PPMWriter::header() const
+{
+    return "P6\n" + std::to_string(film.width) + " " + std::to_string(film.height) + "\n255\n";
+}
+
+void PPMWriter::convertRow(const Real* rgb, unsigned char* out) const
+{
+    const Real minValue = std::ldexp(1.f, -PPM_GAMMA_OCTAVES);
+    const size_t n = static_cast<size_t>(film.width) * 3;
+
+    for (size_t i = 0; i < n; ++i)
+    {
+        // Porovnání je zapsané tak, aby se NaN převedlo na nulu.
+        Real v = min(rgb[i] > minValue ? rgb[i] : minValue, ONE_MINUS_EPSILON);
+
+        uint32_t bits;
+        std::memcpy(&bits, &v, sizeof(bits));
+        uint32_t index = (bits - TABLE_MIN_BITS) >> STEP_SHIFT;
+        Real t = static_cast<Real>((bits >> (STEP_SHIFT - 8)) & 0xff) * (1.f / 256.f);
+
+        out[i] = static_cast<unsigned char>(base[index] + slope[index] * t);
+    }
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "core/imagewriter.h"
+
+#define PPM_GAMMA_OCTAVES 24
+#define PPM_GAMMA_STEPS 16
+
+namespace tracer
+{
+
+/*!
+ * Zápis obrázku ve formátu PPM (binární varianta P6, 8 bitů na složku).
+ * Hodnoty se omezí na interval <0; 1> a převedou gamma křivkou s exponentem
+ * Film::invGamma.
+ *
+ * Převod nevolá pro každou složku funkci pow. Křivka je předpočítaná po
+ * úsecích lineárně: rozsah <2^-24; 1) je rozdělen na oktávy podle exponentu
+ * čísla a každá oktáva na PPM_GAMMA_STEPS dílů podle horních bitů mantisy.
+ * Index úseku i poloha v něm se tak získají přímo z bitů čísla a smyčka
+ * převodu nemá žádné větvení.
+ */
+class PPMWriter : public ImageWriter
+{
+public:
+    /*!
+     * Konstruktor. Otevře soubor a zapíše hlavičku.
+     * \param file cesta k souboru
+     * \param film film, ze kterého se obrázek zapisuje
+     */
+    PPMWriter(const char* file, const Film& film);
+
+    virtual ~PPMWriter();
+
+protected:
+    /*! \copydoc ImageWriter::header() */
+    virtual std::string header() const override;
+
+    /*! \copydoc ImageWriter::bytesPerPixel() */
+    virtual size_t bytesPerPixel() const override
+    { return 3; }
+
+    /*! \copydoc ImageWriter::bottomUp() */
+    virtual bool bottomUp() const override
+    { return false; }
+
+    /*! \copydoc ImageWriter::convertRow() */
+    virtual void convertRow(const Real* rgb, unsigned char* out) const override;
+
+private:
+    static const int TABLE_SIZE = PPM_GAMMA_OCTAVES * PPM_GAMMA_STEPS;
+
+    Real base[TABLE_SIZE]; ///< Hodnota výstupu (0 - 255) na začátku úseku, včetně +0.5 pro zaokrouhlení.
+    Real slope[TABLE_SIZE]; ///< Přírůstek výstupu přes celý úsek.
+};
+
+}